@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+// Direct-mapped cache from a raw IPv4/IPv6 address to its text form, so the
+// few addresses that dominate a link are rendered once and then copied.
+//
+// Entries are one cache line each and guarded by a per-entry sequence lock:
+// lookups never block or write shared state other than the hit counters,
+// and a lookup racing with a refill of the same slot simply misses. Any
+// number of threads may use one cache.
+//
+// With assign_ids, lookups can also return a dictionary ID: distinct
+// addresses are numbered from 1 in order of first request. IDs are stable
+// for the life of the cache; past MAX_IDS addresses lookups return 0.
+class AddressCache
+{
+public:
+    struct Stats
+    {
+        uint64_t lookups;
+        uint64_t hits;
+        uint64_t uncached;     // text too long for an entry
+        uint64_t ids_assigned;
+
+        Stats() : lookups(0), hits(0), uncached(0), ids_assigned(0) {}
+        double hitRate() const { return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0; }
+    };
+
+    static const size_t DEFAULT_ENTRIES = 4096;
+    static const size_t MAX_TEXT_LENGTH = 46; // INET6_ADDRSTRLEN, including the terminator
+    static const uint32_t MAX_IDS = 1u << 24;
+
+    // entries is rounded up to a power of two
+    explicit AddressCache(size_t entries = DEFAULT_ENTRIES, bool assign_ids = false);
+    AddressCache(const AddressCache &) = delete;
+    AddressCache &operator=(const AddressCache &) = delete;
+
+    // Writes the text of a family 4 or 6 address to text (MAX_TEXT_LENGTH
+    // bytes, not terminated) and returns its length, 0 for an unset address.
+    // When id is given and IDs are enabled, also stores the address's ID.
+    size_t lookup(uint8_t family, const uint8_t *bytes, char *text, uint32_t *id = nullptr);
+
+    Stats getStats() const;
+
+    // Process-wide cache used by the parser and the output formatters
+    static AddressCache &shared();
+
+private:
+    static const size_t ENTRY_TEXT_BYTES = 40;
+
+    struct alignas(64) Entry
+    {
+        // Sequence number (low 32 bits, odd while the entry is written),
+        // family (bits 32-39) and text length (bits 40-47)
+        std::atomic<uint64_t> state;
+        std::atomic<uint64_t> key[2];
+        std::atomic<uint64_t> text[ENTRY_TEXT_BYTES / 8];
+    };
+
+    std::unique_ptr<Entry[]> entries_;
+    std::unique_ptr<std::atomic<uint32_t>[]> ids_; // parallel to entries_, covered by their sequence
+    size_t mask_;
+    bool assign_ids_;
+
+    alignas(64) std::atomic<uint64_t> lookups_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> uncached_;
+
+    mutable std::mutex dictionary_mutex_;
+    std::unordered_map<std::string, uint32_t> dictionary_;
+
+    bool read(const Entry &entry, size_t index, uint8_t family, const uint64_t *key, char *text, size_t &length,
+              uint32_t &id) const;
+    void write(Entry &entry, size_t index, uint8_t family, const uint64_t *key, const char *text, size_t length,
+               uint32_t id);
+    uint32_t assignId(uint8_t family, const uint8_t *bytes);
+};
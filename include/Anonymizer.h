@@ -0,0 +1,98 @@
+#pragma once
+
+#include "FeatureStage.h"
+#include "CryptoPAn.h"
+#include "AddressCache.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Identifier classes Anonymizer can rewrite (bitmask)
+enum AnonymizeField : uint32_t
+{
+    ANONYMIZE_ADDRESSES = 1u << 0,  // ip: source/destination and inner tunnel addresses
+    ANONYMIZE_PORTS = 1u << 1,      // ports: transport ports, outer and inner
+    ANONYMIZE_IP_ID = 1u << 2,      // ipid: IPv4 identification and fragment IDs
+    ANONYMIZE_FLOW_LABEL = 1u << 3, // flowlabel: IPv6 flow label
+    ANONYMIZE_TUNNEL_ID = 1u << 4   // tunnelid: VXLAN/GENEVE VNI, GRE key
+};
+
+// Rewrites identifiers of every row under a secret 32-byte key, for datasets
+// that leave the site. Runs after the stages that need the real addresses
+// (enrichment, labels, host windows), so their columns stay meaningful.
+//
+// Addresses are mapped with CryptoPAn, which keeps subnet structure: hosts
+// sharing a prefix still share one of the same length. The other identifiers
+// go through keyed permutations (a four-round Feistel network with a
+// SipHash-2-4 round function) of their own width, so distinct values stay
+// distinct and a flow keeps one value; 16-bit fields use precomputed tables.
+// Header checksums are adjusted for the rewritten IPv4 fields, so a checksum
+// that verified still does and one that did not still does not.
+//
+// Rows carry addresses as bytes and text, so the stage memoizes both per
+// raw address in a direct-mapped table; a host seen before costs one probe
+// and a copy, and only new hosts reach CryptoPAn and the text formatter.
+//
+// The key is read from a file (64 hex digits) or drawn per run; the same key
+// maps a host to the same value across captures. The field permutation keys
+// are derived from it by encrypting constants.
+class Anonymizer : public FeatureStage
+{
+public:
+    static const size_t MEMO_ENTRIES = 1u << 15;
+
+    struct Stats
+    {
+        uint64_t rows;
+        uint64_t addresses;
+        uint64_t memo_hits;
+        CryptoPAn::Stats cryptopan; // addresses missing the memo
+    };
+
+    // "ip,ports,ipid,flowlabel,tunnelid" or "all"
+    static bool parseFields(const std::string &spec, uint32_t &fields, std::string &error);
+
+    // key_file empty = random key for this run
+    Anonymizer(uint32_t fields, const std::string &key_file);
+
+    // Reads or draws the key; false (see getLastError) on a bad key file
+    bool start();
+
+    void process(PacketRecord &record, Arena &arena) override;
+
+    std::string getName() const override { return "anonymize"; }
+    std::string getSummary() const override;
+    Stats getStats() const;
+    std::string getLastError() const { return last_error_; }
+
+    // Keyed permutation of the low bits (even, 2-32) of value
+    static uint32_t permute(const uint64_t *key, uint32_t value, int bits);
+
+private:
+    // Anonymized form and text of one raw address
+    struct MemoEntry
+    {
+        uint64_t key[2];
+        uint8_t family; // 0 = free
+        uint8_t text_length;
+        uint8_t bytes[16];
+        char text[AddressCache::MAX_TEXT_LENGTH];
+    };
+
+    uint32_t fields_;
+    std::string key_file_;
+    std::string last_error_;
+    std::unique_ptr<CryptoPAn> cryptopan_;
+    uint64_t flow_label_key_[2];
+    uint64_t tunnel_id_key_[2];
+    uint64_t fragment_id_key_[2]; // IPv6 fragment IDs (32 bits)
+    std::vector<uint16_t> port_table_;
+    std::vector<uint16_t> ip_id_table_;
+    std::vector<MemoEntry> memo_;
+    uint64_t rows_;
+    uint64_t addresses_;
+    uint64_t memo_hits_;
+
+    void anonymizeAddress(IpAddress &address, std::string_view &text, Arena &arena);
+};
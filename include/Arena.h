@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Monotonic allocator for data that lives exactly as long as one batch.
+// Allocation bumps an offset inside the current block; reset() rewinds to
+// the first block in O(1) and keeps every block, so once the arena has
+// grown to the size of a typical batch it stops calling the heap. Nothing
+// allocated here is destroyed individually: only trivially destructible
+// data (bytes, text) belongs in an arena.
+class Arena
+{
+public:
+    struct Stats
+    {
+        uint64_t allocations;       // allocate() calls since construction
+        uint64_t bytes_allocated;   // bytes handed out since construction
+        uint64_t block_allocations; // heap allocations made for blocks
+        uint64_t resets;
+        size_t bytes_reserved;      // total size of all blocks
+        size_t peak_bytes;          // most bytes in use between two resets
+
+        Stats() : allocations(0), bytes_allocated(0), block_allocations(0), resets(0),
+                  bytes_reserved(0), peak_bytes(0) {}
+    };
+
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    std::string_view copyString(const char *data, size_t size);
+    const uint8_t *copyBytes(const uint8_t *data, size_t size);
+    void reset();
+
+    size_t bytesUsed() const { return used_; }
+    Stats getStats() const;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t block_size_;
+    size_t current_; // index of the block being filled
+    size_t offset_;  // next free byte in blocks_[current_]
+    size_t used_;
+    Stats stats_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "OutputSink.h"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Recycles PacketBatch objects once every sink has dropped them. A batch
+// returned by acquire() is empty (rows and columns cleared, arena reset) but
+// keeps the capacity it grew to, so steady-state capture allocates nothing
+// per batch. Only the capture thread calls acquire(); sinks hand batches back
+// simply by releasing their shared_ptr.
+class BatchPool
+{
+public:
+    struct Stats
+    {
+        uint64_t batches;  // distinct batches created
+        uint64_t acquired;
+        uint64_t reused;
+        Arena::Stats arena; // summed over all batches, peak_bytes is the largest
+
+        Stats() : batches(0), acquired(0), reused(0) {}
+    };
+
+    explicit BatchPool(size_t rows_per_batch);
+
+    std::shared_ptr<PacketBatch> acquire();
+    Stats getStats() const;
+
+private:
+    size_t rows_per_batch_;
+    std::vector<std::shared_ptr<PacketBatch>> batches_;
+    size_t next_; // where the search for a free batch starts
+    uint64_t acquired_;
+    uint64_t reused_;
+};
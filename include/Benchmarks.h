@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Offline self-checks and timings run from the command line; they need no
+// capture interface. Each returns a process exit code.
+
+// --bench-kernels: validates every payload byte-counting kernel the CPU
+// supports against the scalar one on randomized payloads, then reports
+// nanoseconds per byte for each.
+int runKernelBenchmark(size_t packet_count);
+
+// --bench-writer: writes megabytes of CSV rows into directory through each
+// writer backend (posix and io_uring, with and without O_DIRECT), checks
+// that all produce the same file and reports MB/s for formatted rows and
+// for the backend alone.
+int runWriterBenchmark(size_t megabytes, const std::string &directory);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "AddressCache.h"
+#include <fstream>
+
+// Block-columnar binary dataset. Every batch becomes one block in which each
+// column is stored contiguously, so readers can load a single column without
+// parsing whole rows.
+//
+//   file header : "NDAB" u16 version, u16 column count,
+//                 then per column: u8 type, u8 name length, name bytes
+//   block       : u32 row count, then every column in header order
+//                 fixed-width column -> row count values
+//                 string column      -> (row count + 1) u32 offsets, bytes
+//
+// Integers are little-endian. Fields that do not apply to a row's IP
+// version are written as zero / empty. packet_flags holds the
+// FeatureColumns::PacketFlag bits. src_address_id / dst_address_id number
+// the distinct addresses from 1 in order of first appearance; numbering
+// starts again for each run, including runs appending to an existing file.
+class BinarySink : public OutputSink
+{
+public:
+    enum class ColumnType : uint8_t
+    {
+        U8 = 1,
+        U16 = 2,
+        U32 = 3,
+        I64 = 4,
+        STRING = 5
+    };
+
+    static const uint16_t FORMAT_VERSION = 2;
+
+    explicit BinarySink(const std::string &filename);
+    ~BinarySink();
+
+    bool open() override;
+    bool consume(const PacketBatch &batch) override;
+    void close() override;
+
+    std::string getName() const override;
+    std::string getLastError() const override;
+    std::string getSummary() const override;
+    bool wantsColumns() const override { return true; }
+
+private:
+    std::string filename_;
+    std::ofstream file_;
+    std::string last_error_;
+    std::string block_;
+    FeatureColumns scratch_;
+    AddressCache addresses_; // text and dictionary IDs for this file
+    std::vector<uint32_t> src_ids_;
+    std::vector<uint32_t> dst_ids_;
+
+    static std::string buildFileHeader();
+    void encodeBlock(const PacketBatch &batch);
+};
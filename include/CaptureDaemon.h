@@ -0,0 +1,119 @@
+#pragma once
+
+#include "CaptureSession.h"
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Long-running capture service. Clients connect to a Unix-domain socket and
+// send one JSON object per line; each request gets one JSON line back.
+//
+//   {"cmd":"start","id":"c1","output":"/data/c1.csv","interface":"auto",
+//    "filter":"both","duration":30,"promiscuous":"on","stream":"/tmp/c1.sock",
+//    "sinks":"csv:/data/c1-v6.csv:ipv6,binary:/data/c1.bin","columns":"fragment,tunnel",
+//    "tunnelDepth":2,"ring":30,"ringMegabytes":64,"ringTriggerPps":50000,"writer":"uring",
+//    "durability":"periodic:500","backpressure":"spill","queueMegabytes":256,
+//    "enrich":"asn=/data/asn.txt,subnet=/data/subnets.txt","labels":"/data/labels.rules",
+//    "anonymize":"ip,ports","anonymizeKey":"/etc/capture/anon.key"}
+//   {"cmd":"start","id":"tap","output":"/data/tap.csv","interface":"eth1,eth2",
+//    "reorderMs":100,"reorderMegabytes":64,"dedupMs":50}   both sides of a tap, merged,
+//                                                          mirror copies dropped
+//   {"cmd":"start","id":"ds","output":"/data/ds.csv","split":"train=0.8,test=0.2",
+//    "splitSeed":7,"indexRows":4096}   ds-train.csv and ds-test.csv, each flow in one of
+//                                      them, each with a time index
+//   {"cmd":"stop","id":"c1"}      stop one capture (all when id is omitted)
+//   {"cmd":"dump","id":"c1"}      write the capture's packet ring to pcapng
+//   {"cmd":"status"}              state of every known capture
+//   {"cmd":"stats","id":"c1"}     packet counters
+//   {"cmd":"wait","id":"c1"}      reply once the capture has finished
+//   {"cmd":"interfaces"}          same document as --list-interfaces
+//
+// Opened pcap handles (with their compiled filters) are parked after a
+// capture finishes and reused by the next capture on the same interface.
+class CaptureDaemon
+{
+public:
+    static const char *const DEFAULT_SOCKET_PATH;
+    // Finished captures kept for status and wait requests
+    static const size_t MAX_FINISHED_CAPTURES = 32;
+
+    explicit CaptureDaemon(const std::string &socket_path, const std::string &output_dir = "");
+    ~CaptureDaemon();
+
+    int run();
+
+private:
+    struct ManagedCapture
+    {
+        std::string id;
+        std::string state; // starting, running, finished, failed
+        std::string error;
+        std::unique_ptr<CaptureSession> session;
+        std::thread worker;
+        uint64_t finish_sequence = 0; // order in which captures ended, 0 while active
+
+        bool isActive() const { return state == "starting" || state == "running"; }
+    };
+
+    struct ClientConnection
+    {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> done;
+
+        ClientConnection() : fd(-1), done(false) {}
+    };
+
+    typedef std::map<std::string, std::string> Request;
+
+    std::string socket_path_;
+    std::string output_dir_;
+    int listen_fd_;
+    std::atomic<bool> shutting_down_;
+
+    std::mutex mutex_;
+    std::condition_variable state_changed_;
+    std::map<std::string, std::shared_ptr<ManagedCapture>> captures_;
+    uint64_t finished_count_;
+    std::map<std::string, std::vector<std::unique_ptr<PacketCapturer>>> idle_handles_;
+    std::string auto_interface_;
+
+    std::vector<std::unique_ptr<ClientConnection>> clients_;
+
+    bool openSocket();
+    void acceptClient();
+    void reapClients(bool wait_all);
+    void serveClient(ClientConnection *client);
+    std::string handleRequest(const std::string &line);
+
+    std::string startCapture(const Request &request);
+    std::string stopCapture(const Request &request);
+    std::string dumpRing(const Request &request);
+    std::string describeCaptures(const Request &request, bool include_stats);
+    std::string waitForCapture(const Request &request);
+    std::string describeCapture(const ManagedCapture &capture, bool include_stats) const;
+
+    void runCapture(std::shared_ptr<ManagedCapture> capture);
+    // Joins and forgets the oldest finished captures beyond
+    // MAX_FINISHED_CAPTURES; called with mutex_ held
+    void pruneFinishedCaptures();
+    void stopAllCaptures();
+    // Absolute path of requested, which must lie in output_dir_ when one is set
+    bool resolveOutputPath(const std::string &requested, std::string &resolved, std::string &error,
+                           const char *what = "Output") const;
+    // Absolute path of a live stream socket, which must lie in the directory
+    // of the control socket
+    bool resolveSocketPath(const std::string &requested, std::string &resolved, std::string &error) const;
+    // requested (relative to base_dir) resolved inside base_dir; false when outside
+    static bool confinePath(const std::string &base_dir, const std::string &requested, std::string &resolved);
+    std::unique_ptr<PacketCapturer> acquireHandle(const std::string &interface_name, bool promiscuous);
+    void parkHandle(std::unique_ptr<PacketCapturer> capturer);
+
+    static std::string handleKey(const std::string &interface_name, bool promiscuous);
+    static std::string errorResponse(const std::string &message);
+};
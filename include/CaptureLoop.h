@@ -0,0 +1,96 @@
+#pragma once
+
+#include "PacketCapturer.h"
+#include <string>
+#include <atomic>
+#include <functional>
+
+// Drives a PacketCapturer until the capture should end. On Linux the loop
+// waits on the pcap selectable fd together with a timerfd (duration), a
+// signalfd (SIGINT/SIGTERM), an inotify watch (stop file) and an eventfd
+// (requestStop), so no helper threads or per-packet clock reads are needed.
+// Other platforms fall back to a pcap_dispatch loop that checks the same
+// conditions between dispatch calls.
+class CaptureLoop
+{
+public:
+    enum class StopReason
+    {
+        NONE,
+        DURATION,
+        SIGNAL,
+        STOP_FILE,
+        REQUESTED,
+        CAPTURE_ERROR
+    };
+
+    explicit CaptureLoop(PacketCapturer &capturer);
+    ~CaptureLoop();
+
+    void setDuration(int seconds);
+    void setStopFile(const std::string &path);
+    void setHandleSignals(bool enable);
+    // Runs on the loop thread after every dispatch call, i.e. once per burst
+    // of packets handed over by pcap (used to hand off partial batches).
+    void setDispatchCompleteCallback(std::function<void()> callback);
+    // Also runs the dispatch-complete callback every milliseconds while no
+    // packets arrive (0 = off). The polling loop returns from dispatch at
+    // least once per pcap read timeout anyway.
+    void setTickInterval(int milliseconds);
+    // Runs on the loop thread for requestTrigger() and, with signal handling
+    // on, for SIGUSR1 (see blockTriggerSignal). Does not stop the capture.
+    void setTriggerCallback(std::function<void(const std::string &)> callback);
+
+    bool run();
+    void requestStop();
+    // Thread-safe; the trigger callback runs with reason "request"
+    void requestTrigger();
+
+    StopReason getStopReason() const;
+    std::string getLastError() const;
+
+    // Must be called before any thread is started so the termination signals
+    // stay blocked everywhere and are only delivered through the signalfd.
+    static void blockTerminationSignals();
+    // Same for SIGUSR1, for processes that use it as a dump trigger
+    static void blockTriggerSignal();
+    // Used by signal handlers (platforms without signalfd, or a signal that
+    // reached a thread where it was not blocked); wakes every running event
+    // loop that handles signals
+    static void notifySignal();
+    static bool isSignalPending();
+    // Used by the SIGUSR1 handler on platforms without signalfd.
+    static void notifyTriggerSignal();
+    static const char *getStopReasonName(StopReason reason);
+
+private:
+    PacketCapturer &capturer_;
+    int duration_seconds_;
+    std::string stop_file_;
+    bool handle_signals_;
+    int tick_ms_;
+    std::function<void()> dispatch_complete_;
+    std::function<void(const std::string &)> trigger_;
+    std::atomic<bool> stop_requested_;
+    std::atomic<bool> trigger_requested_;
+    StopReason stop_reason_;
+    std::string last_error_;
+    int wake_fd_;
+
+    // Event loops that handle signals and may run at the same time
+    static const int MAX_SIGNAL_LOOPS = 16;
+
+    static std::atomic<bool> signal_pending_;
+    static std::atomic<bool> trigger_signal_pending_;
+    // wake_fd_ + 1 of each running event loop that handles signals, 0 = free
+    // slot; read from signal handlers, so lock-free atomics only
+    static std::atomic<int> signal_wake_fds_[MAX_SIGNAL_LOOPS];
+
+    static bool registerSignalWakeFd(int fd);
+    static void unregisterSignalWakeFd(int fd);
+    static void wakeFromSignal();
+    bool stopFileExists() const;
+    void runPendingTriggers();
+    bool runEventLoop();
+    bool runPollingLoop();
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "PacketCapturer.h"
+#include "PacketParser.h"
+#include "DatasetWriter.h"
+#include "CaptureLoop.h"
+#include "SinkFanout.h"
+#include "FragmentTracker.h"
+#include "FeatureStage.h"
+#include "BatchPool.h"
+#include "PacketRing.h"
+#include "InterfaceMerger.h"
+#include "Deduplicator.h"
+#include "PrefixEnricher.h"
+#include "RuleLabeler.h"
+#include "Anonymizer.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+enum class IPVersionFilter
+{
+    IPv4_ONLY,
+    IPv6_ONLY,
+    ALL,
+    ICMP_ONLY,
+    BGP_ONLY
+};
+
+bool parseIPVersionFilter(const std::string &name, IPVersionFilter &filter);
+std::string getIPVersionFilterString(IPVersionFilter filter);
+CSVMode getCSVModeForFilter(IPVersionFilter filter);
+
+struct CaptureConfig
+{
+    std::string output_filename;
+    std::string interface_name; // device name, "auto", or a comma-separated list of devices to merge
+    IPVersionFilter ip_filter;
+    bool promiscuous;
+    int duration_seconds; // 0 = unlimited
+    std::string stop_file;
+    std::string stream_socket; // live row/stats stream, empty = disabled
+    std::vector<std::string> sinks; // extra outputs, "type:target[:option]" (see SinkSpec)
+    uint32_t column_groups;         // optional CSV columns (ColumnGroup bitmask)
+    int tunnel_depth;               // encapsulation layers to remove, -1 = default for the columns
+    int ring_seconds;               // raw packets kept for dumps (PacketRing), 0 = no ring
+    size_t ring_megabytes;          // memory cap of the ring
+    uint64_t ring_trigger_pps;      // dump when a capture-time second reaches this many packets, 0 = off
+    WriterBackend::Options writer;  // file writing of the CSV outputs
+    BackpressurePolicy backpressure; // what a full output queue does (SinkFanout)
+    int reorder_ms;                 // with several interfaces: how long a frame may wait for the others
+    size_t reorder_megabytes;       // memory cap of the merge buffers
+    int dedup_ms;                   // drop repeated frames seen within this window (Deduplicator), 0 = off
+    std::vector<PrefixSource> enrich_sources; // prefix lists labelling addresses (PrefixEnricher)
+    std::string label_rules;        // ground-truth rules file (RuleLabeler), empty = no label column
+    uint32_t anonymize_fields;      // identifiers to rewrite (AnonymizeField bitmask, Anonymizer), 0 = off
+    std::string anonymize_key_file; // 64 hex digits, empty = random key per run
+    std::vector<DatasetSplit> splits; // flow split of the CSV output into one file per split, empty = one file
+    uint64_t split_seed;              // key of the flow hash choosing the split
+    uint32_t index_rows;              // time index block of the CSV output: rows (TimeIndex), 0 = no row limit
+    int index_ms;                     // ... or capture time; both 0 = no index
+    bool handle_signals; // consume SIGINT/SIGTERM in the capture loop
+    bool verbose;        // per-packet progress lines on stdout
+
+    CaptureConfig() : ip_filter(IPVersionFilter::ALL), promiscuous(true), duration_seconds(0),
+                      column_groups(0), tunnel_depth(-1), ring_seconds(0), ring_megabytes(64), ring_trigger_pps(0),
+                      reorder_ms(100), reorder_megabytes(64), dedup_ms(0), anonymize_fields(0), split_seed(0), index_rows(0), index_ms(0), handle_signals(true), verbose(true) {}
+};
+
+struct CaptureStats
+{
+    uint64_t packets_captured;
+    uint64_t packets_processed;
+    uint64_t packets_dropped;
+    uint64_t packets_duplicate; // discarded by the de-duplicator before parsing
+    double elapsed_seconds;
+};
+
+// One capture from an interface into one or more outputs: owns the capturer,
+// parser, output fan-out and the loop that drives them. Parsed rows are
+// collected into a batch per pcap dispatch and handed to every sink at once.
+// Used directly by the CLI and once per capture by the daemon.
+//
+// Given several interfaces, every interface after the first is captured on
+// a thread of its own, and all frames go through an InterfaceMerger; the
+// loop thread parses them in timestamp order and tags each row with its
+// interface (the interface column group is switched on).
+//
+// Prefix lists in enrich_sources switch on the enrich column group and add
+// a PrefixEnricher stage, which reloads them while the capture runs; a
+// label_rules file likewise adds the label column group and a RuleLabeler.
+// anonymize_fields adds an Anonymizer as the last stage, so the columns of
+// all outputs (and verbose progress lines) carry the rewritten identifiers.
+// splits divides the CSV output by flow into one file per split; the other
+// sinks get every row. index_rows/index_ms give each CSV output file a
+// sidecar time index for DatasetSlice.
+class CaptureSession
+{
+public:
+    explicit CaptureSession(const CaptureConfig &config);
+    // Adopts an already opened capturer (kept warm by the daemon)
+    CaptureSession(const CaptureConfig &config, std::unique_ptr<PacketCapturer> capturer);
+    ~CaptureSession();
+
+    bool initialize();
+    bool run();
+    void requestStop();
+    // Asks the capture thread to dump the packet ring; false without a ring
+    bool requestRingDump();
+    // False without a ring
+    bool getRingStats(PacketRing::Stats &stats, std::string &last_dump_path) const;
+
+    CaptureStats getStats() const;
+    CaptureLoop::StopReason getStopReason() const;
+    const CaptureConfig &getConfig() const;
+    std::unique_ptr<PacketCapturer> releaseCapturer();
+    std::string getLastError() const;
+    void printSummary() const;
+
+private:
+    // A capture thread for an interface after the first
+    struct ExtraInterface
+    {
+        std::unique_ptr<PacketCapturer> capturer;
+        std::unique_ptr<CaptureLoop> loop;
+        std::thread thread;
+    };
+
+    CaptureConfig config_;
+    std::unique_ptr<PacketCapturer> capturer_;
+    std::unique_ptr<PacketParser> parser_;
+    std::unique_ptr<SinkFanout> fanout_;
+    std::unique_ptr<CaptureLoop> loop_;
+    std::unique_ptr<BatchPool> batch_pool_;
+    std::shared_ptr<PacketBatch> pending_batch_;
+    std::unique_ptr<FragmentTracker> fragments_; // only with fragment columns
+    std::vector<std::unique_ptr<FeatureStage>> stages_; // run on every row, in order
+    std::unique_ptr<PacketRing> ring_;                   // only with ring_seconds
+    std::vector<std::string> interface_names_;           // resolved, primary first
+    std::string_view current_interface_;                 // tag for rows being parsed
+    std::vector<std::unique_ptr<ExtraInterface>> extra_interfaces_;
+    std::unique_ptr<InterfaceMerger> merger_;            // only with several interfaces
+    std::unique_ptr<Deduplicator> dedup_;                // only with dedup_ms
+    int64_t rate_second_;                                // capture-time second being counted
+    uint64_t rate_count_;
+    bool rate_armed_;                                    // re-armed by a second below the threshold
+    std::chrono::system_clock::time_point last_packet_time_;
+    bool build_columns_;                                 // fill the batch columns next to the rows
+    std::string last_error_;
+
+    std::atomic<uint64_t> packet_count_;
+    std::atomic<uint64_t> processed_count_;
+    std::atomic<uint64_t> dropped_count_;
+    std::atomic<uint64_t> duplicate_count_;
+    std::atomic<bool> running_;
+    mutable std::mutex time_mutex_;
+    std::chrono::steady_clock::time_point start_time_;
+    std::chrono::steady_clock::time_point end_time_;
+    double first_packet_time_;
+
+    static const size_t MAX_BATCH_ROWS = 256;
+
+    bool createSinks();
+    void flushBatch();
+    void onDispatchComplete();
+    bool openExtraInterfaces(const std::vector<std::string> &names, const std::string &filter);
+    void drainMerged(bool final);
+    void triggerRingDump(const std::string &reason);
+    void countRate(const struct pcap_pkthdr *header);
+    PacketBatch &currentBatch();
+    void handlePacket(const uint8_t *packet, int size, const struct pcap_pkthdr *header);
+    void printProgress(const PacketFeature &feature, const struct pcap_pkthdr *header);
+};
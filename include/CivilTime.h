@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Days since 1970-01-01 of a proleptic Gregorian date (Hinnant's
+// days_from_civil). Shared by the parsers of UTC timestamps (RuleLabeler,
+// TimeIndex, DatasetSlice), which need no time zone database.
+inline int64_t daysFromCivil(int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
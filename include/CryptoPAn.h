@@ -0,0 +1,74 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Prefix-preserving address anonymization (Crypto-PAn, Xu et al.): bit i of
+// an address is flipped by the top bit of AES-128 of its first i bits padded
+// with a secret block, so two addresses sharing a k-bit prefix map to
+// addresses sharing exactly a k-bit prefix. The 32-byte key is the AES key
+// followed by the pad seed, as in the reference implementation.
+//
+// One address costs 32 (IPv4) or 128 (IPv6) AES blocks. They are independent
+// and encrypted with AES-NI several at a time where the CPU has it, else with
+// a table-driven software AES. Flip masks are memoized in direct-mapped
+// tables for a few prefix lengths (IPv4 /16, /24; IPv6 /32, /48, /64), so a
+// new address costs only the bits below its longest memoized prefix: 8 AES
+// blocks for a host in a known IPv4 /24. Callers memoize whole addresses
+// together with what they derive from them (see Anonymizer).
+class CryptoPAn
+{
+public:
+    static const size_t KEY_BYTES = 32;
+    static const size_t DEFAULT_MEMO_ENTRIES = 1u << 15; // per prefix length
+
+    struct Stats
+    {
+        uint64_t addresses;
+        uint64_t prefix_hits;      // part of the mask memoized
+        uint64_t blocks_encrypted; // AES blocks, i.e. address bits computed
+
+        Stats() : addresses(0), prefix_hits(0), blocks_encrypted(0) {}
+    };
+
+    // memo_entries is rounded up to a power of two
+    explicit CryptoPAn(const uint8_t *key, size_t memo_entries = DEFAULT_MEMO_ENTRIES);
+
+    // Replaces a family 4 or 6 address by its anonymized form
+    void anonymize(IpAddress &address);
+
+    Stats getStats() const { return stats_; }
+    bool usesAesInstructions() const { return aes_ni_; }
+
+    // Single-block AES-128 (software), for checking the implementation
+    void encryptBlock(const uint8_t *in, uint8_t *out) const;
+
+private:
+    struct MemoEntry
+    {
+        uint64_t key[2];  // prefix, host bits cleared
+        uint64_t mask[2]; // flip bits of the prefix
+        uint8_t length;   // 0 = free
+    };
+
+    struct MemoLevel
+    {
+        int family;
+        int length;
+        std::vector<MemoEntry> entries;
+    };
+
+    uint32_t round_keys_[44];
+    alignas(16) uint8_t round_key_bytes_[176]; // the same keys in byte order, for AES-NI
+    uint8_t pad_[16];
+    bool aes_ni_;
+    std::vector<MemoLevel> levels_; // by family, shortest first
+    size_t memo_mask_;
+    Stats stats_;
+
+    // Sets mask bits [from, to) of the address
+    void computeMask(const uint8_t *address, int from, int to, uint8_t *mask);
+    MemoEntry &slot(MemoLevel &level, const uint64_t *key);
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "DatasetWriter.h"
+
+class CsvSink : public OutputSink
+{
+public:
+    CsvSink(const std::string &filename, CSVMode mode, uint32_t column_groups = 0,
+            const WriterBackend::Options &writer = WriterBackend::Options());
+
+    // Splits rows by flow into one file per split (DatasetWriter::setSplits)
+    void setSplits(const std::vector<DatasetSplit> &splits, uint64_t seed) { writer_.setSplits(splits, seed); }
+    // Writes a <file>.idx time index next to each file (DatasetWriter::setTimeIndex)
+    void setTimeIndex(uint32_t block_rows, int block_ms) { writer_.setTimeIndex(block_rows, block_ms); }
+
+    bool open() override;
+    bool consume(const PacketBatch &batch) override;
+    void close() override;
+
+    std::string getName() const override;
+    std::string getLastError() const override;
+
+private:
+    std::string filename_;
+    DatasetWriter writer_;
+};
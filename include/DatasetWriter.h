@@ -1,9 +1,13 @@
 #pragma once
 
 #include "PacketFeature.h"
+#include "WriterBackend.h"
+#include "TimeIndex.h"
 #include <string>
-#include <fstream>
+#include <string_view>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 enum class CSVMode {
     BOTH,     // Mixed IPv4/IPv6 with all columns
@@ -11,29 +15,104 @@ enum class CSVMode {
     IPv6_ONLY  // IPv6 columns only
 };
 
+// Optional column groups, appended after ProtocolName in the order listed
+enum ColumnGroup : uint32_t {
+    COLUMNS_FRAGMENT = 1u << 0, // ports, TCP flags and fragment tracking
+    COLUMNS_TUNNEL = 1u << 1,   // encapsulation layers and inner packet features
+    COLUMNS_HOST_WINDOW = 1u << 2, // recent per-host activity (HostWindowTracker)
+    COLUMNS_PAYLOAD = 1u << 3,     // payload length, entropy, printable ratio and byte histogram
+    COLUMNS_INTERFACE = 1u << 4,   // capture interface of the row
+    COLUMNS_ENRICH = 1u << 5,      // prefix list labels of both addresses (PrefixEnricher)
+    COLUMNS_LABEL = 1u << 6,       // ground-truth class from a rules file (RuleLabeler)
+};
+
+// One output of a flow split (see DatasetWriter::setSplits)
+struct DatasetSplit {
+    std::string name;  // file suffix: capture.csv -> capture-<name>.csv
+    double weight;     // share of the flows, relative to the other splits
+};
+
+// With splits set, rows go to one file per split instead of the given file,
+// chosen by a keyed hash (SipHash-2-4) of the flow's 5-tuple with the two
+// endpoints in a fixed order: both directions of a flow, and every packet of
+// it, land in the same split, so a model trained on one split never sees
+// flows of another. The same seed reproduces the assignment across captures
+// and runs. Rows without ports (non-first fragments unless fragment tracking
+// attributes them, ICMP, ...) hash on addresses and protocol alone.
+//
+// Each split has its own header and writer backend with its own buffers; a
+// row is formatted once and copied into the buffer of its split only.
+//
+// With a time index set, every output file gets a TimeIndex sidecar
+// (<file>.idx) mapping blocks of rows to their byte range and time span.
 class DatasetWriter {
 public:
-    DatasetWriter(const std::string& filename, CSVMode mode = CSVMode::BOTH);
+    DatasetWriter(const std::string& filename, CSVMode mode = CSVMode::BOTH, uint32_t column_groups = 0,
+                  const WriterBackend::Options& writer = WriterBackend::Options());
     ~DatasetWriter();
     
+    // Before initialize(); at least two splits
+    void setSplits(const std::vector<DatasetSplit>& splits, uint64_t seed);
+    // Before initialize(); a block ends after block_rows rows or block_ms of
+    // capture time (0 = no limit of that kind)
+    void setTimeIndex(uint32_t block_rows, int block_ms);
     bool initialize();
     bool writePacket(const PacketFeature& packet);
+    // Hands buffered rows to the OS; with an asynchronous backend this does
+    // not wait for them to be written
+    bool flush();
     void close();
     
     std::string getLastError() const;
+    uint64_t getBytesWritten() const;
+
+    // Parses a comma-separated list of group names (e.g. "fragment,tunnel")
+    static bool parseColumnGroups(const std::string& list, uint32_t& groups, std::string& error);
+    // Parses "train=0.8,validation=0.1,test=0.1" (weights are normalized)
+    static bool parseSplits(const std::string& spec, std::vector<DatasetSplit>& splits, std::string& error);
+    // File of one split: capture.csv -> capture-<name>.csv
+    static std::string getSplitFilename(const std::string& filename, const std::string& name);
     
 private:
+    // The file, or one file per split
+    struct Output {
+        std::string name; // split name, empty without splits
+        std::string filename;
+        std::unique_ptr<WriterBackend> file;
+        uint64_t hash_limit; // takes rows whose flow hash (top 32 bits) is below this and not an earlier output's
+        uint64_t rows;
+        std::unique_ptr<TimeIndex> index; // null without a time index
+    };
+
     std::string filename_;
-    std::unique_ptr<std::ofstream> file_;
+    WriterBackend::Options writer_options_;
+    std::vector<Output> outputs_;
+    uint64_t split_key_[2];
+    uint32_t index_block_rows_;
+    int index_block_ms_;
     std::string last_error_;
     bool is_initialized_;
     CSVMode csv_mode_;
+    uint32_t column_groups_;
+    std::string row_;         // row being built, reused for every packet
+    int64_t row_micros_;      // timestamp of the row being built
+    int64_t cached_second_;   // second formatted in cached_date_
+    char cached_date_[32];
+    size_t cached_date_length_;
     
+    bool openOutput(Output& output);
+    bool recoverTornTail(const std::string& filename, uint64_t& removed, uint64_t& kept);
+    size_t selectSplit(const PacketFeature& packet) const;
     void writeCSVHeader();
+    void writeExtraHeaders();
+    void writeExtraColumns(const PacketFeature& packet);
     void writeIPv4CSVHeader();
     void writeIPv6CSVHeader();
-    std::string formatTimestamp(const std::chrono::system_clock::time_point& timestamp);
-    std::string vectorToHex(const std::vector<uint8_t>& data);
-    std::string vectorToString(const std::vector<std::string>& data);
-    std::string escapeCSV(const std::string& field);
+    void appendIPv4Fields(const IPv4PacketFeature& ipv4);
+    void appendTimestamp(const std::chrono::system_clock::time_point& timestamp);
+    void appendNumber(uint64_t value);
+    void appendDecimal(double value);
+    void appendHex(const ByteView& data);
+    void appendCSV(std::string_view field);
+    void appendHostContext(const HostContext& context);
 };
\ No newline at end of file
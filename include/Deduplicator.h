@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Recognises repeated copies of a frame, as SPAN and mirror ports deliver
+// them, before the frame is parsed. A frame is reduced to a 64-bit hash of
+// its invariant part: everything from the IP header on (VLAN tags and the
+// Ethernet header skipped), except the IPv4 TTL and header checksum or the
+// IPv6 hop limit, so copies taken on both sides of a router match too. Only
+// the first HASH_BYTES of the packet are hashed, together with its length.
+//
+// Hashes seen within the window (capture time) are kept in a cuckoo filter:
+// buckets of four 32-bit fingerprints, each with the time it was first seen,
+// and two candidate buckets per hash. Expired slots count as free, so the
+// filter never needs sweeping. When both buckets and a bounded chain of
+// relocations are full, one fingerprint is dropped (counted as an eviction),
+// which can only let a duplicate through; memory stays fixed.
+class Deduplicator
+{
+public:
+    static const size_t DEFAULT_ENTRIES = 1u << 18; // 2 MiB of slots
+    static const size_t HASH_BYTES = 256;
+
+    struct Stats
+    {
+        uint64_t frames;
+        uint64_t duplicates;
+        uint64_t evictions; // fingerprints pushed out while still inside the window
+
+        Stats() : frames(0), duplicates(0), evictions(0) {}
+    };
+
+    // entries is rounded up to a power of two (at least one bucket)
+    explicit Deduplicator(int window_ms, size_t entries = DEFAULT_ENTRIES);
+
+    // True when an equivalent frame was seen in the last window_ms;
+    // otherwise remembers this one
+    bool isDuplicate(const uint8_t *frame, size_t caplen, uint32_t wire_length, int64_t timestamp_us);
+
+    Stats getStats() const { return stats_; }
+    int getWindowMs() const { return window_ms_; }
+    size_t getMemoryBytes() const { return slots_.size() * sizeof(Slot); }
+
+    static uint64_t hashFrame(const uint8_t *frame, size_t caplen, uint32_t wire_length);
+
+private:
+    struct Slot
+    {
+        uint32_t fingerprint; // 0 = free
+        uint32_t seen;        // capture time in ticks, wrapping
+    };
+
+    static const size_t SLOTS_PER_BUCKET = 4;
+    static const int MAX_KICKS = 64;
+    static const int TICK_SHIFT = 7; // 128 us ticks; the clock wraps after 6 days
+
+    int window_ms_;
+    uint32_t window_ticks_;
+    std::vector<Slot> slots_;
+    size_t bucket_mask_;
+    uint32_t kick_state_;
+    Stats stats_;
+
+    size_t alternateBucket(size_t bucket, uint32_t fingerprint) const;
+    bool isLive(const Slot &slot, uint32_t now) const;
+    bool placeInBucket(size_t bucket, const Slot &entry, uint32_t now);
+};
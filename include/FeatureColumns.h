@@ -0,0 +1,77 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct PacketRecord;
+
+// Structure-of-arrays form of a batch of parsed packets: one vector per
+// field, all of size() rows. Fields that do not apply to a row's IP version
+// are zero. Variable-length fields are stored as size() + 1 offsets into a
+// shared byte string.
+struct FeatureColumns
+{
+    enum PacketFlag : uint8_t
+    {
+        FLAG_TRANSPORT = 1 << 0, // src_port/dst_port/tcp_flags are valid
+        FLAG_FRAGMENT = 1 << 1,
+        FLAG_MORE_FRAGMENTS = 1 << 2,
+        FLAG_DATAGRAM_COMPLETE = 1 << 3,
+        FLAG_L4_INFERRED = 1 << 4,
+        FLAG_OVERLAP = 1 << 5,
+        FLAG_TINY = 1 << 6,
+        FLAG_BAD_CHECKSUM = 1 << 7 // IPv4 header checksum did not verify
+    };
+
+    std::vector<int64_t> timestamp_us;
+    std::vector<uint32_t> wire_length;
+    std::vector<uint8_t> version;
+
+    std::vector<uint8_t> ihl;
+    std::vector<uint8_t> tos;
+    std::vector<uint16_t> total_length;
+    std::vector<uint16_t> identification;
+    std::vector<uint8_t> flags;
+    std::vector<uint16_t> fragment_offset;
+    std::vector<uint8_t> ttl;
+    std::vector<uint8_t> protocol;
+    std::vector<uint16_t> header_checksum;
+
+    std::vector<uint8_t> traffic_class;
+    std::vector<uint32_t> flow_label;
+    std::vector<uint16_t> payload_length;
+    std::vector<uint8_t> next_header;
+    std::vector<uint8_t> hop_limit;
+
+    std::vector<IpAddress> src_ip;
+    std::vector<IpAddress> dst_ip;
+    std::vector<uint8_t> l4_protocol;
+    std::vector<uint16_t> src_port;
+    std::vector<uint16_t> dst_port;
+    std::vector<uint8_t> tcp_flags;
+    std::vector<uint8_t> packet_flags;
+    std::vector<uint32_t> fragment_id;
+    std::vector<uint32_t> fragment_offset_bytes;
+    std::vector<uint32_t> datagram_size;
+
+    std::vector<uint32_t> options_offsets; // IPv4 options bytes
+    std::string options_data;
+    std::vector<uint32_t> extension_offsets; // IPv6 extension header text
+    std::string extension_data;
+
+    FeatureColumns();
+
+    size_t size() const { return timestamp_us.size(); }
+    bool empty() const { return timestamp_us.empty(); }
+    void clear();
+    void reserve(size_t rows);
+    // Resizes the fixed-width columns only; variable-length columns are
+    // appended per row by the producer
+    void resizeFixed(size_t rows);
+    // Transposes one row-form packet onto the end of the columns
+    void appendRow(const PacketRecord &record);
+};
+
+std::string formatIpAddress(const IpAddress &address);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "Arena.h"
+#include <string>
+
+// Per-row processing between the parser and the batch. CaptureSession runs
+// its stages in order on the capture thread, once per parsed row and in
+// capture order, before fragment tracking. Stages annotate the row in place;
+// text they attach must live in arena, the row's batch arena.
+class FeatureStage
+{
+public:
+    virtual ~FeatureStage() {}
+
+    virtual void process(PacketRecord &record, Arena &arena) = 0;
+
+    virtual std::string getName() const = 0;
+    // Line for the capture summary, empty when there is nothing to add
+    virtual std::string getSummary() const { return ""; }
+};
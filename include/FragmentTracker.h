@@ -0,0 +1,105 @@
+#pragma once
+
+#include "OutputSink.h"
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include <chrono>
+#include <memory>
+
+// Relates IP fragments of the same datagram, keyed on (src, dst, id, proto).
+// Fragment rows are held until their datagram is complete, then released
+// with the transport fields of the first fragment, the reassembled size and
+// overlap/tiny flags filled in. Incomplete datagrams are released as they are
+// when they time out or when a memory cap forces eviction of the oldest one,
+// so fragment rows may be emitted after later non-fragment rows.
+class FragmentTracker
+{
+public:
+    struct Limits
+    {
+        size_t max_datagrams;
+        size_t max_held_rows;
+        size_t max_fragments_per_datagram;
+        std::chrono::seconds timeout;
+
+        Limits() : max_datagrams(4096), max_held_rows(16384), max_fragments_per_datagram(64), timeout(30) {}
+    };
+
+    struct Stats
+    {
+        uint64_t fragments;
+        uint64_t datagrams_completed;
+        uint64_t datagrams_expired;
+        uint64_t datagrams_evicted;
+        uint64_t overlapping_fragments;
+        uint64_t tiny_fragments;
+
+        Stats() : fragments(0), datagrams_completed(0), datagrams_expired(0), datagrams_evicted(0),
+                  overlapping_fragments(0), tiny_fragments(0) {}
+    };
+
+    // Non-last fragments smaller than this are flagged as tiny
+    static const uint32_t TINY_FRAGMENT_BYTES = 64;
+
+    explicit FragmentTracker(const Limits &limits = Limits());
+
+    // Takes a fragment row; rows that can be emitted now are appended to
+    // released, with their text copied into its arena
+    void add(PacketRecord &&record, PacketBatch &released);
+    // Releases datagrams first seen more than the timeout before now
+    void expire(std::chrono::system_clock::time_point now, PacketBatch &released);
+    void releaseAll(PacketBatch &released);
+
+    Stats getStats() const;
+
+private:
+    struct Key
+    {
+        IpAddress src;
+        IpAddress dst;
+        uint32_t identification;
+        uint8_t protocol;
+
+        bool operator==(const Key &other) const
+        {
+            return identification == other.identification && protocol == other.protocol &&
+                   src == other.src && dst == other.dst;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    // Held rows own a copy of their variable-length fields
+    struct HeldRecord
+    {
+        PacketRecord record;
+        std::unique_ptr<char[]> storage;
+    };
+
+    struct Datagram
+    {
+        std::chrono::system_clock::time_point first_seen;
+        std::list<Key>::iterator age;
+        std::vector<HeldRecord> held;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges; // [start, end) bytes seen
+        uint32_t total_size;                               // known once the last fragment arrived
+        bool have_first;
+        TransportFeature transport;
+
+        Datagram() : total_size(0), have_first(false) {}
+    };
+
+    Limits limits_;
+    std::unordered_map<Key, Datagram, KeyHash> datagrams_;
+    std::list<Key> by_age_; // oldest first
+    size_t held_rows_;
+    Stats stats_;
+
+    static Key makeKey(const PacketFeature &feature);
+    static bool isComplete(const Datagram &datagram);
+    void release(std::unordered_map<Key, Datagram, KeyHash>::iterator it, PacketBatch &released);
+};
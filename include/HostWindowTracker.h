@@ -0,0 +1,81 @@
+#pragma once
+
+#include "FeatureStage.h"
+#include <vector>
+#include <cstdint>
+
+// Incremental per-host context features (HostWindowFeature): for the source
+// and destination of every row, packets, bytes, SYNs and distinct peers and
+// destination ports over the last WINDOW_SECONDS of capture time, plus the
+// packets among the last COUNT_WINDOW rows.
+//
+// Each direction has a fixed-size open-addressed table of hosts. A host
+// keeps BUCKETS time buckets as ring counters, so a row costs two lookups,
+// a few bucket resets and a BUCKETS-long sum. Distinct counts union per-bucket
+// 64-bit bitmaps and apply linear counting. When a probe run is full, the
+// least recently seen host in it is evicted, so memory is fixed.
+class HostWindowTracker : public FeatureStage
+{
+public:
+    static const int WINDOW_SECONDS = 2;
+    static const int BUCKETS = 8;
+    static const size_t COUNT_WINDOW = 100;
+    static const size_t DEFAULT_HOSTS = 8192; // per direction, rounded up to a power of two
+
+    struct Stats
+    {
+        uint64_t rows;
+        uint64_t hosts_added;
+        uint64_t hosts_evicted; // replaced while still inside the windows
+
+        Stats() : rows(0), hosts_added(0), hosts_evicted(0) {}
+    };
+
+    explicit HostWindowTracker(size_t hosts_per_direction = DEFAULT_HOSTS);
+
+    void process(PacketRecord &record, Arena &arena) override;
+
+    std::string getName() const override { return "host-window"; }
+    std::string getSummary() const override;
+    Stats getStats() const { return stats_; }
+
+private:
+    struct Host
+    {
+        IpAddress key;
+        uint64_t hash;
+        int64_t bucket;      // newest time bucket counted, -1 = free slot
+        uint32_t generation; // bumped when the slot changes owner
+        uint16_t recent;
+        uint32_t packets[BUCKETS];
+        uint32_t bytes[BUCKETS];
+        uint32_t syns[BUCKETS];
+        uint64_t peers[BUCKETS];
+        uint64_t ports[BUCKETS];
+    };
+
+    // Slot and owner generation of the hosts a row touched, for retiring it
+    // from the count window
+    struct RecentRow
+    {
+        uint32_t src_slot;
+        uint32_t src_generation;
+        uint32_t dst_slot;
+        uint32_t dst_generation;
+    };
+
+    static const size_t PROBE_LIMIT = 8;
+
+    std::vector<Host> senders_;
+    std::vector<Host> receivers_;
+    std::vector<RecentRow> recent_;
+    size_t recent_next_;
+    size_t recent_filled_;
+    int64_t newest_bucket_;
+    Stats stats_;
+
+    uint32_t findHost(std::vector<Host> &table, const IpAddress &address, uint64_t hash, int64_t bucket);
+    void retire(std::vector<Host> &table, uint32_t slot, uint32_t generation);
+    static void advance(Host &host, int64_t bucket);
+    static void summarise(const Host &host, HostContext &context);
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <cstddef>
+#include <cstdint>
+
+// Longest text formatIPv6ExtensionChain can produce ("Header135," per header)
+const size_t IPV6_EXTENSION_TEXT_MAX = IPv6ExtensionChain::MAX_HEADERS * 10;
+
+// True for next-header values that start (or, for ESP, end) an extension
+// header chain rather than naming an upper-layer protocol
+bool isIPv6ExtensionHeader(uint8_t next_header);
+
+// Walks the extension headers in data (the bytes after the 40-byte fixed
+// header, remaining_size of them captured) starting from next_header.
+// Header lengths come from a per-type table: the RFC 6564 uniform format
+// for Hop-by-Hop, Routing, Destination Options, Mobility, HIP and Shim6,
+// fixed 8 bytes for Fragment and 32-bit words for AH. Every header
+// advances at least 8 bytes and at most MAX_HEADERS are decoded, so a
+// malformed chain cannot loop. A Fragment header fills fragment.
+void walkIPv6ExtensionHeaders(const uint8_t *data, int remaining_size, uint8_t next_header,
+                              IPv6ExtensionChain &chain, FragmentFeature &fragment);
+
+// Writes "Header0,Header43,..." (no terminator) to out, which must hold
+// IPV6_EXTENSION_TEXT_MAX bytes. Returns the length.
+size_t formatIPv6ExtensionChain(const IPv6ExtensionChain &chain, char *out);
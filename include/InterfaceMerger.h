@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <pcap.h>
+#else
+#include <pcap/pcap.h>
+#endif
+
+// Merges frames captured on several interfaces into one stream ordered by
+// capture timestamp. Each input is fed by its own capture thread: push()
+// copies a frame into the input's current chunk and publish() (after every
+// dispatch) makes the frames pushed so far visible to the merging thread,
+// which reads them in place while the capture thread keeps filling the
+// chunk.
+//
+// drain() emits buffered frames in timestamp order up to the watermark, the
+// lowest over all inputs of max(newest published timestamp, now - reorder
+// window): a frame is held until every interface has either delivered
+// something later or had reorder_ms to do so. A frame that arrives below
+// what was already emitted (delivered later than the window) is still
+// emitted, and counted as late.
+//
+// Memory is bounded per input by memory_bytes / inputs. When an input is
+// out of chunks the merger emits its oldest frames regardless of the
+// watermark, and until one is free the capture thread drops new frames
+// (counted in frames_dropped).
+class InterfaceMerger
+{
+public:
+    struct Config
+    {
+        int reorder_ms;
+        size_t memory_bytes;
+
+        Config() : reorder_ms(100), memory_bytes(64u << 20) {}
+    };
+
+    struct Stats
+    {
+        std::vector<uint64_t> frames;         // per input, accepted
+        std::vector<uint64_t> frames_dropped; // per input, no buffer space
+        uint64_t frames_late;                 // emitted below an earlier emitted timestamp
+        uint64_t forced_emits;                // emitted ahead of the watermark to free space
+        size_t peak_bytes;                    // most chunk memory in use at once
+    };
+
+    using FrameCallback = std::function<void(size_t input, const uint8_t *data, const struct pcap_pkthdr *header)>;
+
+    static const size_t CHUNK_BYTES = 256 * 1024;
+
+    InterfaceMerger(size_t inputs, const Config &config);
+
+    // Capture thread of input only (or any thread once it has stopped)
+    void push(size_t input, const struct pcap_pkthdr *header, const uint8_t *data);
+    void publish(size_t input);
+
+    // Merging thread only. now_us is the wall clock in microseconds since
+    // the epoch (capture timestamps use the same clock); final emits
+    // everything published.
+    void drain(int64_t now_us, bool final, const FrameCallback &callback);
+
+    size_t getInputCount() const { return inputs_.size(); }
+    Stats getStats() const;
+
+private:
+    // Frames are stored as a header followed by the captured bytes, padded
+    // to 8 bytes
+    struct FrameHeader
+    {
+        int64_t timestamp_us;
+        uint32_t caplen;
+        uint32_t wire_length;
+    };
+
+    struct Chunk
+    {
+        std::unique_ptr<uint8_t[]> bytes;
+        size_t written;   // capture thread only
+        size_t published; // under the input mutex
+        bool sealed;      // under the input mutex; no more frames will follow
+    };
+
+    // Snapshot of a chunk taken by drain()
+    struct ChunkView
+    {
+        Chunk *chunk;
+        size_t end;
+        bool sealed;
+    };
+
+    struct Input
+    {
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Chunk>> chunks; // oldest first; under mutex
+        std::vector<std::unique_ptr<Chunk>> spare; // under mutex
+        int64_t newest_us;                         // under mutex
+        std::atomic<size_t> chunks_in_use;
+
+        Chunk *current; // capture thread only: chunks.back() while being filled
+        int64_t staged_newest_us;
+
+        std::vector<ChunkView> view; // merging thread only
+        size_t read_offset;          // into view.front()
+
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> frames_dropped;
+
+        Input() : newest_us(INT64_MIN), chunks_in_use(0), current(nullptr), staged_newest_us(INT64_MIN), read_offset(0), frames(0),
+                  frames_dropped(0) {}
+    };
+
+    Config config_;
+    size_t max_chunks_; // per input
+    std::vector<std::unique_ptr<Input>> inputs_;
+    int64_t last_emitted_us_;
+    std::atomic<uint64_t> frames_late_;
+    std::atomic<uint64_t> forced_emits_;
+    std::atomic<size_t> chunks_in_use_;
+    std::atomic<size_t> peak_chunks_;
+
+    bool startChunk(Input &input);
+    const FrameHeader *headFrame(Input &input);
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include <map>
+
+// Minimal JSON helpers for the control and streaming protocols. Requests are
+// flat objects; nested values are rejected rather than silently dropped.
+std::string escapeJSON(const std::string &str);
+
+// Parses {"key": value, ...} into key -> text. String values are unescaped,
+// numbers, booleans and null are stored as their literal text.
+bool parseFlatJSONObject(const std::string &text, std::map<std::string, std::string> &fields, std::string &error);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "LiveStreamServer.h"
+
+class LiveStatsSink : public OutputSink
+{
+public:
+    LiveStatsSink(const std::string &socket_path, LiveStreamServer::Content content);
+
+    bool open() override;
+    bool consume(const PacketBatch &batch) override;
+    void close() override;
+
+    std::string getName() const override;
+    std::string getLastError() const override;
+    std::string getSummary() const override;
+
+private:
+    std::string socket_path_;
+    LiveStreamServer server_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// Publishes capture activity to local subscribers over a Unix-domain socket
+// as newline-delimited JSON:
+//
+//   {"type":"stats", ...}   once per second, aggregated counters
+//   {"type":"rows", ...}    batches of recent rows (every 100 ms)
+//
+// The capture thread never blocks on subscribers: rows are formatted only
+// while someone is connected, the pending batch is capped, and a client whose
+// send buffer is full misses messages (counted) instead of stalling capture.
+class LiveStreamServer
+{
+public:
+    enum class Content
+    {
+        STATS,
+        ROWS_AND_STATS
+    };
+
+    LiveStreamServer(const std::string &socket_path, Content content = Content::ROWS_AND_STATS);
+    ~LiveStreamServer();
+
+    bool start();
+    void stop();
+    void publish(const PacketFeature &packet, uint32_t wire_length);
+
+    uint64_t getDroppedRows() const;
+    uint64_t getDroppedMessages() const;
+    std::string getLastError() const;
+
+private:
+    struct Subscriber
+    {
+        int fd;
+        std::string outbox;
+    };
+
+    struct WindowStats
+    {
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t ipv4;
+        uint64_t ipv6;
+        std::map<std::string, uint64_t> protocols;
+
+        WindowStats() : packets(0), bytes(0), ipv4(0), ipv6(0) {}
+    };
+
+    static const size_t MAX_PENDING_ROWS = 512;
+    static const size_t MAX_OUTBOX_BYTES = 1024 * 1024;
+
+    std::string socket_path_;
+    Content content_;
+    std::string last_error_;
+    int listen_fd_;
+    uint64_t socket_inode_; // of the socket node bound by start(), removed by stop() only if still there
+    int wake_fd_[2];
+    std::thread publisher_;
+    std::atomic<bool> running_;
+    std::atomic<int> subscriber_count_;
+
+    std::mutex mutex_;
+    WindowStats window_;
+    std::vector<std::string> pending_rows_;
+    uint64_t total_packets_;
+
+    std::atomic<uint64_t> dropped_rows_;
+    std::atomic<uint64_t> dropped_messages_;
+
+    std::vector<Subscriber> subscribers_;
+
+    void publisherLoop();
+    void broadcast(const std::string &message);
+    bool flushSubscriber(Subscriber &subscriber);
+    std::string buildStatsMessage();
+    std::string buildRowsMessage();
+    static std::string formatRow(const PacketFeature &packet, uint32_t wire_length);
+};
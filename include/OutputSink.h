@@ -0,0 +1,76 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include "FeatureColumns.h"
+#include "Arena.h"
+#include "WriterBackend.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+struct PacketRecord
+{
+    PacketFeature feature;
+    uint32_t wire_length;
+};
+
+// Rows parsed from one burst of packets. A batch is immutable once handed
+// to the fan-out and is shared by every sink without copying. When a sink
+// asked for columns they hold the same rows as packets, transposed by
+// FeatureColumns::appendRow; otherwise columns is empty. The variable-length
+// fields of packets live in arena, so they are valid exactly as long as the
+// batch (see BatchPool).
+struct PacketBatch
+{
+    std::vector<PacketRecord> packets;
+    FeatureColumns columns;
+    Arena arena;
+};
+
+typedef std::shared_ptr<const PacketBatch> SharedPacketBatch;
+
+// Destination for parsed rows. Each sink runs on its own thread (see
+// SinkFanout), so implementations need no locking of their own.
+class OutputSink
+{
+public:
+    virtual ~OutputSink() {}
+
+    virtual bool open() = 0;
+    virtual bool consume(const PacketBatch &batch) = 0;
+    virtual void close() = 0;
+
+    virtual std::string getName() const = 0;
+    virtual std::string getLastError() const = 0;
+    // Extra line for the capture summary, empty when there is nothing to add
+    virtual std::string getSummary() const { return ""; }
+    // Columnar sinks read PacketBatch::columns when it is filled
+    virtual bool wantsColumns() const { return false; }
+    // Leading payload bytes the sink reads from PayloadFeature::head
+    virtual size_t getPayloadHeadBytes() const { return 0; }
+};
+
+// Output given as "type:target[:option]":
+//   csv:<file>[:ipv4|ipv6|both]   CSV dataset (DatasetWriter)
+//   binary:<file>                 block-columnar binary dataset
+//   live:<socket>[:stats]         live stream (rows and stats, or stats only)
+//   sketch:<file>[:<seconds>]     per-window top sources and distinct counts
+//   npy:<file>[:<bytes>]          leading payload bytes per row as a NumPy tensor
+struct SinkSpec
+{
+    std::string type;
+    std::string target;
+    std::string option;
+
+    bool writesFile() const { return type == "csv" || type == "binary" || type == "sketch" || type == "npy"; }
+    // live: binds (and later removes) a Unix socket at target
+    bool bindsSocket() const { return type == "live"; }
+};
+
+bool parseSinkSpec(const std::string &text, SinkSpec &spec, std::string &error);
+// Splits a comma-separated list of specs, skipping empty entries
+std::vector<std::string> splitSinkList(const std::string &list);
+// column_groups selects the optional CSV column groups (see ColumnGroup)
+std::unique_ptr<OutputSink> createOutputSink(const SinkSpec &spec, uint32_t column_groups = 0,
+                                             const WriterBackend::Options &writer = WriterBackend::Options());
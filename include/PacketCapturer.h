@@ -3,6 +3,7 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <map>
 
 #ifdef _WIN32
 #include <pcap.h>
@@ -20,13 +21,26 @@ public:
 
     bool initialize(const std::string &interface_name = "", bool promiscuous = true);
     bool setFilter(const std::string &filter);
+    bool hasFilter() const;
     void setCallback(PacketCallback callback);
     bool startCapture();
     void stopCapture();
 
+    int getSelectableFd() const;
+    bool setNonBlocking(bool enable);
+    int dispatch(int max_packets = -1);
+    void discardPending();
+
     std::string selectInterfaceInteractively();
     std::string selectFirstActiveInterface();
     void listInterfacesJSON() const;
+    std::string getInterfacesJSON() const;
+    std::string getInterfaceName() const;
+    bool isPromiscuous() const;
+    // pcap LINKTYPE and snapshot length of the open handle (Ethernet and
+    // 65536 before initialize)
+    int getLinkType() const;
+    int getSnapshotLength() const;
     std::string getLastError() const;
 
 private:
@@ -34,6 +48,11 @@ private:
     std::string last_error_;
     PacketCallback packet_callback_;
     bool is_capturing_;
+    std::string device_name_;
+    bool promiscuous_;
+    bool has_filter_;
+    std::string current_filter_;
+    std::map<std::string, struct bpf_program> compiled_filters_;
 
     static void packetHandler(uint8_t *user_data, const struct pcap_pkthdr *header, const uint8_t *packet);
     std::string selectInterface();
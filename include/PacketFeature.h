@@ -1,10 +1,191 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 #include <chrono>
+#include <cstring>
 
+// Raw network-order address, kept next to the formatted string so state
+// tables can key on it without reparsing text.
+struct IpAddress
+{
+    uint8_t family; // 4 or 6, 0 = unset
+    uint8_t bytes[16];
+
+    IpAddress() : family(0) { std::memset(bytes, 0, sizeof(bytes)); }
+
+    bool operator==(const IpAddress &other) const
+    {
+        return family == other.family && std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+};
+
+// Transport header fields, present when the L4 header is in the packet (or
+// was attributed from the first fragment of the same datagram).
+struct TransportFeature
+{
+    bool present;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t tcp_flags;
+
+    TransportFeature() : present(false), src_port(0), dst_port(0), tcp_flags(0) {}
+};
+
+struct FragmentFeature
+{
+    bool is_fragment;
+    bool more_fragments;
+    uint32_t identification; // IPv4 ID or IPv6 fragment header ID
+    uint32_t offset_bytes;
+    uint32_t payload_bytes;  // fragment payload length from the IP header
+    // Filled in by FragmentTracker
+    uint32_t datagram_size;  // reassembled payload length, 0 if never complete
+    bool complete;
+    bool l4_inferred;        // transport fields copied from the first fragment
+    bool overlap;            // overlaps bytes of an earlier fragment
+    bool tiny;               // too small to be a legitimate non-last fragment
+
+    FragmentFeature() : is_fragment(false), more_fragments(false), identification(0), offset_bytes(0),
+                        payload_bytes(0), datagram_size(0), complete(false), l4_inferred(false),
+                        overlap(false), tiny(false) {}
+};
+
+// Recent activity of one host, counted over a sliding time window and over
+// the last packets of the capture; includes the packet itself
+struct HostContext
+{
+    uint32_t packets;
+    uint64_t bytes;
+    uint32_t syns;           // TCP SYN without ACK, i.e. connection attempts
+    uint16_t distinct_peers; // estimated, saturates around 250
+    uint16_t distinct_ports; // destination ports, estimated like peers
+    uint16_t recent_packets; // among the last HostWindowTracker::COUNT_WINDOW packets
+
+    HostContext() : packets(0), bytes(0), syns(0), distinct_peers(0), distinct_ports(0), recent_packets(0) {}
+};
+
+// Filled by HostWindowTracker: the source as a sender and the destination
+// as a receiver
+struct HostWindowFeature
+{
+    bool present;
+    HostContext src;
+    HostContext dst;
+
+    HostWindowFeature() : present(false) {}
+};
+
+// Filled by PrefixEnricher: per prefix list kind (ASN, subnet, GeoIP; see
+// PrefixTable), the label of the longest prefix matching each address,
+// empty when none matched
+struct EnrichmentFeature
+{
+    static const int KINDS = 3;
+
+    bool present;
+    std::string_view src[KINDS];
+    std::string_view dst[KINDS];
+
+    EnrichmentFeature() : present(false) {}
+};
+
+// Encapsulation layers removed by PacketParser when tunnel decapsulation
+// is enabled, outermost first, and the features of the innermost packet.
+// The row's own IPv4/IPv6 fields always describe the outer packet.
+struct TunnelFeature
+{
+    static const int MAX_DEPTH = 4;
+
+    enum class Type : uint8_t
+    {
+        NONE,
+        GRE,
+        IPIP,        // IPv4 or IPv6 directly in IP (protocol 4 or 41), except:
+        SIX_IN_FOUR, // IPv6 in IPv4 (protocol 41)
+        VXLAN,
+        GENEVE
+    };
+
+    uint8_t depth; // layers removed, 0 = not tunnelled
+    Type types[MAX_DEPTH];
+    uint32_t id;   // VXLAN/GENEVE VNI or GRE key of the innermost layer with one
+    bool has_id;
+
+    uint8_t inner_version;
+    uint8_t inner_protocol; // after inner IPv6 extension headers
+    uint16_t inner_length;  // inner IP header plus payload, from the inner header
+    IpAddress inner_src_ip;
+    IpAddress inner_dst_ip;
+    std::string_view inner_src_address;
+    std::string_view inner_dst_address;
+    TransportFeature inner_transport;
+
+    TunnelFeature() : depth(0), types(), id(0), has_id(false), inner_version(0), inner_protocol(0), inner_length(0) {}
+};
+
+// Decoded IPv6 extension header chain, in packet order. The walk stops at
+// the first upper-layer protocol, at ESP (everything after it is
+// encrypted), at a non-first fragment, or after MAX_HEADERS headers.
+struct IPv6ExtensionChain
+{
+    static const int MAX_HEADERS = 8;
+
+    enum Flag : uint8_t
+    {
+        TRUNCATED = 1 << 0,     // a header runs past the captured bytes
+        TOO_DEEP = 1 << 1,      // more than MAX_HEADERS headers
+        HBH_NOT_FIRST = 1 << 2, // Hop-by-Hop after another header (RFC 8200 4.1)
+        ENCRYPTED = 1 << 3      // chain ends at ESP
+    };
+
+    uint8_t count;
+    uint8_t flags;
+    uint8_t types[MAX_HEADERS];
+    uint16_t lengths[MAX_HEADERS]; // bytes, including the 2-byte type/length prefix
+    uint8_t final_protocol;        // next header after the last decoded one
+    uint16_t l4_offset;            // bytes after the fixed header to final_protocol
+
+    IPv6ExtensionChain() : count(0), flags(0), final_protocol(0), l4_offset(0) {}
+};
+
+// Non-owning view of bytes, like std::string_view for binary data
+struct ByteView
+{
+    const uint8_t *data;
+    size_t size;
+
+    ByteView() : data(nullptr), size(0) {}
+    ByteView(const uint8_t *d, size_t n) : data(d), size(n) {}
+
+    bool empty() const { return size == 0; }
+    const uint8_t *begin() const { return data; }
+    const uint8_t *end() const { return data + size; }
+};
+
+// Statistics of the captured L4 payload (after the TCP/UDP/SCTP/ICMP header;
+// the whole fragment for non-first fragments), filled by PacketParser when
+// payload features are enabled. Bytes the snapshot length cut off are not
+// seen, and Ethernet padding past the IP length is excluded.
+struct PayloadFeature
+{
+    static const int BUCKETS = 16;
+
+    bool present;
+    uint16_t length;               // captured payload bytes
+    float entropy;                 // Shannon entropy, bits per byte (0-8)
+    float printable_ratio;         // share of 0x20-0x7E, tab, LF and CR
+    uint16_t buckets[BUCKETS];     // byte counts by high nibble (0x00-0x0F, 0x10-0x1F, ...)
+    ByteView head;                 // first bytes, up to the configured head length
+
+    PayloadFeature() : present(false), length(0), entropy(0), printable_ratio(0), buckets() {}
+};
+
+// Variable-length fields are views: the text and bytes live in the Arena of
+// the PacketBatch holding the row (see relocateVariableFields), and
+// protocol_name points at a static string.
 struct IPv4PacketFeature
 {
     std::chrono::system_clock::time_point timestamp;
@@ -18,14 +199,16 @@ struct IPv4PacketFeature
     uint8_t ttl;
     uint8_t protocol;
     uint16_t header_checksum;
-    std::string src_address;
-    std::string dst_address;
-    std::vector<uint8_t> options;
-    std::string protocol_name;
+    bool checksum_error; // header checksum present but did not verify
+    std::string_view src_address;
+    std::string_view dst_address;
+    ByteView options;
+    std::string_view protocol_name;
 
     IPv4PacketFeature() : version(0), ihl(0), tos(0), total_length(0),
                           identification(0), flags(0), fragment_offset(0),
-                          ttl(0), protocol(0), header_checksum(0), protocol_name("UNKNOWN") {}
+                          ttl(0), protocol(0), header_checksum(0), checksum_error(false),
+                          protocol_name("UNKNOWN") {}
 };
 
 struct IPv6PacketFeature
@@ -37,10 +220,11 @@ struct IPv6PacketFeature
     uint16_t payload_length;
     uint8_t next_header;
     uint8_t hop_limit;
-    std::string src_address;
-    std::string dst_address;
-    std::vector<std::string> extension_headers;
-    std::string protocol_name;
+    std::string_view src_address;
+    std::string_view dst_address;
+    std::string_view extension_headers; // "Header43,Header44,..." in chain order
+    IPv6ExtensionChain extensions;
+    std::string_view protocol_name;
 
     IPv6PacketFeature() : version(0), traffic_class(0), flow_label(0),
                           payload_length(0), next_header(0), hop_limit(0), protocol_name("UNKNOWN") {}
@@ -55,6 +239,104 @@ struct PacketFeature
     } type;
     IPv4PacketFeature ipv4;
     IPv6PacketFeature ipv6;
+    IpAddress src_ip;
+    IpAddress dst_ip;
+    uint8_t l4_protocol; // final protocol after IPv6 extension headers
+    uint16_t l4_offset;  // from the start of the IP header to the L4 header
+    TransportFeature transport;
+    FragmentFeature fragment;
+    TunnelFeature tunnel;
+    HostWindowFeature host_window;
+    EnrichmentFeature enrichment;
+    PayloadFeature payload;
+    std::string_view interface_name; // ingress interface; owned by the capture session, not the arena
+    std::string_view label;          // ground-truth class from RuleLabeler, in the batch arena
 
-    PacketFeature(Type t) : type(t) {}
-};
\ No newline at end of file
+    PacketFeature(Type t) : type(t), l4_protocol(0), l4_offset(0) {}
+};
+
+// Calls text(view) and bytes(view) for every variable-length field of the
+// feature (std::string_view and ByteView), in a fixed order
+template <typename Feature, typename TextFn, typename BytesFn>
+inline void visitVariableFields(Feature &feature, TextFn text, BytesFn bytes)
+{
+    if (feature.type == PacketFeature::Type::IPv4)
+    {
+        text(feature.ipv4.src_address);
+        text(feature.ipv4.dst_address);
+        bytes(feature.ipv4.options);
+    }
+    else
+    {
+        text(feature.ipv6.src_address);
+        text(feature.ipv6.dst_address);
+        text(feature.ipv6.extension_headers);
+    }
+    text(feature.tunnel.inner_src_address);
+    text(feature.tunnel.inner_dst_address);
+    for (int kind = 0; kind < EnrichmentFeature::KINDS; ++kind)
+    {
+        text(feature.enrichment.src[kind]);
+        text(feature.enrichment.dst[kind]);
+    }
+    text(feature.label);
+    bytes(feature.payload.head);
+}
+
+// Bytes needed to hold a copy of the feature's variable-length fields
+inline size_t variableFieldBytes(const PacketFeature &feature)
+{
+    size_t total = 0;
+    auto count_text = [&total](const std::string_view &text)
+    {
+        total += text.size();
+    };
+    auto count_bytes = [&total](const ByteView &bytes)
+    {
+        total += bytes.size;
+    };
+    visitVariableFields(feature, count_text, count_bytes);
+    return total;
+}
+
+// Copies the variable-length fields into storage (variableFieldBytes long)
+// and points the views at the copies. Used when a row moves to storage with
+// a different lifetime, e.g. held by FragmentTracker across batches.
+inline void relocateVariableFields(PacketFeature &feature, char *storage)
+{
+    auto move_text = [&storage](std::string_view &text)
+    {
+        if (text.empty())
+            return;
+        std::memcpy(storage, text.data(), text.size());
+        text = std::string_view(storage, text.size());
+        storage += text.size();
+    };
+    auto move_bytes = [&storage](ByteView &bytes)
+    {
+        if (bytes.empty())
+            return;
+        std::memcpy(storage, bytes.data, bytes.size);
+        bytes.data = reinterpret_cast<const uint8_t *>(storage);
+        storage += bytes.size;
+    };
+    visitVariableFields(feature, move_text, move_bytes);
+}
+
+// After a block holding relocated fields was copied from old_base to
+// new_base (e.g. rows read back from a spill segment), points the views at
+// the same offsets in the copy
+inline void rebaseVariableFields(PacketFeature &feature, uintptr_t old_base, const char *new_base)
+{
+    auto rebase_text = [old_base, new_base](std::string_view &text)
+    {
+        if (!text.empty())
+            text = std::string_view(new_base + (reinterpret_cast<uintptr_t>(text.data()) - old_base), text.size());
+    };
+    auto rebase_bytes = [old_base, new_base](ByteView &bytes)
+    {
+        if (!bytes.empty())
+            bytes.data = reinterpret_cast<const uint8_t *>(new_base + (reinterpret_cast<uintptr_t>(bytes.data) - old_base));
+    };
+    visitVariableFields(feature, rebase_text, rebase_bytes);
+}
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "PacketFeature.h"
+#include "PayloadKernels.h"
+#include "Arena.h"
 #include <memory>
 #include <optional>
 #include <chrono>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #ifdef _WIN32
 #include <pcap.h>
@@ -20,19 +24,68 @@ public:
     PacketParser();
     ~PacketParser();
 
-    optional<PacketFeature> processPacket(const uint8_t *packet, int packet_size, const struct pcap_pkthdr *header);
+    // Variable-length fields of the result (addresses, options, extension
+    // header text) are stored in arena and stay valid until it is reset
+    optional<PacketFeature> processPacket(const uint8_t *packet, int packet_size, const struct pcap_pkthdr *header,
+                                          Arena &arena);
+
+    // Depth used when the tunnel columns are requested without a depth
+    static const int DEFAULT_TUNNEL_DEPTH = 2;
+
+    // Encapsulation layers to remove from each packet in processPacket
+    // (0 = off, the default; capped at TunnelFeature::MAX_DEPTH)
+    void setTunnelDepth(int depth);
+    int getTunnelDepth() const;
+
+    // Largest payload head copied into PayloadFeature::head
+    static const size_t MAX_PAYLOAD_HEAD_BYTES = 1500;
+
+    // Fills PacketFeature::payload in processPacket, copying up to
+    // head_bytes leading payload bytes (capped at MAX_PAYLOAD_HEAD_BYTES).
+    // Off by default.
+    void setPayloadFeatures(bool enabled, size_t head_bytes = 0);
+    bool getPayloadFeatures() const;
+
+    // Renders the address text fields in processPacket (on by default). A
+    // session whose stages replace the addresses and their text turns it off.
+    void setAddressText(bool enabled);
+
+    // The returned reference stays valid for the life of the program
+    static const string &getProtocolName(uint8_t protocol_number);
+    static const char *getTunnelTypeName(TunnelFeature::Type type);
 
 private:
     static const int ETHERNET_HEADER_SIZE = 14;
     static const int IPV4_MIN_HEADER_SIZE = 20;
     static const int IPV6_HEADER_SIZE = 40;
 
-    optional<IPv4PacketFeature> parseIPv4(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp);
-    optional<IPv6PacketFeature> parseIPv6(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp);
+    // Where an encapsulated IP header starts, pointing into the frame
+    struct InnerPacket
+    {
+        TunnelFeature::Type type;
+        const uint8_t *data;
+        int size;
+        uint32_t id;
+        bool has_id;
+
+        InnerPacket() : type(TunnelFeature::Type::NONE), data(nullptr), size(0), id(0), has_id(false) {}
+    };
+
+    int tunnel_depth_;
+    const PayloadKernels *payload_kernels_; // null while payload features are off
+    size_t payload_head_bytes_;
+    bool address_text_;
+
+    bool parseIPv4(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp,
+                   Arena &arena, PacketFeature &packet);
+    bool parseIPv6(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp,
+                   Arena &arena, PacketFeature &packet);
+    void decapsulate(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp,
+                     Arena &arena, PacketFeature &packet);
+    void extractPayload(const uint8_t *ip_header, int remaining_size, Arena &arena, PacketFeature &packet);
+    void parseTransport(uint8_t protocol, const uint8_t *data, int remaining_size, TransportFeature &transport);
 
-    string getProtocolName(uint8_t protocol_number);
-    string ipv4ToString(uint32_t ip);
-    string ipv6ToString(const uint8_t *ip);
-    string bytesToHex(const uint8_t *data, size_t length);
-    string parseIPv6ExtensionHeaders(const uint8_t *data, int remaining_size, uint8_t &next_header);
+    static bool locateInnerPacket(uint8_t outer_version, uint8_t protocol, const TransportFeature &transport,
+                                  const uint8_t *payload, int payload_size, InnerPacket &inner);
+    string_view formatAddress(const IpAddress &address, Arena &arena) const;
 };
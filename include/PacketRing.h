@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <pcap.h>
+#else
+#include <pcap/pcap.h>
+#endif
+
+// Pre-trigger buffer of raw frames: the capture thread copies every frame
+// into a preallocated byte ring that keeps the last retention_seconds of
+// capture time within a fixed memory budget. triggerDump() hands the
+// retained window to a writer thread, which writes it as pcapng while the
+// capture thread keeps filling the ring.
+//
+// Records still waiting to be written are never overwritten: while a dump
+// is in progress, a frame that would need their space is left out of the
+// ring (counted in packets_skipped) rather than stalling capture. Only one
+// dump is written at a time.
+class PacketRing
+{
+public:
+    struct Config
+    {
+        int retention_seconds;
+        size_t memory_bytes;
+        std::string path_prefix; // dumps go to <prefix>-<UTC time>-<n>.pcapng
+        int link_type;           // pcap LINKTYPE of the frames
+        uint32_t snapshot_length;
+
+        Config() : retention_seconds(30), memory_bytes(64u << 20), link_type(DLT_EN10MB), snapshot_length(65536) {}
+    };
+
+    struct Stats
+    {
+        uint64_t packets_stored;
+        uint64_t packets_skipped; // too large for the ring, or space pinned by a dump
+        uint64_t dumps_written;
+        uint64_t dumps_refused;   // triggered while a dump was being written
+        uint64_t packets_dumped;
+    };
+
+    explicit PacketRing(const Config &config);
+    ~PacketRing();
+
+    // Allocates the ring and starts the writer thread
+    bool start();
+    // Waits for a dump in progress, then stops the writer thread
+    void stop();
+
+    // Capture thread only
+    void push(const struct pcap_pkthdr *header, const uint8_t *data);
+    // Capture thread only. Returns false (and counts a refused dump) while
+    // the previous dump is still being written. reason goes into the file
+    // as a section comment.
+    bool triggerDump(const std::string &reason);
+
+    Stats getStats() const;
+    std::string getLastDumpPath() const;
+    std::string getLastError() const;
+
+private:
+    struct RecordHeader
+    {
+        int64_t timestamp_us;
+        uint32_t caplen; // WRAP_MARKER: rest of the lap is unused
+        uint32_t wire_length;
+    };
+
+    static const uint32_t WRAP_MARKER = 0xFFFFFFFFu;
+
+    Config config_;
+    std::unique_ptr<uint8_t[]> buffer_;
+    size_t capacity_;
+    // Monotonic byte positions; physical offset = position % capacity_.
+    // head_ and tail_ belong to the capture thread.
+    uint64_t head_;
+    uint64_t tail_;
+    int64_t newest_us_;
+
+    // Dump hand-off. dump_read_ is advanced by the writer as records are
+    // copied out; the capture thread never evicts at or past it while
+    // dump_active_ is set.
+    std::atomic<bool> dump_active_;
+    std::atomic<uint64_t> dump_read_;
+    uint64_t dump_end_;
+    std::string dump_path_;
+    std::string dump_reason_;
+    uint64_t dump_sequence_;
+
+    std::thread writer_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool running_;
+    bool dump_pending_;
+    std::string last_dump_path_;
+    std::string last_error_;
+
+    std::atomic<uint64_t> packets_stored_;
+    std::atomic<uint64_t> packets_skipped_;
+    std::atomic<uint64_t> dumps_written_;
+    std::atomic<uint64_t> dumps_refused_;
+    std::atomic<uint64_t> packets_dumped_;
+
+    bool evictOldest();
+    void evictExpired(int64_t newest_us);
+    const RecordHeader *recordAt(uint64_t &position) const;
+    void writerLoop();
+    bool writeDump(uint64_t start, uint64_t end, const std::string &path, const std::string &reason);
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Byte-value counting over packet payloads, one implementation per
+// strategy; all of them produce identical counts.
+//
+// count_bytes: adds the occurrences of every byte value in data to
+//   counts[256]. length must not exceed 65535.
+struct PayloadKernels
+{
+    const char *name;
+    void (*count_bytes)(const uint8_t *data, size_t length, uint32_t *counts);
+};
+
+// Fastest implementation on the running CPU. Scatter-based SIMD counting is
+// not faster than split tables on every CPU that supports it, so the choice
+// is made once by timing each available kernel on a synthetic payload.
+const PayloadKernels &getPayloadKernels();
+// Every implementation the running CPU supports, scalar first
+std::vector<const PayloadKernels *> getAvailablePayloadKernels();
+
+// Fills length, entropy, printable_ratio and buckets of feature from the
+// byte counts of a payload of length bytes
+void summarisePayload(const uint32_t *counts, size_t length, PayloadFeature &feature);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "OutputSink.h"
+#include <fstream>
+
+// Side tensor of leading payload bytes for deep-learning datasets: a NumPy
+// .npy file holding one uint8 row of head_bytes per packet, in the same
+// order as the CSV rows, zero-padded past the captured payload (the CSV
+// payload columns give each row's PayloadBytes). The shape in the header
+// is rewritten when the sink closes; an existing file is replaced.
+class PayloadTensorSink : public OutputSink
+{
+public:
+    static const size_t DEFAULT_HEAD_BYTES = 64;
+
+    PayloadTensorSink(const std::string &filename, size_t head_bytes = DEFAULT_HEAD_BYTES);
+    ~PayloadTensorSink();
+
+    bool open() override;
+    bool consume(const PacketBatch &batch) override;
+    void close() override;
+
+    std::string getName() const override;
+    std::string getLastError() const override;
+    std::string getSummary() const override;
+
+    size_t getPayloadHeadBytes() const override { return head_bytes_; }
+
+private:
+    std::string filename_;
+    size_t head_bytes_;
+    std::fstream file_;
+    std::string last_error_;
+    uint64_t rows_;
+    std::string block_;
+
+    std::string buildHeader() const;
+};
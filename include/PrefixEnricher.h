@@ -0,0 +1,86 @@
+#pragma once
+
+#include "FeatureStage.h"
+#include "PrefixTable.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+
+// One prefix list file and the kind of label it provides
+struct PrefixSource
+{
+    int kind; // index into PrefixTable::KIND_NAMES
+    std::string path;
+};
+
+// Labels the source and destination of every row from prefix lists
+// (EnrichmentFeature), looked up in a PrefixTable built from all of them.
+//
+// A watcher thread checks the files every RELOAD_CHECK_SECONDS; when one has
+// changed it builds a new table off the capture thread and publishes it. The
+// capture thread notices through a generation counter and switches tables
+// between two rows, and hands the old table back so that it is freed on the
+// watcher thread. A list that fails to load keeps the previous table. Labels
+// are copied into the row's batch arena, so rows never refer to a table
+// after it is replaced.
+class PrefixEnricher : public FeatureStage
+{
+public:
+    static const int RELOAD_CHECK_SECONDS = 2;
+
+    struct Stats
+    {
+        uint64_t rows;
+        uint64_t addresses_matched; // addresses with at least one label
+        uint64_t reloads;
+        uint64_t reload_failures;
+
+        Stats() : rows(0), addresses_matched(0), reloads(0), reload_failures(0) {}
+    };
+
+    // "<kind>=<file>[,<kind>=<file>...]" with kind asn, subnet or geo
+    static bool parseSpec(const std::string &spec, std::vector<PrefixSource> &sources, std::string &error);
+
+    explicit PrefixEnricher(const std::vector<PrefixSource> &sources);
+    ~PrefixEnricher();
+
+    // Loads the lists and starts the watcher; false (see getLastError) when
+    // a list cannot be read
+    bool start();
+
+    void process(PacketRecord &record, Arena &arena) override;
+
+    std::string getName() const override { return "enrich"; }
+    std::string getSummary() const override;
+    Stats getStats() const;
+    std::string getLastError() const { return last_error_; }
+
+private:
+    std::vector<PrefixSource> sources_;
+    std::shared_ptr<const PrefixTable> table_; // capture thread only
+    uint64_t table_generation_;
+    uint64_t rows_;
+    uint64_t addresses_matched_;
+    std::string last_error_;
+
+    // Shared with the watcher
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    std::shared_ptr<const PrefixTable> published_;
+    std::shared_ptr<const PrefixTable> retired_;
+    std::atomic<uint64_t> generation_;
+    uint64_t reloads_;
+    uint64_t reload_failures_;
+    std::thread watcher_;
+    std::vector<std::filesystem::file_time_type> modified_;
+
+    std::shared_ptr<const PrefixTable> load(std::string &error) const;
+    bool checkModified();
+    void watchLoop();
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdlib>
+
+// Longest-prefix-match labels for addresses, from prefix lists of up to
+// KINDS kinds (ASN, internal subnet, GeoIP). Built once, then read-only, so
+// any number of threads may look up while another builds a replacement.
+//
+// All kinds share one structure. Every lookup entry holds a leaf, the
+// combination of labels (one per kind) of the longest matching prefixes;
+// prefixes are painted over the entries in ascending length order, each
+// replacing its own kind's label in the leaves it covers, so one lookup
+// answers every kind.
+//
+// IPv4 is a DIR-24-8 table: 2^24 entries indexed by the top 24 bits, and
+// for /25-/32 prefixes a group of 256 entries for the last byte, i.e. one or
+// two memory reads. The 64 MiB first level is calloc'ed, so the kernel only
+// backs the pages that prefixes were painted on. IPv6 is a multibit trie
+// with leaf pushing: a 65536-entry root for the first 16 bits, then 16-entry
+// nodes (one cache line) per further 4 bits, as deep as the longest prefix
+// on the path.
+class PrefixTable
+{
+public:
+    static const int KINDS = 3;
+    static const char *const KIND_NAMES[KINDS]; // "asn", "subnet", "geo"
+
+    PrefixTable();
+    PrefixTable(const PrefixTable &) = delete;
+    PrefixTable &operator=(const PrefixTable &) = delete;
+
+    // Reads "<address>[/<length>] <label>" lines, the prefix ending at the
+    // first comma or whitespace; '#' starts a comment line. Prefixes are
+    // collected until build().
+    bool loadFile(int kind, const std::string &path);
+    bool addPrefix(int kind, const std::string &prefix, const std::string &label);
+    bool build();
+
+    // Leaf of the longest matching prefixes, 0 when nothing matched
+    uint32_t lookup(const IpAddress &address) const
+    {
+        if (address.family == 4)
+        {
+            if (!tbl24_)
+                return 0;
+            uint32_t index = (static_cast<uint32_t>(address.bytes[0]) << 16) | (address.bytes[1] << 8) | address.bytes[2];
+            uint32_t entry = tbl24_.get()[index];
+            if (entry & POINTER)
+                entry = tbl8_[((entry & ~POINTER) << 8) | address.bytes[3]];
+            return entry;
+        }
+        if (address.family == 6)
+        {
+            if (root6_.empty())
+                return 0;
+            uint32_t entry = root6_[(address.bytes[0] << 8) | address.bytes[1]];
+            for (int bit = 16; entry & POINTER; bit += STRIDE)
+                entry = nodes6_[((entry & ~POINTER) << STRIDE) | nibble(address.bytes, bit)];
+            return entry;
+        }
+        return 0;
+    }
+
+    std::string_view getLabel(uint32_t leaf, int kind) const { return labels_[leaves_[leaf][kind]]; }
+    bool hasKind(int kind) const { return kind_prefixes_[kind] > 0; }
+
+    size_t getPrefixCount(int family) const { return family == 4 ? prefixes4_ : prefixes6_; }
+    size_t getMemoryBytes() const;
+    std::string getLastError() const { return last_error_; }
+
+private:
+    static const uint32_t POINTER = 0x80000000u; // entry is a tbl8 group or trie node index
+    static const int STRIDE = 4;
+
+    struct PendingPrefix
+    {
+        IpAddress network;
+        uint8_t length;
+        uint8_t kind;
+        uint32_t label;
+    };
+
+    struct LeafHash
+    {
+        size_t operator()(const std::array<uint32_t, KINDS> &leaf) const
+        {
+            uint64_t hash = 0;
+            for (uint32_t label : leaf)
+                hash = (hash ^ label) * 0x9E3779B97F4A7C15ULL;
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    std::unique_ptr<uint32_t, void (*)(void *)> tbl24_;
+    std::vector<uint32_t> tbl8_;
+    std::vector<uint32_t> root6_;
+    std::vector<uint32_t> nodes6_;
+
+    std::vector<std::string> labels_; // 0 = ""
+    std::unordered_map<std::string, uint32_t> label_ids_;
+    std::vector<std::array<uint32_t, KINDS>> leaves_; // 0 = no labels
+    std::unordered_map<std::array<uint32_t, KINDS>, uint32_t, LeafHash> leaf_ids_;
+
+    std::vector<PendingPrefix> pending_;
+    size_t prefixes4_;
+    size_t prefixes6_;
+    size_t kind_prefixes_[KINDS];
+    std::string last_error_;
+
+    static uint32_t nibble(const uint8_t *bytes, int bit)
+    {
+        uint8_t byte = bytes[bit >> 3];
+        return (bit & 4) ? (byte & 0x0F) : (byte >> 4);
+    }
+
+    uint32_t withLabel(uint32_t leaf, int kind, uint32_t label);
+    void paint(uint32_t *entries, size_t count, int kind, uint32_t label);
+    void insert4(const PendingPrefix &prefix);
+    void insert6(const PendingPrefix &prefix);
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "FeatureStage.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Ground-truth labels for supervised datasets (PacketFeature::label) from a
+// rules file; the first rule matching a row gives its label:
+//
+//   # <label> [<field>=<values> ...]
+//   default benign
+//   ddos  dst=192.0.2.10 dport=80 proto=tcp time=2026-10-01T10:00:00Z..2026-10-01T10:30:00Z
+//   scan  src=198.51.100.0/24,198.51.100.7-198.51.100.9
+//   c2    host=203.0.113.5 port=443,8443
+//
+// Fields are src, dst, host (either address), sport, dport, port (either
+// port), proto (name or number) and time (UTC ISO 8601 or epoch seconds;
+// either end may be left open). Values are comma-separated single values,
+// ranges (a-b; a..b for time) and address prefixes. A rule without fields
+// matches every row; rows no rule matches get the default label (empty
+// unless set).
+//
+// The rules are compiled into one decision structure: each field's value
+// space is split into elementary intervals at the bounds of the rules'
+// ranges, and every interval holds the bitset of rules accepting it. Ports
+// and protocol index direct tables, addresses and time are binary-searched
+// (IPv4 within its /16 block; time first tries the previous interval, as rows
+// come in time order), and
+// the matching rule is the lowest bit of the AND of the row's bitsets.
+class RuleLabeler : public FeatureStage
+{
+public:
+    explicit RuleLabeler(const std::string &path);
+
+    // Reads and compiles the rules; false (see getLastError) on a bad rule
+    bool load();
+
+    void process(PacketRecord &record, Arena &arena) override;
+
+    std::string getName() const override { return "labels"; }
+    std::string getSummary() const override;
+    std::string getLastError() const { return last_error_; }
+
+    // Label for the row's fields, "" or the default label when no rule matches
+    const std::string &classify(const PacketFeature &feature);
+    size_t getRuleCount() const { return rule_labels_.size(); }
+
+    struct Address128
+    {
+        uint64_t high;
+        uint64_t low;
+
+        bool operator<(const Address128 &other) const { return high != other.high ? high < other.high : low < other.low; }
+        bool operator==(const Address128 &other) const { return high == other.high && low == other.low; }
+    };
+
+    // Elementary intervals of one field: starts[i] begins the interval whose
+    // rule bitset is at words_[sets[i]]. IPv4 fields also index the interval
+    // holding the start of every /16 block, which narrows the search to the
+    // block's intervals (usually just one).
+    template <typename Key>
+    struct Dimension
+    {
+        bool used;
+        std::vector<Key> starts;
+        std::vector<uint32_t> sets;
+        std::vector<uint32_t> blocks;
+
+        Dimension() : used(false) {}
+    };
+
+private:
+    std::string path_;
+    std::string last_error_;
+
+    std::vector<std::string> labels_;       // distinct labels in order of appearance
+    uint32_t default_label_;                // index into labels_
+    std::vector<uint32_t> rule_labels_;     // compiled rule -> label index
+    std::vector<uint64_t> label_counts_;
+    size_t words_per_set_;
+    std::vector<uint64_t> words_;           // interned rule bitsets
+
+    Dimension<uint64_t> src4_;
+    Dimension<uint64_t> dst4_;
+    Dimension<Address128> src6_;
+    Dimension<Address128> dst6_;
+    Dimension<int64_t> time_;
+    std::vector<uint32_t> sport_;           // direct, index 65536 = no transport header
+    std::vector<uint32_t> dport_;
+    std::vector<uint32_t> proto_;           // direct, 256 entries
+    bool ports_used_;
+    bool proto_used_;
+    size_t last_time_segment_;
+
+    uint32_t match(const PacketFeature &feature);
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "OutputSink.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+
+struct SinkStats
+{
+    std::string name;
+    uint64_t batches_written;
+    uint64_t rows_written;
+    uint64_t write_errors;
+    uint64_t producer_stalls; // submit() waited for this sink's queue
+    uint64_t rows_submitted;
+    uint64_t rows_dropped;     // drop-newest, drop-oldest, or a failed spill
+    uint64_t rows_sampled_out; // skipped by sample
+    uint64_t rows_spilled;     // went through the overflow segment
+    uint64_t spill_peak_bytes;
+    std::string summary;
+};
+
+// What a sink's queue does when it is full (queue_depth batches or
+// queue_bytes of batch memory)
+struct BackpressurePolicy
+{
+    enum class Mode
+    {
+        BLOCK,       // submit() waits: capture slows, the kernel may drop
+        DROP_NEWEST, // the incoming batch is skipped for this sink
+        DROP_OLDEST, // queued batches are discarded to make room
+        SAMPLE,      // above half full only every sample_every-th batch is queued
+        SPILL,       // batches go to an on-disk segment, drained in order
+    };
+
+    Mode mode;
+    size_t queue_bytes;
+    int sample_every;
+    std::string spill_directory;
+
+    BackpressurePolicy() : mode(Mode::BLOCK), queue_bytes(256u << 20), sample_every(10) {}
+
+    // "block", "drop-newest", "drop-oldest", "sample[:<n>]" or "spill[:<dir>]"
+    static bool parse(const std::string &spec, BackpressurePolicy &policy, std::string &error);
+    static const char *getModeName(Mode mode);
+};
+
+// Delivers every batch to several sinks. Each sink gets its own thread and a
+// bounded queue of shared batch pointers; the batch itself is never copied.
+// A full queue is handled by the BackpressurePolicy: by default submit()
+// waits, so a slow sink slows capture instead of losing rows.
+//
+// With SPILL, a batch that does not fit is serialized to the sink's
+// overflow segment (rows plus their variable-length fields, columns rebuilt
+// on reading) and so is every later batch until the sink has read the
+// segment back, so rows keep their order. The segment is reset each time it
+// is drained.
+class SinkFanout
+{
+public:
+    static const size_t DEFAULT_QUEUE_DEPTH = 64;
+
+    explicit SinkFanout(size_t queue_depth = DEFAULT_QUEUE_DEPTH,
+                        const BackpressurePolicy &policy = BackpressurePolicy());
+    ~SinkFanout();
+
+    void addSink(std::unique_ptr<OutputSink> sink);
+    bool start();
+    void submit(SharedPacketBatch batch);
+    void stop();
+
+    size_t getSinkCount() const;
+    bool wantsColumns() const;
+    // Largest payload head any sink reads
+    size_t getPayloadHeadBytes() const;
+    std::vector<SinkStats> getStats() const;
+    const BackpressurePolicy &getPolicy() const { return policy_; }
+    std::string getLastError() const;
+
+private:
+    struct Lane
+    {
+        std::unique_ptr<OutputSink> sink;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::deque<SharedPacketBatch> queue;
+        size_t queued_bytes;
+        bool closing;
+        uint64_t sample_counter;
+        std::atomic<uint64_t> batches_written;
+        std::atomic<uint64_t> rows_written;
+        std::atomic<uint64_t> write_errors;
+        std::atomic<uint64_t> producer_stalls;
+        std::atomic<uint64_t> rows_submitted;
+        std::atomic<uint64_t> rows_dropped;
+        std::atomic<uint64_t> rows_sampled_out;
+        std::atomic<uint64_t> rows_spilled;
+
+        // Overflow segment: written by the producer, read by the worker.
+        // spill_mutex covers the file; spill_pending is under mutex.
+        std::mutex spill_mutex;
+        std::string spill_path;
+        std::ofstream spill_out;
+        std::ifstream spill_in;
+        size_t spill_pending;       // batches written but not yet read back
+        uint64_t spill_bytes;       // written since the last reset
+        uint64_t spill_read_offset; // start of the next batch to read back
+        std::atomic<uint64_t> spill_peak_bytes;
+        std::string spill_buffer;   // producer scratch
+        PacketBatch spill_batch;    // worker scratch for batches read back
+
+        Lane() : queued_bytes(0), closing(false), sample_counter(0), batches_written(0), rows_written(0),
+                 write_errors(0), producer_stalls(0), rows_submitted(0), rows_dropped(0), rows_sampled_out(0),
+                 rows_spilled(0), spill_pending(0), spill_bytes(0), spill_read_offset(0), spill_peak_bytes(0) {}
+    };
+
+    size_t queue_depth_;
+    BackpressurePolicy policy_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    bool started_;
+    std::string last_error_;
+
+    void runLane(Lane &lane);
+    void deliver(Lane &lane, const PacketBatch &batch);
+    bool spillBatch(Lane &lane, const PacketBatch &batch);
+    bool readSpilledBatch(Lane &lane);
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// SipHash-2-4 (Aumasson and Bernstein) of whole 64-bit words under a 128-bit
+// key: a keyed hash whose outputs cannot be steered without the key. Used for
+// keyed permutations (Anonymizer) and flow splits (DatasetWriter).
+inline uint64_t sipRotate(uint64_t x, int b)
+{
+    return (x << b) | (x >> (64 - b));
+}
+
+inline void sipRound(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3)
+{
+    v0 += v1;
+    v1 = sipRotate(v1, 13);
+    v1 ^= v0;
+    v0 = sipRotate(v0, 32);
+    v2 += v3;
+    v3 = sipRotate(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = sipRotate(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = sipRotate(v1, 17);
+    v1 ^= v2;
+    v2 = sipRotate(v2, 32);
+}
+
+// words are taken as little-endian 8-byte blocks of a count * 8 byte message
+inline uint64_t sipHash(const uint64_t *key, const uint64_t *words, size_t count)
+{
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+    for (size_t i = 0; i < count; ++i)
+    {
+        v3 ^= words[i];
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= words[i];
+    }
+    uint64_t last = static_cast<uint64_t>(count * 8) << 56;
+    v3 ^= last;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; ++i)
+    {
+        sipRound(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+inline uint64_t sipHash(const uint64_t *key, uint64_t message)
+{
+    return sipHash(key, &message, 1);
+}
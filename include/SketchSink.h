@@ -0,0 +1,47 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "Sketches.h"
+#include <fstream>
+#include <chrono>
+
+// Auxiliary dataset of per-window traffic summaries. Packets are bucketed
+// into fixed windows of capture time; when a window ends, one row for each
+// of the REPORTED_SOURCES top sources (by bytes) is written:
+//
+//   WindowStart,WindowSeconds,Rank,SrcIP,Bytes,BytesError,Packets,DistinctDstIPs,
+//   WindowPackets,WindowBytes,WindowDistinctSrcIPs,WindowDistinctDstIPs
+//
+// Bytes is the Space-Saving count (Bytes - BytesError is a lower bound),
+// Packets a Count-Min estimate and the distinct counts HyperLogLog
+// estimates. Memory is fixed by TrafficSketch::Config.
+class SketchSink : public OutputSink
+{
+public:
+    static const int DEFAULT_WINDOW_SECONDS = 10;
+    static const size_t REPORTED_SOURCES = 32;
+
+    SketchSink(const std::string &filename, int window_seconds = DEFAULT_WINDOW_SECONDS,
+               const TrafficSketch::Config &config = TrafficSketch::Config());
+    ~SketchSink();
+
+    bool open() override;
+    bool consume(const PacketBatch &batch) override;
+    void close() override;
+
+    std::string getName() const override;
+    std::string getLastError() const override;
+    std::string getSummary() const override;
+
+private:
+    std::string filename_;
+    int64_t window_us_;
+    std::ofstream file_;
+    std::string last_error_;
+    TrafficSketch sketch_;
+    int64_t window_start_us_; // INT64_MIN before the first packet
+    uint64_t windows_written_;
+    std::string rows_;
+
+    bool writeWindow();
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "PacketFeature.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size streaming summaries for per-window traffic features. All memory
+// is allocated by the constructors and never grows with traffic. Sketches of
+// the same dimensions merge, so shards can each keep their own and combine
+// them into one window summary.
+
+// 64-bit hash of an address, suitable for all the sketches below
+uint64_t hashAddress(const IpAddress &address);
+
+// Count-Min sketch with conservative update: an add only raises the counters
+// that are below the new estimate, which keeps the overestimate small on
+// skewed traffic. Estimates never undercount. merge() sums counters, which
+// keeps that guarantee.
+class CountMinSketch
+{
+public:
+    CountMinSketch(size_t width, size_t depth);
+
+    void add(uint64_t hash, uint32_t count = 1);
+    uint32_t estimate(uint64_t hash) const;
+    // Fails when the dimensions differ
+    bool merge(const CountMinSketch &other);
+    void clear();
+
+    size_t getWidth() const { return width_; }
+    size_t getDepth() const { return depth_; }
+
+private:
+    size_t width_;
+    size_t depth_;
+    std::vector<uint32_t> counters_; // depth_ rows of width_ counters
+
+    size_t cell(size_t row, uint64_t hash) const;
+};
+
+// HyperLogLog distinct counter with 2^precision one-byte registers
+// (precision 4-16; standard error about 1.04 / sqrt(2^precision))
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(uint8_t precision = 8);
+
+    void add(uint64_t hash);
+    double estimate() const;
+    // Fails when the precisions differ
+    bool merge(const HyperLogLog &other);
+    void clear();
+
+private:
+    uint8_t precision_;
+    std::vector<uint8_t> registers_;
+};
+
+// Space-Saving top-K (Metwally et al.) over source addresses by weight.
+// count - error is a guaranteed lower bound on a source's true weight and
+// count an upper bound. Each monitored source also counts the distinct
+// destinations it sent to since it entered the table, so a source that
+// replaced an evicted one starts that count from zero.
+class SpaceSaving
+{
+public:
+    struct Entry
+    {
+        IpAddress key;
+        uint64_t hash;
+        uint64_t count;
+        uint64_t error;
+        HyperLogLog destinations;
+
+        explicit Entry(uint8_t precision) : hash(0), count(0), error(0), destinations(precision) {}
+    };
+
+    SpaceSaving(size_t capacity, uint8_t destination_precision = 8);
+
+    void offer(const IpAddress &key, uint64_t hash, uint64_t weight, uint64_t destination_hash);
+    // Mergeable-summaries rule: a key missing from one side is credited with
+    // that side's minimum count when its table is full. Fails when the
+    // capacities or precisions differ.
+    bool merge(const SpaceSaving &other);
+    void clear();
+
+    // Monitored entries, heaviest first
+    std::vector<const Entry *> top(size_t limit) const;
+    size_t size() const { return used_; }
+    size_t capacity() const { return entries_.size(); }
+
+private:
+    uint8_t precision_;
+    std::vector<Entry> entries_;
+    size_t used_;
+    std::vector<uint32_t> heap_;     // entry indices, min-heap on count
+    std::vector<uint32_t> heap_pos_; // entry index -> position in heap_
+    std::vector<int32_t> slots_;     // open-addressing index, entry index or -1
+
+    int32_t find(const IpAddress &key, uint64_t hash) const;
+    void insertSlot(uint32_t index);
+    void eraseSlot(uint32_t index);
+    void siftDown(size_t position);
+    void siftUp(size_t position);
+    void swapHeap(size_t a, size_t b);
+    uint64_t minimumCount() const;
+};
+
+// Per-window traffic summary: top sources by bytes with their distinct
+// destination counts, per-source packet estimates, and window-wide distinct
+// source and destination counts
+class TrafficSketch
+{
+public:
+    struct Config
+    {
+        size_t top_sources; // monitored; more than are reported keeps the reported counts tight
+        size_t count_min_width;
+        size_t count_min_depth;
+        uint8_t source_precision; // per monitored source destination counter
+        uint8_t window_precision; // window-wide distinct counters
+
+        Config() : top_sources(256), count_min_width(2048), count_min_depth(4), source_precision(8), window_precision(12) {}
+    };
+
+    explicit TrafficSketch(const Config &config = Config());
+
+    void add(const PacketFeature &packet, uint32_t wire_length);
+    // Fails, leaving this sketch unchanged, when the configurations differ
+    bool merge(const TrafficSketch &other);
+    void clear();
+
+    const SpaceSaving &getTopSources() const { return top_sources_; }
+    uint32_t estimatePackets(const SpaceSaving::Entry &source) const { return source_packets_.estimate(source.hash); }
+    uint64_t getPackets() const { return packets_; }
+    uint64_t getBytes() const { return bytes_; }
+    double getDistinctSources() const { return sources_.estimate(); }
+    double getDistinctDestinations() const { return destinations_.estimate(); }
+
+private:
+    Config config_;
+    SpaceSaving top_sources_;
+    CountMinSketch source_packets_;
+    HyperLogLog sources_;
+    HyperLogLog destinations_;
+    uint64_t packets_;
+    uint64_t bytes_;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+// Sparse time index of a CSV dataset, kept next to it as <file>.idx. The
+// rows after the header are cut into consecutive blocks of block_rows rows
+// or block_ms of capture time, whichever ends first; each block is one
+// fixed-size entry with its byte range and the earliest and latest
+// timestamp of its rows. Rows are only mostly in time order, so a range is
+// found through the running maximum of the block maxima and the running
+// minimum (from the end) of the block minima, both monotonic (see
+// findBlocks); DatasetSlice uses it to read only the blocks a range needs.
+//
+// Entries are appended as blocks close. An entry past the end of the CSV
+// (rows not written yet, or cut off by recovery) is ignored by readers and
+// dropped by the writer, which indexes any rows the index is missing when
+// it appends to an existing file.
+//
+// Format: the 8-byte magic "NPATIDX1", then entries as four 64-bit words in
+// host byte order: offset, bytes, min and max timestamp in microseconds (UTC).
+class TimeIndex
+{
+public:
+    static const char MAGIC[8];
+
+    struct Entry
+    {
+        uint64_t offset; // first byte of the block's first row
+        uint64_t bytes;  // the block's rows, each ending in '\n'
+        int64_t min_us;
+        int64_t max_us;
+    };
+
+    // block_rows 0 = no row limit, block_ms 0 = no time limit; at least one is set
+    TimeIndex(uint32_t block_rows, int block_ms);
+    ~TimeIndex();
+
+    // Starts indexing data_path, whose first data_size bytes are already
+    // written (0 = new file); false (see getLastError) on I/O errors
+    bool open(const std::string &data_path, uint64_t data_size);
+    // One row of length bytes at offset, right after the previous row
+    void addRow(uint64_t offset, uint64_t length, int64_t timestamp_us);
+    bool flush();
+    // Writes the open block; safe to call more than once
+    bool close();
+
+    bool isOpen() const { return file_ != nullptr; }
+    uint64_t getEntryCount() const { return entry_count_; }
+    std::string getLastError() const { return last_error_; }
+
+    static std::string getPath(const std::string &data_path) { return data_path + ".idx"; }
+    // Entries of index_path that lie within the first data_size bytes
+    static bool load(const std::string &index_path, uint64_t data_size, std::vector<Entry> &entries, std::string &error);
+    // Blocks [first, last) that may hold rows with from_us <= timestamp < to_us;
+    // every row in that range is in one of them. Two binary searches over
+    // running extremes of the entries, which are few (one per block)
+    static void findBlocks(const std::vector<Entry> &entries, int64_t from_us, int64_t to_us, size_t &first, size_t &last);
+    // "YYYY-MM-DD HH:MM:SS.ffffff" at the start of a row, as DatasetWriter
+    // writes it (UTC)
+    static bool parseTimestamp(const char *text, size_t length, int64_t &micros);
+
+private:
+    uint32_t block_rows_;
+    int64_t block_us_;
+    std::string path_;
+    std::FILE *file_;
+    std::string last_error_;
+    bool block_open_;
+    Entry block_;
+    uint32_t block_row_count_;
+    uint64_t entry_count_;
+
+    bool writeEntry(const Entry &entry);
+    bool indexExistingRows(const std::string &data_path, uint64_t from, uint64_t to);
+};
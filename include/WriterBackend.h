@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+enum class WriterBackendType
+{
+    AUTO,  // io_uring where the kernel allows it, otherwise posix
+    POSIX, // blocking write() on the calling thread
+    URING, // asynchronous io_uring writes from registered buffers (Linux)
+};
+
+enum class Durability
+{
+    NONE,     // left to the OS
+    CLOSE,    // one fdatasync when the file is closed
+    PERIODIC, // group commit: fdatasync every sync_interval_ms or sync_bytes, and at close
+};
+
+// Sequential file output through a set of aligned buffers. write() copies
+// into the current buffer; a full buffer is handed to the implementation and
+// the next one is filled meanwhile. A buffer is reused only once its
+// previous write has completed, so with an asynchronous implementation
+// formatting overlaps with the kernel writing up to buffer_count - 1
+// earlier buffers.
+//
+// With direct, the file is opened with O_DIRECT (page cache bypassed) where
+// supported: writes then cover whole DIRECT_ALIGNMENT blocks, a trailing
+// partial block is kept and rewritten by the next submission, and close()
+// trims the file to its real length.
+//
+// With PERIODIC durability a sync thread calls fdatasync whenever the
+// interval has passed or sync_bytes more have been written, covering every
+// write completed by then in one call (group commit); the writing thread
+// never waits for it.
+class WriterBackend
+{
+public:
+    static const size_t DIRECT_ALIGNMENT = 4096;
+
+    struct Options
+    {
+        WriterBackendType type;
+        size_t buffer_bytes; // rounded up to DIRECT_ALIGNMENT
+        int buffer_count;
+        bool direct;
+        Durability durability;
+        int sync_interval_ms;
+        uint64_t sync_bytes;
+
+        Options() : type(WriterBackendType::AUTO), buffer_bytes(1u << 20), buffer_count(4), direct(false),
+                    durability(Durability::NONE), sync_interval_ms(1000), sync_bytes(64u << 20) {}
+    };
+
+    virtual ~WriterBackend();
+
+    // Opens path for writing; append keeps existing content
+    bool open(const std::string &path, bool append);
+    bool write(const char *data, size_t size);
+    bool write(const std::string &data) { return write(data.data(), data.size()); }
+    // Hands everything written so far to the kernel without waiting for it
+    bool submit();
+    // submit() and wait until every write has completed
+    bool flush();
+    // flush() and close the file; safe to call more than once
+    bool close();
+
+    bool isOpen() const { return fd_ >= 0; }
+    uint64_t getBytesWritten() const { return logical_size_ - base_size_; }
+    // File size once everything written so far has reached it
+    uint64_t getFileSize() const { return logical_size_; }
+    // File size known to be on stable storage (initial size included)
+    uint64_t getDurableBytes() const { return durable_size_.load(); }
+    uint64_t getSyncCount() const { return sync_count_.load(); }
+    Durability getDurability() const { return options_.durability; }
+    std::string getLastError() const { return last_error_; }
+    virtual std::string getName() const = 0;
+
+    // Creates the requested backend; AUTO and an io_uring backend the
+    // kernel refuses fall back to posix. Never returns null.
+    static std::unique_ptr<WriterBackend> create(const Options &options = Options());
+    // "<auto|posix|uring>[:direct]" into type and direct of options
+    static bool parseSpec(const std::string &spec, Options &options, std::string &error);
+    // "none", "close" or "periodic[:<ms>[:<mb>]]" into the durability fields
+    static bool parseDurability(const std::string &spec, Options &options, std::string &error);
+    static bool isUringAvailable();
+
+protected:
+    struct Buffer
+    {
+        char *data;
+        size_t used;
+        uint64_t offset;  // file offset of data[0]
+        bool in_flight;
+    };
+
+    explicit WriterBackend(const Options &options);
+
+    Options options_;
+    std::vector<Buffer> buffers_;
+    int fd_;
+    bool direct_active_;
+    std::string last_error_;
+
+    // Starts writing buffer; the implementation clears in_flight once done
+    virtual bool submitBuffer(size_t index) = 0;
+    // Blocks until buffer is no longer in flight
+    virtual bool waitBuffer(size_t index) = 0;
+    virtual bool onOpen() { return true; }
+    virtual void onClose() {}
+
+private:
+    std::unique_ptr<char, void (*)(void *)> memory_;
+    size_t current_;
+    uint64_t logical_size_; // bytes in the file once everything is written
+    uint64_t base_size_;    // size found when opening
+
+    // Group commit. completed_size_ is the prefix of the file whose writes
+    // have all completed, advanced by the writing thread.
+    std::atomic<uint64_t> completed_size_;
+    std::atomic<uint64_t> durable_size_;
+    std::atomic<uint64_t> sync_count_;
+    std::thread syncer_;
+    std::mutex sync_mutex_;
+    std::condition_variable sync_wake_;
+    bool sync_stop_;
+    uint64_t sync_requested_at_; // completed_size_ when the byte threshold last woke the syncer
+    std::string sync_error_;
+
+    bool submitCurrent(bool pad);
+    void updateCompleted();
+    bool syncFile();
+    bool checkSyncError();
+    void syncLoop();
+};
@@ -0,0 +1,197 @@
+#include "AddressCache.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+namespace
+{
+    inline size_t hashKey(uint8_t family, const uint64_t *key)
+    {
+        // Multiply-xorshift over the address words; the top bits pick the slot
+        uint64_t hash = (key[0] ^ (key[1] * 0x9E3779B97F4A7C15ULL) ^ family) * 0xBF58476D1CE4E5B9ULL;
+        return static_cast<size_t>(hash ^ (hash >> 31));
+    }
+}
+
+AddressCache::AddressCache(size_t entries, bool assign_ids)
+    : mask_(0), assign_ids_(assign_ids), lookups_(0), hits_(0), uncached_(0)
+{
+    size_t size = 1;
+    while (size < entries)
+    {
+        size <<= 1;
+    }
+    entries_.reset(new Entry[size]);
+    for (size_t i = 0; i < size; ++i)
+    {
+        entries_[i].state.store(0, std::memory_order_relaxed);
+        entries_[i].key[0].store(0, std::memory_order_relaxed);
+        entries_[i].key[1].store(0, std::memory_order_relaxed);
+    }
+    if (assign_ids_)
+    {
+        ids_.reset(new std::atomic<uint32_t>[size]);
+        for (size_t i = 0; i < size; ++i)
+        {
+            ids_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    mask_ = size - 1;
+}
+
+size_t AddressCache::lookup(uint8_t family, const uint8_t *bytes, char *text, uint32_t *id)
+{
+    if (family != 4 && family != 6)
+    {
+        return 0;
+    }
+
+    uint64_t key[2] = {0, 0};
+    std::memcpy(key, bytes, family == 4 ? 4 : 16);
+    size_t index = hashKey(family, key) & mask_;
+    Entry &entry = entries_[index];
+    bool want_id = id != nullptr && assign_ids_;
+
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+    size_t length = 0;
+    uint32_t cached_id = 0;
+    if (read(entry, index, family, key, text, length, cached_id) && (!want_id || cached_id != 0))
+    {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        if (id)
+            *id = cached_id;
+        return length;
+    }
+
+    if (length == 0)
+    {
+        char formatted[MAX_TEXT_LENGTH];
+        if (inet_ntop(family == 4 ? AF_INET : AF_INET6, bytes, formatted, sizeof(formatted)) == nullptr)
+        {
+            return 0;
+        }
+        length = std::strlen(formatted);
+        std::memcpy(text, formatted, length);
+    }
+    uint32_t new_id = want_id ? assignId(family, bytes) : 0;
+    if (id)
+        *id = new_id;
+
+    if (length <= ENTRY_TEXT_BYTES)
+    {
+        write(entry, index, family, key, text, length, new_id);
+    }
+    else
+    {
+        uncached_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return length;
+}
+
+bool AddressCache::read(const Entry &entry, size_t index, uint8_t family, const uint64_t *key, char *text,
+                        size_t &length, uint32_t &id) const
+{
+    uint64_t state = entry.state.load(std::memory_order_acquire);
+    if ((state & 1) != 0 || ((state >> 32) & 0xFF) != family)
+    {
+        return false;
+    }
+    if (entry.key[0].load(std::memory_order_relaxed) != key[0] || entry.key[1].load(std::memory_order_relaxed) != key[1])
+    {
+        return false;
+    }
+
+    uint64_t words[ENTRY_TEXT_BYTES / 8];
+    for (size_t i = 0; i < ENTRY_TEXT_BYTES / 8; ++i)
+    {
+        words[i] = entry.text[i].load(std::memory_order_relaxed);
+    }
+    uint32_t stored_id = ids_ ? ids_[index].load(std::memory_order_relaxed) : 0;
+
+    // Sequence lock: the copy is only valid if no writer started meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (entry.state.load(std::memory_order_relaxed) != state)
+    {
+        return false;
+    }
+
+    length = static_cast<size_t>((state >> 40) & 0xFF);
+    std::memcpy(text, words, length);
+    id = stored_id;
+    return true;
+}
+
+void AddressCache::write(Entry &entry, size_t index, uint8_t family, const uint64_t *key, const char *text,
+                         size_t length, uint32_t id)
+{
+    uint64_t state = entry.state.load(std::memory_order_relaxed);
+    // Another thread is filling this slot: leave it to that one
+    if ((state & 1) != 0 ||
+        !entry.state.compare_exchange_strong(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t words[ENTRY_TEXT_BYTES / 8] = {0};
+    std::memcpy(words, text, length);
+    entry.key[0].store(key[0], std::memory_order_relaxed);
+    entry.key[1].store(key[1], std::memory_order_relaxed);
+    for (size_t i = 0; i < ENTRY_TEXT_BYTES / 8; ++i)
+    {
+        entry.text[i].store(words[i], std::memory_order_relaxed);
+    }
+    if (ids_)
+    {
+        ids_[index].store(id, std::memory_order_relaxed);
+    }
+
+    uint64_t sequence = (state + 2) & 0xFFFFFFFFULL;
+    entry.state.store(sequence | (static_cast<uint64_t>(family) << 32) | (static_cast<uint64_t>(length) << 40),
+                      std::memory_order_release);
+}
+
+uint32_t AddressCache::assignId(uint8_t family, const uint8_t *bytes)
+{
+    std::string key(1, static_cast<char>(family));
+    key.append(reinterpret_cast<const char *>(bytes), family == 4 ? 4 : 16);
+
+    std::lock_guard<std::mutex> lock(dictionary_mutex_);
+    auto it = dictionary_.find(key);
+    if (it != dictionary_.end())
+    {
+        return it->second;
+    }
+    if (dictionary_.size() >= MAX_IDS)
+    {
+        return 0;
+    }
+    uint32_t id = static_cast<uint32_t>(dictionary_.size()) + 1;
+    dictionary_.emplace(std::move(key), id);
+    return id;
+}
+
+AddressCache::Stats AddressCache::getStats() const
+{
+    Stats stats;
+    stats.lookups = lookups_.load(std::memory_order_relaxed);
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.uncached = uncached_.load(std::memory_order_relaxed);
+    if (assign_ids_)
+    {
+        std::lock_guard<std::mutex> lock(dictionary_mutex_);
+        stats.ids_assigned = dictionary_.size();
+    }
+    return stats;
+}
+
+AddressCache &AddressCache::shared()
+{
+    static AddressCache cache;
+    return cache;
+}
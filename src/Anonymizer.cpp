@@ -0,0 +1,358 @@
+#include "Anonymizer.h"
+#include "SipHash.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <cctype>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+const size_t Anonymizer::MEMO_ENTRIES;
+
+namespace
+{
+    // RFC 1624: checksum after 16-bit words old[] were replaced by new[]
+    uint16_t adjustChecksum(uint16_t checksum, const uint8_t *old_bytes, const uint8_t *new_bytes, size_t length)
+    {
+        uint32_t sum = static_cast<uint16_t>(~checksum);
+        for (size_t i = 0; i + 1 < length; i += 2)
+        {
+            sum += static_cast<uint16_t>(~((old_bytes[i] << 8) | old_bytes[i + 1]));
+            sum += static_cast<uint16_t>((new_bytes[i] << 8) | new_bytes[i + 1]);
+        }
+        while (sum >> 16)
+        {
+            sum = (sum & 0xffff) + (sum >> 16);
+        }
+        return static_cast<uint16_t>(~sum);
+    }
+
+    bool readKey(const std::string &path, uint8_t *key, std::string &error)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            error = "Cannot open anonymization key file " + path;
+            return false;
+        }
+        std::string hex;
+        char c;
+        while (file.get(c))
+        {
+            if (!std::isspace(static_cast<unsigned char>(c)))
+            {
+                hex += c;
+            }
+        }
+        if (hex.size() != 2 * CryptoPAn::KEY_BYTES ||
+            hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+        {
+            error = "Anonymization key file " + path + " must hold " + std::to_string(2 * CryptoPAn::KEY_BYTES) +
+                    " hex digits";
+            return false;
+        }
+        for (size_t i = 0; i < CryptoPAn::KEY_BYTES; ++i)
+        {
+            key[i] = static_cast<uint8_t>(std::stoul(hex.substr(2 * i, 2), nullptr, 16));
+        }
+        return true;
+    }
+
+    // Dotted quad without inet_ntop's locale and bounds handling
+    size_t formatIPv4(const uint8_t *bytes, char *text)
+    {
+        char *out = text;
+        for (int i = 0; i < 4; ++i)
+        {
+            unsigned value = bytes[i];
+            if (value >= 100)
+                *out++ = static_cast<char>('0' + value / 100);
+            if (value >= 10)
+                *out++ = static_cast<char>('0' + value / 10 % 10);
+            *out++ = static_cast<char>('0' + value % 10);
+            if (i < 3)
+                *out++ = '.';
+        }
+        return static_cast<size_t>(out - text);
+    }
+
+    const struct
+    {
+        const char *name;
+        uint32_t field;
+    } FIELD_NAMES[] = {
+        {"ip", ANONYMIZE_ADDRESSES},
+        {"ports", ANONYMIZE_PORTS},
+        {"ipid", ANONYMIZE_IP_ID},
+        {"flowlabel", ANONYMIZE_FLOW_LABEL},
+        {"tunnelid", ANONYMIZE_TUNNEL_ID},
+    };
+} // namespace
+
+bool Anonymizer::parseFields(const std::string &spec, uint32_t &fields, std::string &error)
+{
+    fields = 0;
+    std::istringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        if (item == "all")
+        {
+            for (const auto &entry : FIELD_NAMES)
+                fields |= entry.field;
+            continue;
+        }
+        uint32_t field = 0;
+        for (const auto &entry : FIELD_NAMES)
+        {
+            if (item == entry.name)
+                field = entry.field;
+        }
+        if (field == 0)
+        {
+            error = "Unknown identifier '" + item + "' (expected ip, ports, ipid, flowlabel, tunnelid or all)";
+            return false;
+        }
+        fields |= field;
+    }
+    if (fields == 0)
+    {
+        error = "No identifiers to anonymize given";
+        return false;
+    }
+    return true;
+}
+
+uint32_t Anonymizer::permute(const uint64_t *key, uint32_t value, int bits)
+{
+    int half = bits / 2;
+    uint32_t half_mask = static_cast<uint32_t>((1ULL << half) - 1);
+    uint32_t left = (value >> half) & half_mask;
+    uint32_t right = value & half_mask;
+    for (uint64_t round = 0; round < 4; ++round)
+    {
+        uint32_t next = left ^ (static_cast<uint32_t>(sipHash(key, (round << 32) | right)) & half_mask);
+        left = right;
+        right = next;
+    }
+    return (left << half) | right;
+}
+
+Anonymizer::Anonymizer(uint32_t fields, const std::string &key_file)
+    : fields_(fields), key_file_(key_file), flow_label_key_(), tunnel_id_key_(), fragment_id_key_(), rows_(0), addresses_(0),
+      memo_hits_(0)
+{
+}
+
+bool Anonymizer::start()
+{
+    uint8_t key[CryptoPAn::KEY_BYTES];
+    if (!key_file_.empty())
+    {
+        if (!readKey(key_file_, key, last_error_))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        std::random_device random;
+        for (size_t i = 0; i < CryptoPAn::KEY_BYTES; i += 4)
+        {
+            uint32_t word = random();
+            std::memcpy(key + i, &word, 4);
+        }
+    }
+    cryptopan_ = std::make_unique<CryptoPAn>(key);
+    std::memset(key, 0, sizeof(key));
+
+    // Field keys: the AES encryption of a per-field constant
+    auto deriveKey = [this](uint8_t purpose, uint64_t *out)
+    {
+        uint8_t block[16] = {'a', 'n', 'o', 'n', 'y', 'm', 'i', 'z', 'e', 0, 0, 0, 0, 0, 0, purpose};
+        uint8_t derived[16];
+        cryptopan_->encryptBlock(block, derived);
+        std::memcpy(out, derived, 16);
+    };
+    uint64_t port_key[2];
+    uint64_t ip_id_key[2];
+    deriveKey(1, port_key);
+    deriveKey(2, ip_id_key);
+    deriveKey(3, flow_label_key_);
+    deriveKey(4, tunnel_id_key_);
+    deriveKey(5, fragment_id_key_);
+    if (fields_ & ANONYMIZE_ADDRESSES)
+    {
+        MemoEntry empty;
+        std::memset(&empty, 0, sizeof(empty));
+        memo_.assign(MEMO_ENTRIES, empty);
+    }
+    if (fields_ & ANONYMIZE_PORTS)
+    {
+        port_table_.resize(1u << 16);
+        for (uint32_t value = 0; value < port_table_.size(); ++value)
+            port_table_[value] = static_cast<uint16_t>(permute(port_key, value, 16));
+    }
+    if (fields_ & ANONYMIZE_IP_ID)
+    {
+        ip_id_table_.resize(1u << 16);
+        for (uint32_t value = 0; value < ip_id_table_.size(); ++value)
+            ip_id_table_[value] = static_cast<uint16_t>(permute(ip_id_key, value, 16));
+    }
+
+    std::cout << "Anonymizing";
+    for (const auto &entry : FIELD_NAMES)
+    {
+        if (fields_ & entry.field)
+            std::cout << " " << entry.name;
+    }
+    std::cout << " with " << (key_file_.empty() ? "a random key for this run" : "the key from " + key_file_)
+              << (cryptopan_->usesAesInstructions() ? " (AES-NI)" : "") << std::endl;
+    return true;
+}
+
+void Anonymizer::anonymizeAddress(IpAddress &address, std::string_view &text, Arena &arena)
+{
+    if (address.family != 4 && address.family != 6)
+    {
+        return;
+    }
+    addresses_++;
+    uint64_t key[2] = {0, 0};
+    std::memcpy(key, address.bytes, address.family == 4 ? 4 : 16);
+    uint64_t hash = (key[0] ^ (key[1] * 0x9e3779b97f4a7c15ULL) ^ address.family) * 0xbf58476d1ce4e5b9ULL;
+    MemoEntry &entry = memo_[(hash ^ (hash >> 31)) & (MEMO_ENTRIES - 1)];
+    if (entry.family != address.family || entry.key[0] != key[0] || entry.key[1] != key[1])
+    {
+        IpAddress anonymized = address;
+        cryptopan_->anonymize(anonymized);
+        size_t length = 0;
+        if (address.family == 4)
+        {
+            length = formatIPv4(anonymized.bytes, entry.text);
+        }
+        else if (inet_ntop(AF_INET6, anonymized.bytes, entry.text, sizeof(entry.text)) != nullptr)
+        {
+            length = std::strlen(entry.text);
+        }
+        entry.key[0] = key[0];
+        entry.key[1] = key[1];
+        entry.family = address.family;
+        std::memcpy(entry.bytes, anonymized.bytes, sizeof(entry.bytes));
+        entry.text_length = static_cast<uint8_t>(length);
+    }
+    else
+    {
+        memo_hits_++;
+    }
+    std::memcpy(address.bytes, entry.bytes, sizeof(address.bytes));
+    text = arena.copyString(entry.text, entry.text_length);
+}
+
+void Anonymizer::process(PacketRecord &record, Arena &arena)
+{
+    PacketFeature &feature = record.feature;
+    bool ipv4 = feature.type == PacketFeature::Type::IPv4;
+    rows_++;
+
+    if (fields_ & ANONYMIZE_ADDRESSES)
+    {
+        uint8_t old_addresses[8];
+        std::memcpy(old_addresses, feature.src_ip.bytes, 4);
+        std::memcpy(old_addresses + 4, feature.dst_ip.bytes, 4);
+        anonymizeAddress(feature.src_ip, ipv4 ? feature.ipv4.src_address : feature.ipv6.src_address, arena);
+        anonymizeAddress(feature.dst_ip, ipv4 ? feature.ipv4.dst_address : feature.ipv6.dst_address, arena);
+        if (ipv4)
+        {
+            uint8_t new_addresses[8];
+            std::memcpy(new_addresses, feature.src_ip.bytes, 4);
+            std::memcpy(new_addresses + 4, feature.dst_ip.bytes, 4);
+            feature.ipv4.header_checksum =
+                adjustChecksum(feature.ipv4.header_checksum, old_addresses, new_addresses, sizeof(old_addresses));
+        }
+        if (feature.tunnel.depth > 0)
+        {
+            anonymizeAddress(feature.tunnel.inner_src_ip, feature.tunnel.inner_src_address, arena);
+            anonymizeAddress(feature.tunnel.inner_dst_ip, feature.tunnel.inner_dst_address, arena);
+        }
+    }
+    if (fields_ & ANONYMIZE_PORTS)
+    {
+        if (feature.transport.present)
+        {
+            feature.transport.src_port = port_table_[feature.transport.src_port];
+            feature.transport.dst_port = port_table_[feature.transport.dst_port];
+        }
+        if (feature.tunnel.inner_transport.present)
+        {
+            feature.tunnel.inner_transport.src_port = port_table_[feature.tunnel.inner_transport.src_port];
+            feature.tunnel.inner_transport.dst_port = port_table_[feature.tunnel.inner_transport.dst_port];
+        }
+    }
+    if (fields_ & ANONYMIZE_IP_ID)
+    {
+        if (ipv4)
+        {
+            uint16_t old_id = feature.ipv4.identification;
+            uint16_t new_id = ip_id_table_[old_id];
+            uint8_t old_bytes[2] = {static_cast<uint8_t>(old_id >> 8), static_cast<uint8_t>(old_id)};
+            uint8_t new_bytes[2] = {static_cast<uint8_t>(new_id >> 8), static_cast<uint8_t>(new_id)};
+            feature.ipv4.identification = new_id;
+            feature.ipv4.header_checksum = adjustChecksum(feature.ipv4.header_checksum, old_bytes, new_bytes, 2);
+            if (feature.fragment.is_fragment)
+                feature.fragment.identification = new_id;
+        }
+        else if (feature.fragment.is_fragment)
+        {
+            feature.fragment.identification = permute(fragment_id_key_, feature.fragment.identification, 32);
+        }
+    }
+    if ((fields_ & ANONYMIZE_FLOW_LABEL) && !ipv4)
+    {
+        feature.ipv6.flow_label = permute(flow_label_key_, feature.ipv6.flow_label, 20);
+    }
+    if ((fields_ & ANONYMIZE_TUNNEL_ID) && feature.tunnel.has_id)
+    {
+        // The low 24 bits hold a whole VNI, so VNIs stay VNI-sized
+        uint32_t id = feature.tunnel.id;
+        feature.tunnel.id = (id & 0xff000000u) | permute(tunnel_id_key_, id & 0xffffffu, 24);
+    }
+}
+
+Anonymizer::Stats Anonymizer::getStats() const
+{
+    Stats stats;
+    stats.rows = rows_;
+    stats.addresses = addresses_;
+    stats.memo_hits = memo_hits_;
+    stats.cryptopan = cryptopan_ ? cryptopan_->getStats() : CryptoPAn::Stats();
+    return stats;
+}
+
+std::string Anonymizer::getSummary() const
+{
+    Stats stats = getStats();
+    std::ostringstream summary;
+    summary << "Anonymization: " << stats.rows << " rows";
+    if (fields_ & ANONYMIZE_ADDRESSES)
+    {
+        double hit_rate = stats.addresses > 0 ? 100.0 * stats.memo_hits / stats.addresses : 0.0;
+        summary << ", " << stats.addresses << " addresses (" << std::fixed << std::setprecision(1) << hit_rate
+                << "% memoized; " << stats.cryptopan.prefix_hits << " of " << stats.cryptopan.addresses
+                << " others from a known prefix, " << stats.cryptopan.blocks_encrypted
+                << " AES blocks)";
+    }
+    return summary.str();
+}
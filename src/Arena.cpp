@@ -0,0 +1,75 @@
+#include "Arena.h"
+#include <cstring>
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size), current_(0), offset_(0), used_(0)
+{
+}
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+    stats_.allocations++;
+    stats_.bytes_allocated += size;
+
+    for (;;)
+    {
+        if (current_ == blocks_.size())
+        {
+            // Oversized requests get a block of their own; it is kept and
+            // reused like any other after a reset
+            size_t block_size = size + alignment > block_size_ ? size + alignment : block_size_;
+            blocks_.push_back({std::unique_ptr<char[]>(new char[block_size]), block_size});
+            stats_.block_allocations++;
+            stats_.bytes_reserved += block_size;
+        }
+
+        Block &block = blocks_[current_];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t aligned = ((base + offset_ + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+        if (aligned + size <= block.size)
+        {
+            offset_ = aligned + size;
+            used_ += size;
+            stats_.peak_bytes = used_ > stats_.peak_bytes ? used_ : stats_.peak_bytes;
+            return block.data.get() + aligned;
+        }
+        // The tail of this block stays unused until the next reset
+        ++current_;
+        offset_ = 0;
+    }
+}
+
+std::string_view Arena::copyString(const char *data, size_t size)
+{
+    if (size == 0)
+    {
+        return std::string_view();
+    }
+    char *copy = static_cast<char *>(allocate(size, 1));
+    std::memcpy(copy, data, size);
+    return std::string_view(copy, size);
+}
+
+const uint8_t *Arena::copyBytes(const uint8_t *data, size_t size)
+{
+    if (size == 0)
+    {
+        return nullptr;
+    }
+    uint8_t *copy = static_cast<uint8_t *>(allocate(size, 1));
+    std::memcpy(copy, data, size);
+    return copy;
+}
+
+void Arena::reset()
+{
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+    stats_.resets++;
+}
+
+Arena::Stats Arena::getStats() const
+{
+    return stats_;
+}
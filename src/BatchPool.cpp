@@ -0,0 +1,55 @@
+#include "BatchPool.h"
+#include <atomic>
+
+BatchPool::BatchPool(size_t rows_per_batch)
+    : rows_per_batch_(rows_per_batch), next_(0), acquired_(0), reused_(0)
+{
+}
+
+std::shared_ptr<PacketBatch> BatchPool::acquire()
+{
+    acquired_++;
+    for (size_t i = 0; i < batches_.size(); ++i)
+    {
+        size_t index = (next_ + i) % batches_.size();
+        std::shared_ptr<PacketBatch> &batch = batches_[index];
+        if (batch.use_count() != 1)
+        {
+            continue;
+        }
+        // Only the pool holds it. The fence pairs with the release done by
+        // the last sink dropping its reference, so the sink's reads happen
+        // before the batch is cleared here.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        next_ = index + 1;
+        batch->packets.clear();
+        batch->columns.clear();
+        batch->arena.reset();
+        reused_++;
+        return batch;
+    }
+
+    auto batch = std::make_shared<PacketBatch>();
+    batch->packets.reserve(rows_per_batch_);
+    batches_.push_back(batch);
+    return batch;
+}
+
+BatchPool::Stats BatchPool::getStats() const
+{
+    Stats stats;
+    stats.batches = batches_.size();
+    stats.acquired = acquired_;
+    stats.reused = reused_;
+    for (const auto &batch : batches_)
+    {
+        Arena::Stats arena = batch->arena.getStats();
+        stats.arena.allocations += arena.allocations;
+        stats.arena.bytes_allocated += arena.bytes_allocated;
+        stats.arena.block_allocations += arena.block_allocations;
+        stats.arena.resets += arena.resets;
+        stats.arena.bytes_reserved += arena.bytes_reserved;
+        stats.arena.peak_bytes = arena.peak_bytes > stats.arena.peak_bytes ? arena.peak_bytes : stats.arena.peak_bytes;
+    }
+    return stats;
+}
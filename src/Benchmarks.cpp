@@ -0,0 +1,359 @@
+#include "Benchmarks.h"
+#include "PacketParser.h"
+#include "PayloadKernels.h"
+#include "OutputSink.h"
+#include "DatasetWriter.h"
+#include "WriterBackend.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+
+namespace
+{
+    const size_t BENCH_BATCH_ROWS = 256;
+    const int BENCH_ROUNDS = 20;
+
+    struct SyntheticFrame
+    {
+        std::vector<uint8_t> bytes;
+        uint32_t caplen;
+    };
+
+    void storeChecksum(uint8_t *header, size_t length)
+    {
+        header[10] = 0;
+        header[11] = 0;
+        uint32_t sum = 0;
+        for (size_t i = 0; i + 1 < length; i += 2)
+        {
+            sum += static_cast<uint32_t>(header[i] << 8 | header[i + 1]);
+        }
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        uint16_t checksum = static_cast<uint16_t>(~sum);
+        header[10] = static_cast<uint8_t>(checksum >> 8);
+        header[11] = static_cast<uint8_t>(checksum & 0xFF);
+    }
+
+    // Mostly well-formed IPv4/IPv6 with a share of options, bad checksums,
+    // fragments, truncated captures and non-IP frames
+    std::vector<SyntheticFrame> generateFrames(size_t count)
+    {
+        std::mt19937 rng(0x5eed);
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::vector<SyntheticFrame> frames(count);
+
+        for (auto &frame : frames)
+        {
+            frame.bytes.resize(14 + 128);
+            for (auto &b : frame.bytes)
+            {
+                b = static_cast<uint8_t>(byte(rng));
+            }
+            frame.caplen = static_cast<uint32_t>(frame.bytes.size());
+            uint8_t *ip = frame.bytes.data() + 14;
+            int kind = percent(rng);
+
+            if (kind < 70)
+            {
+                int ihl = percent(rng) < 85 ? 5 : 6 + percent(rng) % 10;
+                ip[0] = static_cast<uint8_t>(0x40 | ihl);
+                ip[9] = static_cast<uint8_t>(percent(rng) < 50 ? 6 : percent(rng) < 70 ? 17 : byte(rng));
+                if (percent(rng) < 70)
+                {
+                    ip[6] &= 0x40; // mostly unfragmented
+                    ip[7] = 0;
+                }
+                if (percent(rng) < 85)
+                {
+                    storeChecksum(ip, static_cast<size_t>(ihl) * 4);
+                }
+                if (percent(rng) < 5)
+                {
+                    frame.caplen = 14 + 20 + percent(rng) % 20; // options cut off
+                }
+            }
+            else if (kind < 95)
+            {
+                ip[0] = static_cast<uint8_t>(0x60 | (ip[0] & 0x0F));
+                static const uint8_t next_headers[] = {6, 17, 58, 43, 44, 60};
+                ip[6] = next_headers[percent(rng) % 6];
+                if (percent(rng) < 3)
+                {
+                    frame.caplen = 14 + percent(rng) % 40; // short of the fixed header
+                }
+            }
+            else
+            {
+                ip[0] = static_cast<uint8_t>(percent(rng) < 50 ? 0x45 : byte(rng));
+                frame.caplen = 14 + percent(rng) % 24;
+            }
+        }
+        return frames;
+    }
+
+    // Payloads of typical sizes: a third zero-filled, a third text-like and
+    // a third random
+    std::vector<std::vector<uint8_t>> generatePayloads(size_t count)
+    {
+        std::mt19937 rng(0xbeef);
+        std::uniform_int_distribution<int> size(0, 1460);
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::uniform_int_distribution<int> letter('a', 'z');
+        std::vector<std::vector<uint8_t>> payloads(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            payloads[i].resize(static_cast<size_t>(size(rng)));
+            for (auto &b : payloads[i])
+            {
+                b = static_cast<uint8_t>(i % 3 == 0 ? 0 : i % 3 == 1 ? letter(rng) : byte(rng));
+            }
+        }
+        return payloads;
+    }
+
+    // Checks every payload kernel against the scalar one and times them
+    bool runPayloadKernels(size_t packet_count)
+    {
+        using clock = std::chrono::steady_clock;
+        std::vector<std::vector<uint8_t>> payloads = generatePayloads(packet_count);
+        uint64_t total_bytes = 0;
+        for (const auto &payload : payloads)
+        {
+            total_bytes += payload.size();
+        }
+
+        std::vector<const PayloadKernels *> kernels = getAvailablePayloadKernels();
+        std::cout << "Payload kernels: " << payloads.size() << " payloads, " << total_bytes << " bytes, selected "
+                  << getPayloadKernels().name << std::endl;
+        std::cout << std::left << std::setw(10) << "kernel" << std::right << std::setw(14) << "ns/byte" << "  check" << std::endl;
+
+        bool all_match = true;
+        uint32_t expected[256];
+        uint32_t actual[256];
+        for (const PayloadKernels *kernel : kernels)
+        {
+            bool match = true;
+            for (const auto &payload : payloads)
+            {
+                std::fill(expected, expected + 256, 0);
+                std::fill(actual, actual + 256, 0);
+                kernels.front()->count_bytes(payload.data(), payload.size(), expected);
+                kernel->count_bytes(payload.data(), payload.size(), actual);
+                match = match && std::equal(expected, expected + 256, actual);
+            }
+            all_match = all_match && match;
+
+            auto start = clock::now();
+            for (int round = 0; round < BENCH_ROUNDS; ++round)
+            {
+                for (const auto &payload : payloads)
+                {
+                    std::fill(actual, actual + 256, 0);
+                    kernel->count_bytes(payload.data(), payload.size(), actual);
+                }
+            }
+            double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() /
+                        (static_cast<double>(BENCH_ROUNDS) * (total_bytes == 0 ? 1 : total_bytes));
+            std::cout << std::left << std::setw(10) << kernel->name << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(14) << ns << "  " << (match ? "ok" : "MISMATCH") << std::endl;
+        }
+        return all_match;
+    }
+
+    // FNV-1a over a whole file, to compare what each writer produced
+    bool hashFile(const std::string &path, uint64_t &hash, uint64_t &size)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        std::vector<char> chunk(1 << 20);
+        hash = 1469598103934665603ull;
+        size = 0;
+        while (file)
+        {
+            file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            std::streamsize got = file.gcount();
+            for (std::streamsize i = 0; i < got; ++i)
+            {
+                hash = (hash ^ static_cast<uint8_t>(chunk[static_cast<size_t>(i)])) * 1099511628211ull;
+            }
+            size += static_cast<uint64_t>(got);
+        }
+        return true;
+    }
+
+    // Formats rows cyclically through a DatasetWriter until target_bytes,
+    // handing each BENCH_BATCH_ROWS to the backend as CsvSink does; returns
+    // MB/s including the final drain, or a negative value on error
+    double timeCsvWriter(const std::vector<PacketFeature> &rows, const std::string &path,
+                         const WriterBackend::Options &options, uint64_t target_bytes, std::string &error)
+    {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        DatasetWriter writer(path, CSVMode::BOTH, 0, options);
+        std::filesystem::remove(path);
+        if (!writer.initialize())
+        {
+            error = writer.getLastError();
+            return -1;
+        }
+        size_t next = 0;
+        while (writer.getBytesWritten() < target_bytes)
+        {
+            for (size_t i = 0; i < BENCH_BATCH_ROWS; ++i)
+            {
+                if (!writer.writePacket(rows[next]))
+                {
+                    error = writer.getLastError();
+                    return -1;
+                }
+                next = next + 1 == rows.size() ? 0 : next + 1;
+            }
+            if (!writer.flush())
+            {
+                error = writer.getLastError();
+                return -1;
+            }
+        }
+        uint64_t bytes = writer.getBytesWritten();
+        writer.close();
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        return bytes / 1e6 / seconds;
+    }
+
+    // Writes a preformatted 64 KiB block repeatedly: the backend alone
+    double timeRawWriter(const std::string &block, const std::string &path, const WriterBackend::Options &options,
+                         uint64_t target_bytes, std::string &name, std::string &error)
+    {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        std::unique_ptr<WriterBackend> backend = WriterBackend::create(options);
+        if (!backend->open(path, false))
+        {
+            error = backend->getLastError();
+            return -1;
+        }
+        name = backend->getName();
+        while (backend->getBytesWritten() < target_bytes)
+        {
+            if (!backend->write(block))
+            {
+                error = backend->getLastError();
+                return -1;
+            }
+        }
+        uint64_t bytes = backend->getBytesWritten();
+        if (!backend->close())
+        {
+            error = backend->getLastError();
+            return -1;
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        return bytes / 1e6 / seconds;
+    }
+}
+
+int runKernelBenchmark(size_t packet_count)
+{
+    if (!runPayloadKernels(packet_count))
+    {
+        std::cerr << "Error: payload kernels disagree with the scalar one" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int runWriterBenchmark(size_t megabytes, const std::string &directory)
+{
+    // Rows as a capture would produce them, formatted again and again
+    std::vector<SyntheticFrame> frames = generateFrames(4096);
+    PacketParser parser;
+    Arena arena;
+    std::vector<PacketFeature> rows;
+    for (const SyntheticFrame &frame : frames)
+    {
+        struct pcap_pkthdr header;
+        header.ts.tv_sec = 1700000000 + static_cast<decltype(header.ts.tv_sec)>(rows.size() / 1000);
+        header.ts.tv_usec = static_cast<decltype(header.ts.tv_usec)>(rows.size() % 1000 * 1000);
+        header.caplen = frame.caplen;
+        header.len = frame.caplen;
+        auto feature = parser.processPacket(frame.bytes.data(), static_cast<int>(frame.caplen), &header, arena);
+        if (feature)
+        {
+            rows.push_back(std::move(*feature));
+        }
+    }
+    std::string block;
+    while (block.size() < 64 * 1024)
+    {
+        block += "1700000000.000000,4,5,0,60,4660,2,0,64,6,47806,10.0.0.1,10.0.0.2,,,,,,,,TCP\n";
+    }
+    block.resize(64 * 1024);
+
+    uint64_t target_bytes = static_cast<uint64_t>(megabytes) << 20;
+    std::string path = (std::filesystem::path(directory) / "bench-writer.csv").string();
+    std::cout << "Writer backends: " << megabytes << " MiB per run to " << path << " ("
+              << rows.size() << " distinct rows)" << std::endl;
+    std::cout << std::left << std::setw(14) << "backend" << std::right << std::setw(12) << "csv MB/s"
+              << std::setw(12) << "raw MB/s" << "  check" << std::endl;
+
+    const char *const specs[] = {"posix", "posix:direct", "uring", "uring:direct"};
+    bool all_match = true;
+    bool have_reference = false;
+    uint64_t reference_hash = 0;
+    uint64_t reference_size = 0;
+    for (const char *spec : specs)
+    {
+        WriterBackend::Options options;
+        std::string error;
+        WriterBackend::parseSpec(spec, options, error);
+        if (options.type == WriterBackendType::URING && !WriterBackend::isUringAvailable())
+        {
+            std::cout << std::left << std::setw(14) << spec << "  io_uring not available" << std::endl;
+            continue;
+        }
+
+        double csv_rate = timeCsvWriter(rows, path, options, target_bytes, error);
+        uint64_t hash = 0;
+        uint64_t size = 0;
+        bool match = csv_rate >= 0 && hashFile(path, hash, size);
+        if (match && !have_reference)
+        {
+            have_reference = true;
+            reference_hash = hash;
+            reference_size = size;
+        }
+        match = match && hash == reference_hash && size == reference_size;
+        std::string name;
+        double raw_rate = csv_rate >= 0 ? timeRawWriter(block, path, options, target_bytes, name, error) : -1;
+        std::filesystem::remove(path);
+
+        // e.g. O_DIRECT refused by the file system
+        std::string label = spec;
+        std::replace(label.begin(), label.end(), ':', '-');
+        if (!name.empty() && name != label)
+            label += " (" + name + ")";
+        std::cout << std::left << std::setw(14) << label << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << csv_rate << std::setw(12) << raw_rate << "  "
+                  << (!error.empty() ? "ERROR: " + error : match ? "ok" : "MISMATCH") << std::endl;
+        all_match = all_match && match && error.empty();
+    }
+
+    if (!all_match)
+    {
+        std::cerr << "Error: writer backends produced different files" << std::endl;
+        return 1;
+    }
+    return 0;
+}
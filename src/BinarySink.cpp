@@ -0,0 +1,281 @@
+#include "BinarySink.h"
+#include "PacketParser.h"
+#include <iostream>
+#include <filesystem>
+#include <iterator>
+
+namespace
+{
+    struct ColumnSpec
+    {
+        const char *name;
+        BinarySink::ColumnType type;
+    };
+
+    // Order here is the on-disk column order
+    const ColumnSpec COLUMNS[] = {
+        {"timestamp_us", BinarySink::ColumnType::I64},
+        {"version", BinarySink::ColumnType::U8},
+        {"wire_length", BinarySink::ColumnType::U32},
+        {"ihl", BinarySink::ColumnType::U8},
+        {"tos", BinarySink::ColumnType::U8},
+        {"total_length", BinarySink::ColumnType::U16},
+        {"identification", BinarySink::ColumnType::U16},
+        {"flags", BinarySink::ColumnType::U8},
+        {"fragment_offset", BinarySink::ColumnType::U16},
+        {"ttl", BinarySink::ColumnType::U8},
+        {"protocol", BinarySink::ColumnType::U8},
+        {"header_checksum", BinarySink::ColumnType::U16},
+        {"traffic_class", BinarySink::ColumnType::U8},
+        {"flow_label", BinarySink::ColumnType::U32},
+        {"payload_length", BinarySink::ColumnType::U16},
+        {"next_header", BinarySink::ColumnType::U8},
+        {"hop_limit", BinarySink::ColumnType::U8},
+        {"src_port", BinarySink::ColumnType::U16},
+        {"dst_port", BinarySink::ColumnType::U16},
+        {"tcp_flags", BinarySink::ColumnType::U8},
+        {"packet_flags", BinarySink::ColumnType::U8},
+        {"fragment_id", BinarySink::ColumnType::U32},
+        {"fragment_offset_bytes", BinarySink::ColumnType::U32},
+        {"datagram_size", BinarySink::ColumnType::U32},
+        {"src_address", BinarySink::ColumnType::STRING},
+        {"dst_address", BinarySink::ColumnType::STRING},
+        {"options", BinarySink::ColumnType::STRING},
+        {"extension_headers", BinarySink::ColumnType::STRING},
+        {"protocol_name", BinarySink::ColumnType::STRING},
+        {"src_address_id", BinarySink::ColumnType::U32},
+        {"dst_address_id", BinarySink::ColumnType::U32},
+    };
+
+    void appendLE(std::string &out, uint64_t value, int width)
+    {
+        for (int i = 0; i < width; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    template <typename T>
+    void appendColumn(std::string &out, const std::vector<T> &values)
+    {
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_WIN32)
+        // Columns are already laid out as the file wants them
+        out.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+#else
+        for (const T &value : values)
+        {
+            appendLE(out, static_cast<uint64_t>(value), sizeof(T));
+        }
+#endif
+    }
+
+    void appendOffsets(std::string &out, const std::vector<uint32_t> &offsets, const std::string &data)
+    {
+        appendColumn(out, offsets);
+        out += data;
+    }
+
+    template <typename Format>
+    void appendStringColumn(std::string &out, size_t rows, Format format)
+    {
+        std::string data;
+        appendLE(out, 0, 4);
+        for (size_t row = 0; row < rows; ++row)
+        {
+            data += format(row);
+            appendLE(out, data.size(), 4);
+        }
+        out += data;
+    }
+
+    // Text column of addresses; the dictionary IDs are collected on the way
+    void appendAddressColumn(std::string &out, const std::vector<IpAddress> &addresses, AddressCache &cache,
+                             std::vector<uint32_t> &ids)
+    {
+        std::string data;
+        char text[AddressCache::MAX_TEXT_LENGTH];
+        ids.resize(addresses.size());
+        appendLE(out, 0, 4);
+        for (size_t row = 0; row < addresses.size(); ++row)
+        {
+            const IpAddress &address = addresses[row];
+            ids[row] = 0;
+            data.append(text, cache.lookup(address.family, address.bytes, text, &ids[row]));
+            appendLE(out, data.size(), 4);
+        }
+        out += data;
+    }
+}
+
+BinarySink::BinarySink(const std::string &filename)
+    : filename_(filename), addresses_(AddressCache::DEFAULT_ENTRIES, true)
+{
+}
+
+BinarySink::~BinarySink()
+{
+    close();
+}
+
+bool BinarySink::open()
+{
+    namespace fs = std::filesystem;
+
+    std::string header = buildFileHeader();
+    std::error_code ec;
+    auto size = fs::file_size(filename_, ec);
+    bool has_content = !ec && size > 0;
+
+    if (has_content)
+    {
+        // Only append to a file written with the same column layout
+        std::ifstream existing(filename_, std::ios::binary);
+        std::string existing_header(header.size(), '\0');
+        existing.read(&existing_header[0], static_cast<std::streamsize>(existing_header.size()));
+        if (!existing || existing_header != header)
+        {
+            last_error_ = "Existing file has a different binary layout: " + filename_;
+            return false;
+        }
+    }
+
+    file_.open(filename_, std::ios::binary | std::ios::out | (has_content ? std::ios::app : std::ios::trunc));
+    if (!file_.is_open())
+    {
+        last_error_ = "Failed to open file: " + filename_;
+        return false;
+    }
+    if (!has_content)
+    {
+        file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    }
+
+    std::cout << (has_content ? "Appending to existing binary file: " : "Initialized new binary output file: ") << filename_ << std::endl;
+    return true;
+}
+
+bool BinarySink::consume(const PacketBatch &batch)
+{
+    if (!file_.is_open())
+    {
+        last_error_ = "Writer not initialized or file not open";
+        return false;
+    }
+    if (batch.packets.empty())
+    {
+        return true;
+    }
+
+    encodeBlock(batch);
+    file_.write(block_.data(), static_cast<std::streamsize>(block_.size()));
+    file_.flush();
+    if (!file_)
+    {
+        last_error_ = "Error writing block to " + filename_;
+        return false;
+    }
+    return true;
+}
+
+void BinarySink::close()
+{
+    if (file_.is_open())
+    {
+        file_.close();
+        std::cout << "Closed binary output file" << std::endl;
+    }
+}
+
+std::string BinarySink::getName() const
+{
+    return "binary:" + filename_;
+}
+
+std::string BinarySink::getLastError() const
+{
+    return last_error_;
+}
+
+std::string BinarySink::getSummary() const
+{
+    AddressCache::Stats stats = addresses_.getStats();
+    if (stats.lookups == 0)
+    {
+        return "";
+    }
+    return getName() + ": " + std::to_string(stats.ids_assigned) + " distinct addresses, " +
+           std::to_string(static_cast<int>(stats.hitRate() * 100.0 + 0.5)) + "% address cache hits";
+}
+
+std::string BinarySink::buildFileHeader()
+{
+    std::string header = "NDAB";
+    appendLE(header, FORMAT_VERSION, 2);
+    appendLE(header, std::size(COLUMNS), 2);
+    for (const auto &column : COLUMNS)
+    {
+        std::string name(column.name);
+        header.push_back(static_cast<char>(column.type));
+        header.push_back(static_cast<char>(name.size()));
+        header += name;
+    }
+    return header;
+}
+
+void BinarySink::encodeBlock(const PacketBatch &batch)
+{
+    // Row-only batches are transposed here; batches parsed straight into
+    // columns are written as they are
+    const FeatureColumns *columns = &batch.columns;
+    if (batch.columns.empty())
+    {
+        scratch_.clear();
+        scratch_.reserve(batch.packets.size());
+        for (const auto &record : batch.packets)
+        {
+            scratch_.appendRow(record);
+        }
+        columns = &scratch_;
+    }
+    const FeatureColumns &c = *columns;
+
+    block_.clear();
+    appendLE(block_, c.size(), 4);
+
+    appendColumn(block_, c.timestamp_us);
+    appendColumn(block_, c.version);
+    appendColumn(block_, c.wire_length);
+
+    appendColumn(block_, c.ihl);
+    appendColumn(block_, c.tos);
+    appendColumn(block_, c.total_length);
+    appendColumn(block_, c.identification);
+    appendColumn(block_, c.flags);
+    appendColumn(block_, c.fragment_offset);
+    appendColumn(block_, c.ttl);
+    appendColumn(block_, c.protocol);
+    appendColumn(block_, c.header_checksum);
+
+    appendColumn(block_, c.traffic_class);
+    appendColumn(block_, c.flow_label);
+    appendColumn(block_, c.payload_length);
+    appendColumn(block_, c.next_header);
+    appendColumn(block_, c.hop_limit);
+
+    appendColumn(block_, c.src_port);
+    appendColumn(block_, c.dst_port);
+    appendColumn(block_, c.tcp_flags);
+    appendColumn(block_, c.packet_flags);
+    appendColumn(block_, c.fragment_id);
+    appendColumn(block_, c.fragment_offset_bytes);
+    appendColumn(block_, c.datagram_size);
+
+    appendAddressColumn(block_, c.src_ip, addresses_, src_ids_);
+    appendAddressColumn(block_, c.dst_ip, addresses_, dst_ids_);
+    appendOffsets(block_, c.options_offsets, c.options_data);
+    appendOffsets(block_, c.extension_offsets, c.extension_data);
+    appendStringColumn(block_, c.size(), [&c](size_t row) -> const std::string &
+                       { return PacketParser::getProtocolName(c.l4_protocol[row]); });
+    appendColumn(block_, src_ids_);
+    appendColumn(block_, dst_ids_);
+}
\ No newline at end of file
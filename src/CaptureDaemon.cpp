@@ -0,0 +1,953 @@
+#include "CaptureDaemon.h"
+#include "JsonUtil.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/signalfd.h>
+#endif
+
+const char *const CaptureDaemon::DEFAULT_SOCKET_PATH = "/tmp/network-packet-analyzer.sock";
+
+namespace
+{
+    const size_t MAX_REQUEST_LINE = 64 * 1024;
+
+    std::string getField(const std::map<std::string, std::string> &request, const std::string &key,
+                         const std::string &fallback = "")
+    {
+        auto it = request.find(key);
+        return it == request.end() ? fallback : it->second;
+    }
+}
+
+CaptureDaemon::CaptureDaemon(const std::string &socket_path, const std::string &output_dir)
+    : socket_path_(socket_path), output_dir_(output_dir), listen_fd_(-1), shutting_down_(false), finished_count_(0)
+{
+}
+
+CaptureDaemon::~CaptureDaemon()
+{
+#ifndef _WIN32
+    if (listen_fd_ >= 0)
+    {
+        ::close(listen_fd_);
+        ::unlink(socket_path_.c_str());
+    }
+#endif
+}
+
+#ifdef _WIN32
+int CaptureDaemon::run()
+{
+    std::cerr << "Daemon mode requires Unix-domain sockets and is not supported on Windows" << std::endl;
+    return 1;
+}
+#else
+int CaptureDaemon::run()
+{
+    // Blocked before any capture or client thread exists; delivered via signalfd below
+    CaptureLoop::blockTerminationSignals();
+
+    if (!openSocket())
+    {
+        return 1;
+    }
+
+    PacketCapturer enumerator;
+    auto_interface_ = enumerator.selectFirstActiveInterface();
+    std::cout << "Capture daemon listening on " << socket_path_;
+    if (!auto_interface_.empty())
+    {
+        std::cout << " (auto interface: " << auto_interface_ << ")";
+    }
+    std::cout << std::endl;
+
+    int signal_fd = -1;
+#ifdef __linux__
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+#endif
+
+    while (!shutting_down_)
+    {
+        struct pollfd fds[2];
+        int nfds = 0;
+        fds[nfds].fd = listen_fd_;
+        fds[nfds].events = POLLIN;
+        nfds++;
+        if (signal_fd >= 0)
+        {
+            fds[nfds].fd = signal_fd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+
+        // Without signalfd the pending-signal flag is checked on a short timeout
+        int ready = poll(fds, nfds, signal_fd >= 0 ? -1 : 250);
+        if (ready < 0 && errno != EINTR)
+        {
+            std::cerr << "Daemon poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (CaptureLoop::isSignalPending() || (signal_fd >= 0 && ready > 0 && (fds[1].revents & POLLIN)))
+        {
+            std::cout << "Capture daemon shutting down..." << std::endl;
+            break;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN))
+        {
+            acceptClient();
+        }
+        reapClients(false);
+    }
+
+    shutting_down_ = true;
+    stopAllCaptures();
+    reapClients(true);
+
+    if (signal_fd >= 0)
+    {
+        ::close(signal_fd);
+    }
+    return 0;
+}
+#endif
+
+bool CaptureDaemon::openSocket()
+{
+#ifdef _WIN32
+    return false;
+#else
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socket_path_ << std::endl;
+        return false;
+    }
+    std::strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+    {
+        std::cerr << "Failed to create control socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A stale socket from a previous run would make bind fail
+    ::unlink(socket_path_.c_str());
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 16) != 0)
+    {
+        std::cerr << "Failed to bind control socket " << socket_path_ << ": " << std::strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    // Owner and group only: the daemon writes files with capture privileges
+    chmod(socket_path_.c_str(), 0660);
+    return true;
+#endif
+}
+
+void CaptureDaemon::acceptClient()
+{
+#ifndef _WIN32
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    auto client = std::make_unique<ClientConnection>();
+    client->fd = fd;
+    ClientConnection *raw = client.get();
+    client->thread = std::thread([this, raw]()
+                                 { serveClient(raw); });
+    clients_.push_back(std::move(client));
+#endif
+}
+
+void CaptureDaemon::reapClients(bool wait_all)
+{
+#ifndef _WIN32
+    for (auto it = clients_.begin(); it != clients_.end();)
+    {
+        ClientConnection *client = it->get();
+        if (wait_all && !client->done)
+        {
+            // Unblocks a pending read so the client thread can exit
+            shutdown(client->fd, SHUT_RDWR);
+        }
+        if (wait_all || client->done)
+        {
+            if (client->thread.joinable())
+            {
+                client->thread.join();
+            }
+            ::close(client->fd);
+            it = clients_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+#endif
+}
+
+void CaptureDaemon::serveClient(ClientConnection *client)
+{
+#ifndef _WIN32
+    std::string buffer;
+    char chunk[4096];
+
+    while (!shutting_down_)
+    {
+        ssize_t received = ::recv(client->fd, chunk, sizeof(chunk), 0);
+        if (received <= 0)
+        {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos)
+        {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (line.empty() || line == "\r")
+            {
+                continue;
+            }
+
+            std::string response = handleRequest(line) + "\n";
+            size_t sent = 0;
+            while (sent < response.size())
+            {
+                ssize_t n = ::send(client->fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    client->done = true;
+                    return;
+                }
+                sent += static_cast<size_t>(n);
+            }
+        }
+
+        if (buffer.size() > MAX_REQUEST_LINE)
+        {
+            std::string response = errorResponse("Request line too long") + "\n";
+            ::send(client->fd, response.data(), response.size(), MSG_NOSIGNAL);
+            break;
+        }
+    }
+#endif
+    client->done = true;
+}
+
+std::string CaptureDaemon::handleRequest(const std::string &line)
+{
+    Request request;
+    std::string error;
+    if (!parseFlatJSONObject(line, request, error))
+    {
+        return errorResponse("Malformed request: " + error);
+    }
+
+    std::string cmd = getField(request, "cmd");
+    if (cmd == "start")
+        return startCapture(request);
+    if (cmd == "stop")
+        return stopCapture(request);
+    if (cmd == "dump")
+        return dumpRing(request);
+    if (cmd == "status")
+        return describeCaptures(request, false);
+    if (cmd == "stats")
+        return describeCaptures(request, true);
+    if (cmd == "wait")
+        return waitForCapture(request);
+    if (cmd == "interfaces")
+    {
+        // The document is pretty-printed; the protocol needs it on one line
+        PacketCapturer enumerator;
+        std::string json = enumerator.getInterfacesJSON();
+        json.erase(std::remove(json.begin(), json.end(), '\n'), json.end());
+        return json;
+    }
+    return errorResponse("Unknown command '" + cmd + "'");
+}
+
+std::string CaptureDaemon::startCapture(const Request &request)
+{
+    CaptureConfig config;
+    std::string error;
+    if (!resolveOutputPath(getField(request, "output"), config.output_filename, error))
+    {
+        return errorResponse(error);
+    }
+
+    if (!parseIPVersionFilter(getField(request, "filter", "both"), config.ip_filter))
+    {
+        return errorResponse("Invalid filter '" + getField(request, "filter") + "'");
+    }
+
+    try
+    {
+        config.duration_seconds = std::stoi(getField(request, "duration", "0"));
+    }
+    catch (...)
+    {
+        return errorResponse("Invalid duration '" + getField(request, "duration") + "'");
+    }
+
+    std::string promisc = getField(request, "promiscuous", "on");
+    config.promiscuous = !(promisc == "off" || promisc == "false");
+    // The stop file is removed when the capture ends, so it is confined like
+    // the output and must not exist yet: only a file created to stop this
+    // capture is ever deleted
+    std::string stop_file = getField(request, "stopFile");
+    if (!stop_file.empty())
+    {
+        std::error_code ec;
+        if (!resolveOutputPath(stop_file, config.stop_file, error, "Stop file"))
+        {
+            return errorResponse(error);
+        }
+        if (std::filesystem::exists(std::filesystem::symlink_status(config.stop_file, ec)))
+        {
+            return errorResponse("Stop file " + config.stop_file + " already exists");
+        }
+    }
+    std::string stream = getField(request, "stream");
+    if (!stream.empty() && !resolveSocketPath(stream, config.stream_socket, error))
+    {
+        return errorResponse(error);
+    }
+    if (!DatasetWriter::parseColumnGroups(getField(request, "columns"), config.column_groups, error))
+    {
+        return errorResponse(error);
+    }
+    std::string enrich = getField(request, "enrich");
+    if (!enrich.empty() && !PrefixEnricher::parseSpec(enrich, config.enrich_sources, error))
+    {
+        return errorResponse(error);
+    }
+    config.label_rules = getField(request, "labels");
+    std::string anonymize = getField(request, "anonymize");
+    if (!anonymize.empty() && !Anonymizer::parseFields(anonymize, config.anonymize_fields, error))
+    {
+        return errorResponse(error);
+    }
+    config.anonymize_key_file = getField(request, "anonymizeKey");
+    if (config.anonymize_fields == 0 && !config.anonymize_key_file.empty())
+    {
+        config.anonymize_fields = ANONYMIZE_ADDRESSES;
+    }
+    // Split files sit next to the output (names are [A-Za-z0-9_-]), so the
+    // output directory confines them too
+    std::string split = getField(request, "split");
+    if (!split.empty() && !DatasetWriter::parseSplits(split, config.splits, error))
+    {
+        return errorResponse(error);
+    }
+    std::string split_seed = getField(request, "splitSeed");
+    if (!split_seed.empty())
+    {
+        char *end = nullptr;
+        unsigned long long seed = std::strtoull(split_seed.c_str(), &end, 10);
+        if (*end != '\0' || split_seed[0] == '-')
+        {
+            return errorResponse("Invalid splitSeed '" + split_seed + "'");
+        }
+        config.split_seed = static_cast<uint64_t>(seed);
+    }
+    std::string index_rows = getField(request, "indexRows");
+    if (!index_rows.empty())
+    {
+        char *end = nullptr;
+        long rows = std::strtol(index_rows.c_str(), &end, 10);
+        if (*end != '\0' || rows < 1 || rows > 100000000)
+        {
+            return errorResponse("Invalid indexRows '" + index_rows + "'");
+        }
+        config.index_rows = static_cast<uint32_t>(rows);
+    }
+    std::string index_ms = getField(request, "indexMs");
+    if (!index_ms.empty())
+    {
+        char *end = nullptr;
+        long milliseconds = std::strtol(index_ms.c_str(), &end, 10);
+        if (*end != '\0' || milliseconds < 1 || milliseconds > 3600000)
+        {
+            return errorResponse("Invalid indexMs '" + index_ms + "'");
+        }
+        config.index_ms = static_cast<int>(milliseconds);
+    }
+    std::string tunnel_depth = getField(request, "tunnelDepth");
+    if (!tunnel_depth.empty())
+    {
+        char *end = nullptr;
+        long depth = std::strtol(tunnel_depth.c_str(), &end, 10);
+        if (*end != '\0' || depth < 0 || depth > TunnelFeature::MAX_DEPTH)
+        {
+            return errorResponse("Invalid tunnelDepth '" + tunnel_depth + "'");
+        }
+        config.tunnel_depth = static_cast<int>(depth);
+    }
+    std::string ring_seconds = getField(request, "ring");
+    if (!ring_seconds.empty())
+    {
+        char *end = nullptr;
+        long seconds = std::strtol(ring_seconds.c_str(), &end, 10);
+        if (*end != '\0' || seconds < 1 || seconds > 3600)
+        {
+            return errorResponse("Invalid ring '" + ring_seconds + "'");
+        }
+        config.ring_seconds = static_cast<int>(seconds);
+    }
+    std::string ring_megabytes = getField(request, "ringMegabytes");
+    if (!ring_megabytes.empty())
+    {
+        char *end = nullptr;
+        long megabytes = std::strtol(ring_megabytes.c_str(), &end, 10);
+        if (*end != '\0' || megabytes < 1 || megabytes > 65536)
+        {
+            return errorResponse("Invalid ringMegabytes '" + ring_megabytes + "'");
+        }
+        config.ring_megabytes = static_cast<size_t>(megabytes);
+    }
+    std::string ring_pps = getField(request, "ringTriggerPps");
+    if (!ring_pps.empty())
+    {
+        char *end = nullptr;
+        long long pps = std::strtoll(ring_pps.c_str(), &end, 10);
+        if (*end != '\0' || pps < 1)
+        {
+            return errorResponse("Invalid ringTriggerPps '" + ring_pps + "'");
+        }
+        config.ring_trigger_pps = static_cast<uint64_t>(pps);
+    }
+    std::string writer = getField(request, "writer");
+    if ((!writer.empty() && !WriterBackend::parseSpec(writer, config.writer, error)) ||
+        !WriterBackend::parseDurability(getField(request, "durability"), config.writer, error))
+    {
+        return errorResponse(error);
+    }
+    if (!BackpressurePolicy::parse(getField(request, "backpressure"), config.backpressure, error))
+    {
+        return errorResponse(error);
+    }
+    if (!config.backpressure.spill_directory.empty() &&
+        !resolveOutputPath(config.backpressure.spill_directory, config.backpressure.spill_directory, error, "Spill directory"))
+    {
+        return errorResponse(error);
+    }
+    std::string queue_megabytes = getField(request, "queueMegabytes");
+    if (!queue_megabytes.empty())
+    {
+        char *end = nullptr;
+        long megabytes = std::strtol(queue_megabytes.c_str(), &end, 10);
+        if (*end != '\0' || megabytes < 1 || megabytes > 65536)
+        {
+            return errorResponse("Invalid queueMegabytes '" + queue_megabytes + "'");
+        }
+        config.backpressure.queue_bytes = static_cast<size_t>(megabytes) << 20;
+    }
+    std::string reorder_ms = getField(request, "reorderMs");
+    if (!reorder_ms.empty())
+    {
+        char *end = nullptr;
+        long milliseconds = std::strtol(reorder_ms.c_str(), &end, 10);
+        if (*end != '\0' || milliseconds < 1 || milliseconds > 60000)
+        {
+            return errorResponse("Invalid reorderMs '" + reorder_ms + "'");
+        }
+        config.reorder_ms = static_cast<int>(milliseconds);
+    }
+    std::string reorder_megabytes = getField(request, "reorderMegabytes");
+    if (!reorder_megabytes.empty())
+    {
+        char *end = nullptr;
+        long megabytes = std::strtol(reorder_megabytes.c_str(), &end, 10);
+        if (*end != '\0' || megabytes < 1 || megabytes > 65536)
+        {
+            return errorResponse("Invalid reorderMegabytes '" + reorder_megabytes + "'");
+        }
+        config.reorder_megabytes = static_cast<size_t>(megabytes);
+    }
+    std::string dedup_ms = getField(request, "dedupMs");
+    if (!dedup_ms.empty())
+    {
+        char *end = nullptr;
+        long milliseconds = std::strtol(dedup_ms.c_str(), &end, 10);
+        if (*end != '\0' || milliseconds < 0 || milliseconds > 60000)
+        {
+            return errorResponse("Invalid dedupMs '" + dedup_ms + "'");
+        }
+        config.dedup_ms = static_cast<int>(milliseconds);
+    }
+    for (const auto &text : splitSinkList(getField(request, "sinks")))
+    {
+        // Extra file outputs are confined the same way as the main output,
+        // extra live sockets the same way as the stream socket
+        SinkSpec spec;
+        if (!parseSinkSpec(text, spec, error))
+        {
+            return errorResponse(error);
+        }
+        if (spec.writesFile() && !resolveOutputPath(spec.target, spec.target, error))
+        {
+            return errorResponse(error);
+        }
+        if (spec.bindsSocket() && !resolveSocketPath(spec.target, spec.target, error))
+        {
+            return errorResponse(error);
+        }
+        config.sinks.push_back(spec.type + ":" + spec.target + (spec.option.empty() ? "" : ":" + spec.option));
+    }
+    config.handle_signals = false;
+    config.verbose = false;
+
+    std::string id = getField(request, "id", config.output_filename);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (shutting_down_)
+    {
+        return errorResponse("Daemon is shutting down");
+    }
+    for (const auto &entry : captures_)
+    {
+        const ManagedCapture &other = *entry.second;
+        if (!other.isActive())
+            continue;
+        if (other.id == id)
+            return errorResponse("Capture '" + id + "' is already running");
+        if (other.session->getConfig().output_filename == config.output_filename)
+            return errorResponse("Output " + config.output_filename + " is in use by capture '" + other.id + "'");
+    }
+
+    config.interface_name = getField(request, "interface", "auto");
+    if (config.interface_name == "auto" || config.interface_name.empty())
+    {
+        if (auto_interface_.empty())
+        {
+            PacketCapturer enumerator;
+            auto_interface_ = enumerator.selectFirstActiveInterface();
+        }
+        if (auto_interface_.empty())
+        {
+            return errorResponse("No active network interface found");
+        }
+        config.interface_name = auto_interface_;
+    }
+
+    // The entry reserves the id and output while the session initializes
+    // without the lock. A finished capture under the same id is replaced (its
+    // worker has nothing left to do but return) and put back on failure
+    auto capture = std::make_shared<ManagedCapture>();
+    capture->id = id;
+    capture->state = "starting";
+    capture->session = std::make_unique<CaptureSession>(config, acquireHandle(config.interface_name, config.promiscuous));
+    std::shared_ptr<ManagedCapture> previous;
+    auto existing = captures_.find(id);
+    if (existing != captures_.end())
+    {
+        previous = existing->second;
+        if (previous->worker.joinable())
+        {
+            previous->worker.join();
+        }
+    }
+    captures_[id] = capture;
+    lock.unlock();
+
+    bool initialized = capture->session->initialize();
+
+    lock.lock();
+    if (!initialized || shutting_down_)
+    {
+        std::string message = initialized ? "Daemon is shutting down" : capture->session->getLastError();
+        capture->state = "failed";
+        capture->error = message;
+        parkHandle(capture->session->releaseCapturer());
+        if (previous)
+        {
+            captures_[id] = previous;
+        }
+        else
+        {
+            captures_.erase(id);
+        }
+        state_changed_.notify_all();
+        return errorResponse(message);
+    }
+    capture->state = "running";
+    capture->worker = std::thread([this, capture]()
+                                  { runCapture(capture); });
+    std::string response = "{\"ok\": true, \"capture\": " + describeCapture(*capture, false) + "}";
+    pruneFinishedCaptures();
+    lock.unlock();
+
+    std::cout << "Started capture '" << id << "' on " << config.interface_name
+              << " -> " << config.output_filename << std::endl;
+    return response;
+}
+
+std::string CaptureDaemon::stopCapture(const Request &request)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string id = getField(request, "id");
+    int stopped = 0;
+
+    for (auto &entry : captures_)
+    {
+        ManagedCapture &capture = *entry.second;
+        if ((id.empty() || capture.id == id) && capture.state == "running")
+        {
+            capture.session->requestStop();
+            stopped++;
+        }
+    }
+
+    if (!id.empty() && stopped == 0)
+    {
+        return errorResponse("No running capture '" + id + "'");
+    }
+    return "{\"ok\": true, \"stopped\": " + std::to_string(stopped) + "}";
+}
+
+std::string CaptureDaemon::dumpRing(const Request &request)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string id = getField(request, "id");
+    auto it = captures_.find(id);
+    if (it == captures_.end() || it->second->state != "running")
+    {
+        return errorResponse("No running capture '" + id + "'");
+    }
+    if (!it->second->session->requestRingDump())
+    {
+        return errorResponse("Capture '" + id + "' has no packet ring");
+    }
+    // The file name is reported by stats once the dump has been written
+    return "{\"ok\": true, \"id\": \"" + escapeJSON(id) + "\"}";
+}
+
+std::string CaptureDaemon::describeCaptures(const Request &request, bool include_stats)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pruneFinishedCaptures();
+    std::string id = getField(request, "id");
+
+    if (!id.empty())
+    {
+        auto it = captures_.find(id);
+        if (it == captures_.end())
+        {
+            return errorResponse("Unknown capture '" + id + "'");
+        }
+        return "{\"ok\": true, \"capture\": " + describeCapture(*it->second, include_stats) + "}";
+    }
+
+    std::ostringstream json;
+    json << "{\"ok\": true, \"captures\": [";
+    bool first = true;
+    for (const auto &entry : captures_)
+    {
+        if (!first)
+            json << ", ";
+        first = false;
+        json << describeCapture(*entry.second, include_stats);
+    }
+    json << "]";
+
+    if (include_stats)
+    {
+        size_t idle = 0;
+        for (const auto &entry : idle_handles_)
+        {
+            idle += entry.second.size();
+        }
+        json << ", \"idleHandles\": " << idle;
+    }
+    json << "}";
+    return json.str();
+}
+
+std::string CaptureDaemon::waitForCapture(const Request &request)
+{
+    std::string id = getField(request, "id");
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    auto it = captures_.find(id);
+    if (it == captures_.end())
+    {
+        return errorResponse("Unknown capture '" + id + "'");
+    }
+
+    std::shared_ptr<ManagedCapture> capture = it->second;
+    state_changed_.wait(lock, [&capture]()
+                        { return !capture->isActive(); });
+
+    if (capture->state == "failed")
+    {
+        return "{\"ok\": false, \"error\": \"" + escapeJSON(capture->error) +
+               "\", \"capture\": " + describeCapture(*capture, true) + "}";
+    }
+    return "{\"ok\": true, \"capture\": " + describeCapture(*capture, true) + "}";
+}
+
+std::string CaptureDaemon::describeCapture(const ManagedCapture &capture, bool include_stats) const
+{
+    const CaptureConfig &config = capture.session->getConfig();
+    std::ostringstream json;
+    json << "{\"id\": \"" << escapeJSON(capture.id) << "\""
+         << ", \"state\": \"" << capture.state << "\""
+         << ", \"output\": \"" << escapeJSON(config.output_filename) << "\""
+         << ", \"interface\": \"" << escapeJSON(config.interface_name) << "\"";
+
+    if (!capture.isActive())
+    {
+        json << ", \"stopReason\": \"" << CaptureLoop::getStopReasonName(capture.session->getStopReason()) << "\"";
+    }
+    if (!capture.error.empty())
+    {
+        json << ", \"error\": \"" << escapeJSON(capture.error) << "\"";
+    }
+
+    if (include_stats)
+    {
+        CaptureStats stats = capture.session->getStats();
+        json << ", \"packetsCaptured\": " << stats.packets_captured
+             << ", \"packetsProcessed\": " << stats.packets_processed
+             << ", \"packetsDropped\": " << stats.packets_dropped
+             << ", \"packetsDuplicate\": " << stats.packets_duplicate
+             << ", \"elapsedSeconds\": " << std::fixed << std::setprecision(3) << stats.elapsed_seconds;
+
+        PacketRing::Stats ring;
+        std::string last_dump;
+        if (capture.session->getRingStats(ring, last_dump))
+        {
+            json << ", \"ringPackets\": " << ring.packets_stored
+                 << ", \"ringSkipped\": " << ring.packets_skipped
+                 << ", \"ringDumps\": " << ring.dumps_written
+                 << ", \"lastRingDump\": \"" << escapeJSON(last_dump) << "\"";
+        }
+    }
+    json << "}";
+    return json.str();
+}
+
+void CaptureDaemon::runCapture(std::shared_ptr<ManagedCapture> capture)
+{
+    bool ok = capture->session->run();
+
+    const CaptureConfig &config = capture->session->getConfig();
+    if (!config.stop_file.empty())
+    {
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(std::filesystem::symlink_status(config.stop_file, ec)))
+        {
+            std::filesystem::remove(config.stop_file, ec);
+        }
+    }
+
+    CaptureStats stats = capture->session->getStats();
+    std::cout << "Capture '" << capture->id << "' finished ("
+              << CaptureLoop::getStopReasonName(capture->session->getStopReason()) << "): "
+              << stats.packets_processed << " packets written to " << config.output_filename << std::endl;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    capture->finish_sequence = ++finished_count_;
+    if (ok)
+    {
+        capture->state = "finished";
+        parkHandle(capture->session->releaseCapturer());
+    }
+    else
+    {
+        capture->state = "failed";
+        capture->error = capture->session->getLastError();
+    }
+    state_changed_.notify_all();
+}
+
+void CaptureDaemon::pruneFinishedCaptures()
+{
+    if (shutting_down_)
+    {
+        return; // stopAllCaptures joins everything
+    }
+    std::vector<std::pair<uint64_t, std::string>> finished;
+    for (const auto &entry : captures_)
+    {
+        if (entry.second->finish_sequence > 0)
+        {
+            finished.emplace_back(entry.second->finish_sequence, entry.first);
+        }
+    }
+    if (finished.size() <= MAX_FINISHED_CAPTURES)
+    {
+        return;
+    }
+
+    // A finished worker only has to return once it has set the state under
+    // the lock, so joining here does not wait on anything
+    std::sort(finished.begin(), finished.end());
+    for (size_t i = 0; i + MAX_FINISHED_CAPTURES < finished.size(); ++i)
+    {
+        auto it = captures_.find(finished[i].second);
+        if (it->second->worker.joinable())
+        {
+            it->second->worker.join();
+        }
+        captures_.erase(it);
+    }
+}
+
+void CaptureDaemon::stopAllCaptures()
+{
+    std::vector<std::shared_ptr<ManagedCapture>> captures;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &entry : captures_)
+        {
+            if (entry.second->state == "running")
+            {
+                entry.second->session->requestStop();
+            }
+            captures.push_back(entry.second);
+        }
+    }
+
+    for (auto &capture : captures)
+    {
+        if (capture->worker.joinable())
+        {
+            capture->worker.join();
+        }
+    }
+}
+
+bool CaptureDaemon::resolveOutputPath(const std::string &requested, std::string &resolved, std::string &error,
+                                      const char *what) const
+{
+    namespace fs = std::filesystem;
+
+    if (requested.empty())
+    {
+        error = "Missing 'output'";
+        return false;
+    }
+
+    std::error_code ec;
+    fs::path path(requested);
+    if (!output_dir_.empty())
+    {
+        if (!confinePath(output_dir_, requested, resolved))
+        {
+            error = std::string(what) + " must be inside " + fs::weakly_canonical(fs::path(output_dir_), ec).string();
+            return false;
+        }
+        return true;
+    }
+
+    resolved = path.is_absolute() ? path.string() : fs::absolute(path, ec).string();
+    return true;
+}
+
+bool CaptureDaemon::resolveSocketPath(const std::string &requested, std::string &resolved, std::string &error) const
+{
+    // Stream sockets live next to the control socket, in a directory the
+    // daemon's operator chose
+    std::string directory = std::filesystem::path(socket_path_).parent_path().string();
+    if (directory.empty())
+    {
+        directory = ".";
+    }
+    if (!confinePath(directory, requested, resolved))
+    {
+        std::error_code ec;
+        error = "Stream socket must be inside " + std::filesystem::weakly_canonical(directory, ec).string();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureDaemon::confinePath(const std::string &base_dir, const std::string &requested, std::string &resolved)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::path path(requested);
+    fs::path base = fs::weakly_canonical(fs::path(base_dir), ec);
+    if (ec)
+    {
+        return false;
+    }
+    fs::path candidate = fs::weakly_canonical(path.is_absolute() ? path : base / path, ec);
+    auto mismatch = std::mismatch(base.begin(), base.end(), candidate.begin(), candidate.end());
+    if (ec || mismatch.first != base.end())
+    {
+        return false;
+    }
+    resolved = candidate.string();
+    return true;
+}
+
+std::unique_ptr<PacketCapturer> CaptureDaemon::acquireHandle(const std::string &interface_name, bool promiscuous)
+{
+    auto it = idle_handles_.find(handleKey(interface_name, promiscuous));
+    if (it == idle_handles_.end() || it->second.empty())
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<PacketCapturer> capturer = std::move(it->second.back());
+    it->second.pop_back();
+    return capturer;
+}
+
+void CaptureDaemon::parkHandle(std::unique_ptr<PacketCapturer> capturer)
+{
+    if (!capturer || capturer->getInterfaceName().empty() || shutting_down_)
+    {
+        return;
+    }
+    std::string key = handleKey(capturer->getInterfaceName(), capturer->isPromiscuous());
+    idle_handles_[key].push_back(std::move(capturer));
+}
+
+std::string CaptureDaemon::handleKey(const std::string &interface_name, bool promiscuous)
+{
+    return interface_name + (promiscuous ? "|promisc" : "|local");
+}
+
+std::string CaptureDaemon::errorResponse(const std::string &message)
+{
+    return "{\"ok\": false, \"error\": \"" + escapeJSON(message) + "\"}";
+}
@@ -0,0 +1,606 @@
+#include "CaptureLoop.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+
+#ifdef __linux__
+#include <csignal>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#endif
+
+std::atomic<bool> CaptureLoop::signal_pending_(false);
+std::atomic<bool> CaptureLoop::trigger_signal_pending_(false);
+std::atomic<int> CaptureLoop::signal_wake_fds_[CaptureLoop::MAX_SIGNAL_LOOPS];
+
+namespace
+{
+#ifdef __linux__
+    enum EventSource : uint32_t
+    {
+        SOURCE_PCAP,
+        SOURCE_WAKE,
+        SOURCE_TIMER,
+        SOURCE_SIGNAL,
+        SOURCE_INOTIFY,
+        SOURCE_STOP_POLL,
+        SOURCE_TICK
+    };
+
+    bool addToEpoll(int epoll_fd, int fd, EventSource source)
+    {
+        struct epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = source;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    int createTimer(int initial_ms, int interval_ms)
+    {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        struct itimerspec spec;
+        std::memset(&spec, 0, sizeof(spec));
+        spec.it_value.tv_sec = initial_ms / 1000;
+        spec.it_value.tv_nsec = static_cast<long>(initial_ms % 1000) * 1000000L;
+        spec.it_interval.tv_sec = interval_ms / 1000;
+        spec.it_interval.tv_nsec = static_cast<long>(interval_ms % 1000) * 1000000L;
+        if (timerfd_settime(fd, 0, &spec, nullptr) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    void closeIfOpen(int fd)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+#endif
+
+    const int STOP_FILE_POLL_MS = 200;
+}
+
+CaptureLoop::CaptureLoop(PacketCapturer &capturer)
+    : capturer_(capturer), duration_seconds_(0), handle_signals_(true), tick_ms_(0),
+      stop_requested_(false), trigger_requested_(false), stop_reason_(StopReason::NONE), wake_fd_(-1)
+{
+#ifdef __linux__
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+CaptureLoop::~CaptureLoop()
+{
+#ifdef __linux__
+    closeIfOpen(wake_fd_);
+#endif
+}
+
+void CaptureLoop::setDuration(int seconds)
+{
+    duration_seconds_ = seconds > 0 ? seconds : 0;
+}
+
+void CaptureLoop::setStopFile(const std::string &path)
+{
+    stop_file_ = path;
+}
+
+void CaptureLoop::setHandleSignals(bool enable)
+{
+    handle_signals_ = enable;
+}
+
+void CaptureLoop::setTickInterval(int milliseconds)
+{
+    tick_ms_ = milliseconds > 0 ? milliseconds : 0;
+}
+
+void CaptureLoop::setDispatchCompleteCallback(std::function<void()> callback)
+{
+    dispatch_complete_ = std::move(callback);
+}
+
+void CaptureLoop::setTriggerCallback(std::function<void(const std::string &)> callback)
+{
+    trigger_ = std::move(callback);
+}
+
+bool CaptureLoop::run()
+{
+    stop_reason_ = StopReason::NONE;
+#ifdef __linux__
+    if (capturer_.getSelectableFd() >= 0 && wake_fd_ >= 0)
+    {
+        return runEventLoop();
+    }
+#endif
+    return runPollingLoop();
+}
+
+void CaptureLoop::requestStop()
+{
+    stop_requested_ = true;
+#ifdef __linux__
+    if (wake_fd_ >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+void CaptureLoop::requestTrigger()
+{
+    trigger_requested_ = true;
+#ifdef __linux__
+    if (wake_fd_ >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+void CaptureLoop::runPendingTriggers()
+{
+    bool requested = trigger_requested_.exchange(false);
+    bool signalled = handle_signals_ && trigger_signal_pending_.exchange(false);
+    if (trigger_ && requested)
+    {
+        trigger_("request");
+    }
+    if (trigger_ && signalled)
+    {
+        trigger_("signal");
+    }
+}
+
+CaptureLoop::StopReason CaptureLoop::getStopReason() const
+{
+    return stop_reason_;
+}
+
+std::string CaptureLoop::getLastError() const
+{
+    return last_error_;
+}
+
+void CaptureLoop::blockTerminationSignals()
+{
+#ifdef __linux__
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+#endif
+}
+
+void CaptureLoop::blockTriggerSignal()
+{
+#ifdef __linux__
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+#endif
+}
+
+void CaptureLoop::notifyTriggerSignal()
+{
+    trigger_signal_pending_ = true;
+    wakeFromSignal();
+}
+
+void CaptureLoop::notifySignal()
+{
+    signal_pending_ = true;
+    wakeFromSignal();
+}
+
+bool CaptureLoop::registerSignalWakeFd(int fd)
+{
+    for (std::atomic<int> &slot : signal_wake_fds_)
+    {
+        int expected = 0;
+        if (slot.compare_exchange_strong(expected, fd + 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CaptureLoop::unregisterSignalWakeFd(int fd)
+{
+    for (std::atomic<int> &slot : signal_wake_fds_)
+    {
+        int expected = fd + 1;
+        if (slot.compare_exchange_strong(expected, 0))
+        {
+            return;
+        }
+    }
+}
+
+void CaptureLoop::wakeFromSignal()
+{
+#ifdef __linux__
+    // write() on an eventfd is async-signal-safe
+    for (std::atomic<int> &slot : signal_wake_fds_)
+    {
+        int fd = slot.load() - 1;
+        if (fd >= 0)
+        {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(fd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+#endif
+}
+
+bool CaptureLoop::isSignalPending()
+{
+    return signal_pending_;
+}
+
+const char *CaptureLoop::getStopReasonName(StopReason reason)
+{
+    switch (reason)
+    {
+    case StopReason::NONE:
+        return "none";
+    case StopReason::DURATION:
+        return "duration";
+    case StopReason::SIGNAL:
+        return "signal";
+    case StopReason::STOP_FILE:
+        return "stop_file";
+    case StopReason::REQUESTED:
+        return "requested";
+    case StopReason::CAPTURE_ERROR:
+        return "error";
+    }
+    return "none";
+}
+
+bool CaptureLoop::stopFileExists() const
+{
+    std::error_code ec;
+    return !stop_file_.empty() && std::filesystem::exists(stop_file_, ec);
+}
+
+#ifdef __linux__
+bool CaptureLoop::runEventLoop()
+{
+    int pcap_fd = capturer_.getSelectableFd();
+    if (!capturer_.setNonBlocking(true))
+    {
+        std::cout << "Warning: Could not switch capture to non-blocking mode, using polling loop" << std::endl;
+        return runPollingLoop();
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        capturer_.setNonBlocking(false);
+        return runPollingLoop();
+    }
+
+    int timer_fd = -1;
+    int signal_fd = -1;
+    int inotify_fd = -1;
+    int stop_poll_fd = -1;
+    int tick_fd = -1;
+    std::string stop_file_name;
+
+    addToEpoll(epoll_fd, pcap_fd, SOURCE_PCAP);
+    addToEpoll(epoll_fd, wake_fd_, SOURCE_WAKE);
+    bool wake_registered = handle_signals_ && registerSignalWakeFd(wake_fd_);
+    if (handle_signals_ && !wake_registered)
+    {
+        std::cerr << "Warning: more than " << MAX_SIGNAL_LOOPS
+                  << " capture loops handle signals; this one only sees signals through its signalfd" << std::endl;
+    }
+
+    if (duration_seconds_ > 0)
+    {
+        timer_fd = createTimer(duration_seconds_ * 1000, 0);
+        if (timer_fd >= 0)
+        {
+            addToEpoll(epoll_fd, timer_fd, SOURCE_TIMER);
+        }
+    }
+
+    if (tick_ms_ > 0 && dispatch_complete_)
+    {
+        tick_fd = createTimer(tick_ms_, tick_ms_);
+        if (tick_fd >= 0)
+        {
+            addToEpoll(epoll_fd, tick_fd, SOURCE_TICK);
+        }
+    }
+
+    if (handle_signals_)
+    {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        if (trigger_)
+        {
+            sigaddset(&mask, SIGUSR1);
+        }
+        signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (signal_fd >= 0)
+        {
+            addToEpoll(epoll_fd, signal_fd, SOURCE_SIGNAL);
+        }
+    }
+
+    if (!stop_file_.empty())
+    {
+        std::filesystem::path stop_path(stop_file_);
+        std::string directory = stop_path.parent_path().string();
+        if (directory.empty())
+        {
+            directory = ".";
+        }
+        stop_file_name = stop_path.filename().string();
+
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd >= 0 &&
+            inotify_add_watch(inotify_fd, directory.c_str(), IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE) >= 0)
+        {
+            addToEpoll(epoll_fd, inotify_fd, SOURCE_INOTIFY);
+        }
+        else
+        {
+            // Directory not watchable (missing, or inotify limits reached)
+            closeIfOpen(inotify_fd);
+            inotify_fd = -1;
+            stop_poll_fd = createTimer(STOP_FILE_POLL_MS, STOP_FILE_POLL_MS);
+            if (stop_poll_fd >= 0)
+            {
+                addToEpoll(epoll_fd, stop_poll_fd, SOURCE_STOP_POLL);
+            }
+        }
+    }
+
+    // The stop file may have been created before the watch was installed
+    if (stopFileExists())
+    {
+        stop_reason_ = StopReason::STOP_FILE;
+    }
+    if (handle_signals_ && signal_pending_)
+    {
+        stop_reason_ = StopReason::SIGNAL;
+    }
+    if (stop_requested_)
+    {
+        stop_reason_ = StopReason::REQUESTED;
+    }
+
+    struct epoll_event events[8];
+    while (stop_reason_ == StopReason::NONE)
+    {
+        int ready = epoll_wait(epoll_fd, events, 8, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            last_error_ = std::string("epoll_wait failed: ") + std::strerror(errno);
+            stop_reason_ = StopReason::CAPTURE_ERROR;
+            break;
+        }
+
+        for (int i = 0; i < ready && stop_reason_ == StopReason::NONE; ++i)
+        {
+            switch (events[i].data.u32)
+            {
+            case SOURCE_PCAP:
+            {
+                int result = capturer_.dispatch(-1);
+                if (dispatch_complete_)
+                {
+                    dispatch_complete_();
+                }
+                if (result == -1)
+                {
+                    last_error_ = capturer_.getLastError();
+                    stop_reason_ = StopReason::CAPTURE_ERROR;
+                }
+                else if (result == -2 || stop_requested_)
+                {
+                    stop_reason_ = StopReason::REQUESTED;
+                }
+                break;
+            }
+            case SOURCE_WAKE:
+            {
+                uint64_t value;
+                ssize_t ignored = ::read(wake_fd_, &value, sizeof(value));
+                (void)ignored;
+                runPendingTriggers();
+                if (handle_signals_ && signal_pending_)
+                {
+                    std::cout << "\nReceived termination signal. Stopping capture..." << std::endl;
+                    stop_reason_ = StopReason::SIGNAL;
+                }
+                else if (stop_requested_)
+                {
+                    stop_reason_ = StopReason::REQUESTED;
+                }
+                break;
+            }
+            case SOURCE_TIMER:
+                std::cout << "\n[Timer] Duration reached. Stopping capture..." << std::endl;
+                stop_reason_ = StopReason::DURATION;
+                break;
+            case SOURCE_SIGNAL:
+            {
+                struct signalfd_siginfo info;
+                if (::read(signal_fd, &info, sizeof(info)) != sizeof(info))
+                {
+                    break;
+                }
+                if (info.ssi_signo == SIGUSR1)
+                {
+                    trigger_("signal");
+                }
+                else
+                {
+                    std::cout << "\nReceived signal " << info.ssi_signo << ". Stopping capture..." << std::endl;
+                    stop_reason_ = StopReason::SIGNAL;
+                    // The signalfd hands each signal to one reader only
+                    notifySignal();
+                }
+                break;
+            }
+            case SOURCE_INOTIFY:
+            {
+                alignas(struct inotify_event) char buffer[4096];
+                ssize_t length;
+                while ((length = ::read(inotify_fd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char *ptr = buffer; ptr < buffer + length;)
+                    {
+                        auto *event = reinterpret_cast<struct inotify_event *>(ptr);
+                        if (event->len > 0 && stop_file_name == event->name)
+                        {
+                            stop_reason_ = StopReason::STOP_FILE;
+                        }
+                        ptr += sizeof(struct inotify_event) + event->len;
+                    }
+                }
+                if (stop_reason_ == StopReason::STOP_FILE)
+                {
+                    std::cout << "\n[Stop] External stop signal detected. Stopping capture..." << std::endl;
+                }
+                break;
+            }
+            case SOURCE_STOP_POLL:
+            {
+                uint64_t expirations;
+                ssize_t ignored = ::read(stop_poll_fd, &expirations, sizeof(expirations));
+                (void)ignored;
+                if (stopFileExists())
+                {
+                    std::cout << "\n[Stop] External stop signal detected. Stopping capture..." << std::endl;
+                    stop_reason_ = StopReason::STOP_FILE;
+                }
+                break;
+            }
+            case SOURCE_TICK:
+            {
+                uint64_t expirations;
+                ssize_t ignored = ::read(tick_fd, &expirations, sizeof(expirations));
+                (void)ignored;
+                dispatch_complete_();
+                break;
+            }
+            }
+        }
+    }
+
+    if (wake_registered)
+    {
+        unregisterSignalWakeFd(wake_fd_);
+    }
+    closeIfOpen(timer_fd);
+    closeIfOpen(tick_fd);
+    closeIfOpen(signal_fd);
+    closeIfOpen(inotify_fd);
+    closeIfOpen(stop_poll_fd);
+    ::close(epoll_fd);
+    capturer_.setNonBlocking(false);
+
+    return stop_reason_ != StopReason::CAPTURE_ERROR;
+}
+#else
+bool CaptureLoop::runEventLoop()
+{
+    return runPollingLoop();
+}
+#endif
+
+bool CaptureLoop::runPollingLoop()
+{
+    using namespace std::chrono;
+
+    // pcap_dispatch returns at least once per read timeout, so deadlines are
+    // checked once per dispatch call rather than once per packet.
+    auto start = steady_clock::now();
+    auto deadline = start + seconds(duration_seconds_);
+    auto next_stop_check = start;
+
+    while (true)
+    {
+        if (stop_requested_)
+        {
+            stop_reason_ = StopReason::REQUESTED;
+            break;
+        }
+        if (handle_signals_ && signal_pending_)
+        {
+            std::cout << "\nReceived termination signal. Stopping capture..." << std::endl;
+            stop_reason_ = StopReason::SIGNAL;
+            break;
+        }
+
+        int result = capturer_.dispatch(-1);
+        if (dispatch_complete_)
+        {
+            dispatch_complete_();
+        }
+        if (result == -1)
+        {
+            last_error_ = capturer_.getLastError();
+            stop_reason_ = StopReason::CAPTURE_ERROR;
+            break;
+        }
+        runPendingTriggers();
+
+        auto now = steady_clock::now();
+        if (duration_seconds_ > 0 && now >= deadline)
+        {
+            std::cout << "\n[Timer] Duration reached. Stopping capture..." << std::endl;
+            stop_reason_ = StopReason::DURATION;
+            break;
+        }
+        if (!stop_file_.empty() && now >= next_stop_check)
+        {
+            next_stop_check = now + milliseconds(STOP_FILE_POLL_MS);
+            if (stopFileExists())
+            {
+                std::cout << "\n[Stop] External stop signal detected. Stopping capture..." << std::endl;
+                stop_reason_ = StopReason::STOP_FILE;
+                break;
+            }
+        }
+    }
+
+    return stop_reason_ != StopReason::CAPTURE_ERROR;
+}
@@ -0,0 +1,799 @@
+#include "CaptureSession.h"
+#include "CsvSink.h"
+#include "LiveStatsSink.h"
+#include "AddressCache.h"
+#include "HostWindowTracker.h"
+#include <iostream>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    std::vector<std::string> splitInterfaceList(const std::string &list)
+    {
+        std::vector<std::string> names;
+        std::istringstream stream(list);
+        std::string name;
+        while (std::getline(stream, name, ','))
+        {
+            if (!name.empty())
+            {
+                names.push_back(name);
+            }
+        }
+        return names;
+    }
+}
+
+bool parseIPVersionFilter(const std::string &name, IPVersionFilter &filter)
+{
+    if (name == "ipv4")
+        filter = IPVersionFilter::IPv4_ONLY;
+    else if (name == "ipv6")
+        filter = IPVersionFilter::IPv6_ONLY;
+    else if (name == "both" || name == "all")
+        filter = IPVersionFilter::ALL;
+    else if (name == "icmp")
+        filter = IPVersionFilter::ICMP_ONLY;
+    else if (name == "bgp")
+        filter = IPVersionFilter::BGP_ONLY;
+    else
+        return false;
+    return true;
+}
+
+std::string getIPVersionFilterString(IPVersionFilter filter)
+{
+    switch (filter)
+    {
+    case IPVersionFilter::IPv4_ONLY:
+        return "ip";
+    case IPVersionFilter::IPv6_ONLY:
+        return "ip6";
+    case IPVersionFilter::ALL:
+        return "";
+    case IPVersionFilter::ICMP_ONLY:
+        return "icmp or icmp6";
+    case IPVersionFilter::BGP_ONLY:
+        return "tcp port 179";
+    }
+    return "";
+}
+
+CSVMode getCSVModeForFilter(IPVersionFilter filter)
+{
+    switch (filter)
+    {
+    case IPVersionFilter::IPv4_ONLY:
+        return CSVMode::IPv4_ONLY;
+    case IPVersionFilter::IPv6_ONLY:
+        return CSVMode::IPv6_ONLY;
+    case IPVersionFilter::ALL:
+    case IPVersionFilter::ICMP_ONLY:
+    case IPVersionFilter::BGP_ONLY:
+        break;
+    }
+    return CSVMode::BOTH;
+}
+
+CaptureSession::CaptureSession(const CaptureConfig &config)
+    : CaptureSession(config, nullptr)
+{
+}
+
+CaptureSession::CaptureSession(const CaptureConfig &config, std::unique_ptr<PacketCapturer> capturer)
+    : config_(config), capturer_(std::move(capturer)), rate_second_(INT64_MIN), rate_count_(0), rate_armed_(true),
+      build_columns_(false), packet_count_(0), processed_count_(0), dropped_count_(0), duplicate_count_(0),
+      running_(false), first_packet_time_(-1.0)
+{
+    if (!capturer_)
+    {
+        capturer_ = std::make_unique<PacketCapturer>();
+    }
+    parser_ = std::make_unique<PacketParser>();
+    batch_pool_ = std::make_unique<BatchPool>(static_cast<size_t>(MAX_BATCH_ROWS));
+    BackpressurePolicy backpressure = config_.backpressure;
+    if (backpressure.mode == BackpressurePolicy::Mode::SPILL && backpressure.spill_directory.empty())
+    {
+        size_t slash = config_.output_filename.rfind('/');
+        backpressure.spill_directory = slash == std::string::npos ? "." : config_.output_filename.substr(0, slash + 1);
+    }
+    fanout_ = std::make_unique<SinkFanout>(SinkFanout::DEFAULT_QUEUE_DEPTH, backpressure);
+    loop_ = std::make_unique<CaptureLoop>(*capturer_);
+    loop_->setDuration(config_.duration_seconds);
+    loop_->setStopFile(config_.stop_file);
+    loop_->setHandleSignals(config_.handle_signals);
+    loop_->setDispatchCompleteCallback([this]()
+                                       { onDispatchComplete(); });
+    if (config_.ring_seconds > 0)
+    {
+        loop_->setTriggerCallback([this](const std::string &reason)
+                                  { triggerRingDump(reason); });
+    }
+    if (splitInterfaceList(config_.interface_name).size() > 1)
+    {
+        config_.column_groups |= COLUMNS_INTERFACE;
+        loop_->setTickInterval(config_.reorder_ms / 4 > 1 ? config_.reorder_ms / 4 : 1);
+    }
+    if (!config_.enrich_sources.empty())
+    {
+        config_.column_groups |= COLUMNS_ENRICH;
+    }
+    if (!config_.label_rules.empty())
+    {
+        config_.column_groups |= COLUMNS_LABEL;
+    }
+    if (config_.dedup_ms > 0)
+    {
+        dedup_ = std::make_unique<Deduplicator>(config_.dedup_ms);
+    }
+    if (config_.column_groups & COLUMNS_FRAGMENT)
+    {
+        fragments_ = std::make_unique<FragmentTracker>();
+    }
+    if (config_.column_groups & COLUMNS_HOST_WINDOW)
+    {
+        stages_.push_back(std::make_unique<HostWindowTracker>());
+    }
+    if (config_.tunnel_depth >= 0)
+    {
+        parser_->setTunnelDepth(config_.tunnel_depth);
+    }
+    else if (config_.column_groups & COLUMNS_TUNNEL)
+    {
+        parser_->setTunnelDepth(PacketParser::DEFAULT_TUNNEL_DEPTH);
+    }
+}
+
+CaptureSession::~CaptureSession()
+{
+    for (auto &extra : extra_interfaces_)
+    {
+        if (extra->thread.joinable())
+        {
+            extra->loop->requestStop();
+            extra->thread.join();
+        }
+    }
+    fanout_->stop();
+}
+
+bool CaptureSession::initialize()
+{
+    std::vector<std::string> names = splitInterfaceList(config_.interface_name);
+    if (names.size() > 1)
+    {
+        for (const auto &name : names)
+        {
+            if (name == "auto")
+            {
+                last_error_ = "Interface lists need device names, not 'auto'";
+                return false;
+            }
+        }
+    }
+
+    // A capturer handed over by the daemon is already open on its interface
+    if (capturer_->getInterfaceName().empty())
+    {
+        std::string interface_name = names.empty() ? "" : names.front();
+        if (interface_name == "auto" || interface_name.empty())
+        {
+            // Auto-select: pick first active interface with addresses
+            interface_name = capturer_->selectFirstActiveInterface();
+            if (interface_name.empty())
+            {
+                last_error_ = "No active network interface found";
+                return false;
+            }
+            std::cout << "Auto-selected interface: " << interface_name << std::endl;
+        }
+
+        if (!capturer_->initialize(interface_name, config_.promiscuous))
+        {
+            last_error_ = "Failed to initialize packet capturer: " + capturer_->getLastError();
+            return false;
+        }
+    }
+    else
+    {
+        capturer_->discardPending();
+    }
+    interface_names_.assign(1, capturer_->getInterfaceName());
+
+    std::string filter_string = getIPVersionFilterString(config_.ip_filter);
+    if (names.size() > 1 && !openExtraInterfaces(std::vector<std::string>(names.begin() + 1, names.end()), filter_string))
+    {
+        return false;
+    }
+    current_interface_ = interface_names_.front();
+
+    if (config_.ring_seconds > 0)
+    {
+        PacketRing::Config ring_config;
+        ring_config.retention_seconds = config_.ring_seconds;
+        ring_config.memory_bytes = config_.ring_megabytes << 20;
+        ring_config.path_prefix = std::filesystem::path(config_.output_filename).replace_extension().string() + "-ring";
+        ring_config.link_type = capturer_->getLinkType();
+        ring_config.snapshot_length = static_cast<uint32_t>(capturer_->getSnapshotLength());
+        ring_ = std::make_unique<PacketRing>(ring_config);
+        if (!ring_->start())
+        {
+            last_error_ = ring_->getLastError();
+            return false;
+        }
+    }
+
+    if (!config_.enrich_sources.empty())
+    {
+        auto enricher = std::make_unique<PrefixEnricher>(config_.enrich_sources);
+        if (!enricher->start())
+        {
+            last_error_ = "Failed to load prefix lists: " + enricher->getLastError();
+            return false;
+        }
+        stages_.push_back(std::move(enricher));
+    }
+    if (!config_.label_rules.empty())
+    {
+        auto labeler = std::make_unique<RuleLabeler>(config_.label_rules);
+        if (!labeler->load())
+        {
+            last_error_ = "Failed to load label rules: " + labeler->getLastError();
+            return false;
+        }
+        std::cout << "Labelling rows with " << labeler->getRuleCount() << " rules from " << config_.label_rules << std::endl;
+        stages_.push_back(std::move(labeler));
+    }
+    if (config_.anonymize_fields != 0)
+    {
+        auto anonymizer = std::make_unique<Anonymizer>(config_.anonymize_fields, config_.anonymize_key_file);
+        if (!anonymizer->start())
+        {
+            last_error_ = "Failed to set up anonymization: " + anonymizer->getLastError();
+            return false;
+        }
+        if (config_.anonymize_fields & ANONYMIZE_ADDRESSES)
+        {
+            // The anonymizer renders the text of the addresses it writes
+            parser_->setAddressText(false);
+        }
+        stages_.push_back(std::move(anonymizer));
+    }
+
+    if (!createSinks())
+    {
+        return false;
+    }
+    if (config_.anonymize_fields != 0 && (ring_ || fanout_->getPayloadHeadBytes() > 0))
+    {
+        std::cerr << "Warning: ring dumps and payload head bytes are written as captured, not anonymized" << std::endl;
+    }
+    if (!fanout_->start())
+    {
+        last_error_ = "Failed to initialize dataset writer: " + fanout_->getLastError();
+        return false;
+    }
+    // Columns are filled here only when rows are final once the stages ran
+    // (fragment tracking holds back, reorders and annotates rows); otherwise
+    // the sinks transpose the rows themselves
+    build_columns_ = fanout_->wantsColumns() && !fragments_;
+
+    if (!filter_string.empty() || capturer_->hasFilter())
+    {
+        if (!capturer_->setFilter(filter_string))
+        {
+            last_error_ = "Failed to set packet filter: " + capturer_->getLastError();
+            return false;
+        }
+    }
+    if (filter_string.empty())
+    {
+        std::cout << "No packet filter applied - capturing all packets" << std::endl;
+    }
+
+    if (merger_)
+    {
+        capturer_->setCallback([this](const uint8_t *packet, int, const struct pcap_pkthdr *header)
+                               { merger_->push(0, header, packet); });
+    }
+    else
+    {
+        capturer_->setCallback([this](const uint8_t *packet, int size, const struct pcap_pkthdr *header)
+                               { handlePacket(packet, size, header); });
+    }
+    return true;
+}
+
+bool CaptureSession::openExtraInterfaces(const std::vector<std::string> &names, const std::string &filter)
+{
+    InterfaceMerger::Config merge_config;
+    merge_config.reorder_ms = config_.reorder_ms;
+    merge_config.memory_bytes = config_.reorder_megabytes << 20;
+    merger_ = std::make_unique<InterfaceMerger>(names.size() + 1, merge_config);
+
+    for (const auto &name : names)
+    {
+        auto extra = std::make_unique<ExtraInterface>();
+        extra->capturer = std::make_unique<PacketCapturer>();
+        if (!extra->capturer->initialize(name, config_.promiscuous))
+        {
+            last_error_ = "Failed to initialize packet capturer on " + name + ": " + extra->capturer->getLastError();
+            return false;
+        }
+        if (!filter.empty() && !extra->capturer->setFilter(filter))
+        {
+            last_error_ = "Failed to set packet filter on " + name + ": " + extra->capturer->getLastError();
+            return false;
+        }
+        if (config_.ring_seconds > 0 && extra->capturer->getLinkType() != capturer_->getLinkType())
+        {
+            // The ring writes one pcapng interface for all frames
+            last_error_ = "Packet ring needs interfaces of one link type; " + name + " differs from " +
+                          capturer_->getInterfaceName();
+            return false;
+        }
+
+        size_t input = interface_names_.size();
+        InterfaceMerger *merger = merger_.get();
+        extra->capturer->setCallback([merger, input](const uint8_t *packet, int, const struct pcap_pkthdr *header)
+                                     { merger->push(input, header, packet); });
+        extra->loop = std::make_unique<CaptureLoop>(*extra->capturer);
+        extra->loop->setHandleSignals(false);
+        extra->loop->setDispatchCompleteCallback([merger, input]()
+                                                 { merger->publish(input); });
+        interface_names_.push_back(extra->capturer->getInterfaceName());
+        extra_interfaces_.push_back(std::move(extra));
+    }
+    std::cout << "Merging " << interface_names_.size() << " interfaces by timestamp (reorder window "
+              << config_.reorder_ms << " ms)" << std::endl;
+    return true;
+}
+
+void CaptureSession::drainMerged(bool final)
+{
+    auto now = std::chrono::system_clock::now();
+    int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+    merger_->drain(now_us, final, [this](size_t input, const uint8_t *packet, const struct pcap_pkthdr *header)
+                   {
+                       current_interface_ = interface_names_[input];
+                       handlePacket(packet, static_cast<int>(header->caplen), header); });
+}
+
+bool CaptureSession::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(time_mutex_);
+        start_time_ = std::chrono::steady_clock::now();
+    }
+    running_ = true;
+
+    for (auto &extra : extra_interfaces_)
+    {
+        ExtraInterface *raw = extra.get();
+        extra->thread = std::thread([raw]()
+                                    {
+                                        if (!raw->loop->run())
+                                        {
+                                            std::cerr << "Capture on " << raw->capturer->getInterfaceName() << " stopped: "
+                                                      << raw->loop->getLastError() << std::endl;
+                                        } });
+    }
+
+    bool ok = loop_->run();
+    if (!ok)
+    {
+        last_error_ = "Failed to run capture: " + loop_->getLastError();
+    }
+
+    for (auto &extra : extra_interfaces_)
+    {
+        extra->loop->requestStop();
+        extra->thread.join();
+    }
+    if (merger_)
+    {
+        // Every capture thread has stopped, so anything they staged is safe
+        // to publish from here
+        for (size_t input = 0; input < merger_->getInputCount(); ++input)
+        {
+            merger_->publish(input);
+        }
+        drainMerged(true);
+    }
+
+    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(time_mutex_);
+        end_time_ = std::chrono::steady_clock::now();
+    }
+    if (fragments_)
+    {
+        fragments_->releaseAll(currentBatch());
+    }
+    flushBatch();
+    fanout_->stop();
+    if (ring_)
+    {
+        // Lets a dump in progress finish
+        ring_->stop();
+    }
+    return ok;
+}
+
+void CaptureSession::requestStop()
+{
+    loop_->requestStop();
+}
+
+bool CaptureSession::requestRingDump()
+{
+    if (!ring_)
+    {
+        return false;
+    }
+    loop_->requestTrigger();
+    return true;
+}
+
+bool CaptureSession::getRingStats(PacketRing::Stats &stats, std::string &last_dump_path) const
+{
+    if (!ring_)
+    {
+        return false;
+    }
+    stats = ring_->getStats();
+    last_dump_path = ring_->getLastDumpPath();
+    return true;
+}
+
+void CaptureSession::triggerRingDump(const std::string &reason)
+{
+    if (ring_ && !ring_->triggerDump(reason))
+    {
+        std::cout << "Packet ring dump (" << reason << ") skipped: the previous dump is still being written" << std::endl;
+    }
+}
+
+void CaptureSession::countRate(const struct pcap_pkthdr *header)
+{
+    int64_t second = static_cast<int64_t>(header->ts.tv_sec);
+    if (second != rate_second_)
+    {
+        // A full second below the threshold ends the spike
+        rate_armed_ = rate_armed_ || (rate_second_ != INT64_MIN && rate_count_ < config_.ring_trigger_pps);
+        rate_second_ = second;
+        rate_count_ = 0;
+    }
+    if (++rate_count_ == config_.ring_trigger_pps && rate_armed_)
+    {
+        rate_armed_ = false;
+        triggerRingDump("rate reached " + std::to_string(config_.ring_trigger_pps) + " packets/s");
+    }
+}
+
+CaptureStats CaptureSession::getStats() const
+{
+    CaptureStats stats;
+    stats.packets_captured = packet_count_.load(std::memory_order_relaxed);
+    stats.packets_processed = processed_count_.load(std::memory_order_relaxed);
+    stats.packets_dropped = dropped_count_.load(std::memory_order_relaxed);
+    stats.packets_duplicate = duplicate_count_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(time_mutex_);
+    auto end = running_ ? std::chrono::steady_clock::now() : end_time_;
+    stats.elapsed_seconds = start_time_ == std::chrono::steady_clock::time_point()
+                                ? 0.0
+                                : std::chrono::duration<double>(end - start_time_).count();
+    return stats;
+}
+
+CaptureLoop::StopReason CaptureSession::getStopReason() const
+{
+    return loop_->getStopReason();
+}
+
+const CaptureConfig &CaptureSession::getConfig() const
+{
+    return config_;
+}
+
+std::unique_ptr<PacketCapturer> CaptureSession::releaseCapturer()
+{
+    if (capturer_)
+    {
+        capturer_->setCallback(nullptr);
+    }
+    return std::move(capturer_);
+}
+
+std::string CaptureSession::getLastError() const
+{
+    return last_error_;
+}
+
+void CaptureSession::printSummary() const
+{
+    CaptureStats stats = getStats();
+    auto total_elapsed_sec = static_cast<long long>(stats.elapsed_seconds);
+    double avg_pps = total_elapsed_sec > 0 ? static_cast<double>(stats.packets_processed) / total_elapsed_sec : 0;
+
+    std::cout << "\n=== CAPTURE SUMMARY ===" << std::endl;
+    std::cout << "Total packets captured: " << stats.packets_captured << std::endl;
+    std::cout << "Packets processed: " << stats.packets_processed << std::endl;
+    std::cout << "Packets dropped: " << stats.packets_dropped << std::endl;
+    if (dedup_)
+    {
+        Deduplicator::Stats dedup = dedup_->getStats();
+        std::cout << "Duplicates: " << stats.packets_duplicate << " of " << stats.packets_captured << " frames ("
+                  << std::fixed << std::setprecision(1)
+                  << (stats.packets_captured > 0 ? 100.0 * stats.packets_duplicate / stats.packets_captured : 0.0)
+                  << "%) within " << dedup_->getWindowMs() << " ms, " << dedup.evictions << " evictions ("
+                  << (dedup_->getMemoryBytes() >> 10) << " KiB filter)" << std::endl;
+    }
+    uint64_t unique_packets = stats.packets_captured - stats.packets_duplicate;
+    std::cout << "Success rate: " << std::fixed << std::setprecision(1)
+              << (unique_packets > 0 ? (100.0 * stats.packets_processed / unique_packets) : 0) << "%" << std::endl;
+    std::cout << "Capture duration: " << total_elapsed_sec << " seconds" << std::endl;
+    std::cout << "Average rate: " << std::fixed << std::setprecision(1) << avg_pps << " packets/sec" << std::endl;
+    for (const auto &sink : fanout_->getStats())
+    {
+        if (fanout_->getSinkCount() > 1)
+        {
+            std::cout << "Output " << sink.name << ": " << sink.rows_written << " rows";
+            if (sink.write_errors > 0)
+                std::cout << ", " << sink.write_errors << " failed batches";
+            if (sink.producer_stalls > 0)
+                std::cout << ", capture waited " << sink.producer_stalls << " times";
+            std::cout << std::endl;
+        }
+        if (fanout_->getPolicy().mode != BackpressurePolicy::Mode::BLOCK)
+        {
+            uint64_t written = sink.rows_written;
+            std::cout << "Backpressure " << BackpressurePolicy::getModeName(fanout_->getPolicy().mode) << " (" << sink.name
+                      << "): " << written << " of " << sink.rows_submitted << " rows written (" << std::fixed
+                      << std::setprecision(1) << (sink.rows_submitted > 0 ? 100.0 * written / sink.rows_submitted : 100.0)
+                      << "%), dropped " << sink.rows_dropped << ", sampled out " << sink.rows_sampled_out << ", spilled "
+                      << sink.rows_spilled << " (segment peak " << (sink.spill_peak_bytes >> 20) << " MiB)" << std::endl;
+        }
+        if (!sink.summary.empty())
+        {
+            std::cout << sink.summary << std::endl;
+        }
+    }
+    BatchPool::Stats batches = batch_pool_->getStats();
+    std::cout << "Batch memory: " << batches.batches << " batches reused " << batches.reused << " times, arena peak "
+              << batches.arena.peak_bytes << " bytes/batch, " << batches.arena.block_allocations << " heap blocks total" << std::endl;
+    AddressCache::Stats addresses = AddressCache::shared().getStats();
+    std::cout << "Address text cache: " << std::fixed << std::setprecision(1) << addresses.hitRate() * 100.0
+              << "% hits over " << addresses.lookups << " lookups (process total)" << std::endl;
+    if (fragments_)
+    {
+        FragmentTracker::Stats fragments = fragments_->getStats();
+        std::cout << "Fragments: " << fragments.fragments << " (datagrams completed " << fragments.datagrams_completed
+                  << ", expired " << fragments.datagrams_expired << ", evicted " << fragments.datagrams_evicted
+                  << "; overlapping " << fragments.overlapping_fragments << ", tiny " << fragments.tiny_fragments << ")" << std::endl;
+    }
+    if (ring_)
+    {
+        PacketRing::Stats ring = ring_->getStats();
+        std::cout << "Packet ring: " << ring.packets_stored << " packets buffered, " << ring.packets_skipped
+                  << " skipped, " << ring.dumps_written << " dumps written (" << ring.packets_dumped << " packets)";
+        if (ring.dumps_refused > 0)
+            std::cout << ", " << ring.dumps_refused << " triggers while busy";
+        std::cout << std::endl;
+    }
+    if (merger_)
+    {
+        InterfaceMerger::Stats merge = merger_->getStats();
+        std::cout << "Interfaces:";
+        for (size_t i = 0; i < interface_names_.size(); ++i)
+        {
+            std::cout << (i > 0 ? ", " : " ") << interface_names_[i] << " " << merge.frames[i] << " frames";
+            if (merge.frames_dropped[i] > 0)
+                std::cout << " (" << merge.frames_dropped[i] << " dropped, merge buffer full)";
+        }
+        std::cout << "; merged with " << merge.frames_late << " late and " << merge.forced_emits
+                  << " forced frames, buffer peak " << (merge.peak_bytes >> 10) << " KiB" << std::endl;
+    }
+    for (const auto &stage : stages_)
+    {
+        std::string summary = stage->getSummary();
+        if (!summary.empty())
+        {
+            std::cout << summary << std::endl;
+        }
+    }
+    if (config_.splits.empty())
+    {
+        std::cout << "Output saved to: " << config_.output_filename << std::endl;
+    }
+    else
+    {
+        std::cout << "Output saved to:";
+        for (const auto &split : config_.splits)
+        {
+            std::cout << " " << DatasetWriter::getSplitFilename(config_.output_filename, split.name);
+        }
+        std::cout << std::endl;
+    }
+}
+
+void CaptureSession::handlePacket(const uint8_t *packet, int size, const struct pcap_pkthdr *header)
+{
+    packet_count_.fetch_add(1, std::memory_order_relaxed);
+    if (dedup_ && dedup_->isDuplicate(packet, static_cast<size_t>(size), header->len,
+                                      static_cast<int64_t>(header->ts.tv_sec) * 1000000 + header->ts.tv_usec))
+    {
+        // Mirror copies never reach the ring, the parser or the outputs
+        duplicate_count_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (ring_)
+    {
+        ring_->push(header, packet);
+        if (config_.ring_trigger_pps > 0)
+        {
+            countRate(header);
+        }
+    }
+
+    auto feature = parser_->processPacket(packet, size, header, currentBatch().arena);
+    if (feature)
+    {
+        feature->interface_name = current_interface_;
+        uint64_t processed_count = processed_count_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        PacketRecord record{std::move(*feature), header->len};
+        for (auto &stage : stages_)
+        {
+            stage->process(record, currentBatch().arena);
+        }
+
+        // After the stages, so progress lines show anonymized addresses
+        if (config_.verbose && processed_count % 5 == 0)
+        {
+            printProgress(record.feature, header);
+        }
+
+        if (config_.verbose && processed_count % 100 == 0)
+        {
+            std::cout << "=== Milestone: " << processed_count << " packets processed ===" << std::endl;
+        }
+        if (fragments_)
+        {
+            // Fragment expiry follows capture time, like the progress rate
+            last_packet_time_ = record.feature.type == PacketFeature::Type::IPv4 ? record.feature.ipv4.timestamp
+                                                                                 : record.feature.ipv6.timestamp;
+        }
+        if (fragments_ && record.feature.fragment.is_fragment)
+        {
+            fragments_->add(std::move(record), currentBatch());
+        }
+        else
+        {
+            // Columns from the row just parsed, so each packet is parsed once
+            if (build_columns_)
+            {
+                currentBatch().columns.appendRow(record);
+            }
+            currentBatch().packets.push_back(std::move(record));
+        }
+        if (currentBatch().packets.size() >= MAX_BATCH_ROWS)
+        {
+            flushBatch();
+        }
+    }
+    else
+    {
+        uint64_t dropped_count = dropped_count_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (config_.verbose && dropped_count % 50 == 0)
+        {
+            std::cout << "Warning: " << dropped_count << " packets dropped (parsing failed or non-IP)" << std::endl;
+        }
+    }
+}
+
+void CaptureSession::printProgress(const PacketFeature &feature, const struct pcap_pkthdr *header)
+{
+    // Rate is derived from capture timestamps so the hot path never reads the clock
+    double packet_time = header->ts.tv_sec + header->ts.tv_usec / 1e6;
+    if (first_packet_time_ < 0)
+    {
+        first_packet_time_ = packet_time;
+    }
+    double elapsed_sec = packet_time - first_packet_time_;
+    uint64_t processed_count = processed_count_.load(std::memory_order_relaxed);
+    double pps = elapsed_sec > 0 ? static_cast<double>(processed_count) / elapsed_sec : 0;
+
+    std::string ip_type;
+    std::string_view protocol_name, src_ip, dst_ip;
+
+    if (feature.type == PacketFeature::Type::IPv4)
+    {
+        ip_type = "IPv4";
+        protocol_name = feature.ipv4.protocol_name;
+        src_ip = feature.ipv4.src_address;
+        dst_ip = feature.ipv4.dst_address;
+    }
+    else
+    {
+        ip_type = "IPv6";
+        protocol_name = feature.ipv6.protocol_name;
+        src_ip = feature.ipv6.src_address;
+        dst_ip = feature.ipv6.dst_address;
+    }
+
+    std::cout << "[" << processed_count << "] " << ip_type << "/" << protocol_name
+              << " | " << src_ip << " -> " << dst_ip
+              << " | Size: " << header->len << " bytes"
+              << " | Rate: " << std::fixed << std::setprecision(1) << pps << " pps"
+              << " | Total captured: " << packet_count_.load(std::memory_order_relaxed) << std::endl;
+}
+
+bool CaptureSession::createSinks()
+{
+    auto csv = std::make_unique<CsvSink>(config_.output_filename, getCSVModeForFilter(config_.ip_filter), config_.column_groups,
+                                         config_.writer);
+    if (!config_.splits.empty())
+    {
+        csv->setSplits(config_.splits, config_.split_seed);
+    }
+    if (config_.index_rows > 0 || config_.index_ms > 0)
+    {
+        csv->setTimeIndex(config_.index_rows, config_.index_ms);
+    }
+    fanout_->addSink(std::move(csv));
+    if (!config_.stream_socket.empty())
+    {
+        fanout_->addSink(std::make_unique<LiveStatsSink>(config_.stream_socket, LiveStreamServer::Content::ROWS_AND_STATS));
+    }
+    for (const auto &text : config_.sinks)
+    {
+        SinkSpec spec;
+        if (!parseSinkSpec(text, spec, last_error_))
+        {
+            return false;
+        }
+        fanout_->addSink(createOutputSink(spec, config_.column_groups, config_.writer));
+    }
+    size_t payload_head_bytes = fanout_->getPayloadHeadBytes();
+    if (payload_head_bytes > 0 || (config_.column_groups & COLUMNS_PAYLOAD))
+    {
+        parser_->setPayloadFeatures(true, payload_head_bytes);
+    }
+    return true;
+}
+
+void CaptureSession::onDispatchComplete()
+{
+    if (merger_)
+    {
+        merger_->publish(0);
+        drainMerged(false);
+    }
+    if (fragments_)
+    {
+        fragments_->expire(last_packet_time_, currentBatch());
+    }
+    flushBatch();
+}
+
+PacketBatch &CaptureSession::currentBatch()
+{
+    if (!pending_batch_)
+    {
+        pending_batch_ = batch_pool_->acquire();
+    }
+    return *pending_batch_;
+}
+
+void CaptureSession::flushBatch()
+{
+    if (pending_batch_ && !pending_batch_->packets.empty())
+    {
+        fanout_->submit(std::move(pending_batch_));
+    }
+    pending_batch_.reset();
+}
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "CryptoPAn.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CRYPTOPAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Encryption tables, derived from the field arithmetic on first use
+    // rather than typed in
+    struct AesTables
+    {
+        uint8_t sbox[256];
+        uint32_t te[4][256];
+
+        static uint8_t multiply(uint8_t a, uint8_t b)
+        {
+            uint8_t product = 0;
+            while (b)
+            {
+                if (b & 1)
+                    product ^= a;
+                a = static_cast<uint8_t>((a << 1) ^ ((a & 0x80) ? 0x1b : 0));
+                b >>= 1;
+            }
+            return product;
+        }
+
+        AesTables()
+        {
+            for (int x = 0; x < 256; ++x)
+            {
+                uint8_t inverse = 0;
+                for (int y = 1; y < 256 && x != 0; ++y)
+                {
+                    if (multiply(static_cast<uint8_t>(x), static_cast<uint8_t>(y)) == 1)
+                    {
+                        inverse = static_cast<uint8_t>(y);
+                        break;
+                    }
+                }
+                uint8_t s = inverse;
+                for (int shift = 1; shift <= 4; ++shift)
+                {
+                    s ^= static_cast<uint8_t>((inverse << shift) | (inverse >> (8 - shift)));
+                }
+                sbox[x] = static_cast<uint8_t>(s ^ 0x63);
+            }
+            for (int x = 0; x < 256; ++x)
+            {
+                uint8_t s = sbox[x];
+                uint32_t word = (static_cast<uint32_t>(multiply(s, 2)) << 24) | (static_cast<uint32_t>(s) << 16) |
+                                (static_cast<uint32_t>(s) << 8) | multiply(s, 3);
+                for (int t = 0; t < 4; ++t)
+                {
+                    te[t][x] = t == 0 ? word : (word >> (8 * t)) | (word << (32 - 8 * t));
+                }
+            }
+        }
+    };
+
+    const AesTables &tables()
+    {
+        static const AesTables instance;
+        return instance;
+    }
+
+    // PREFIX_MASKS[i] has the first i bits of a block set
+    struct PrefixMasks
+    {
+        alignas(16) uint8_t bytes[129][16];
+
+        PrefixMasks()
+        {
+            for (int bits = 0; bits <= 128; ++bits)
+            {
+                for (int i = 0; i < 16; ++i)
+                {
+                    int set = bits - 8 * i;
+                    bytes[bits][i] = static_cast<uint8_t>(set >= 8 ? 0xff : (set <= 0 ? 0 : 0xff << (8 - set)));
+                }
+            }
+        }
+    };
+
+    const PrefixMasks &prefixMasks()
+    {
+        static const PrefixMasks instance;
+        return instance;
+    }
+
+    inline uint32_t loadWord(const uint8_t *p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    inline void storeWord(uint8_t *p, uint32_t word)
+    {
+        p[0] = static_cast<uint8_t>(word >> 24);
+        p[1] = static_cast<uint8_t>(word >> 16);
+        p[2] = static_cast<uint8_t>(word >> 8);
+        p[3] = static_cast<uint8_t>(word);
+    }
+
+    void encryptSoftware(const uint32_t *rk, const uint8_t *in, uint8_t *out)
+    {
+        const AesTables &t = tables();
+        uint32_t s0 = loadWord(in) ^ rk[0];
+        uint32_t s1 = loadWord(in + 4) ^ rk[1];
+        uint32_t s2 = loadWord(in + 8) ^ rk[2];
+        uint32_t s3 = loadWord(in + 12) ^ rk[3];
+        for (int round = 1; round < 10; ++round)
+        {
+            const uint32_t *k = rk + 4 * round;
+            uint32_t t0 = t.te[0][s0 >> 24] ^ t.te[1][(s1 >> 16) & 0xff] ^ t.te[2][(s2 >> 8) & 0xff] ^ t.te[3][s3 & 0xff] ^ k[0];
+            uint32_t t1 = t.te[0][s1 >> 24] ^ t.te[1][(s2 >> 16) & 0xff] ^ t.te[2][(s3 >> 8) & 0xff] ^ t.te[3][s0 & 0xff] ^ k[1];
+            uint32_t t2 = t.te[0][s2 >> 24] ^ t.te[1][(s3 >> 16) & 0xff] ^ t.te[2][(s0 >> 8) & 0xff] ^ t.te[3][s1 & 0xff] ^ k[2];
+            uint32_t t3 = t.te[0][s3 >> 24] ^ t.te[1][(s0 >> 16) & 0xff] ^ t.te[2][(s1 >> 8) & 0xff] ^ t.te[3][s2 & 0xff] ^ k[3];
+            s0 = t0;
+            s1 = t1;
+            s2 = t2;
+            s3 = t3;
+        }
+        const uint8_t *sbox = t.sbox;
+        auto last = [sbox](uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+        {
+            return (static_cast<uint32_t>(sbox[a >> 24]) << 24) | (static_cast<uint32_t>(sbox[(b >> 16) & 0xff]) << 16) |
+                   (static_cast<uint32_t>(sbox[(c >> 8) & 0xff]) << 8) | sbox[d & 0xff];
+        };
+        storeWord(out, last(s0, s1, s2, s3) ^ rk[40]);
+        storeWord(out + 4, last(s1, s2, s3, s0) ^ rk[41]);
+        storeWord(out + 8, last(s2, s3, s0, s1) ^ rk[42]);
+        storeWord(out + 12, last(s3, s0, s1, s2) ^ rk[43]);
+    }
+
+#ifdef CRYPTOPAN_X86
+    // Encrypts the blocks for mask bits [from, to) and sets the bits in flips
+    // (big-endian 128-bit order). Blocks are assembled in registers, eight in
+    // flight to hide the latency of aesenc.
+    __attribute__((target("aes,sse2"))) void maskBitsAESNI(const uint8_t *round_keys, const uint8_t *address,
+                                                         const uint8_t *pad, int from, int to, uint8_t *flips)
+    {
+        __m128i keys[11];
+        for (int i = 0; i < 11; ++i)
+        {
+            keys[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(round_keys + 16 * i));
+        }
+        const __m128i address_block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(address));
+        const __m128i pad_block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pad));
+        const uint8_t(*masks)[16] = prefixMasks().bytes;
+        const int WIDTH = 8;
+        for (int start = from; start < to; start += WIDTH)
+        {
+            int count = to - start < WIDTH ? to - start : WIDTH;
+            __m128i blocks[WIDTH];
+            for (int j = 0; j < WIDTH; ++j)
+            {
+                // Past the end the last block is repeated and its bits dropped
+                int bits = start + (j < count ? j : count - 1);
+                __m128i keep = _mm_load_si128(reinterpret_cast<const __m128i *>(masks[bits]));
+                blocks[j] = _mm_xor_si128(_mm_or_si128(_mm_and_si128(address_block, keep), _mm_andnot_si128(keep, pad_block)), keys[0]);
+            }
+            for (int round = 1; round < 10; ++round)
+            {
+                for (int j = 0; j < WIDTH; ++j)
+                {
+                    blocks[j] = _mm_aesenc_si128(blocks[j], keys[round]);
+                }
+            }
+            for (int j = 0; j < count; ++j)
+            {
+                int bit = start + j;
+                // Bit 0 of the byte sign mask is the top bit of the first byte
+                int top = _mm_movemask_epi8(_mm_aesenclast_si128(blocks[j], keys[10])) & 1;
+                flips[bit / 8] |= static_cast<uint8_t>(top << (7 - bit % 8));
+            }
+        }
+    }
+#endif
+
+    inline uint64_t loadBig64(const uint8_t *p)
+    {
+        return (static_cast<uint64_t>(loadWord(p)) << 32) | loadWord(p + 4);
+    }
+
+    inline void storeBig64(uint8_t *p, uint64_t value)
+    {
+        storeWord(p, static_cast<uint32_t>(value >> 32));
+        storeWord(p + 4, static_cast<uint32_t>(value));
+    }
+
+    // Top length bits of a 128-bit big-endian value
+    inline void prefixKey(const uint8_t *address, int length, uint64_t *key)
+    {
+        uint64_t high = loadBig64(address);
+        uint64_t low = loadBig64(address + 8);
+        key[0] = length >= 64 ? high : (length == 0 ? 0 : high & (~0ULL << (64 - length)));
+        key[1] = length >= 128 ? low : (length <= 64 ? 0 : low & (~0ULL << (128 - length)));
+    }
+
+    const int LEVELS_V4[] = {16, 24};
+    const int LEVELS_V6[] = {32, 48, 64};
+} // namespace
+
+const size_t CryptoPAn::KEY_BYTES;
+const size_t CryptoPAn::DEFAULT_MEMO_ENTRIES;
+
+CryptoPAn::CryptoPAn(const uint8_t *key, size_t memo_entries) : aes_ni_(false)
+{
+    static const uint8_t RCON[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+    const uint8_t *sbox = tables().sbox;
+    for (int i = 0; i < 4; ++i)
+    {
+        round_keys_[i] = loadWord(key + 4 * i);
+    }
+    for (int i = 4; i < 44; ++i)
+    {
+        uint32_t temp = round_keys_[i - 1];
+        if (i % 4 == 0)
+        {
+            temp = (temp << 8) | (temp >> 24);
+            temp = (static_cast<uint32_t>(sbox[temp >> 24]) << 24) | (static_cast<uint32_t>(sbox[(temp >> 16) & 0xff]) << 16) |
+                   (static_cast<uint32_t>(sbox[(temp >> 8) & 0xff]) << 8) | sbox[temp & 0xff];
+            temp ^= static_cast<uint32_t>(RCON[i / 4 - 1]) << 24;
+        }
+        round_keys_[i] = round_keys_[i - 4] ^ temp;
+    }
+    for (int i = 0; i < 44; ++i)
+    {
+        storeWord(round_key_bytes_ + 4 * i, round_keys_[i]);
+    }
+#ifdef CRYPTOPAN_X86
+    aes_ni_ = __builtin_cpu_supports("aes");
+#endif
+
+    encryptBlock(key + 16, pad_);
+
+    size_t entries = 1;
+    while (entries < memo_entries)
+    {
+        entries <<= 1;
+    }
+    memo_mask_ = entries - 1;
+    MemoEntry empty;
+    std::memset(&empty, 0, sizeof(empty));
+    for (int length : LEVELS_V4)
+    {
+        levels_.push_back(MemoLevel{4, length, std::vector<MemoEntry>(entries, empty)});
+    }
+    for (int length : LEVELS_V6)
+    {
+        levels_.push_back(MemoLevel{6, length, std::vector<MemoEntry>(entries, empty)});
+    }
+}
+
+void CryptoPAn::encryptBlock(const uint8_t *in, uint8_t *out) const
+{
+    encryptSoftware(round_keys_, in, out);
+}
+
+void CryptoPAn::computeMask(const uint8_t *address, int from, int to, uint8_t *mask)
+{
+    // Block i is the first i address bits followed by the pad's remaining bits
+    stats_.blocks_encrypted += to - from;
+#ifdef CRYPTOPAN_X86
+    if (aes_ni_)
+    {
+        maskBitsAESNI(round_key_bytes_, address, pad_, from, to, mask);
+        return;
+    }
+#endif
+    const uint8_t(*masks)[16] = prefixMasks().bytes;
+    uint8_t block[16];
+    uint8_t out[16];
+    for (int bit = from; bit < to; ++bit)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            block[i] = static_cast<uint8_t>((address[i] & masks[bit][i]) | (pad_[i] & ~masks[bit][i]));
+        }
+        encryptSoftware(round_keys_, block, out);
+        mask[bit / 8] |= static_cast<uint8_t>((out[0] >> 7) << (7 - bit % 8));
+    }
+}
+
+CryptoPAn::MemoEntry &CryptoPAn::slot(MemoLevel &level, const uint64_t *key)
+{
+    // IPv4 keys have only their top 32 bits set, so mix fully before masking
+    uint64_t hash = key[0] ^ (key[1] * 0x9e3779b97f4a7c15ULL) ^ static_cast<uint64_t>(level.length);
+    hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdULL;
+    hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return level.entries[(hash ^ (hash >> 33)) & memo_mask_];
+}
+
+void CryptoPAn::anonymize(IpAddress &address)
+{
+    if (address.family != 4 && address.family != 6)
+    {
+        return;
+    }
+    stats_.addresses++;
+    size_t first = address.family == 4 ? 0 : sizeof(LEVELS_V4) / sizeof(LEVELS_V4[0]);
+    size_t last = address.family == 4 ? first + sizeof(LEVELS_V4) / sizeof(LEVELS_V4[0]) : levels_.size();
+    int bits = address.family == 4 ? 32 : 128;
+
+    uint8_t mask[16] = {};
+    int known = 0;
+    size_t found = last;
+    for (size_t level = last; level-- > first;)
+    {
+        uint64_t key[2];
+        prefixKey(address.bytes, levels_[level].length, key);
+        const MemoEntry &entry = slot(levels_[level], key);
+        if (entry.length == levels_[level].length && entry.key[0] == key[0] && entry.key[1] == key[1])
+        {
+            storeBig64(mask, entry.mask[0]);
+            storeBig64(mask + 8, entry.mask[1]);
+            known = entry.length;
+            found = level;
+            break;
+        }
+    }
+    if (known > 0)
+    {
+        stats_.prefix_hits++;
+    }
+    computeMask(address.bytes, known, bits, mask);
+    uint64_t full[2] = {loadBig64(mask), loadBig64(mask + 8)};
+    for (size_t level = found == last ? first : found + 1; level < last; ++level)
+    {
+        int length = levels_[level].length;
+        uint64_t key[2];
+        prefixKey(address.bytes, length, key);
+        MemoEntry &entry = slot(levels_[level], key);
+        entry.key[0] = key[0];
+        entry.key[1] = key[1];
+        entry.mask[0] = length >= 64 ? full[0] : full[0] & (~0ULL << (64 - length));
+        entry.mask[1] = length <= 64 ? 0 : full[1] & (~0ULL << (128 - length));
+        entry.length = static_cast<uint8_t>(length);
+    }
+    for (int i = 0; i < bits / 8; ++i)
+    {
+        address.bytes[i] ^= mask[i];
+    }
+}
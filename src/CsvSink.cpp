@@ -0,0 +1,40 @@
+#include "CsvSink.h"
+
+CsvSink::CsvSink(const std::string &filename, CSVMode mode, uint32_t column_groups,
+                 const WriterBackend::Options &writer)
+    : filename_(filename), writer_(filename, mode, column_groups, writer)
+{
+}
+
+bool CsvSink::open()
+{
+    return writer_.initialize();
+}
+
+bool CsvSink::consume(const PacketBatch &batch)
+{
+    for (const auto &record : batch.packets)
+    {
+        if (!writer_.writePacket(record.feature))
+        {
+            return false;
+        }
+    }
+    // One hand-off per batch; the rows are written while the next batch is formatted
+    return writer_.flush();
+}
+
+void CsvSink::close()
+{
+    writer_.close();
+}
+
+std::string CsvSink::getName() const
+{
+    return "csv:" + filename_;
+}
+
+std::string CsvSink::getLastError() const
+{
+    return writer_.getLastError();
+}
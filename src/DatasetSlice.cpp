@@ -0,0 +1,390 @@
+// DatasetSlice: copies the rows of a time range out of a CSV written by
+// DatasetWriter, reading only the blocks its time index (<file>.idx) says
+// can hold them. Blocks entirely inside the range are copied as they are;
+// boundary blocks, and rows written after the last indexed block, are
+// filtered row by row.
+
+#include "TimeIndex.h"
+#include "CivilTime.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const size_t CHUNK_BYTES = 1u << 20;
+
+    void printUsage(const char *program_name)
+    {
+        std::cerr << "Usage: " << program_name << " <file.csv> <from> <to> [options]" << std::endl;
+        std::cerr << "\nCopies the header and the rows with from <= Timestamp < to (UTC) using <file.csv>.idx," << std::endl;
+        std::cerr << "written by the capture with --index-rows or --index-ms." << std::endl;
+        std::cerr << "\nTimes:" << std::endl;
+        std::cerr << "  2026-10-18 10:03[:SS[.ffffff]]  date and time (a 'T' may separate them)" << std::endl;
+        std::cerr << "  10:03[:SS[.ffffff]]             time of day, on the date of the file's first row" << std::endl;
+        std::cerr << "  1760781780[.5]                  Unix seconds" << std::endl;
+        std::cerr << "\nOptions:" << std::endl;
+        std::cerr << "  -o <file>   Write to file instead of stdout" << std::endl;
+        std::cerr << "  --mmap      Map the CSV instead of reading it (not on Windows)" << std::endl;
+    }
+
+    // "HH:MM[:SS[.f]]" into microseconds since midnight
+    bool parseTimeOfDay(const char *text, int64_t &micros)
+    {
+        int hour, minute, consumed = 0;
+        if (std::sscanf(text, "%2d:%2d%n", &hour, &minute, &consumed) != 2 || hour > 23 || minute > 59)
+            return false;
+        double seconds = 0;
+        const char *rest = text + consumed;
+        if (*rest == ':')
+        {
+            char *end = nullptr;
+            seconds = std::strtod(rest + 1, &end);
+            if (end == rest + 1 || seconds < 0 || seconds >= 60)
+                return false;
+            rest = end;
+        }
+        if (*rest != '\0' && !(rest[0] == 'Z' && rest[1] == '\0'))
+            return false;
+        micros = (static_cast<int64_t>(hour) * 3600 + minute * 60) * 1000000 + static_cast<int64_t>(seconds * 1e6 + 0.5);
+        return true;
+    }
+
+    // Absolute time, or a time of day (time_of_day set) to be placed later
+    bool parseTime(const std::string &text, int64_t &micros, bool &time_of_day)
+    {
+        time_of_day = false;
+        char *end = nullptr;
+        double seconds = std::strtod(text.c_str(), &end);
+        if (!text.empty() && *end == '\0')
+        {
+            micros = static_cast<int64_t>(seconds * 1e6);
+            return true;
+        }
+        int year, month, day, consumed = 0;
+        if (std::sscanf(text.c_str(), "%4d-%2d-%2d%n", &year, &month, &day, &consumed) == 3)
+        {
+            if (month < 1 || month > 12 || day < 1 || day > 31 || (text[consumed] != ' ' && text[consumed] != 'T'))
+                return false;
+            int64_t clock = 0;
+            if (!parseTimeOfDay(text.c_str() + consumed + 1, clock))
+                return false;
+            micros = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400000000LL + clock;
+            return true;
+        }
+        time_of_day = true;
+        return parseTimeOfDay(text.c_str(), micros);
+    }
+
+    // The CSV, mapped or read through a buffer
+    class DataFile
+    {
+    public:
+        DataFile() : map_(nullptr), size_(0) {}
+
+        ~DataFile()
+        {
+#ifndef _WIN32
+            if (map_ != nullptr)
+                ::munmap(map_, size_);
+#endif
+        }
+
+        bool open(const std::string &path, bool use_mmap, std::string &error)
+        {
+            std::error_code ec;
+            size_ = std::filesystem::file_size(path, ec);
+            if (ec)
+            {
+                error = "Cannot read " + path + ": " + ec.message();
+                return false;
+            }
+            if (use_mmap && size_ > 0)
+            {
+#ifndef _WIN32
+                int fd = ::open(path.c_str(), O_RDONLY);
+                void *map = fd < 0 ? MAP_FAILED : ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                if (fd >= 0)
+                    ::close(fd);
+                if (map == MAP_FAILED)
+                {
+                    error = "Cannot map " + path + ": " + std::strerror(errno);
+                    return false;
+                }
+                ::madvise(map, size_, MADV_SEQUENTIAL);
+                map_ = static_cast<char *>(map);
+                return true;
+#else
+                std::cerr << "Warning: --mmap is not supported here, reading instead" << std::endl;
+#endif
+            }
+            file_.open(path, std::ios::binary);
+            if (!file_.is_open())
+            {
+                error = "Cannot open " + path;
+                return false;
+            }
+            buffer_.resize(CHUNK_BYTES);
+            return true;
+        }
+
+        uint64_t size() const { return size_; }
+
+        // Calls fn(data, length) for consecutive pieces of [offset, offset + bytes)
+        template <typename Fn>
+        bool read(uint64_t offset, uint64_t bytes, Fn fn)
+        {
+            if (map_ != nullptr)
+            {
+                fn(map_ + offset, static_cast<size_t>(bytes));
+                return true;
+            }
+            file_.clear();
+            file_.seekg(static_cast<std::streamoff>(offset));
+            while (bytes > 0)
+            {
+                size_t want = static_cast<size_t>(bytes < buffer_.size() ? bytes : buffer_.size());
+                if (!file_.read(buffer_.data(), static_cast<std::streamsize>(want)))
+                    return false;
+                fn(buffer_.data(), want);
+                bytes -= want;
+            }
+            return true;
+        }
+
+    private:
+        char *map_;
+        uint64_t size_;
+        std::ifstream file_;
+        std::vector<char> buffer_;
+    };
+
+    // Copies the whole rows of a byte stream whose timestamp is in range;
+    // a row cut by a piece boundary is carried over
+    class RowFilter
+    {
+    public:
+        RowFilter(std::FILE *out, int64_t from_us, int64_t to_us) : out_(out), from_us_(from_us), to_us_(to_us), bytes_(0) {}
+
+        void feed(const char *data, size_t length)
+        {
+            size_t start = 0;
+            while (start < length)
+            {
+                const char *newline = static_cast<const char *>(std::memchr(data + start, '\n', length - start));
+                if (newline == nullptr)
+                {
+                    partial_.append(data + start, length - start);
+                    return;
+                }
+                size_t end = static_cast<size_t>(newline - data) + 1;
+                if (partial_.empty())
+                {
+                    emit(data + start, end - start);
+                }
+                else
+                {
+                    partial_.append(data + start, end - start);
+                    emit(partial_.data(), partial_.size());
+                    partial_.clear();
+                }
+                start = end;
+            }
+        }
+
+        // Drops an unfinished last row (still being written)
+        void finish() { partial_.clear(); }
+
+        uint64_t getBytes() const { return bytes_; }
+
+    private:
+        std::FILE *out_;
+        int64_t from_us_;
+        int64_t to_us_;
+        std::string partial_;
+        uint64_t bytes_;
+
+        void emit(const char *row, size_t length)
+        {
+            int64_t micros = 0;
+            if (TimeIndex::parseTimestamp(row, length, micros) && micros >= from_us_ && micros < to_us_)
+            {
+                std::fwrite(row, 1, length, out_);
+                bytes_ += length;
+            }
+        }
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> positional;
+    std::string output_path;
+    bool use_mmap = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output_path = argv[++i];
+        else if (arg == "--mmap")
+            use_mmap = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.size() != 3)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const std::string &data_path = positional[0];
+
+    DataFile data;
+    std::string error;
+    if (!data.open(data_path, use_mmap, error))
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    std::vector<TimeIndex::Entry> entries;
+    if (!TimeIndex::load(TimeIndex::getPath(data_path), data.size(), entries, error))
+    {
+        std::cerr << "Warning: " << error << "; scanning the whole file" << std::endl;
+    }
+
+    // Header: the first line
+    std::string header;
+    uint64_t header_end = 0;
+    bool header_done = false;
+    data.read(0, data.size() < CHUNK_BYTES ? data.size() : CHUNK_BYTES, [&](const char *piece, size_t length) {
+        if (header_done)
+            return;
+        const char *newline = static_cast<const char *>(std::memchr(piece, '\n', length));
+        header.append(piece, newline == nullptr ? length : static_cast<size_t>(newline - piece) + 1);
+        header_done = newline != nullptr;
+    });
+    if (!header_done)
+    {
+        std::cerr << "Error: " << data_path << " has no complete header" << std::endl;
+        return 1;
+    }
+    header_end = header.size();
+
+    int64_t from_us = 0;
+    int64_t to_us = 0;
+    bool from_of_day = false;
+    bool to_of_day = false;
+    if (!parseTime(positional[1], from_us, from_of_day) || !parseTime(positional[2], to_us, to_of_day))
+    {
+        std::cerr << "Error: Invalid time range '" << positional[1] << "' - '" << positional[2] << "'" << std::endl;
+        return 1;
+    }
+    if (from_of_day || to_of_day)
+    {
+        // Times of day fall on the date of the first row; a range that wraps
+        // past midnight ends on the next day
+        int64_t first_us = 0;
+        std::string first_row;
+        if (!entries.empty())
+        {
+            first_us = entries.front().min_us;
+        }
+        else
+        {
+            data.read(header_end, data.size() - header_end < 64 ? data.size() - header_end : 64,
+                      [&](const char *piece, size_t length) { first_row.append(piece, length); });
+            if (!TimeIndex::parseTimestamp(first_row.data(), first_row.size(), first_us))
+            {
+                std::cerr << "Error: " << data_path << " has no rows to take the date from" << std::endl;
+                return 1;
+            }
+        }
+        int64_t midnight = first_us - ((first_us % 86400000000LL) + 86400000000LL) % 86400000000LL;
+        if (from_of_day)
+            from_us += midnight;
+        if (to_of_day)
+            to_us += midnight;
+        if (to_of_day && to_us <= from_us)
+            to_us += 86400000000LL;
+    }
+
+    std::FILE *out = stdout;
+    if (!output_path.empty())
+    {
+        out = std::fopen(output_path.c_str(), "wb");
+        if (out == nullptr)
+        {
+            std::cerr << "Error: Cannot create " << output_path << std::endl;
+            return 1;
+        }
+    }
+    std::vector<char> out_buffer(CHUNK_BYTES);
+    std::setvbuf(out, out_buffer.data(), _IOFBF, out_buffer.size());
+    std::fwrite(header.data(), 1, header.size(), out);
+
+    size_t first = 0;
+    size_t last = 0;
+    TimeIndex::findBlocks(entries, from_us, to_us, first, last);
+    RowFilter filter(out, from_us, to_us);
+    uint64_t copied_rows_bytes = 0;
+    uint64_t bytes_read = 0;
+    bool ok = true;
+    for (size_t i = first; i < last && ok; ++i)
+    {
+        const TimeIndex::Entry &entry = entries[i];
+        if (entry.max_us < from_us || entry.min_us >= to_us)
+        {
+            continue; // out of order neighbours of the range
+        }
+        bytes_read += entry.bytes;
+        if (entry.min_us >= from_us && entry.max_us < to_us)
+        {
+            ok = data.read(entry.offset, entry.bytes, [&](const char *piece, size_t length) {
+                std::fwrite(piece, 1, length, out);
+            });
+            copied_rows_bytes += entry.bytes;
+        }
+        else
+        {
+            ok = data.read(entry.offset, entry.bytes, [&](const char *piece, size_t length) { filter.feed(piece, length); });
+            filter.finish();
+        }
+    }
+
+    // Rows after the last indexed block
+    uint64_t indexed_end = entries.empty() ? header_end : entries.back().offset + entries.back().bytes;
+    if (ok && indexed_end < data.size())
+    {
+        bytes_read += data.size() - indexed_end;
+        ok = data.read(indexed_end, data.size() - indexed_end, [&](const char *piece, size_t length) { filter.feed(piece, length); });
+        filter.finish();
+    }
+
+    bool write_ok = std::fflush(out) == 0 && !std::ferror(out);
+    if (out != stdout)
+        write_ok = std::fclose(out) == 0 && write_ok;
+    if (!ok || !write_ok)
+    {
+        std::cerr << "Error: " << (ok ? "writing the output failed" : "reading " + data_path + " failed") << std::endl;
+        return 1;
+    }
+    std::cerr << "Read " << bytes_read << " of " << data.size() << " bytes (" << (last - first) << " of " << entries.size()
+              << " indexed blocks); wrote " << (copied_rows_bytes + filter.getBytes()) << " bytes of rows" << std::endl;
+    return 0;
+}
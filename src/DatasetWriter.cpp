@@ -1,13 +1,29 @@
 #include "DatasetWriter.h"
+#include "PacketParser.h"
+#include "SipHash.h"
 #include <iostream>
-#include <sstream>
 #include <iomanip>
+#include <sstream>
 #include <filesystem>
+#include <charconv>
+#include <ctime>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <fstream>
+
+namespace
+{
+    const uint64_t HASH_RANGE = 1ULL << 32; // flow hashes are compared by their top 32 bits
+}
 
-DatasetWriter::DatasetWriter(const std::string &filename, CSVMode mode)
-    : filename_(filename), is_initialized_(false), csv_mode_(mode)
+DatasetWriter::DatasetWriter(const std::string &filename, CSVMode mode, uint32_t column_groups,
+                             const WriterBackend::Options &writer)
+    : filename_(filename), writer_options_(writer), split_key_{0, 0}, index_block_rows_(0), index_block_ms_(0),
+      is_initialized_(false), csv_mode_(mode), column_groups_(column_groups), row_micros_(0),
+      cached_second_(INT64_MIN), cached_date_length_(0)
 {
-    file_ = std::make_unique<std::ofstream>();
+    outputs_.push_back(Output{std::string(), filename, WriterBackend::create(writer), HASH_RANGE, 0, nullptr});
 }
 
 DatasetWriter::~DatasetWriter()
@@ -15,7 +31,60 @@ DatasetWriter::~DatasetWriter()
     close();
 }
 
+void DatasetWriter::setSplits(const std::vector<DatasetSplit> &splits, uint64_t seed)
+{
+    double total = 0.0;
+    for (const auto &split : splits)
+    {
+        total += split.weight;
+    }
+
+    // Consecutive ranges of the hash, in the order given
+    outputs_.clear();
+    double cumulative = 0.0;
+    for (size_t i = 0; i < splits.size(); ++i)
+    {
+        cumulative += splits[i].weight;
+        uint64_t limit = i + 1 == splits.size() ? HASH_RANGE
+                                                 : static_cast<uint64_t>(cumulative / total * static_cast<double>(HASH_RANGE));
+        outputs_.push_back(Output{splits[i].name, getSplitFilename(filename_, splits[i].name),
+                                  WriterBackend::create(writer_options_), limit, 0, nullptr});
+    }
+    // The seed selects the assignment; the second word keeps seed 0 from
+    // being an all-zero key
+    split_key_[0] = seed;
+    split_key_[1] = 0x73706c6974666c6fULL;
+}
+
+void DatasetWriter::setTimeIndex(uint32_t block_rows, int block_ms)
+{
+    index_block_rows_ = block_rows;
+    index_block_ms_ = block_ms;
+}
+
 bool DatasetWriter::initialize()
+{
+    for (auto &output : outputs_)
+    {
+        if (index_block_rows_ > 0 || index_block_ms_ > 0)
+        {
+            output.index = std::make_unique<TimeIndex>(index_block_rows_, index_block_ms_);
+        }
+        if (!openOutput(output))
+        {
+            for (auto &opened : outputs_)
+            {
+                opened.file->close();
+                opened.index.reset();
+            }
+            return false;
+        }
+    }
+    is_initialized_ = true;
+    return true;
+}
+
+bool DatasetWriter::openOutput(Output &output)
 {
     namespace fs = std::filesystem;
 
@@ -23,11 +92,11 @@ bool DatasetWriter::initialize()
     bool has_content = false;
     try
     {
-        file_exists = fs::exists(filename_);
+        file_exists = fs::exists(output.filename);
         if (file_exists)
         {
             std::error_code ec;
-            auto size = fs::file_size(filename_, ec);
+            auto size = fs::file_size(output.filename, ec);
             has_content = (!ec && size > 0);
         }
     }
@@ -38,164 +107,392 @@ bool DatasetWriter::initialize()
         has_content = false;
     }
 
-    std::ios_base::openmode mode = std::ios::out;
+    uint64_t kept = 0;
     if (has_content)
     {
-        // Append to existing non-empty file
-        mode |= std::ios::app;
-    }
-    else
-    {
-        // Create new file or ensure empty one gets header; use trunc to reset if it exists but is empty
-        mode |= std::ios::trunc;
+        uint64_t removed = 0;
+        if (!recoverTornTail(output.filename, removed, kept))
+        {
+            return false;
+        }
+        if (removed > 0)
+        {
+            std::cout << "Recovered " << output.filename << ": removed " << removed
+                      << " bytes after the last complete row" << std::endl;
+        }
+        has_content = kept > 0;
     }
 
-    file_->open(filename_, mode);
-    if (!file_->is_open())
+    // Append to an existing non-empty file; otherwise create it, or reset
+    // an empty one so it gets a header
+    if (!output.file->open(output.filename, has_content))
     {
-        last_error_ = "Failed to open file: " + filename_;
+        last_error_ = "Failed to open file: " + output.filename + " (" + output.file->getLastError() + ")";
         return false;
     }
 
     // Only write header when file is new or empty
     if (!has_content)
     {
+        row_.clear();
         writeCSVHeader();
+        if (!output.file->write(row_))
+        {
+            last_error_ = "Error writing header to " + output.filename + ": " + output.file->getLastError();
+            return false;
+        }
     }
 
-    is_initialized_ = true;
-    std::cout << (has_content ? "Appending to existing CSV file: " : "Initialized new CSV output file: ") << filename_ << std::endl;
+    // Rows found in an existing file that the index lacks are indexed now
+    if (output.index && !output.index->open(output.filename, has_content ? kept : 0))
+    {
+        last_error_ = output.index->getLastError();
+        return false;
+    }
+
+    std::cout << (has_content ? "Appending to existing CSV file: " : "Initialized new CSV output file: ") << output.filename
+              << " (" << output.file->getName() << " writer" << (output.index ? ", time index" : "") << ")" << std::endl;
     return true;
 }
 
+size_t DatasetWriter::selectSplit(const PacketFeature &packet) const
+{
+    // 5-tuple with the lower (address, port) endpoint first, so both
+    // directions hash alike
+    const IpAddress *low = &packet.src_ip;
+    const IpAddress *high = &packet.dst_ip;
+    uint16_t low_port = packet.transport.present ? packet.transport.src_port : 0;
+    uint16_t high_port = packet.transport.present ? packet.transport.dst_port : 0;
+    int order = std::memcmp(low->bytes, high->bytes, sizeof(low->bytes));
+    if (order > 0 || (order == 0 && low_port > high_port))
+    {
+        std::swap(low, high);
+        std::swap(low_port, high_port);
+    }
+
+    uint64_t words[5];
+    std::memcpy(&words[0], low->bytes, 16);
+    std::memcpy(&words[2], high->bytes, 16);
+    words[4] = (static_cast<uint64_t>(low->family) << 40) | (static_cast<uint64_t>(packet.l4_protocol) << 32) |
+               (static_cast<uint64_t>(low_port) << 16) | high_port;
+    uint64_t hash = sipHash(split_key_, words, 5) >> 32;
+
+    size_t index = 0;
+    while (hash >= outputs_[index].hash_limit)
+    {
+        index++;
+    }
+    return index;
+}
+
 bool DatasetWriter::writePacket(const PacketFeature &packet)
 {
-    if (!is_initialized_ || !file_->is_open())
+    if (!is_initialized_)
     {
         last_error_ = "Writer not initialized or file not open";
         return false;
     }
 
-    try
+    // Rows are built in row_, which keeps its capacity between packets
+    row_.clear();
+    if (csv_mode_ == CSVMode::IPv4_ONLY && packet.type == PacketFeature::Type::IPv4)
+    {
+        const auto &ipv4 = packet.ipv4;
+        appendTimestamp(ipv4.timestamp);
+        row_ += ',';
+        appendIPv4Fields(ipv4);
+        appendCSV(ipv4.protocol_name);
+    }
+    else if (csv_mode_ == CSVMode::IPv6_ONLY && packet.type == PacketFeature::Type::IPv6)
+    {
+        const auto &ipv6 = packet.ipv6;
+        appendTimestamp(ipv6.timestamp);
+        row_ += ',';
+        appendNumber(ipv6.version);
+        row_ += ',';
+        appendNumber(ipv6.traffic_class);
+        row_ += ',';
+        appendNumber(ipv6.flow_label);
+        row_ += ',';
+        appendNumber(ipv6.payload_length);
+        row_ += ',';
+        appendNumber(ipv6.next_header);
+        row_ += ',';
+        appendNumber(ipv6.hop_limit);
+        row_ += ',';
+        appendCSV(ipv6.src_address);
+        row_ += ',';
+        appendCSV(ipv6.dst_address);
+        row_ += ',';
+        appendCSV(ipv6.extension_headers);
+        row_ += ',';
+        appendCSV(ipv6.protocol_name);
+    }
+    else if (csv_mode_ == CSVMode::BOTH)
     {
-        if (csv_mode_ == CSVMode::IPv4_ONLY && packet.type == PacketFeature::Type::IPv4)
+        // Keep existing mixed format
+        if (packet.type == PacketFeature::Type::IPv4)
         {
             const auto &ipv4 = packet.ipv4;
-            *file_ << escapeCSV(formatTimestamp(ipv4.timestamp)) << ","
-                   << static_cast<int>(ipv4.version) << ","
-                   << static_cast<int>(ipv4.ihl) << ","
-                   << static_cast<int>(ipv4.tos) << ","
-                   << ipv4.total_length << ","
-                   << ipv4.identification << ","
-                   << static_cast<int>(ipv4.flags) << ","
-                   << ipv4.fragment_offset << ","
-                   << static_cast<int>(ipv4.ttl) << ","
-                   << static_cast<int>(ipv4.protocol) << ","
-                   << ipv4.header_checksum << ","
-                   << escapeCSV(ipv4.src_address) << ","
-                   << escapeCSV(ipv4.dst_address) << ","
-                   << escapeCSV(vectorToHex(ipv4.options)) << ","
-                   << escapeCSV(ipv4.protocol_name)
-                   << std::endl;
-        }
-        else if (csv_mode_ == CSVMode::IPv6_ONLY && packet.type == PacketFeature::Type::IPv6)
+            appendTimestamp(ipv4.timestamp);
+            row_ += ',';
+            appendIPv4Fields(ipv4);
+            row_ += ",,,,,,"; // TrafficClass..ExtensionHeaders (IPv6 only)
+            appendCSV(ipv4.protocol_name);
+        }
+        else
         {
             const auto &ipv6 = packet.ipv6;
-            *file_ << escapeCSV(formatTimestamp(ipv6.timestamp)) << ","
-                   << static_cast<int>(ipv6.version) << ","
-                   << static_cast<int>(ipv6.traffic_class) << ","
-                   << ipv6.flow_label << ","
-                   << ipv6.payload_length << ","
-                   << static_cast<int>(ipv6.next_header) << ","
-                   << static_cast<int>(ipv6.hop_limit) << ","
-                   << escapeCSV(ipv6.src_address) << ","
-                   << escapeCSV(ipv6.dst_address) << ","
-                   << escapeCSV(vectorToString(ipv6.extension_headers)) << ","
-                   << escapeCSV(ipv6.protocol_name)
-                   << std::endl;
-        }
-        else if (csv_mode_ == CSVMode::BOTH)
-        {
-            // Keep existing mixed format
-            if (packet.type == PacketFeature::Type::IPv4)
-            {
-                const auto &ipv4 = packet.ipv4;
-                *file_ << escapeCSV(formatTimestamp(ipv4.timestamp)) << ","
-                       << static_cast<int>(ipv4.version) << ","
-                       << static_cast<int>(ipv4.ihl) << ","
-                       << static_cast<int>(ipv4.tos) << ","
-                       << ipv4.total_length << ","
-                       << ipv4.identification << ","
-                       << static_cast<int>(ipv4.flags) << ","
-                       << ipv4.fragment_offset << ","
-                       << static_cast<int>(ipv4.ttl) << ","
-                       << static_cast<int>(ipv4.protocol) << ","
-                       << ipv4.header_checksum << ","
-                       << escapeCSV(ipv4.src_address) << ","
-                       << escapeCSV(ipv4.dst_address) << ","
-                       << escapeCSV(vectorToHex(ipv4.options)) << ","
-                       << "," // TrafficClass (IPv6 only)
-                       << "," // FlowLabel (IPv6 only)
-                       << "," // PayloadLength (IPv6 only)
-                       << "," // NextHeader (IPv6 only)
-                       << "," // HopLimit (IPv6 only)
-                       << "," // ExtensionHeaders (IPv6 only)
-                       << escapeCSV(ipv4.protocol_name)
-                       << std::endl;
-            }
-            else if (packet.type == PacketFeature::Type::IPv6)
+            appendTimestamp(ipv6.timestamp);
+            row_ += ',';
+            appendNumber(ipv6.version);
+            row_ += ",,,,,,,,,,"; // IHL..HeaderChecksum (IPv4 only)
+            appendCSV(ipv6.src_address);
+            row_ += ',';
+            appendCSV(ipv6.dst_address);
+            row_ += ",,"; // Options (IPv4 only)
+            appendNumber(ipv6.traffic_class);
+            row_ += ',';
+            appendNumber(ipv6.flow_label);
+            row_ += ',';
+            appendNumber(ipv6.payload_length);
+            row_ += ',';
+            appendNumber(ipv6.next_header);
+            row_ += ',';
+            appendNumber(ipv6.hop_limit);
+            row_ += ',';
+            appendCSV(ipv6.extension_headers);
+            row_ += ',';
+            appendCSV(ipv6.protocol_name);
+        }
+    }
+    else
+    {
+        // Wrong packet type for this mode, skip
+        return true;
+    }
+    writeExtraColumns(packet);
+    row_ += '\n';
+
+    Output &output = outputs_.size() == 1 ? outputs_.front() : outputs_[selectSplit(packet)];
+    output.rows++;
+    if (output.index)
+    {
+        output.index->addRow(output.file->getFileSize(), row_.size(), row_micros_);
+    }
+    if (!output.file->write(row_))
+    {
+        last_error_ = "Error writing packet to " + output.filename + ": " + output.file->getLastError();
+        return false;
+    }
+    return true;
+}
+
+namespace
+{
+    const size_t RECOVERY_SCAN_BYTES = 64 * 1024;
+
+    size_t countCSVFields(const char *line, size_t length)
+    {
+        size_t fields = 1;
+        bool quoted = false;
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (line[i] == '"')
+                quoted = !quoted;
+            else if (line[i] == ',' && !quoted)
+                fields++;
+        }
+        return fields;
+    }
+}
+
+bool DatasetWriter::recoverTornTail(const std::string &filename, uint64_t &removed, uint64_t &kept)
+{
+    // A crash can leave the last row cut short, or followed by zero bytes
+    // (a padded O_DIRECT block, or blocks allocated but never written).
+    // Appending would glue the next row onto it, so the file is cut back to
+    // its last complete row; a last row with NUL bytes or a field count
+    // different from the header's is dropped as well.
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    uint64_t size = fs::file_size(filename, ec);
+    std::ifstream file(filename, std::ios::binary);
+    if (ec || !file.is_open())
+    {
+        last_error_ = "Failed to read " + filename + " for recovery";
+        return false;
+    }
+
+    std::string head(static_cast<size_t>(size < RECOVERY_SCAN_BYTES ? size : RECOVERY_SCAN_BYTES), '\0');
+    file.read(&head[0], static_cast<std::streamsize>(head.size()));
+    size_t header_end = head.find('\n');
+    uint64_t tail_start = size > RECOVERY_SCAN_BYTES ? size - RECOVERY_SCAN_BYTES : 0;
+    std::string tail(static_cast<size_t>(size - tail_start), '\0');
+    file.seekg(static_cast<std::streamoff>(tail_start));
+    file.read(&tail[0], static_cast<std::streamsize>(tail.size()));
+    if (!file)
+    {
+        last_error_ = "Failed to read " + filename + " for recovery";
+        return false;
+    }
+    file.close();
+
+    kept = size;
+    if (header_end != std::string::npos && std::memchr(head.data(), '\0', header_end) != nullptr)
+    {
+        header_end = std::string::npos;
+    }
+    size_t last_newline = tail.rfind('\n');
+    if (header_end == std::string::npos)
+    {
+        kept = 0; // not even the header is complete
+    }
+    else if (last_newline != std::string::npos)
+    {
+        kept = tail_start + last_newline + 1;
+        // Check the last complete row, unless it is the header or starts
+        // before the scanned tail
+        size_t previous = last_newline == 0 ? std::string::npos : tail.rfind('\n', last_newline - 1);
+        size_t line_start = previous == std::string::npos ? 0 : previous + 1;
+        uint64_t row_offset = tail_start + line_start;
+        if ((previous != std::string::npos || tail_start == 0) && row_offset > header_end)
+        {
+            const char *row = tail.data() + line_start;
+            size_t length = last_newline - line_start;
+            if (std::memchr(row, '\0', length) != nullptr ||
+                countCSVFields(row, length) != countCSVFields(head.data(), header_end))
             {
-                const auto &ipv6 = packet.ipv6;
-                *file_ << escapeCSV(formatTimestamp(ipv6.timestamp)) << ","
-                       << static_cast<int>(ipv6.version) << ","
-                       << "," // IHL (IPv4 only)
-                       << "," // TOS (IPv4 only)
-                       << "," // TotalLength (IPv4 only)
-                       << "," // Identification (IPv4 only)
-                       << "," // Flags (IPv4 only)
-                       << "," // FragmentOffset (IPv4 only)
-                       << "," // TTL (IPv4 only)
-                       << "," // Protocol (IPv4 only)
-                       << "," // HeaderChecksum (IPv4 only)
-                       << escapeCSV(ipv6.src_address) << ","
-                       << escapeCSV(ipv6.dst_address) << ","
-                       << "," // Options (IPv4 only)
-                       << static_cast<int>(ipv6.traffic_class) << ","
-                       << ipv6.flow_label << ","
-                       << ipv6.payload_length << ","
-                       << static_cast<int>(ipv6.next_header) << ","
-                       << static_cast<int>(ipv6.hop_limit) << ","
-                       << escapeCSV(vectorToString(ipv6.extension_headers)) << ","
-                       << escapeCSV(ipv6.protocol_name)
-                       << std::endl;
+                kept = row_offset;
             }
         }
-        else
+    }
+    // else: no row boundary in the scanned tail; rows are far shorter, so
+    // the file is left alone
+
+    removed = size - kept;
+    if (removed > 0)
+    {
+        fs::resize_file(filename, kept, ec);
+        if (ec)
         {
-            // Wrong packet type for this mode, skip
-            return true;
+            last_error_ = "Failed to truncate the torn row of " + filename + ": " + ec.message();
+            return false;
         }
+    }
+    return true;
+}
 
-        file_->flush();
+bool DatasetWriter::flush()
+{
+    if (!is_initialized_)
+    {
         return true;
     }
-    catch (const std::exception &e)
+    for (auto &output : outputs_)
     {
-        last_error_ = std::string("Error writing packet: ") + e.what();
-        return false;
+        if (!output.file->submit())
+        {
+            last_error_ = "Error writing to " + output.filename + ": " + output.file->getLastError();
+            return false;
+        }
+        if (output.index && !output.index->flush())
+        {
+            last_error_ = output.index->getLastError();
+            return false;
+        }
     }
+    return true;
+}
+
+void DatasetWriter::appendIPv4Fields(const IPv4PacketFeature &ipv4)
+{
+    // Version through OptionsHex, each followed by a comma
+    appendNumber(ipv4.version);
+    row_ += ',';
+    appendNumber(ipv4.ihl);
+    row_ += ',';
+    appendNumber(ipv4.tos);
+    row_ += ',';
+    appendNumber(ipv4.total_length);
+    row_ += ',';
+    appendNumber(ipv4.identification);
+    row_ += ',';
+    appendNumber(ipv4.flags);
+    row_ += ',';
+    appendNumber(ipv4.fragment_offset);
+    row_ += ',';
+    appendNumber(ipv4.ttl);
+    row_ += ',';
+    appendNumber(ipv4.protocol);
+    row_ += ',';
+    appendNumber(ipv4.header_checksum);
+    row_ += ',';
+    appendCSV(ipv4.src_address);
+    row_ += ',';
+    appendCSV(ipv4.dst_address);
+    row_ += ',';
+    appendHex(ipv4.options);
+    row_ += ',';
 }
 
 void DatasetWriter::close()
 {
-    if (file_ && file_->is_open())
+    bool closed = false;
+    uint64_t syncs = 0;
+    uint64_t rows = 0;
+    for (auto &output : outputs_)
     {
-        file_->close();
-        std::cout << "Closed CSV output file" << std::endl;
+        if (!output.file->isOpen())
+        {
+            continue;
+        }
+        if (!output.file->close())
+        {
+            last_error_ = "Error closing " + output.filename + ": " + output.file->getLastError();
+            std::cerr << "Error: " << last_error_ << std::endl;
+        }
+        if (output.index && !output.index->close())
+        {
+            last_error_ = output.index->getLastError();
+            std::cerr << "Error: " << last_error_ << std::endl;
+        }
+        closed = true;
+        syncs += output.file->getSyncCount();
+        rows += output.rows;
+    }
+    if (closed)
+    {
+        std::cout << (outputs_.size() == 1 ? "Closed CSV output file" : "Closed CSV output files");
+        if (writer_options_.durability != Durability::NONE)
+            std::cout << " (" << syncs << " fdatasync calls)";
+        std::cout << std::endl;
+        if (outputs_.size() > 1)
+        {
+            std::cout << "Flow split:";
+            for (const auto &output : outputs_)
+            {
+                double percent = rows == 0 ? 0.0 : static_cast<double>(output.rows) * 100.0 / static_cast<double>(rows);
+                std::cout << (&output == &outputs_.front() ? " " : ", ") << output.name << " " << output.rows << " rows ("
+                          << std::fixed << std::setprecision(1) << percent << "%)";
+            }
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout << std::endl;
+        }
     }
     is_initialized_ = false;
 }
 
+uint64_t DatasetWriter::getBytesWritten() const
+{
+    uint64_t bytes = 0;
+    for (const auto &output : outputs_)
+    {
+        bytes += output.file->getBytesWritten();
+    }
+    return bytes;
+}
+
 std::string DatasetWriter::getLastError() const
 {
     return last_error_;
@@ -212,91 +509,375 @@ void DatasetWriter::writeCSVHeader()
         writeIPv6CSVHeader();
         break;
     case CSVMode::BOTH:
-        *file_ << "Timestamp,Version,IHL,TOS,TotalLength,Identification,Flags,FragmentOffset,"
-               << "TTL,Protocol,HeaderChecksum,SrcIP,DstIP,OptionsHex,TrafficClass,"
-               << "FlowLabel,PayloadLength,NextHeader,HopLimit,ExtensionHeaders,ProtocolName" << std::endl;
+        row_ += "Timestamp,Version,IHL,TOS,TotalLength,Identification,Flags,FragmentOffset,"
+                "TTL,Protocol,HeaderChecksum,SrcIP,DstIP,OptionsHex,TrafficClass,"
+                "FlowLabel,PayloadLength,NextHeader,HopLimit,ExtensionHeaders,ProtocolName";
+        writeExtraHeaders();
+        row_ += '\n';
         break;
     }
 }
 
 void DatasetWriter::writeIPv4CSVHeader()
 {
-    *file_ << "Timestamp,Version,IHL,TOS,TotalLength,Identification,Flags,FragmentOffset,"
-           << "TTL,Protocol,HeaderChecksum,SrcIP,DstIP,OptionsHex,ProtocolName" << std::endl;
+    row_ += "Timestamp,Version,IHL,TOS,TotalLength,Identification,Flags,FragmentOffset,"
+            "TTL,Protocol,HeaderChecksum,SrcIP,DstIP,OptionsHex,ProtocolName";
+    writeExtraHeaders();
+    row_ += '\n';
 }
 
 void DatasetWriter::writeIPv6CSVHeader()
 {
-    *file_ << "Timestamp,Version,TrafficClass,FlowLabel,PayloadLength,NextHeader,"
-           << "HopLimit,SrcIP,DstIP,ExtensionHeaders,ProtocolName" << std::endl;
+    row_ += "Timestamp,Version,TrafficClass,FlowLabel,PayloadLength,NextHeader,"
+            "HopLimit,SrcIP,DstIP,ExtensionHeaders,ProtocolName";
+    writeExtraHeaders();
+    row_ += '\n';
 }
 
-std::string DatasetWriter::formatTimestamp(const std::chrono::system_clock::time_point &timestamp)
+void DatasetWriter::writeExtraHeaders()
 {
-    auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
-                            timestamp.time_since_epoch()) %
-                        1000000;
-
-    std::ostringstream oss;
-    oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(6) << microseconds.count();
-    return oss.str();
+    if (column_groups_ & COLUMNS_FRAGMENT)
+    {
+        row_ += ",SrcPort,DstPort,TCPFlags,IsFragment,MoreFragments,FragmentId,FragmentOffsetBytes,"
+                "DatagramSize,DatagramComplete,L4Inferred,FragmentOverlap,TinyFragment";
+    }
+    if (column_groups_ & COLUMNS_TUNNEL)
+    {
+        row_ += ",TunnelDepth,TunnelTypes,TunnelId,InnerVersion,InnerSrcIP,InnerDstIP,InnerLength,"
+                "InnerProtocol,InnerSrcPort,InnerDstPort,InnerTCPFlags";
+    }
+    if (column_groups_ & COLUMNS_HOST_WINDOW)
+    {
+        row_ += ",SrcPkts2s,SrcBytes2s,SrcSyns2s,SrcDistinctDsts2s,SrcDistinctDstPorts2s,SrcPktsLast100,"
+                "DstPkts2s,DstBytes2s,DstSyns2s,DstDistinctSrcs2s,DstDistinctDstPorts2s,DstPktsLast100";
+    }
+    if (column_groups_ & COLUMNS_PAYLOAD)
+    {
+        row_ += ",PayloadBytes,PayloadEntropy,PayloadPrintableRatio";
+        for (int bucket = 0; bucket < PayloadFeature::BUCKETS; ++bucket)
+        {
+            row_ += ",PayloadBucket";
+            row_ += std::to_string(bucket);
+        }
+    }
+    if (column_groups_ & COLUMNS_INTERFACE)
+    {
+        row_ += ",Interface";
+    }
+    if (column_groups_ & COLUMNS_ENRICH)
+    {
+        row_ += ",SrcASN,SrcSubnet,SrcGeo,DstASN,DstSubnet,DstGeo";
+    }
+    if (column_groups_ & COLUMNS_LABEL)
+    {
+        row_ += ",Label";
+    }
 }
 
-std::string DatasetWriter::vectorToHex(const std::vector<uint8_t> &data)
+void DatasetWriter::writeExtraColumns(const PacketFeature &packet)
 {
-    if (data.empty())
+    if (column_groups_ & COLUMNS_FRAGMENT)
+    {
+        const auto &transport = packet.transport;
+        const auto &fragment = packet.fragment;
+        if (transport.present)
+        {
+            row_ += ',';
+            appendNumber(transport.src_port);
+            row_ += ',';
+            appendNumber(transport.dst_port);
+            row_ += ',';
+            if (packet.l4_protocol == 6)
+                appendNumber(transport.tcp_flags);
+        }
+        else
+        {
+            row_ += ",,,";
+        }
+        row_ += ',';
+        appendNumber(fragment.is_fragment);
+        if (fragment.is_fragment)
+        {
+            const uint32_t values[] = {fragment.more_fragments, fragment.identification, fragment.offset_bytes,
+                                       fragment.datagram_size, fragment.complete, fragment.l4_inferred,
+                                       fragment.overlap, fragment.tiny};
+            for (uint32_t value : values)
+            {
+                row_ += ',';
+                appendNumber(value);
+            }
+        }
+        else
+        {
+            row_ += ",,,,,,,,";
+        }
+    }
+    if (column_groups_ & COLUMNS_TUNNEL)
+    {
+        const auto &tunnel = packet.tunnel;
+        row_ += ',';
+        appendNumber(tunnel.depth);
+        if (tunnel.depth == 0)
+        {
+            row_ += ",,,,,,,,,,";
+        }
+        else
+        {
+            row_ += ',';
+            for (int i = 0; i < tunnel.depth; ++i)
+            {
+                if (i > 0)
+                    row_ += '/';
+                row_ += PacketParser::getTunnelTypeName(tunnel.types[i]);
+            }
+            row_ += ',';
+            if (tunnel.has_id)
+                appendNumber(tunnel.id);
+            row_ += ',';
+            appendNumber(tunnel.inner_version);
+            row_ += ',';
+            appendCSV(tunnel.inner_src_address);
+            row_ += ',';
+            appendCSV(tunnel.inner_dst_address);
+            row_ += ',';
+            appendNumber(tunnel.inner_length);
+            row_ += ',';
+            appendNumber(tunnel.inner_protocol);
+            if (tunnel.inner_transport.present)
+            {
+                row_ += ',';
+                appendNumber(tunnel.inner_transport.src_port);
+                row_ += ',';
+                appendNumber(tunnel.inner_transport.dst_port);
+                row_ += ',';
+                if (tunnel.inner_protocol == 6)
+                    appendNumber(tunnel.inner_transport.tcp_flags);
+            }
+            else
+            {
+                row_ += ",,,";
+            }
+        }
+    }
+    if (column_groups_ & COLUMNS_HOST_WINDOW)
     {
-        return "";
+        if (packet.host_window.present)
+        {
+            appendHostContext(packet.host_window.src);
+            appendHostContext(packet.host_window.dst);
+        }
+        else
+        {
+            row_ += ",,,,,,,,,,,,";
+        }
     }
-
-    std::ostringstream oss;
-    for (size_t i = 0; i < data.size(); ++i)
+    if (column_groups_ & COLUMNS_PAYLOAD)
     {
-        oss << std::hex << std::setfill('0') << std::setw(2) << static_cast<unsigned>(data[i]);
+        const PayloadFeature &payload = packet.payload;
+        if (payload.present)
+        {
+            row_ += ',';
+            appendNumber(payload.length);
+            row_ += ',';
+            appendDecimal(payload.entropy);
+            row_ += ',';
+            appendDecimal(payload.printable_ratio);
+            for (uint16_t count : payload.buckets)
+            {
+                row_ += ',';
+                appendNumber(count);
+            }
+        }
+        else
+        {
+            row_.append(3 + PayloadFeature::BUCKETS, ',');
+        }
+    }
+    if (column_groups_ & COLUMNS_INTERFACE)
+    {
+        row_ += ',';
+        appendCSV(packet.interface_name);
+    }
+    if (column_groups_ & COLUMNS_ENRICH)
+    {
+        for (const auto *labels : {packet.enrichment.src, packet.enrichment.dst})
+        {
+            for (int kind = 0; kind < EnrichmentFeature::KINDS; ++kind)
+            {
+                row_ += ',';
+                appendCSV(labels[kind]);
+            }
+        }
+    }
+    if (column_groups_ & COLUMNS_LABEL)
+    {
+        row_ += ',';
+        appendCSV(packet.label);
     }
-    return oss.str();
 }
 
-std::string DatasetWriter::vectorToString(const std::vector<std::string> &data)
+void DatasetWriter::appendHostContext(const HostContext &context)
 {
-    if (data.empty())
+    const uint64_t values[] = {context.packets, context.bytes, context.syns,
+                               context.distinct_peers, context.distinct_ports, context.recent_packets};
+    for (uint64_t value : values)
     {
-        return "";
+        row_ += ',';
+        appendNumber(value);
     }
+}
 
-    std::ostringstream oss;
-    for (size_t i = 0; i < data.size(); ++i)
+bool DatasetWriter::parseColumnGroups(const std::string &list, uint32_t &groups, std::string &error)
+{
+    std::istringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ','))
     {
-        if (i > 0)
-            oss << ";";
-        oss << data[i];
+        if (name == "fragment")
+            groups |= COLUMNS_FRAGMENT;
+        else if (name == "tunnel")
+            groups |= COLUMNS_TUNNEL;
+        else if (name == "host")
+            groups |= COLUMNS_HOST_WINDOW;
+        else if (name == "payload")
+            groups |= COLUMNS_PAYLOAD;
+        else if (name == "interface")
+            groups |= COLUMNS_INTERFACE;
+        else if (!name.empty())
+        {
+            error = "Unknown column group '" + name + "'";
+            return false;
+        }
     }
-    return oss.str();
+    return true;
 }
 
-std::string DatasetWriter::escapeCSV(const std::string &field)
+bool DatasetWriter::parseSplits(const std::string &spec, std::vector<DatasetSplit> &splits, std::string &error)
 {
-    if (field.find(',') != std::string::npos ||
-        field.find('"') != std::string::npos ||
-        field.find('\n') != std::string::npos)
+    splits.clear();
+    std::istringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ','))
     {
-
-        std::string escaped = "\"";
-        for (char c : field)
+        size_t equals = item.find('=');
+        DatasetSplit split;
+        split.name = item.substr(0, equals);
+        if (split.name.empty() || equals == std::string::npos)
         {
-            if (c == '"')
+            error = "Split '" + item + "' is not <name>=<weight>";
+            return false;
+        }
+        for (char c : split.name)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-')
             {
-                escaped += "\"\"";
+                error = "Split name '" + split.name + "' may only contain letters, digits, '_' and '-'";
+                return false;
             }
-            else
+        }
+        for (const auto &other : splits)
+        {
+            if (other.name == split.name)
             {
-                escaped += c;
+                error = "Split '" + split.name + "' is given twice";
+                return false;
             }
         }
-        escaped += "\"";
-        return escaped;
+        std::string weight = item.substr(equals + 1);
+        char *end = nullptr;
+        split.weight = std::strtod(weight.c_str(), &end);
+        if (weight.empty() || *end != '\0' || !(split.weight > 0.0) || split.weight > 1e9)
+        {
+            error = "Weight of split '" + split.name + "' must be a positive number";
+            return false;
+        }
+        splits.push_back(split);
+    }
+    if (splits.size() < 2)
+    {
+        error = "A split needs at least two outputs (e.g. train=0.8,test=0.2)";
+        return false;
     }
-    return field;
-}
\ No newline at end of file
+    return true;
+}
+
+std::string DatasetWriter::getSplitFilename(const std::string &filename, const std::string &name)
+{
+    std::filesystem::path path(filename);
+    std::filesystem::path split = path.stem().string() + "-" + name + path.extension().string();
+    return (path.parent_path() / split).string();
+}
+
+void DatasetWriter::appendTimestamp(const std::chrono::system_clock::time_point &timestamp)
+{
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
+    row_micros_ = micros;
+    int64_t seconds = micros / 1000000;
+    int64_t fraction = micros % 1000000;
+    if (fraction < 0)
+    {
+        fraction += 1000000;
+        seconds -= 1;
+    }
+
+    // Packets arrive in bursts within the same second: format the date once
+    if (seconds != cached_second_)
+    {
+        std::time_t time_t = static_cast<std::time_t>(seconds);
+        cached_date_length_ = std::strftime(cached_date_, sizeof(cached_date_), "%Y-%m-%d %H:%M:%S", std::gmtime(&time_t));
+        cached_second_ = seconds;
+    }
+    row_.append(cached_date_, cached_date_length_);
+
+    char digits[8] = {'.', '0', '0', '0', '0', '0', '0', '0'};
+    for (int i = 6; i >= 1; --i)
+    {
+        digits[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    row_.append(digits, 7);
+}
+
+void DatasetWriter::appendNumber(uint64_t value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    row_.append(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+void DatasetWriter::appendDecimal(double value)
+{
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, 4);
+    row_.append(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+void DatasetWriter::appendHex(const ByteView &data)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (uint8_t byte : data)
+    {
+        row_ += HEX_DIGITS[byte >> 4];
+        row_ += HEX_DIGITS[byte & 0x0F];
+    }
+}
+
+void DatasetWriter::appendCSV(std::string_view field)
+{
+    if (field.find_first_of(",\"\n") == std::string_view::npos)
+    {
+        row_.append(field.data(), field.size());
+        return;
+    }
+
+    row_ += '"';
+    for (char c : field)
+    {
+        if (c == '"')
+        {
+            row_ += '"';
+        }
+        row_ += c;
+    }
+    row_ += '"';
+}
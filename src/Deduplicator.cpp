@@ -0,0 +1,192 @@
+#include "Deduplicator.h"
+#include <cstring>
+
+namespace
+{
+    const uint16_t ETHERTYPE_IPV4 = 0x0800;
+    const uint16_t ETHERTYPE_IPV6 = 0x86DD;
+    const uint16_t ETHERTYPE_VLAN = 0x8100;
+    const uint16_t ETHERTYPE_QINQ = 0x88A8;
+    const size_t ETHERNET_HEADER_SIZE = 14;
+    const uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+    inline uint16_t loadBE16(const uint8_t *p)
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    // splitmix64 finaliser
+    inline uint64_t mix64(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // Eight bytes per multiply; the tail is zero-padded into one more word
+    inline uint64_t hashBytes(uint64_t hash, const uint8_t *data, size_t length)
+    {
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * HASH_MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        if (i < length)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, data + i, length - i);
+            hash = (hash ^ word ^ (static_cast<uint64_t>(length - i) << 59)) * HASH_MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+    inline size_t roundUpPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+const size_t Deduplicator::DEFAULT_ENTRIES;
+const size_t Deduplicator::HASH_BYTES;
+
+Deduplicator::Deduplicator(int window_ms, size_t entries)
+    : window_ms_(window_ms > 0 ? window_ms : 1), kick_state_(0x9E3779B9u)
+{
+    window_ticks_ = static_cast<uint32_t>((static_cast<int64_t>(window_ms_) * 1000) >> TICK_SHIFT);
+    size_t buckets = roundUpPowerOfTwo(entries / SLOTS_PER_BUCKET > 0 ? entries / SLOTS_PER_BUCKET : 1);
+    slots_.assign(buckets * SLOTS_PER_BUCKET, Slot{0, 0});
+    bucket_mask_ = buckets - 1;
+}
+
+uint64_t Deduplicator::hashFrame(const uint8_t *frame, size_t caplen, uint32_t wire_length)
+{
+    size_t offset = ETHERNET_HEADER_SIZE;
+    if (caplen < offset)
+    {
+        return mix64(hashBytes(wire_length, frame, caplen));
+    }
+    uint16_t ethertype = loadBE16(frame + 12);
+    while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) && caplen >= offset + 4)
+    {
+        ethertype = loadBE16(frame + offset + 2);
+        offset += 4;
+    }
+
+    const uint8_t *packet = frame + offset;
+    size_t length = caplen - offset;
+    size_t hashed = length < HASH_BYTES ? length : HASH_BYTES;
+    // Tags added or removed by the mirror change the frame length, not the
+    // packet length
+    uint64_t packet_length = wire_length > offset ? wire_length - offset : 0;
+    uint64_t hash = mix64(packet_length ^ (static_cast<uint64_t>(ethertype) << 32));
+
+    if (ethertype == ETHERTYPE_IPV4 && hashed >= 20 && (packet[0] >> 4) == 4)
+    {
+        // Skip TTL (8) and header checksum (10-11); keep protocol (9)
+        hash = hashBytes(hash, packet, 8);
+        hash = hashBytes(hash, packet + 9, 1);
+        hash = hashBytes(hash, packet + 12, hashed - 12);
+    }
+    else if (ethertype == ETHERTYPE_IPV6 && hashed >= 40 && (packet[0] >> 4) == 6)
+    {
+        // Skip the hop limit (7)
+        hash = hashBytes(hash, packet, 7);
+        hash = hashBytes(hash, packet + 8, hashed - 8);
+    }
+    else
+    {
+        hash = hashBytes(hash, packet, hashed);
+    }
+    return mix64(hash);
+}
+
+size_t Deduplicator::alternateBucket(size_t bucket, uint32_t fingerprint) const
+{
+    // Partial-key cuckoo hashing: an involution, so either bucket leads to
+    // the other from the fingerprint alone
+    return (bucket ^ static_cast<size_t>(mix64(fingerprint))) & bucket_mask_;
+}
+
+bool Deduplicator::isLive(const Slot &slot, uint32_t now) const
+{
+    return slot.fingerprint != 0 && static_cast<uint32_t>(now - slot.seen) <= window_ticks_;
+}
+
+bool Deduplicator::placeInBucket(size_t bucket, const Slot &entry, uint32_t now)
+{
+    Slot *slots = &slots_[bucket * SLOTS_PER_BUCKET];
+    for (size_t i = 0; i < SLOTS_PER_BUCKET; ++i)
+    {
+        if (!isLive(slots[i], now))
+        {
+            slots[i] = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Deduplicator::isDuplicate(const uint8_t *frame, size_t caplen, uint32_t wire_length, int64_t timestamp_us)
+{
+    stats_.frames++;
+    uint64_t hash = hashFrame(frame, caplen, wire_length);
+    uint32_t fingerprint = static_cast<uint32_t>(hash >> 32);
+    fingerprint = fingerprint != 0 ? fingerprint : 1;
+    size_t first = static_cast<size_t>(hash) & bucket_mask_;
+    size_t second = alternateBucket(first, fingerprint);
+    uint32_t now = static_cast<uint32_t>(static_cast<uint64_t>(timestamp_us) >> TICK_SHIFT);
+
+    // The window runs from the first copy, so a steady stream of identical
+    // frames is let through once per window
+    for (size_t bucket : {first, second})
+    {
+        const Slot *slots = &slots_[bucket * SLOTS_PER_BUCKET];
+        for (size_t i = 0; i < SLOTS_PER_BUCKET; ++i)
+        {
+            if (slots[i].fingerprint == fingerprint && isLive(slots[i], now))
+            {
+                stats_.duplicates++;
+                return true;
+            }
+        }
+    }
+
+    Slot entry{fingerprint, now};
+    if (placeInBucket(first, entry, now) || placeInBucket(second, entry, now))
+    {
+        return false;
+    }
+
+    // Both buckets hold live fingerprints: move one to its other bucket,
+    // and so on for a bounded number of steps
+    size_t bucket = (kick_state_ & 1) ? first : second;
+    for (int kick = 0; kick < MAX_KICKS; ++kick)
+    {
+        kick_state_ ^= kick_state_ << 13;
+        kick_state_ ^= kick_state_ >> 17;
+        kick_state_ ^= kick_state_ << 5;
+        Slot &victim = slots_[bucket * SLOTS_PER_BUCKET + (kick_state_ & (SLOTS_PER_BUCKET - 1))];
+        Slot displaced = victim;
+        victim = entry;
+        entry = displaced;
+        bucket = alternateBucket(bucket, entry.fingerprint);
+        if (placeInBucket(bucket, entry, now))
+        {
+            return false;
+        }
+    }
+    stats_.evictions++;
+    return false;
+}
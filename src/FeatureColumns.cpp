@@ -0,0 +1,149 @@
+#include "FeatureColumns.h"
+#include "OutputSink.h"
+#include "AddressCache.h"
+
+FeatureColumns::FeatureColumns()
+{
+    clear();
+}
+
+void FeatureColumns::clear()
+{
+    resizeFixed(0);
+    options_offsets.assign(1, 0);
+    options_data.clear();
+    extension_offsets.assign(1, 0);
+    extension_data.clear();
+}
+
+void FeatureColumns::reserve(size_t rows)
+{
+    timestamp_us.reserve(rows);
+    wire_length.reserve(rows);
+    version.reserve(rows);
+    ihl.reserve(rows);
+    tos.reserve(rows);
+    total_length.reserve(rows);
+    identification.reserve(rows);
+    flags.reserve(rows);
+    fragment_offset.reserve(rows);
+    ttl.reserve(rows);
+    protocol.reserve(rows);
+    header_checksum.reserve(rows);
+    traffic_class.reserve(rows);
+    flow_label.reserve(rows);
+    payload_length.reserve(rows);
+    next_header.reserve(rows);
+    hop_limit.reserve(rows);
+    src_ip.reserve(rows);
+    dst_ip.reserve(rows);
+    l4_protocol.reserve(rows);
+    src_port.reserve(rows);
+    dst_port.reserve(rows);
+    tcp_flags.reserve(rows);
+    packet_flags.reserve(rows);
+    fragment_id.reserve(rows);
+    fragment_offset_bytes.reserve(rows);
+    datagram_size.reserve(rows);
+    options_offsets.reserve(rows + 1);
+    extension_offsets.reserve(rows + 1);
+}
+
+void FeatureColumns::resizeFixed(size_t rows)
+{
+    // New rows start zeroed, so producers only write the fields they parse
+    timestamp_us.resize(rows);
+    wire_length.resize(rows);
+    version.resize(rows);
+    ihl.resize(rows);
+    tos.resize(rows);
+    total_length.resize(rows);
+    identification.resize(rows);
+    flags.resize(rows);
+    fragment_offset.resize(rows);
+    ttl.resize(rows);
+    protocol.resize(rows);
+    header_checksum.resize(rows);
+    traffic_class.resize(rows);
+    flow_label.resize(rows);
+    payload_length.resize(rows);
+    next_header.resize(rows);
+    hop_limit.resize(rows);
+    src_ip.resize(rows);
+    dst_ip.resize(rows);
+    l4_protocol.resize(rows);
+    src_port.resize(rows);
+    dst_port.resize(rows);
+    tcp_flags.resize(rows);
+    packet_flags.resize(rows);
+    fragment_id.resize(rows);
+    fragment_offset_bytes.resize(rows);
+    datagram_size.resize(rows);
+}
+
+void FeatureColumns::appendRow(const PacketRecord &record)
+{
+    const PacketFeature &feature = record.feature;
+    size_t row = size();
+    resizeFixed(row + 1);
+
+    bool is_ipv4 = feature.type == PacketFeature::Type::IPv4;
+    const auto &timestamp = is_ipv4 ? feature.ipv4.timestamp : feature.ipv6.timestamp;
+    timestamp_us[row] = std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
+    wire_length[row] = record.wire_length;
+    version[row] = is_ipv4 ? 4 : 6;
+
+    if (is_ipv4)
+    {
+        const auto &ipv4 = feature.ipv4;
+        ihl[row] = ipv4.ihl;
+        tos[row] = ipv4.tos;
+        total_length[row] = ipv4.total_length;
+        identification[row] = ipv4.identification;
+        flags[row] = ipv4.flags;
+        fragment_offset[row] = ipv4.fragment_offset;
+        ttl[row] = ipv4.ttl;
+        protocol[row] = ipv4.protocol;
+        header_checksum[row] = ipv4.header_checksum;
+        options_data.append(reinterpret_cast<const char *>(ipv4.options.data), ipv4.options.size);
+    }
+    else
+    {
+        const auto &ipv6 = feature.ipv6;
+        traffic_class[row] = ipv6.traffic_class;
+        flow_label[row] = ipv6.flow_label;
+        payload_length[row] = ipv6.payload_length;
+        next_header[row] = ipv6.next_header;
+        hop_limit[row] = ipv6.hop_limit;
+        extension_data += ipv6.extension_headers;
+    }
+    options_offsets.push_back(static_cast<uint32_t>(options_data.size()));
+    extension_offsets.push_back(static_cast<uint32_t>(extension_data.size()));
+
+    src_ip[row] = feature.src_ip;
+    dst_ip[row] = feature.dst_ip;
+    l4_protocol[row] = feature.l4_protocol;
+    src_port[row] = feature.transport.src_port;
+    dst_port[row] = feature.transport.dst_port;
+    tcp_flags[row] = feature.transport.tcp_flags;
+
+    const auto &fragment = feature.fragment;
+    packet_flags[row] = static_cast<uint8_t>((feature.transport.present ? FLAG_TRANSPORT : 0) |
+                                             (fragment.is_fragment ? FLAG_FRAGMENT : 0) |
+                                             (fragment.more_fragments ? FLAG_MORE_FRAGMENTS : 0) |
+                                             (fragment.complete ? FLAG_DATAGRAM_COMPLETE : 0) |
+                                             (fragment.l4_inferred ? FLAG_L4_INFERRED : 0) |
+                                             (fragment.overlap ? FLAG_OVERLAP : 0) |
+                                             (fragment.tiny ? FLAG_TINY : 0) |
+                                             (is_ipv4 && feature.ipv4.checksum_error ? FLAG_BAD_CHECKSUM : 0));
+    fragment_id[row] = fragment.identification;
+    fragment_offset_bytes[row] = fragment.offset_bytes;
+    datagram_size[row] = fragment.datagram_size;
+}
+
+std::string formatIpAddress(const IpAddress &address)
+{
+    char text[AddressCache::MAX_TEXT_LENGTH];
+    size_t length = AddressCache::shared().lookup(address.family, address.bytes, text);
+    return std::string(text, length);
+}
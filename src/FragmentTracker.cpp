@@ -0,0 +1,213 @@
+#include "FragmentTracker.h"
+#include <algorithm>
+
+namespace
+{
+    // Smallest transport header a first fragment must carry in full
+    uint32_t minimumTransportHeader(uint8_t protocol)
+    {
+        switch (protocol)
+        {
+        case 6: // TCP
+            return 20;
+        case 17:  // UDP
+        case 1:   // ICMP
+        case 58:  // ICMPv6
+            return 8;
+        case 132: // SCTP
+            return 12;
+        default:
+            return 0;
+        }
+    }
+}
+
+size_t FragmentTracker::KeyHash::operator()(const Key &key) const
+{
+    // FNV-1a over the key fields
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const uint8_t *data, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(key.src.bytes, key.src.family == 6 ? 16 : 4);
+    mix(key.dst.bytes, key.dst.family == 6 ? 16 : 4);
+    mix(reinterpret_cast<const uint8_t *>(&key.identification), sizeof(key.identification));
+    mix(&key.protocol, 1);
+    return static_cast<size_t>(hash);
+}
+
+FragmentTracker::FragmentTracker(const Limits &limits)
+    : limits_(limits), held_rows_(0)
+{
+}
+
+void FragmentTracker::add(PacketRecord &&record, PacketBatch &released)
+{
+    FragmentFeature &fragment = record.feature.fragment;
+    stats_.fragments++;
+
+    // Make room before taking on more state
+    while (!by_age_.empty() && (held_rows_ >= limits_.max_held_rows || datagrams_.size() >= limits_.max_datagrams))
+    {
+        stats_.datagrams_evicted++;
+        release(datagrams_.find(by_age_.front()), released);
+    }
+
+    Key key = makeKey(record.feature);
+    auto it = datagrams_.find(key);
+    if (it == datagrams_.end())
+    {
+        Datagram datagram;
+        datagram.first_seen = record.feature.type == PacketFeature::Type::IPv4 ? record.feature.ipv4.timestamp
+                                                                              : record.feature.ipv6.timestamp;
+        by_age_.push_back(key);
+        datagram.age = std::prev(by_age_.end());
+        it = datagrams_.emplace(key, std::move(datagram)).first;
+    }
+    Datagram &datagram = it->second;
+
+    uint32_t start = fragment.offset_bytes;
+    uint32_t end = start + fragment.payload_bytes;
+    for (const auto &range : datagram.ranges)
+    {
+        if (start < range.second && range.first < end)
+        {
+            fragment.overlap = true;
+            stats_.overlapping_fragments++;
+            break;
+        }
+    }
+
+    uint32_t transport_header = minimumTransportHeader(record.feature.l4_protocol);
+    if ((fragment.more_fragments && fragment.payload_bytes < TINY_FRAGMENT_BYTES) ||
+        (start == 0 && fragment.payload_bytes < transport_header))
+    {
+        fragment.tiny = true;
+        stats_.tiny_fragments++;
+    }
+
+    if (start == 0 && !datagram.have_first)
+    {
+        datagram.have_first = true;
+        datagram.transport = record.feature.transport;
+    }
+    if (!fragment.more_fragments)
+    {
+        datagram.total_size = end;
+    }
+
+    datagram.ranges.emplace_back(start, end);
+    // The row outlives the batch its text was parsed into, so it takes a copy
+    HeldRecord held{std::move(record), nullptr};
+    size_t bytes = variableFieldBytes(held.record.feature);
+    if (bytes > 0)
+    {
+        held.storage.reset(new char[bytes]);
+        relocateVariableFields(held.record.feature, held.storage.get());
+    }
+    datagram.held.push_back(std::move(held));
+    held_rows_++;
+
+    if (isComplete(datagram))
+    {
+        stats_.datagrams_completed++;
+        release(it, released);
+    }
+    else if (datagram.held.size() >= limits_.max_fragments_per_datagram)
+    {
+        stats_.datagrams_evicted++;
+        release(it, released);
+    }
+}
+
+void FragmentTracker::expire(std::chrono::system_clock::time_point now, PacketBatch &released)
+{
+    while (!by_age_.empty())
+    {
+        auto it = datagrams_.find(by_age_.front());
+        if (now - it->second.first_seen < limits_.timeout)
+        {
+            break;
+        }
+        stats_.datagrams_expired++;
+        release(it, released);
+    }
+}
+
+void FragmentTracker::releaseAll(PacketBatch &released)
+{
+    while (!by_age_.empty())
+    {
+        stats_.datagrams_expired++;
+        release(datagrams_.find(by_age_.front()), released);
+    }
+}
+
+FragmentTracker::Stats FragmentTracker::getStats() const
+{
+    return stats_;
+}
+
+FragmentTracker::Key FragmentTracker::makeKey(const PacketFeature &feature)
+{
+    Key key;
+    key.src = feature.src_ip;
+    key.dst = feature.dst_ip;
+    key.identification = feature.fragment.identification;
+    key.protocol = feature.l4_protocol;
+    return key;
+}
+
+bool FragmentTracker::isComplete(const Datagram &datagram)
+{
+    if (!datagram.have_first || datagram.total_size == 0)
+    {
+        return false;
+    }
+
+    auto ranges = datagram.ranges;
+    std::sort(ranges.begin(), ranges.end());
+    uint32_t covered = 0;
+    for (const auto &range : ranges)
+    {
+        if (range.first > covered)
+        {
+            return false;
+        }
+        covered = std::max(covered, range.second);
+    }
+    return covered >= datagram.total_size;
+}
+
+void FragmentTracker::release(std::unordered_map<Key, Datagram, KeyHash>::iterator it, PacketBatch &released)
+{
+    Datagram &datagram = it->second;
+    bool complete = isComplete(datagram);
+    for (auto &held : datagram.held)
+    {
+        PacketRecord &record = held.record;
+        FragmentFeature &fragment = record.feature.fragment;
+        fragment.complete = complete;
+        fragment.datagram_size = complete ? datagram.total_size : 0;
+        if (!record.feature.transport.present && datagram.have_first && datagram.transport.present)
+        {
+            record.feature.transport = datagram.transport;
+            fragment.l4_inferred = true;
+        }
+        size_t bytes = variableFieldBytes(record.feature);
+        if (bytes > 0)
+        {
+            relocateVariableFields(record.feature, static_cast<char *>(released.arena.allocate(bytes, 1)));
+        }
+        released.packets.push_back(std::move(record));
+    }
+
+    held_rows_ -= datagram.held.size();
+    by_age_.erase(datagram.age);
+    datagrams_.erase(it);
+}
@@ -0,0 +1,216 @@
+#include "HostWindowTracker.h"
+#include "Sketches.h"
+#include <cmath>
+
+namespace
+{
+    const int64_t BUCKET_US = static_cast<int64_t>(HostWindowTracker::WINDOW_SECONDS) * 1000000 / HostWindowTracker::BUCKETS;
+
+    inline int popCount64(uint64_t x)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        int count = 0;
+        for (; x != 0; x &= x - 1)
+        {
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    // Linear counting over a 64-bit bitmap
+    uint16_t estimateDistinct(uint64_t bitmap)
+    {
+        int zeros = 64 - popCount64(bitmap);
+        if (zeros == 0)
+        {
+            zeros = 1; // saturated
+        }
+        return static_cast<uint16_t>(std::lround(-64.0 * std::log(zeros / 64.0)));
+    }
+
+    // splitmix64 finaliser, so that neighbouring ports land on unrelated bits
+    inline uint64_t mixPort(uint16_t port)
+    {
+        uint64_t x = port + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    inline uint64_t bitFor(uint64_t hash)
+    {
+        return uint64_t(1) << (hash >> 58);
+    }
+
+    size_t tableSizeFor(size_t hosts)
+    {
+        size_t size = 64;
+        while (size < hosts)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+}
+
+HostWindowTracker::HostWindowTracker(size_t hosts_per_direction)
+    : recent_(COUNT_WINDOW), recent_next_(0), recent_filled_(0), newest_bucket_(INT64_MIN)
+{
+    Host empty = Host();
+    empty.bucket = -1;
+    senders_.assign(tableSizeFor(hosts_per_direction), empty);
+    receivers_.assign(tableSizeFor(hosts_per_direction), empty);
+}
+
+void HostWindowTracker::advance(Host &host, int64_t bucket)
+{
+    if (bucket <= host.bucket)
+    {
+        return;
+    }
+    // Clear the buckets that fell out of the window since the last update
+    int64_t stale = bucket - host.bucket;
+    int clear = stale >= BUCKETS ? BUCKETS : static_cast<int>(stale);
+    for (int i = 1; i <= clear; ++i)
+    {
+        size_t index = static_cast<size_t>((host.bucket + i) % BUCKETS);
+        host.packets[index] = 0;
+        host.bytes[index] = 0;
+        host.syns[index] = 0;
+        host.peers[index] = 0;
+        host.ports[index] = 0;
+    }
+    host.bucket = bucket;
+}
+
+uint32_t HostWindowTracker::findHost(std::vector<Host> &table, const IpAddress &address, uint64_t hash, int64_t bucket)
+{
+    size_t mask = table.size() - 1;
+    size_t start = hash & mask;
+    size_t victim = start;
+    for (size_t probe = 0; probe < PROBE_LIMIT; ++probe)
+    {
+        size_t slot = (start + probe) & mask;
+        Host &host = table[slot];
+        if (host.bucket >= 0 && host.hash == hash && host.key == address)
+        {
+            return static_cast<uint32_t>(slot);
+        }
+        if (host.bucket < 0)
+        {
+            victim = slot;
+            break;
+        }
+        if (host.bucket < table[victim].bucket)
+        {
+            victim = slot;
+        }
+    }
+
+    // Take a free slot or the least recently seen host of the probe run
+    Host &host = table[victim];
+    if (host.bucket >= 0 && (host.recent > 0 || host.bucket + BUCKETS > bucket))
+    {
+        stats_.hosts_evicted++;
+    }
+    uint32_t generation = host.generation + 1;
+    host = Host();
+    host.key = address;
+    host.hash = hash;
+    host.bucket = bucket;
+    host.generation = generation;
+    stats_.hosts_added++;
+    return static_cast<uint32_t>(victim);
+}
+
+void HostWindowTracker::retire(std::vector<Host> &table, uint32_t slot, uint32_t generation)
+{
+    Host &host = table[slot];
+    if (host.generation == generation && host.recent > 0)
+    {
+        host.recent--;
+    }
+}
+
+void HostWindowTracker::summarise(const Host &host, HostContext &context)
+{
+    uint64_t peers = 0;
+    uint64_t ports = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        context.packets += host.packets[i];
+        context.bytes += host.bytes[i];
+        context.syns += host.syns[i];
+        peers |= host.peers[i];
+        ports |= host.ports[i];
+    }
+    context.distinct_peers = estimateDistinct(peers);
+    context.distinct_ports = ports ? estimateDistinct(ports) : 0;
+    context.recent_packets = host.recent;
+}
+
+void HostWindowTracker::process(PacketRecord &record, Arena &)
+{
+    PacketFeature &feature = record.feature;
+    const auto &timestamp = feature.type == PacketFeature::Type::IPv4 ? feature.ipv4.timestamp : feature.ipv6.timestamp;
+    int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
+    int64_t bucket = micros >= 0 ? micros / BUCKET_US : 0;
+    // Rows that arrive out of order are counted in the newest bucket
+    if (bucket < newest_bucket_)
+    {
+        bucket = newest_bucket_;
+    }
+    newest_bucket_ = bucket;
+
+    if (recent_filled_ == COUNT_WINDOW)
+    {
+        const RecentRow &oldest = recent_[recent_next_];
+        retire(senders_, oldest.src_slot, oldest.src_generation);
+        retire(receivers_, oldest.dst_slot, oldest.dst_generation);
+    }
+    else
+    {
+        recent_filled_++;
+    }
+
+    uint64_t src_hash = hashAddress(feature.src_ip);
+    uint64_t dst_hash = hashAddress(feature.dst_ip);
+    const TransportFeature &transport = feature.transport;
+    bool syn = feature.l4_protocol == 6 && transport.present && (transport.tcp_flags & 0x12) == 0x02;
+    uint64_t port_bit = transport.present ? bitFor(mixPort(transport.dst_port)) : 0;
+    size_t index = static_cast<size_t>(bucket % BUCKETS);
+
+    uint32_t src_slot = findHost(senders_, feature.src_ip, src_hash, bucket);
+    uint32_t dst_slot = findHost(receivers_, feature.dst_ip, dst_hash, bucket);
+    Host *hosts[2] = {&senders_[src_slot], &receivers_[dst_slot]};
+    uint64_t peer_bits[2] = {bitFor(dst_hash), bitFor(src_hash)};
+    for (int side = 0; side < 2; ++side)
+    {
+        Host &host = *hosts[side];
+        advance(host, bucket);
+        host.packets[index]++;
+        host.bytes[index] += record.wire_length;
+        host.syns[index] += syn ? 1 : 0;
+        host.peers[index] |= peer_bits[side];
+        host.ports[index] |= port_bit;
+        host.recent++;
+    }
+
+    recent_[recent_next_] = {src_slot, senders_[src_slot].generation, dst_slot, receivers_[dst_slot].generation};
+    recent_next_ = (recent_next_ + 1) % COUNT_WINDOW;
+
+    HostWindowFeature &context = feature.host_window;
+    context.present = true;
+    summarise(senders_[src_slot], context.src);
+    summarise(receivers_[dst_slot], context.dst);
+    stats_.rows++;
+}
+
+std::string HostWindowTracker::getSummary() const
+{
+    return "Host windows: " + std::to_string(stats_.rows) + " rows, " + std::to_string(stats_.hosts_added) +
+           " host entries created, " + std::to_string(stats_.hosts_evicted) + " evicted while active";
+}
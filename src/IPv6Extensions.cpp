@@ -0,0 +1,150 @@
+#include "IPv6Extensions.h"
+#include <array>
+
+namespace
+{
+    enum HeaderKind : uint8_t
+    {
+        KIND_NONE = 0, // upper-layer protocol or No Next Header
+        KIND_UNIFORM,  // 8 + length * 8 bytes
+        KIND_FRAGMENT, // always 8 bytes
+        KIND_AH,       // (length + 2) * 4 bytes
+        KIND_ESP       // boundary: the rest is encrypted
+    };
+
+    std::array<uint8_t, 256> buildKindTable()
+    {
+        std::array<uint8_t, 256> kinds{};
+        kinds[0] = KIND_UNIFORM;   // Hop-by-Hop Options
+        kinds[43] = KIND_UNIFORM;  // Routing
+        kinds[44] = KIND_FRAGMENT; // Fragment
+        kinds[50] = KIND_ESP;      // Encapsulating Security Payload
+        kinds[51] = KIND_AH;       // Authentication Header
+        kinds[60] = KIND_UNIFORM;  // Destination Options
+        kinds[135] = KIND_UNIFORM; // Mobility
+        kinds[139] = KIND_UNIFORM; // Host Identity Protocol
+        kinds[140] = KIND_UNIFORM; // Shim6
+        kinds[253] = KIND_UNIFORM; // Experimentation (RFC 3692)
+        kinds[254] = KIND_UNIFORM;
+        return kinds;
+    }
+
+    const std::array<uint8_t, 256> HEADER_KINDS = buildKindTable();
+}
+
+bool isIPv6ExtensionHeader(uint8_t next_header)
+{
+    return HEADER_KINDS[next_header] != KIND_NONE;
+}
+
+void walkIPv6ExtensionHeaders(const uint8_t *data, int remaining_size, uint8_t next_header,
+                              IPv6ExtensionChain &chain, FragmentFeature &fragment)
+{
+    chain = IPv6ExtensionChain();
+    int offset = 0;
+
+    for (;;)
+    {
+        uint8_t kind = HEADER_KINDS[next_header];
+        if (kind == KIND_NONE)
+        {
+            break;
+        }
+        if (kind == KIND_ESP)
+        {
+            chain.flags |= IPv6ExtensionChain::ENCRYPTED;
+            break;
+        }
+        if (chain.count == IPv6ExtensionChain::MAX_HEADERS)
+        {
+            chain.flags |= IPv6ExtensionChain::TOO_DEEP;
+            break;
+        }
+
+        int fixed_bytes = kind == KIND_FRAGMENT ? 8 : 2;
+        if (offset + fixed_bytes > remaining_size)
+        {
+            chain.flags |= IPv6ExtensionChain::TRUNCATED;
+            break;
+        }
+
+        const uint8_t *header = &data[offset];
+        int length;
+        switch (kind)
+        {
+        case KIND_FRAGMENT:
+            length = 8;
+            break;
+        case KIND_AH:
+            length = (header[1] + 2) * 4;
+            break;
+        default:
+            length = 8 + header[1] * 8;
+            break;
+        }
+
+        if (next_header == 0 && chain.count > 0)
+        {
+            chain.flags |= IPv6ExtensionChain::HBH_NOT_FIRST;
+        }
+        chain.types[chain.count] = next_header;
+        chain.lengths[chain.count] = static_cast<uint16_t>(length);
+        chain.count++;
+
+        bool non_first_fragment = false;
+        if (kind == KIND_FRAGMENT)
+        {
+            uint16_t offset_and_flags = static_cast<uint16_t>((header[2] << 8) | header[3]);
+            fragment.offset_bytes = static_cast<uint32_t>(offset_and_flags >> 3) * 8;
+            fragment.more_fragments = (offset_and_flags & 0x01) != 0;
+            fragment.is_fragment = true;
+            fragment.identification = (static_cast<uint32_t>(header[4]) << 24) | (static_cast<uint32_t>(header[5]) << 16) |
+                                      (static_cast<uint32_t>(header[6]) << 8) | header[7];
+            // What follows a non-first fragment is payload, not headers
+            non_first_fragment = fragment.offset_bytes != 0;
+        }
+
+        next_header = header[0];
+        offset += length;
+        if (offset > remaining_size)
+        {
+            chain.flags |= IPv6ExtensionChain::TRUNCATED;
+            break;
+        }
+        if (non_first_fragment)
+        {
+            break;
+        }
+    }
+
+    chain.final_protocol = next_header;
+    chain.l4_offset = static_cast<uint16_t>(offset);
+}
+
+size_t formatIPv6ExtensionChain(const IPv6ExtensionChain &chain, char *out)
+{
+    char *p = out;
+    for (int i = 0; i < chain.count; ++i)
+    {
+        if (i > 0)
+        {
+            *p++ = ',';
+        }
+        static const char prefix[] = {'H', 'e', 'a', 'd', 'e', 'r'};
+        for (char c : prefix)
+        {
+            *p++ = c;
+        }
+        uint8_t type = chain.types[i];
+        if (type >= 100)
+        {
+            *p++ = static_cast<char>('0' + type / 100);
+        }
+        if (type >= 10)
+        {
+            *p++ = static_cast<char>('0' + type / 10 % 10);
+        }
+        *p++ = static_cast<char>('0' + type % 10);
+    }
+    return static_cast<size_t>(p - out);
+}
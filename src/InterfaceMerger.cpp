@@ -0,0 +1,228 @@
+#include "InterfaceMerger.h"
+#include <cstring>
+
+namespace
+{
+    inline size_t align8(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+}
+
+const size_t InterfaceMerger::CHUNK_BYTES;
+
+InterfaceMerger::InterfaceMerger(size_t inputs, const Config &config)
+    : config_(config), last_emitted_us_(INT64_MIN), frames_late_(0), forced_emits_(0), chunks_in_use_(0),
+      peak_chunks_(0)
+{
+    size_t count = inputs > 0 ? inputs : 1;
+    size_t per_input = config_.memory_bytes / count / CHUNK_BYTES;
+    // One chunk being filled while another waits to be merged
+    max_chunks_ = per_input > 2 ? per_input : 2;
+    for (size_t i = 0; i < count; ++i)
+    {
+        inputs_.push_back(std::make_unique<Input>());
+    }
+}
+
+bool InterfaceMerger::startChunk(Input &input)
+{
+    std::lock_guard<std::mutex> lock(input.mutex);
+    if (input.current)
+    {
+        input.current->published = input.current->written;
+        input.current->sealed = true;
+        input.current = nullptr;
+        input.newest_us = input.staged_newest_us > input.newest_us ? input.staged_newest_us : input.newest_us;
+    }
+
+    std::unique_ptr<Chunk> chunk;
+    if (!input.spare.empty())
+    {
+        chunk = std::move(input.spare.back());
+        input.spare.pop_back();
+    }
+    else if (input.chunks.size() < max_chunks_)
+    {
+        chunk = std::make_unique<Chunk>();
+        chunk->bytes.reset(new uint8_t[CHUNK_BYTES]);
+    }
+    else
+    {
+        return false;
+    }
+    if (input.chunks.size() >= max_chunks_)
+    {
+        input.spare.push_back(std::move(chunk));
+        return false;
+    }
+    chunk->written = 0;
+    chunk->published = 0;
+    chunk->sealed = false;
+    input.current = chunk.get();
+    input.chunks.push_back(std::move(chunk));
+    input.chunks_in_use.store(input.chunks.size(), std::memory_order_relaxed);
+
+    size_t in_use = chunks_in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t peak = peak_chunks_.load(std::memory_order_relaxed);
+    while (in_use > peak && !peak_chunks_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+
+void InterfaceMerger::push(size_t input_index, const struct pcap_pkthdr *header, const uint8_t *data)
+{
+    Input &input = *inputs_[input_index];
+    size_t caplen = header->caplen;
+    if (caplen > CHUNK_BYTES - sizeof(FrameHeader))
+    {
+        caplen = CHUNK_BYTES - sizeof(FrameHeader);
+    }
+    size_t size = align8(sizeof(FrameHeader) + caplen);
+    if ((!input.current || input.current->written + size > CHUNK_BYTES) && !startChunk(input))
+    {
+        input.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Chunk &chunk = *input.current;
+    FrameHeader frame;
+    frame.timestamp_us = static_cast<int64_t>(header->ts.tv_sec) * 1000000 + header->ts.tv_usec;
+    frame.caplen = static_cast<uint32_t>(caplen);
+    frame.wire_length = header->len;
+    std::memcpy(chunk.bytes.get() + chunk.written, &frame, sizeof(frame));
+    std::memcpy(chunk.bytes.get() + chunk.written + sizeof(frame), data, caplen);
+    chunk.written += size;
+    input.staged_newest_us = frame.timestamp_us > input.staged_newest_us ? frame.timestamp_us : input.staged_newest_us;
+    input.frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void InterfaceMerger::publish(size_t input_index)
+{
+    Input &input = *inputs_[input_index];
+    if (!input.current)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(input.mutex);
+    input.current->published = input.current->written;
+    input.newest_us = input.staged_newest_us > input.newest_us ? input.staged_newest_us : input.newest_us;
+}
+
+const InterfaceMerger::FrameHeader *InterfaceMerger::headFrame(Input &input)
+{
+    while (!input.view.empty())
+    {
+        const ChunkView &view = input.view.front();
+        if (input.read_offset < view.end)
+        {
+            return reinterpret_cast<const FrameHeader *>(view.chunk->bytes.get() + input.read_offset);
+        }
+        if (!view.sealed)
+        {
+            return nullptr;
+        }
+        // Fully merged and finished by the capture thread: recycle it
+        {
+            std::lock_guard<std::mutex> lock(input.mutex);
+            input.spare.push_back(std::move(input.chunks.front()));
+            input.chunks.pop_front();
+            input.chunks_in_use.store(input.chunks.size(), std::memory_order_relaxed);
+        }
+        chunks_in_use_.fetch_sub(1, std::memory_order_relaxed);
+        input.view.erase(input.view.begin());
+        input.read_offset = 0;
+    }
+    return nullptr;
+}
+
+void InterfaceMerger::drain(int64_t now_us, bool final, const FrameCallback &callback)
+{
+    int64_t idle_bound = now_us - static_cast<int64_t>(config_.reorder_ms) * 1000;
+    int64_t watermark = INT64_MAX;
+    for (auto &entry : inputs_)
+    {
+        Input &input = *entry;
+        std::lock_guard<std::mutex> lock(input.mutex);
+        input.view.clear();
+        for (const auto &chunk : input.chunks)
+        {
+            input.view.push_back({chunk.get(), chunk->published, chunk->sealed});
+        }
+        int64_t bound = input.newest_us > idle_bound ? input.newest_us : idle_bound;
+        watermark = bound < watermark ? bound : watermark;
+    }
+    if (final)
+    {
+        watermark = INT64_MAX;
+    }
+
+    struct pcap_pkthdr header;
+    while (true)
+    {
+        // k is the number of interfaces, so a linear scan for the oldest
+        // head frame is cheaper than keeping a heap
+        const FrameHeader *oldest = nullptr;
+        size_t oldest_index = 0;
+        bool pressured = false;
+        for (size_t i = 0; i < inputs_.size(); ++i)
+        {
+            Input &input = *inputs_[i];
+            const FrameHeader *head = headFrame(input);
+            if (!head)
+            {
+                continue;
+            }
+            if (!oldest || head->timestamp_us < oldest->timestamp_us)
+            {
+                oldest = head;
+                oldest_index = i;
+            }
+            // The capture thread is about to run out of chunks
+            pressured = pressured || input.chunks_in_use.load(std::memory_order_relaxed) >= max_chunks_;
+        }
+        if (!oldest)
+        {
+            break;
+        }
+
+        if (oldest->timestamp_us > watermark)
+        {
+            if (!pressured)
+            {
+                break;
+            }
+            forced_emits_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (oldest->timestamp_us < last_emitted_us_)
+        {
+            frames_late_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            last_emitted_us_ = oldest->timestamp_us;
+        }
+
+        header.ts.tv_sec = static_cast<decltype(header.ts.tv_sec)>(oldest->timestamp_us / 1000000);
+        header.ts.tv_usec = static_cast<decltype(header.ts.tv_usec)>(oldest->timestamp_us % 1000000);
+        header.caplen = oldest->caplen;
+        header.len = oldest->wire_length;
+        callback(oldest_index, reinterpret_cast<const uint8_t *>(oldest + 1), &header);
+        inputs_[oldest_index]->read_offset += align8(sizeof(FrameHeader) + oldest->caplen);
+    }
+}
+
+InterfaceMerger::Stats InterfaceMerger::getStats() const
+{
+    Stats stats;
+    for (const auto &input : inputs_)
+    {
+        stats.frames.push_back(input->frames.load(std::memory_order_relaxed));
+        stats.frames_dropped.push_back(input->frames_dropped.load(std::memory_order_relaxed));
+    }
+    stats.frames_late = frames_late_.load(std::memory_order_relaxed);
+    stats.forced_emits = forced_emits_.load(std::memory_order_relaxed);
+    stats.peak_bytes = peak_chunks_.load(std::memory_order_relaxed) * CHUNK_BYTES;
+    return stats;
+}
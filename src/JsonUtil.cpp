@@ -0,0 +1,238 @@
+#include "JsonUtil.h"
+#include <cstdio>
+#include <cctype>
+
+std::string escapeJSON(const std::string &str)
+{
+    std::string escaped;
+    escaped.reserve(str.size() + 2);
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\"':
+            escaped += "\\\"";
+            break;
+        case '\b':
+            escaped += "\\b";
+            break;
+        case '\f':
+            escaped += "\\f";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 32)
+            {
+                // Escape other control characters
+                char buf[7];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                escaped += buf;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+namespace
+{
+    void skipWhitespace(const std::string &text, size_t &pos)
+    {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+        {
+            ++pos;
+        }
+    }
+
+    void appendUtf8(std::string &out, unsigned code)
+    {
+        if (code < 0x80)
+        {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parseString(const std::string &text, size_t &pos, std::string &out)
+    {
+        if (pos >= text.size() || text[pos] != '"')
+        {
+            return false;
+        }
+        ++pos;
+        while (pos < text.size())
+        {
+            char c = text[pos++];
+            if (c == '"')
+            {
+                return true;
+            }
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size())
+            {
+                return false;
+            }
+            char esc = text[pos++];
+            switch (esc)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                out += esc;
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u':
+            {
+                if (pos + 4 > text.size())
+                {
+                    return false;
+                }
+                unsigned code = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    char h = text[pos++];
+                    code <<= 4;
+                    if (h >= '0' && h <= '9')
+                        code |= h - '0';
+                    else if (h >= 'a' && h <= 'f')
+                        code |= h - 'a' + 10;
+                    else if (h >= 'A' && h <= 'F')
+                        code |= h - 'A' + 10;
+                    else
+                        return false;
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+}
+
+bool parseFlatJSONObject(const std::string &text, std::map<std::string, std::string> &fields, std::string &error)
+{
+    size_t pos = 0;
+    skipWhitespace(text, pos);
+    if (pos >= text.size() || text[pos] != '{')
+    {
+        error = "Expected JSON object";
+        return false;
+    }
+    ++pos;
+
+    skipWhitespace(text, pos);
+    if (pos < text.size() && text[pos] == '}')
+    {
+        return true;
+    }
+
+    while (pos < text.size())
+    {
+        std::string key;
+        skipWhitespace(text, pos);
+        if (!parseString(text, pos, key))
+        {
+            error = "Invalid object key";
+            return false;
+        }
+
+        skipWhitespace(text, pos);
+        if (pos >= text.size() || text[pos] != ':')
+        {
+            error = "Expected ':' after key '" + key + "'";
+            return false;
+        }
+        ++pos;
+        skipWhitespace(text, pos);
+
+        std::string value;
+        if (pos < text.size() && text[pos] == '"')
+        {
+            if (!parseString(text, pos, value))
+            {
+                error = "Invalid string value for '" + key + "'";
+                return false;
+            }
+        }
+        else
+        {
+            while (pos < text.size() && text[pos] != ',' && text[pos] != '}' &&
+                   !std::isspace(static_cast<unsigned char>(text[pos])))
+            {
+                if (text[pos] == '{' || text[pos] == '[')
+                {
+                    error = "Nested values are not supported ('" + key + "')";
+                    return false;
+                }
+                value += text[pos++];
+            }
+            if (value.empty())
+            {
+                error = "Missing value for '" + key + "'";
+                return false;
+            }
+        }
+        fields[key] = value;
+
+        skipWhitespace(text, pos);
+        if (pos < text.size() && text[pos] == ',')
+        {
+            ++pos;
+            continue;
+        }
+        if (pos < text.size() && text[pos] == '}')
+        {
+            return true;
+        }
+        error = "Expected ',' or '}'";
+        return false;
+    }
+
+    error = "Unterminated JSON object";
+    return false;
+}
@@ -0,0 +1,41 @@
+#include "LiveStatsSink.h"
+
+LiveStatsSink::LiveStatsSink(const std::string &socket_path, LiveStreamServer::Content content)
+    : socket_path_(socket_path), server_(socket_path, content)
+{
+}
+
+bool LiveStatsSink::open()
+{
+    return server_.start();
+}
+
+bool LiveStatsSink::consume(const PacketBatch &batch)
+{
+    for (const auto &record : batch.packets)
+    {
+        server_.publish(record.feature, record.wire_length);
+    }
+    return true;
+}
+
+void LiveStatsSink::close()
+{
+    server_.stop();
+}
+
+std::string LiveStatsSink::getName() const
+{
+    return "live:" + socket_path_;
+}
+
+std::string LiveStatsSink::getLastError() const
+{
+    return server_.getLastError();
+}
+
+std::string LiveStatsSink::getSummary() const
+{
+    return "Live stream rows dropped: " + std::to_string(server_.getDroppedRows()) +
+           " (messages skipped for slow subscribers: " + std::to_string(server_.getDroppedMessages()) + ")";
+}
@@ -0,0 +1,417 @@
+#include "LiveStreamServer.h"
+#include "JsonUtil.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const int ROWS_INTERVAL_MS = 100;
+    const int STATS_INTERVAL_MS = 1000;
+}
+
+LiveStreamServer::LiveStreamServer(const std::string &socket_path, Content content)
+    : socket_path_(socket_path), content_(content), listen_fd_(-1), socket_inode_(0), running_(false),
+      subscriber_count_(0), total_packets_(0), dropped_rows_(0), dropped_messages_(0)
+{
+    wake_fd_[0] = -1;
+    wake_fd_[1] = -1;
+}
+
+LiveStreamServer::~LiveStreamServer()
+{
+    stop();
+}
+
+bool LiveStreamServer::start()
+{
+#ifdef _WIN32
+    last_error_ = "Live streaming requires Unix-domain sockets and is not supported on Windows";
+    return false;
+#else
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(addr.sun_path))
+    {
+        last_error_ = "Stream socket path too long: " + socket_path_;
+        return false;
+    }
+    std::strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0)
+    {
+        last_error_ = std::string("Failed to create stream socket: ") + std::strerror(errno);
+        return false;
+    }
+
+    // Only a stale socket is replaced: never another kind of file, and not
+    // a socket something still listens on
+    struct stat existing;
+    if (::lstat(socket_path_.c_str(), &existing) == 0)
+    {
+        bool in_use = false;
+        if (S_ISSOCK(existing.st_mode))
+        {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            in_use = probe >= 0 && connect(probe, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0;
+            if (probe >= 0)
+                ::close(probe);
+        }
+        if (!S_ISSOCK(existing.st_mode) || in_use)
+        {
+            last_error_ = "Stream socket path " + socket_path_ +
+                          (in_use ? " is in use" : " exists and is not a socket");
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        ::unlink(socket_path_.c_str());
+    }
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 8) != 0 || pipe(wake_fd_) != 0)
+    {
+        last_error_ = "Failed to bind stream socket " + socket_path_ + ": " + std::strerror(errno);
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    fcntl(listen_fd_, F_SETFL, O_NONBLOCK);
+    struct stat bound;
+    socket_inode_ = ::lstat(socket_path_.c_str(), &bound) == 0 ? static_cast<uint64_t>(bound.st_ino) : 0;
+
+    running_ = true;
+    publisher_ = std::thread(&LiveStreamServer::publisherLoop, this);
+    std::cout << "Streaming live capture data on " << socket_path_ << std::endl;
+    return true;
+#endif
+}
+
+void LiveStreamServer::stop()
+{
+#ifndef _WIN32
+    if (running_)
+    {
+        running_ = false;
+        char byte = 0;
+        ssize_t ignored = ::write(wake_fd_[1], &byte, 1);
+        (void)ignored;
+    }
+    if (publisher_.joinable())
+    {
+        publisher_.join();
+    }
+
+    for (auto &subscriber : subscribers_)
+    {
+        ::close(subscriber.fd);
+    }
+    subscribers_.clear();
+    subscriber_count_ = 0;
+
+    for (int &fd : wake_fd_)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    if (listen_fd_ >= 0)
+    {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        struct stat node;
+        if (::lstat(socket_path_.c_str(), &node) == 0 && S_ISSOCK(node.st_mode) &&
+            static_cast<uint64_t>(node.st_ino) == socket_inode_)
+        {
+            ::unlink(socket_path_.c_str());
+        }
+    }
+#endif
+}
+
+void LiveStreamServer::publish(const PacketFeature &packet, uint32_t wire_length)
+{
+    bool want_row = content_ == Content::ROWS_AND_STATS && subscriber_count_.load(std::memory_order_relaxed) > 0;
+    std::string row;
+    if (want_row)
+    {
+        row = formatRow(packet, wire_length);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_.packets++;
+    window_.bytes += wire_length;
+    if (packet.type == PacketFeature::Type::IPv4)
+    {
+        window_.ipv4++;
+        window_.protocols[std::string(packet.ipv4.protocol_name)]++;
+    }
+    else
+    {
+        window_.ipv6++;
+        window_.protocols[std::string(packet.ipv6.protocol_name)]++;
+    }
+    total_packets_++;
+
+    if (want_row)
+    {
+        if (pending_rows_.size() < MAX_PENDING_ROWS)
+        {
+            pending_rows_.push_back(std::move(row));
+        }
+        else
+        {
+            dropped_rows_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t LiveStreamServer::getDroppedRows() const
+{
+    return dropped_rows_.load();
+}
+
+uint64_t LiveStreamServer::getDroppedMessages() const
+{
+    return dropped_messages_.load();
+}
+
+std::string LiveStreamServer::getLastError() const
+{
+    return last_error_;
+}
+
+void LiveStreamServer::publisherLoop()
+{
+#ifndef _WIN32
+    using namespace std::chrono;
+    auto next_rows = steady_clock::now() + milliseconds(ROWS_INTERVAL_MS);
+    auto next_stats = steady_clock::now() + milliseconds(STATS_INTERVAL_MS);
+
+    std::vector<struct pollfd> fds;
+    while (running_)
+    {
+        fds.clear();
+        fds.push_back({listen_fd_, POLLIN, 0});
+        fds.push_back({wake_fd_[0], POLLIN, 0});
+        for (const auto &subscriber : subscribers_)
+        {
+            short events = POLLIN;
+            if (!subscriber.outbox.empty())
+                events |= POLLOUT;
+            fds.push_back({subscriber.fd, events, 0});
+        }
+
+        auto now = steady_clock::now();
+        auto next_tick = content_ == Content::ROWS_AND_STATS ? std::min(next_rows, next_stats) : next_stats;
+        int timeout_ms = static_cast<int>(std::max<int64_t>(0, duration_cast<milliseconds>(next_tick - now).count()));
+
+        int ready = poll(fds.data(), fds.size(), timeout_ms);
+        if (ready < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        if (ready > 0)
+        {
+            if (fds[0].revents & POLLIN)
+            {
+                int fd;
+                while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0)
+                {
+                    fcntl(fd, F_SETFL, O_NONBLOCK);
+                    subscribers_.push_back({fd, std::string()});
+                }
+            }
+
+            // Iterate the snapshot taken for poll; new subscribers are appended after it
+            for (size_t i = 2, s = 0; i < fds.size(); ++i, ++s)
+            {
+                Subscriber &subscriber = subscribers_[s];
+                bool alive = !(fds[i].revents & (POLLHUP | POLLERR | POLLNVAL));
+                if (alive && (fds[i].revents & POLLIN))
+                {
+                    // Subscribers do not send anything; a read of 0 means they left
+                    char discard[256];
+                    ssize_t n = ::recv(subscriber.fd, discard, sizeof(discard), 0);
+                    alive = n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+                }
+                if (alive && (fds[i].revents & POLLOUT))
+                {
+                    alive = flushSubscriber(subscriber);
+                }
+                if (!alive)
+                {
+                    ::close(subscriber.fd);
+                    subscriber.fd = -1;
+                }
+            }
+        }
+
+        for (auto it = subscribers_.begin(); it != subscribers_.end();)
+        {
+            it = it->fd < 0 ? subscribers_.erase(it) : it + 1;
+        }
+        subscriber_count_ = static_cast<int>(subscribers_.size());
+
+        now = steady_clock::now();
+        if (content_ == Content::ROWS_AND_STATS && now >= next_rows)
+        {
+            next_rows = now + milliseconds(ROWS_INTERVAL_MS);
+            std::string rows = buildRowsMessage();
+            if (!rows.empty())
+            {
+                broadcast(rows);
+            }
+        }
+        if (now >= next_stats)
+        {
+            next_stats += milliseconds(STATS_INTERVAL_MS);
+            broadcast(buildStatsMessage());
+        }
+    }
+
+    // Final counters so subscribers see the totals of the finished capture
+    if (content_ == Content::ROWS_AND_STATS)
+    {
+        std::string rows = buildRowsMessage();
+        if (!rows.empty())
+        {
+            broadcast(rows);
+        }
+    }
+    broadcast(buildStatsMessage());
+    broadcast("{\"type\":\"end\"}\n");
+    for (auto &subscriber : subscribers_)
+    {
+        flushSubscriber(subscriber);
+    }
+#endif
+}
+
+void LiveStreamServer::broadcast(const std::string &message)
+{
+    for (auto &subscriber : subscribers_)
+    {
+        if (subscriber.outbox.size() + message.size() > MAX_OUTBOX_BYTES)
+        {
+            // Slow reader: skip this message rather than buffering without bound
+            dropped_messages_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        subscriber.outbox += message;
+        if (!flushSubscriber(subscriber))
+        {
+#ifndef _WIN32
+            ::close(subscriber.fd);
+#endif
+            subscriber.fd = -1;
+        }
+    }
+}
+
+bool LiveStreamServer::flushSubscriber(Subscriber &subscriber)
+{
+#ifndef _WIN32
+    while (!subscriber.outbox.empty() && subscriber.fd >= 0)
+    {
+        ssize_t n = ::send(subscriber.fd, subscriber.outbox.data(), subscriber.outbox.size(), MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            subscriber.outbox.erase(0, static_cast<size_t>(n));
+            continue;
+        }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+#endif
+    return subscriber.fd >= 0;
+}
+
+std::string LiveStreamServer::buildStatsMessage()
+{
+    WindowStats window;
+    uint64_t total;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(window, window_);
+        total = total_packets_;
+    }
+
+    auto now = std::chrono::system_clock::now();
+    std::ostringstream json;
+    json << "{\"type\":\"stats\",\"time\":" << std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count()
+         << ",\"packets\":" << window.packets
+         << ",\"bytes\":" << window.bytes
+         << ",\"ipv4\":" << window.ipv4
+         << ",\"ipv6\":" << window.ipv6
+         << ",\"totalPackets\":" << total
+         << ",\"droppedRows\":" << dropped_rows_.load()
+         << ",\"droppedMessages\":" << dropped_messages_.load()
+         << ",\"protocols\":{";
+    bool first = true;
+    for (const auto &entry : window.protocols)
+    {
+        if (!first)
+            json << ",";
+        first = false;
+        json << "\"" << escapeJSON(entry.first) << "\":" << entry.second;
+    }
+    json << "}}\n";
+    return json.str();
+}
+
+std::string LiveStreamServer::buildRowsMessage()
+{
+    std::vector<std::string> rows;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rows.swap(pending_rows_);
+    }
+    if (rows.empty())
+    {
+        return "";
+    }
+
+    std::string message = "{\"type\":\"rows\",\"rows\":[";
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        if (i > 0)
+            message += ",";
+        message += rows[i];
+    }
+    message += "]}\n";
+    return message;
+}
+
+std::string LiveStreamServer::formatRow(const PacketFeature &packet, uint32_t wire_length)
+{
+    bool is_ipv4 = packet.type == PacketFeature::Type::IPv4;
+    const auto &timestamp = is_ipv4 ? packet.ipv4.timestamp : packet.ipv6.timestamp;
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
+
+    const IPv4PacketFeature &ipv4 = packet.ipv4;
+    const IPv6PacketFeature &ipv6 = packet.ipv6;
+    std::ostringstream json;
+    json << "{\"ts\":" << micros / 1000000 << "." << std::setfill('0') << std::setw(6) << micros % 1000000
+         << ",\"version\":" << (is_ipv4 ? 4 : 6)
+         << ",\"src\":\"" << escapeJSON(std::string(is_ipv4 ? ipv4.src_address : ipv6.src_address)) << "\""
+         << ",\"dst\":\"" << escapeJSON(std::string(is_ipv4 ? ipv4.dst_address : ipv6.dst_address)) << "\""
+         << ",\"protocol\":\"" << escapeJSON(std::string(is_ipv4 ? ipv4.protocol_name : ipv6.protocol_name)) << "\""
+         << ",\"length\":" << wire_length << "}";
+    return json.str();
+}
@@ -0,0 +1,147 @@
+#include "OutputSink.h"
+#include "CsvSink.h"
+#include "BinarySink.h"
+#include "LiveStatsSink.h"
+#include "SketchSink.h"
+#include "PayloadTensorSink.h"
+#include <sstream>
+
+namespace
+{
+    const char *const CSV_OPTIONS[] = {"ipv4", "ipv6", "both"};
+    const char *const LIVE_OPTIONS[] = {"stats"};
+
+    // Splits a trailing ":option" off the target when it is one of the known
+    // options, so targets may themselves contain ':' (e.g. Windows paths).
+    template <size_t N>
+    std::string takeOption(std::string &target, const char *const (&options)[N])
+    {
+        size_t colon = target.rfind(':');
+        if (colon == std::string::npos)
+        {
+            return "";
+        }
+        std::string option = target.substr(colon + 1);
+        for (const char *known : options)
+        {
+            if (option == known)
+            {
+                target.erase(colon);
+                return option;
+            }
+        }
+        return "";
+    }
+
+    // Splits a trailing ":<digits>" off the target
+    std::string takeNumericOption(std::string &target)
+    {
+        size_t colon = target.rfind(':');
+        if (colon == std::string::npos || colon + 1 == target.size() ||
+            target.find_first_not_of("0123456789", colon + 1) != std::string::npos)
+        {
+            return "";
+        }
+        std::string option = target.substr(colon + 1);
+        target.erase(colon);
+        return option;
+    }
+}
+
+bool parseSinkSpec(const std::string &text, SinkSpec &spec, std::string &error)
+{
+    size_t colon = text.find(':');
+    if (colon == std::string::npos || colon + 1 == text.size())
+    {
+        error = "Invalid output '" + text + "' (expected type:target)";
+        return false;
+    }
+
+    spec.type = text.substr(0, colon);
+    spec.target = text.substr(colon + 1);
+    if (spec.type == "csv")
+    {
+        spec.option = takeOption(spec.target, CSV_OPTIONS);
+    }
+    else if (spec.type == "live")
+    {
+        spec.option = takeOption(spec.target, LIVE_OPTIONS);
+    }
+    else if (spec.type == "sketch")
+    {
+        spec.option = takeNumericOption(spec.target);
+        if (spec.option == "0" || spec.option.size() > 6)
+        {
+            error = "Invalid sketch window '" + spec.option + "' in output '" + text + "'";
+            return false;
+        }
+    }
+    else if (spec.type == "npy")
+    {
+        spec.option = takeNumericOption(spec.target);
+        if (spec.option == "0" || spec.option.size() > 4)
+        {
+            error = "Invalid payload byte count '" + spec.option + "' in output '" + text + "'";
+            return false;
+        }
+    }
+    else if (spec.type != "binary")
+    {
+        error = "Unknown output type '" + spec.type + "' (expected csv, binary, live, sketch or npy)";
+        return false;
+    }
+
+    if (spec.target.empty())
+    {
+        error = "Missing target in output '" + text + "'";
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> splitSinkList(const std::string &list)
+{
+    std::vector<std::string> specs;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            specs.push_back(item);
+        }
+    }
+    return specs;
+}
+
+std::unique_ptr<OutputSink> createOutputSink(const SinkSpec &spec, uint32_t column_groups,
+                                             const WriterBackend::Options &writer)
+{
+    if (spec.type == "csv")
+    {
+        CSVMode mode = spec.option == "ipv4"   ? CSVMode::IPv4_ONLY
+                       : spec.option == "ipv6" ? CSVMode::IPv6_ONLY
+                                               : CSVMode::BOTH;
+        return std::make_unique<CsvSink>(spec.target, mode, column_groups, writer);
+    }
+    if (spec.type == "binary")
+    {
+        return std::make_unique<BinarySink>(spec.target);
+    }
+    if (spec.type == "live")
+    {
+        return std::make_unique<LiveStatsSink>(spec.target, spec.option == "stats" ? LiveStreamServer::Content::STATS
+                                                                                   : LiveStreamServer::Content::ROWS_AND_STATS);
+    }
+    if (spec.type == "sketch")
+    {
+        int window = spec.option.empty() ? SketchSink::DEFAULT_WINDOW_SECONDS : std::stoi(spec.option);
+        return std::make_unique<SketchSink>(spec.target, window);
+    }
+    if (spec.type == "npy")
+    {
+        size_t head_bytes = spec.option.empty() ? PayloadTensorSink::DEFAULT_HEAD_BYTES : std::stoul(spec.option);
+        return std::make_unique<PayloadTensorSink>(spec.target, head_bytes);
+    }
+    return nullptr;
+}
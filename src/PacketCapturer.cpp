@@ -1,5 +1,7 @@
 ﻿#include "PacketCapturer.h"
+#include "JsonUtil.h"
 #include <iostream>
+#include <sstream>
 #include <cstring>
 #include <vector>
 
@@ -8,7 +10,7 @@
 #include <ws2tcpip.h>
 #endif
 
-PacketCapturer::PacketCapturer() : pcap_handle_(nullptr), is_capturing_(false)
+PacketCapturer::PacketCapturer() : pcap_handle_(nullptr), is_capturing_(false), promiscuous_(true), has_filter_(false)
 {
 #ifdef _WIN32
     WSADATA wsa_data;
@@ -19,6 +21,10 @@ PacketCapturer::PacketCapturer() : pcap_handle_(nullptr), is_capturing_(false)
 PacketCapturer::~PacketCapturer()
 {
     stopCapture();
+    for (auto &entry : compiled_filters_)
+    {
+        pcap_freecode(&entry.second);
+    }
     if (pcap_handle_)
     {
         pcap_close(pcap_handle_);
@@ -72,6 +78,8 @@ bool PacketCapturer::initialize(const std::string &interface_name, bool promiscu
         return false;
     }
 
+    device_name_ = device_name;
+    promiscuous_ = promiscuous;
     std::cout << "Initialized packet capture on interface: " << device_name
               << " (Promiscuous mode: " << (promiscuous ? "enabled" : "disabled") << ")" << std::endl;
     return true;
@@ -85,27 +93,45 @@ bool PacketCapturer::setFilter(const std::string &filter)
         return false;
     }
 
-    struct bpf_program fp;
-    char errbuf[PCAP_ERRBUF_SIZE];
+    if (has_filter_ && filter == current_filter_)
+    {
+        return true;
+    }
 
-    if (pcap_compile(pcap_handle_, &fp, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1)
+    // Compiled programs are kept for the lifetime of the handle so a reused
+    // capturer only pays for pcap_setfilter when switching between filters
+    auto it = compiled_filters_.find(filter);
+    if (it == compiled_filters_.end())
     {
-        last_error_ = std::string("Failed to compile filter: ") + pcap_geterr(pcap_handle_);
-        return false;
+        struct bpf_program fp;
+        if (pcap_compile(pcap_handle_, &fp, filter.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1)
+        {
+            last_error_ = std::string("Failed to compile filter: ") + pcap_geterr(pcap_handle_);
+            return false;
+        }
+        it = compiled_filters_.emplace(filter, fp).first;
     }
 
-    if (pcap_setfilter(pcap_handle_, &fp) == -1)
+    if (pcap_setfilter(pcap_handle_, &it->second) == -1)
     {
         last_error_ = std::string("Failed to set filter: ") + pcap_geterr(pcap_handle_);
-        pcap_freecode(&fp);
         return false;
     }
 
-    pcap_freecode(&fp);
-    std::cout << "Set packet filter: " << filter << std::endl;
+    has_filter_ = true;
+    current_filter_ = filter;
+    if (!filter.empty())
+    {
+        std::cout << "Set packet filter: " << filter << std::endl;
+    }
     return true;
 }
 
+bool PacketCapturer::hasFilter() const
+{
+    return has_filter_;
+}
+
 void PacketCapturer::setCallback(PacketCallback callback)
 {
     packet_callback_ = callback;
@@ -143,6 +169,87 @@ void PacketCapturer::stopCapture()
     }
 }
 
+int PacketCapturer::getSelectableFd() const
+{
+#ifdef _WIN32
+    return -1;
+#else
+    return pcap_handle_ ? pcap_get_selectable_fd(pcap_handle_) : -1;
+#endif
+}
+
+bool PacketCapturer::setNonBlocking(bool enable)
+{
+    if (!pcap_handle_)
+    {
+        last_error_ = "Capturer not initialized";
+        return false;
+    }
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    if (pcap_setnonblock(pcap_handle_, enable ? 1 : 0, errbuf) == -1)
+    {
+        last_error_ = std::string("Failed to change blocking mode: ") + errbuf;
+        return false;
+    }
+    return true;
+}
+
+int PacketCapturer::dispatch(int max_packets)
+{
+    if (!pcap_handle_ || !packet_callback_)
+    {
+        last_error_ = "Capturer not properly initialized or callback not set";
+        return -1;
+    }
+
+    int result = pcap_dispatch(pcap_handle_, max_packets, packetHandler, reinterpret_cast<uint8_t *>(this));
+    if (result == -1)
+    {
+        last_error_ = std::string("Capture error: ") + pcap_geterr(pcap_handle_);
+    }
+    return result;
+}
+
+void PacketCapturer::discardPending()
+{
+    if (!pcap_handle_)
+    {
+        return;
+    }
+
+    PacketCallback saved = packet_callback_;
+    packet_callback_ = [](const uint8_t *, int, const struct pcap_pkthdr *) {};
+    char errbuf[PCAP_ERRBUF_SIZE];
+    int was_nonblocking = pcap_getnonblock(pcap_handle_, errbuf);
+    pcap_setnonblock(pcap_handle_, 1, errbuf);
+    while (pcap_dispatch(pcap_handle_, -1, packetHandler, reinterpret_cast<uint8_t *>(this)) > 0)
+    {
+    }
+    pcap_setnonblock(pcap_handle_, was_nonblocking == 1 ? 1 : 0, errbuf);
+    packet_callback_ = saved;
+}
+
+std::string PacketCapturer::getInterfaceName() const
+{
+    return device_name_;
+}
+
+int PacketCapturer::getLinkType() const
+{
+    return pcap_handle_ ? pcap_datalink(pcap_handle_) : DLT_EN10MB;
+}
+
+int PacketCapturer::getSnapshotLength() const
+{
+    return pcap_handle_ ? pcap_snapshot(pcap_handle_) : 65536;
+}
+
+bool PacketCapturer::isPromiscuous() const
+{
+    return promiscuous_;
+}
+
 std::string PacketCapturer::getLastError() const
 {
     return last_error_;
@@ -401,63 +508,22 @@ std::string PacketCapturer::selectFirstActiveInterface()
 }
 
 void PacketCapturer::listInterfacesJSON() const
+{
+    std::cout << getInterfacesJSON() << std::endl;
+}
+
+std::string PacketCapturer::getInterfacesJSON() const
 {
     pcap_if_t *all_devices;
     char errbuf[PCAP_ERRBUF_SIZE];
 
     if (pcap_findalldevs(&all_devices, errbuf) == -1)
     {
-        std::cout << "{\"success\": false, \"error\": \"" << errbuf << "\"}" << std::endl;
-        return;
+        return std::string("{\"success\": false, \"error\": \"") + escapeJSON(errbuf) + "\"}";
     }
 
-    // Helper lambda to escape strings for JSON
-    auto escapeJSON = [](const std::string &str) -> std::string
-    {
-        std::string escaped;
-        for (char c : str)
-        {
-            switch (c)
-            {
-            case '\\':
-                escaped += "\\\\";
-                break;
-            case '\"':
-                escaped += "\\\"";
-                break;
-            case '\b':
-                escaped += "\\b";
-                break;
-            case '\f':
-                escaped += "\\f";
-                break;
-            case '\n':
-                escaped += "\\n";
-                break;
-            case '\r':
-                escaped += "\\r";
-                break;
-            case '\t':
-                escaped += "\\t";
-                break;
-            default:
-                if (c < 32)
-                {
-                    // Escape other control characters
-                    char buf[7];
-                    snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
-                    escaped += buf;
-                }
-                else
-                {
-                    escaped += c;
-                }
-            }
-        }
-        return escaped;
-    };
-
-    std::cout << "{\"success\": true, \"interfaces\": [" << std::endl;
+    std::ostringstream json;
+    json << "{\"success\": true, \"interfaces\": [" << std::endl;
 
     bool first = true;
     for (pcap_if_t *device = all_devices; device != nullptr; device = device->next)
@@ -466,21 +532,21 @@ void PacketCapturer::listInterfacesJSON() const
             continue;
 
         if (!first)
-            std::cout << "," << std::endl;
+            json << "," << std::endl;
         first = false;
 
         std::string deviceName = device->name ? device->name : "";
         std::string desc = device->description ? device->description : deviceName;
 
-        std::cout << "  {" << std::endl;
-        std::cout << "    \"id\": \"" << escapeJSON(deviceName) << "\"," << std::endl;
-        std::cout << "    \"description\": \"" << escapeJSON(desc) << "\"," << std::endl;
-        std::cout << "    \"name\": \"" << escapeJSON(deviceName) << "\"," << std::endl;
-        std::cout << "    \"isUp\": " << ((device->flags & PCAP_IF_UP) ? "true" : "false") << "," << std::endl;
-        std::cout << "    \"hasAddresses\": " << (device->addresses ? "true" : "false") << "," << std::endl;
-        std::cout << "    \"isLoopback\": false," << std::endl;
-        std::cout << "    \"isWireless\": " << ((device->flags & PCAP_IF_WIRELESS) ? "true" : "false") << "," << std::endl;
-        std::cout << "    \"isRunning\": " << ((device->flags & PCAP_IF_RUNNING) ? "true" : "false");
+        json << "  {" << std::endl;
+        json << "    \"id\": \"" << escapeJSON(deviceName) << "\"," << std::endl;
+        json << "    \"description\": \"" << escapeJSON(desc) << "\"," << std::endl;
+        json << "    \"name\": \"" << escapeJSON(deviceName) << "\"," << std::endl;
+        json << "    \"isUp\": " << ((device->flags & PCAP_IF_UP) ? "true" : "false") << "," << std::endl;
+        json << "    \"hasAddresses\": " << (device->addresses ? "true" : "false") << "," << std::endl;
+        json << "    \"isLoopback\": false," << std::endl;
+        json << "    \"isWireless\": " << ((device->flags & PCAP_IF_WIRELESS) ? "true" : "false") << "," << std::endl;
+        json << "    \"isRunning\": " << ((device->flags & PCAP_IF_RUNNING) ? "true" : "false");
 
         if (device->addresses)
         {
@@ -489,18 +555,19 @@ void PacketCapturer::listInterfacesJSON() const
                 if (addr->addr && addr->addr->sa_family == AF_INET)
                 {
                     struct sockaddr_in *sin = (struct sockaddr_in *)addr->addr;
-                    std::cout << "," << std::endl
-                              << "    \"ipv4\": \"" << inet_ntoa(sin->sin_addr) << "\"";
+                    json << "," << std::endl
+                         << "    \"ipv4\": \"" << inet_ntoa(sin->sin_addr) << "\"";
                     break;
                 }
             }
         }
 
-        std::cout << std::endl
-                  << "  }";
+        json << std::endl
+             << "  }";
     }
 
-    std::cout << std::endl
-              << "]}" << std::endl;
+    json << std::endl
+         << "]}";
     pcap_freealldevs(all_devices);
+    return json.str();
 }
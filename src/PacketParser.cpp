@@ -1,7 +1,7 @@
 #include "PacketParser.h"
+#include "AddressCache.h"
+#include "IPv6Extensions.h"
 #include <iostream>
-#include <sstream>
-#include <iomanip>
 #include <cstring>
 
 #ifdef _WIN32
@@ -13,11 +13,85 @@
 
 using namespace std;
 
-PacketParser::PacketParser() {}
+namespace
+{
+    // Byte-wise big-endian loads: no alignment requirement, no branches
+    inline uint16_t loadBE16(const uint8_t *p)
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline uint32_t loadBE32(const uint8_t *p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    // One's-complement sum over the header folded to 16 bits; a valid
+    // header sums to 0xFFFF in either byte order (RFC 1071)
+    bool verifyIPv4HeaderChecksum(const uint8_t *header, size_t length)
+    {
+        uint32_t sum = 0;
+        for (size_t i = 0; i + 1 < length; i += 2)
+        {
+            sum += static_cast<uint32_t>(header[i] << 8 | header[i + 1]);
+        }
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        return sum == 0xFFFF;
+    }
+
+    const uint16_t ETHERTYPE_IPV4 = 0x0800;
+    const uint16_t ETHERTYPE_IPV6 = 0x86DD;
+    const uint16_t ETHERTYPE_VLAN = 0x8100;
+    const uint16_t ETHERTYPE_TEB = 0x6558; // transparent Ethernet bridging
+    const uint16_t VXLAN_PORT = 4789;
+    const uint16_t GENEVE_PORT = 6081;
+
+    // Checks that data starts with an IP header of the version ethertype
+    // names; anything else (ARP, MPLS, ...) is not decapsulated
+    bool matchEtherType(uint16_t ethertype, const uint8_t *data, int size)
+    {
+        if (size < 1)
+            return false;
+        uint8_t version = data[0] >> 4;
+        return (ethertype == ETHERTYPE_IPV4 && version == 4) || (ethertype == ETHERTYPE_IPV6 && version == 6);
+    }
+
+    // Skips an inner Ethernet header (with at most one VLAN tag)
+    bool skipEthernet(const uint8_t *&data, int &size)
+    {
+        if (size < 14)
+            return false;
+        int header = 14;
+        uint16_t ethertype = loadBE16(&data[12]);
+        if (ethertype == ETHERTYPE_VLAN && size >= 18)
+        {
+            ethertype = loadBE16(&data[16]);
+            header = 18;
+        }
+        data += header;
+        size -= header;
+        return matchEtherType(ethertype, data, size);
+    }
+
+    // Strips an encapsulation payload that carries an ethertype (GRE,
+    // GENEVE) down to the IP header
+    bool skipToIP(uint16_t ethertype, const uint8_t *&data, int &size)
+    {
+        if (ethertype == ETHERTYPE_TEB)
+            return skipEthernet(data, size);
+        return matchEtherType(ethertype, data, size);
+    }
+}
+
+PacketParser::PacketParser()
+    : tunnel_depth_(0), payload_kernels_(nullptr), payload_head_bytes_(0), address_text_(true) {}
 
 PacketParser::~PacketParser() {}
 
-optional<PacketFeature> PacketParser::processPacket(const uint8_t *packet, int packet_size, const struct pcap_pkthdr *header)
+optional<PacketFeature> PacketParser::processPacket(const uint8_t *packet, int packet_size, const struct pcap_pkthdr *header,
+                                                    Arena &arena)
 {
     if (packet_size < ETHERNET_HEADER_SIZE)
     {
@@ -39,35 +113,151 @@ optional<PacketFeature> PacketParser::processPacket(const uint8_t *packet, int p
 
     if (version == 4)
     {
-        auto ipv4_feature = parseIPv4(ip_header, remaining_size, timestamp);
-        if (ipv4_feature)
+        PacketFeature feature(PacketFeature::Type::IPv4);
+        if (parseIPv4(ip_header, remaining_size, timestamp, arena, feature))
         {
-            PacketFeature feature(PacketFeature::Type::IPv4);
-            feature.ipv4 = *ipv4_feature;
+            if (payload_kernels_)
+                extractPayload(ip_header, remaining_size, arena, feature);
+            if (tunnel_depth_ > 0)
+                decapsulate(ip_header, remaining_size, timestamp, arena, feature);
             return feature;
         }
     }
     else if (version == 6)
     {
-        auto ipv6_feature = parseIPv6(ip_header, remaining_size, timestamp);
-        if (ipv6_feature)
+        PacketFeature feature(PacketFeature::Type::IPv6);
+        if (parseIPv6(ip_header, remaining_size, timestamp, arena, feature))
         {
-            PacketFeature feature(PacketFeature::Type::IPv6);
-            feature.ipv6 = *ipv6_feature;
+            if (payload_kernels_)
+                extractPayload(ip_header, remaining_size, arena, feature);
+            if (tunnel_depth_ > 0)
+                decapsulate(ip_header, remaining_size, timestamp, arena, feature);
             return feature;
         }
     }
     return nullopt;
 }
 
-optional<IPv4PacketFeature> PacketParser::parseIPv4(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp)
+void PacketParser::setTunnelDepth(int depth)
+{
+    tunnel_depth_ = depth < 0 ? 0 : (depth > TunnelFeature::MAX_DEPTH ? TunnelFeature::MAX_DEPTH : depth);
+}
+
+int PacketParser::getTunnelDepth() const
+{
+    return tunnel_depth_;
+}
+
+void PacketParser::setPayloadFeatures(bool enabled, size_t head_bytes)
+{
+    payload_kernels_ = enabled ? &getPayloadKernels() : nullptr;
+    payload_head_bytes_ = enabled ? (head_bytes > MAX_PAYLOAD_HEAD_BYTES ? MAX_PAYLOAD_HEAD_BYTES : head_bytes) : 0;
+}
+
+bool PacketParser::getPayloadFeatures() const
+{
+    return payload_kernels_ != nullptr;
+}
+
+void PacketParser::setAddressText(bool enabled)
+{
+    address_text_ = enabled;
+}
+
+const char *PacketParser::getTunnelTypeName(TunnelFeature::Type type)
+{
+    switch (type)
+    {
+    case TunnelFeature::Type::GRE:
+        return "gre";
+    case TunnelFeature::Type::IPIP:
+        return "ipip";
+    case TunnelFeature::Type::SIX_IN_FOUR:
+        return "6in4";
+    case TunnelFeature::Type::VXLAN:
+        return "vxlan";
+    case TunnelFeature::Type::GENEVE:
+        return "geneve";
+    default:
+        return "none";
+    }
+}
+
+void PacketParser::decapsulate(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp,
+                               Arena &arena, PacketFeature &packet)
+{
+    // One layer per iteration: find where the encapsulated IP header starts
+    // inside the current layer, then parse it in place with the ordinary
+    // IPv4/IPv6 parsers. Only the innermost layer's features are kept.
+    TunnelFeature &tunnel = packet.tunnel;
+    const uint8_t *layer = ip_header;
+    int layer_size = remaining_size;
+    uint8_t version = (ip_header[0] >> 4) & 0x0F;
+    uint8_t protocol = packet.l4_protocol;
+    int l4_offset = packet.l4_offset;
+    TransportFeature transport = packet.transport;
+    bool fragment = packet.fragment.is_fragment;
+
+    while (tunnel.depth < tunnel_depth_ && !fragment && l4_offset > 0 && l4_offset < layer_size)
+    {
+        InnerPacket inner;
+        if (!locateInnerPacket(version, protocol, transport, &layer[l4_offset], layer_size - l4_offset, inner))
+        {
+            break;
+        }
+
+        uint8_t inner_version = (inner.data[0] >> 4) & 0x0F;
+        PacketFeature inner_feature(inner_version == 4 ? PacketFeature::Type::IPv4 : PacketFeature::Type::IPv6);
+        bool parsed = inner_version == 4 ? parseIPv4(inner.data, inner.size, timestamp, arena, inner_feature)
+                                         : parseIPv6(inner.data, inner.size, timestamp, arena, inner_feature);
+        if (!parsed)
+        {
+            break;
+        }
+
+        tunnel.types[tunnel.depth++] = inner.type;
+        if (inner.has_id)
+        {
+            tunnel.id = inner.id;
+            tunnel.has_id = true;
+        }
+        tunnel.inner_version = inner_version;
+        tunnel.inner_protocol = inner_feature.l4_protocol;
+        tunnel.inner_src_ip = inner_feature.src_ip;
+        tunnel.inner_dst_ip = inner_feature.dst_ip;
+        tunnel.inner_transport = inner_feature.transport;
+        if (inner_version == 4)
+        {
+            tunnel.inner_length = inner_feature.ipv4.total_length;
+            tunnel.inner_src_address = inner_feature.ipv4.src_address;
+            tunnel.inner_dst_address = inner_feature.ipv4.dst_address;
+        }
+        else
+        {
+            tunnel.inner_length = static_cast<uint16_t>(inner_feature.ipv6.payload_length + IPV6_HEADER_SIZE);
+            tunnel.inner_src_address = inner_feature.ipv6.src_address;
+            tunnel.inner_dst_address = inner_feature.ipv6.dst_address;
+        }
+
+        layer = inner.data;
+        layer_size = inner.size;
+        version = inner_version;
+        protocol = inner_feature.l4_protocol;
+        l4_offset = inner_feature.l4_offset;
+        transport = inner_feature.transport;
+        fragment = inner_feature.fragment.is_fragment;
+    }
+}
+
+bool PacketParser::parseIPv4(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp,
+                             Arena &arena, PacketFeature &packet)
 {
     if (remaining_size < IPV4_MIN_HEADER_SIZE)
     {
-        return nullopt;
+        return false;
     }
 
-    IPv4PacketFeature feature;
+    IPv4PacketFeature &feature = packet.ipv4;
     feature.timestamp = timestamp;
 
     feature.version = (ip_header[0] >> 4) & 0x0F;
@@ -83,33 +273,54 @@ optional<IPv4PacketFeature> PacketParser::parseIPv4(const uint8_t *ip_header, in
     feature.ttl = ip_header[8];
     feature.protocol = ip_header[9];
     feature.header_checksum = ntohs(*reinterpret_cast<const uint16_t *>(&ip_header[10]));
+    if (feature.ihl >= 5 && feature.ihl * 4 <= remaining_size)
+    {
+        feature.checksum_error = !verifyIPv4HeaderChecksum(ip_header, feature.ihl * 4);
+    }
 
     feature.protocol_name = getProtocolName(feature.protocol);
 
-    uint32_t src_ip = *reinterpret_cast<const uint32_t *>(&ip_header[12]);
-    uint32_t dst_ip = *reinterpret_cast<const uint32_t *>(&ip_header[16]);
-    feature.src_address = ipv4ToString(src_ip);
-    feature.dst_address = ipv4ToString(dst_ip);
+    packet.src_ip.family = 4;
+    packet.dst_ip.family = 4;
+    memcpy(packet.src_ip.bytes, &ip_header[12], 4);
+    memcpy(packet.dst_ip.bytes, &ip_header[16], 4);
+    feature.src_address = formatAddress(packet.src_ip, arena);
+    feature.dst_address = formatAddress(packet.dst_ip, arena);
+    packet.l4_protocol = feature.protocol;
 
     int header_length = feature.ihl * 4;
+    packet.l4_offset = static_cast<uint16_t>(header_length >= IPV4_MIN_HEADER_SIZE ? header_length : 0);
     if (header_length > IPV4_MIN_HEADER_SIZE && header_length <= remaining_size)
     {
-        int options_length = header_length - IPV4_MIN_HEADER_SIZE;
-        feature.options.resize(options_length);
-        memcpy(feature.options.data(), &ip_header[IPV4_MIN_HEADER_SIZE], options_length);
+        size_t options_length = static_cast<size_t>(header_length - IPV4_MIN_HEADER_SIZE);
+        feature.options = ByteView(arena.copyBytes(&ip_header[IPV4_MIN_HEADER_SIZE], options_length), options_length);
+    }
+
+    FragmentFeature &fragment = packet.fragment;
+    fragment.more_fragments = (feature.flags & 0x01) != 0;
+    fragment.is_fragment = fragment.more_fragments || feature.fragment_offset != 0;
+    fragment.identification = feature.identification;
+    fragment.offset_bytes = static_cast<uint32_t>(feature.fragment_offset) * 8;
+    fragment.payload_bytes = feature.total_length > header_length ? feature.total_length - header_length : 0;
+
+    // Only the first fragment carries the transport header
+    if (feature.fragment_offset == 0 && header_length >= IPV4_MIN_HEADER_SIZE && header_length < remaining_size)
+    {
+        parseTransport(feature.protocol, &ip_header[header_length], remaining_size - header_length, packet.transport);
     }
 
-    return feature;
+    return true;
 }
 
-optional<IPv6PacketFeature> PacketParser::parseIPv6(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp)
+bool PacketParser::parseIPv6(const uint8_t *ip_header, int remaining_size, chrono::system_clock::time_point timestamp,
+                             Arena &arena, PacketFeature &packet)
 {
     if (remaining_size < IPV6_HEADER_SIZE)
     {
-        return nullopt;
+        return false;
     }
 
-    IPv6PacketFeature feature;
+    IPv6PacketFeature &feature = packet.ipv6;
     feature.timestamp = timestamp;
 
     uint32_t version_tc_fl = ntohl(*reinterpret_cast<const uint32_t *>(ip_header));
@@ -121,152 +332,250 @@ optional<IPv6PacketFeature> PacketParser::parseIPv6(const uint8_t *ip_header, in
     feature.next_header = ip_header[6];
     feature.hop_limit = ip_header[7];
 
-    feature.src_address = ipv6ToString(&ip_header[8]);
-    feature.dst_address = ipv6ToString(&ip_header[24]);
-
-    uint8_t final_protocol = feature.next_header;
-
-    if (remaining_size > IPV6_HEADER_SIZE)
+    packet.src_ip.family = 6;
+    packet.dst_ip.family = 6;
+    memcpy(packet.src_ip.bytes, &ip_header[8], 16);
+    memcpy(packet.dst_ip.bytes, &ip_header[24], 16);
+    feature.src_address = formatAddress(packet.src_ip, arena);
+    feature.dst_address = formatAddress(packet.dst_ip, arena);
+
+    IPv6ExtensionChain &chain = feature.extensions;
+    walkIPv6ExtensionHeaders(&ip_header[IPV6_HEADER_SIZE], remaining_size - IPV6_HEADER_SIZE, feature.next_header,
+                             chain, packet.fragment);
+    if (chain.count > 0)
     {
-        string ext_headers = parseIPv6ExtensionHeaders(&ip_header[IPV6_HEADER_SIZE],
-                                                       remaining_size - IPV6_HEADER_SIZE,
-                                                       final_protocol);
-        if (!ext_headers.empty())
-        {
-            feature.extension_headers.push_back(ext_headers);
-        }
+        char text[IPV6_EXTENSION_TEXT_MAX];
+        feature.extension_headers = arena.copyString(text, formatIPv6ExtensionChain(chain, text));
     }
+    uint8_t final_protocol = chain.final_protocol;
+    int ext_bytes = chain.l4_offset;
 
     feature.protocol_name = getProtocolName(final_protocol);
+    packet.l4_protocol = final_protocol;
+    packet.l4_offset = static_cast<uint16_t>(IPV6_HEADER_SIZE + ext_bytes);
 
-    return feature;
-}
+    if (packet.fragment.is_fragment)
+    {
+        packet.fragment.payload_bytes = feature.payload_length > ext_bytes ? feature.payload_length - ext_bytes : 0;
+    }
 
-string PacketParser::ipv4ToString(uint32_t ip)
-{
-    struct in_addr addr;
-    addr.s_addr = ip;
-    return string(inet_ntoa(addr));
+    int l4_offset = IPV6_HEADER_SIZE + ext_bytes;
+    if (packet.fragment.offset_bytes == 0 && l4_offset < remaining_size)
+    {
+        parseTransport(final_protocol, &ip_header[l4_offset], remaining_size - l4_offset, packet.transport);
+    }
+
+    return true;
 }
 
-string PacketParser::ipv6ToString(const uint8_t *ip)
+void PacketParser::extractPayload(const uint8_t *ip_header, int remaining_size, Arena &arena, PacketFeature &packet)
 {
-    char str[INET6_ADDRSTRLEN];
-    struct in6_addr addr;
-    memcpy(&addr, ip, 16);
+    // The IP length bounds the payload, so Ethernet padding is not counted
+    int end = remaining_size;
+    if (packet.type == PacketFeature::Type::IPv4)
+    {
+        if (packet.ipv4.total_length >= packet.l4_offset && packet.ipv4.total_length < end)
+            end = packet.ipv4.total_length;
+    }
+    else if (packet.ipv6.payload_length != 0 && IPV6_HEADER_SIZE + packet.ipv6.payload_length < end)
+    {
+        end = IPV6_HEADER_SIZE + packet.ipv6.payload_length;
+    }
 
-#ifdef _WIN32
-    if (inet_ntop(AF_INET6, &addr, str, INET6_ADDRSTRLEN) != nullptr)
+    int start = packet.l4_offset;
+    if (start == 0)
     {
-        return string(str);
+        return;
     }
-#else
-    if (inet_ntop(AF_INET6, &addr, str, INET6_ADDRSTRLEN) != nullptr)
+    // Non-first fragments carry no transport header
+    if (packet.fragment.offset_bytes == 0 && start < end)
     {
-        return string(str);
+        const uint8_t *l4 = &ip_header[start];
+        switch (packet.l4_protocol)
+        {
+        case 6: // TCP: data offset, when the header is captured
+            start = end - start >= 13 && (l4[12] >> 4) >= 5 ? start + (l4[12] >> 4) * 4 : end;
+            break;
+        case 17:  // UDP
+        case 1:   // ICMP
+        case 58:  // ICMPv6
+            start += 8;
+            break;
+        case 132: // SCTP common header; chunks count as payload
+            start += 12;
+            break;
+        default:
+            break;
+        }
     }
-#endif
 
-    ostringstream oss;
-    for (int i = 0; i < 16; i += 2)
+    PayloadFeature &payload = packet.payload;
+    size_t length = start < end ? static_cast<size_t>(end - start) : 0;
+    uint32_t counts[256] = {0};
+    if (length > 0)
+    {
+        payload_kernels_->count_bytes(&ip_header[start], length, counts);
+    }
+    summarisePayload(counts, length, payload);
+    size_t head = length < payload_head_bytes_ ? length : payload_head_bytes_;
+    if (head > 0)
     {
-        if (i > 0)
-            oss << ":";
-        oss << hex << setfill('0') << setw(4)
-            << (static_cast<uint16_t>(ip[i]) << 8 | ip[i + 1]);
+        payload.head = ByteView(arena.copyBytes(&ip_header[start], head), head);
     }
-    return oss.str();
 }
 
-string PacketParser::bytesToHex(const uint8_t *data, size_t length)
+void PacketParser::parseTransport(uint8_t protocol, const uint8_t *data, int remaining_size, TransportFeature &transport)
 {
-    ostringstream oss;
-    for (size_t i = 0; i < length; ++i)
+    switch (protocol)
     {
-        oss << hex << setfill('0') << setw(2) << static_cast<unsigned>(data[i]);
+    case 6:   // TCP
+    case 17:  // UDP
+    case 132: // SCTP
+        if (remaining_size < 4)
+        {
+            return;
+        }
+        transport.present = true;
+        transport.src_port = ntohs(*reinterpret_cast<const uint16_t *>(&data[0]));
+        transport.dst_port = ntohs(*reinterpret_cast<const uint16_t *>(&data[2]));
+        if (protocol == 6 && remaining_size >= 14)
+        {
+            transport.tcp_flags = data[13];
+        }
+        break;
+    default:
+        break;
     }
-    return oss.str();
 }
 
-string PacketParser::parseIPv6ExtensionHeaders(const uint8_t *data, int remaining_size, uint8_t &next_header)
+bool PacketParser::locateInnerPacket(uint8_t outer_version, uint8_t protocol, const TransportFeature &transport,
+                                     const uint8_t *payload, int payload_size, InnerPacket &inner)
 {
-    ostringstream oss;
-    int offset = 0;
+    const uint8_t *data = payload;
+    int size = payload_size;
+    switch (protocol)
+    {
+    case 4:  // IPv4 encapsulation
+    case 41: // IPv6 encapsulation
+        if (size < 1 || (data[0] >> 4) != (protocol == 4 ? 4 : 6))
+            return false;
+        inner.type = protocol == 41 && outer_version == 4 ? TunnelFeature::Type::SIX_IN_FOUR : TunnelFeature::Type::IPIP;
+        break;
+
+    case 47: // GRE (RFC 2784/2890); version 1 is PPTP and carries PPP
+    {
+        if (size < 4)
+            return false;
+        uint16_t flags = loadBE16(&data[0]);
+        if ((flags & 0x0007) != 0 || (flags & 0x4000) != 0)
+            return false;
+        int header = 4;
+        if (flags & 0x8000) // checksum present
+            header += 4;
+        if (flags & 0x2000) // key present
+        {
+            if (size < header + 4)
+                return false;
+            inner.id = loadBE32(&data[header]);
+            inner.has_id = true;
+            header += 4;
+        }
+        if (flags & 0x1000) // sequence number present
+            header += 4;
+        if (size < header)
+            return false;
+        uint16_t ethertype = loadBE16(&data[2]);
+        data += header;
+        size -= header;
+        if (!skipToIP(ethertype, data, size))
+            return false;
+        inner.type = TunnelFeature::Type::GRE;
+        break;
+    }
 
-    while (offset < remaining_size)
+    case 17: // UDP: VXLAN and GENEVE on their IANA ports
     {
-        switch (next_header)
+        if (!transport.present || size < 16)
+            return false;
+        data += 8;
+        size -= 8;
+        if (transport.dst_port == VXLAN_PORT)
         {
-        case 0:  // Hop-by-Hop Options
-        case 6:  // TCP
-        case 17: // UDP
-        case 58: // ICMPv6
-            return oss.str();
-
-        case 43: // Routing Header
-        case 44: // Fragment Header
-        case 60: // Destination Options
+            if ((data[0] & 0x08) == 0) // VNI flag
+                return false;
+            inner.id = loadBE32(&data[4]) >> 8;
+            inner.has_id = true;
+            data += 8;
+            size -= 8;
+            if (!skipEthernet(data, size))
+                return false;
+            inner.type = TunnelFeature::Type::VXLAN;
+        }
+        else if (transport.dst_port == GENEVE_PORT)
         {
-            if (offset + 2 > remaining_size)
-            {
-                return oss.str();
-            }
-
-            if (!oss.str().empty())
-                oss << ",";
-            oss << "Header" << static_cast<int>(next_header);
-
-            if (next_header == 44)
-            {
-                next_header = data[offset];
-                offset += 8;
-            }
-            else
-            {
-                next_header = data[offset];
-                uint8_t length = data[offset + 1];
-                offset += 8 + length * 8;
-            }
-            break;
+            if ((data[0] >> 6) != 0) // version
+                return false;
+            int header = 8 + (data[0] & 0x3F) * 4;
+            if (size < header)
+                return false;
+            uint16_t ethertype = loadBE16(&data[2]);
+            inner.id = loadBE32(&data[4]) >> 8;
+            inner.has_id = true;
+            data += header;
+            size -= header;
+            if (!skipToIP(ethertype, data, size))
+                return false;
+            inner.type = TunnelFeature::Type::GENEVE;
         }
-        default:
-            return oss.str();
+        else
+        {
+            return false;
         }
+        break;
+    }
 
-        if (offset >= remaining_size)
-            break;
+    default:
+        return false;
     }
 
-    return oss.str();
+    inner.data = data;
+    inner.size = size;
+    return true;
 }
 
-string PacketParser::getProtocolName(uint8_t protocol_number)
+string_view PacketParser::formatAddress(const IpAddress &address, Arena &arena) const
 {
-    switch (protocol_number)
-    {
-    case 1:
-        return "ICMP";
-    case 2:
-        return "IGMP";
-    case 6:
-        return "TCP";
-    case 17:
-        return "UDP";
-    case 41:
-        return "IPv6";
-    case 47:
-        return "GRE";
-    case 50:
-        return "ESP";
-    case 51:
-        return "AH";
-    case 58:
-        return "ICMPv6";
-    case 89:
-        return "OSPF";
-    case 132:
-        return "SCTP";
-    default:
-        return "PROTO_" + to_string(protocol_number);
+    if (!address_text_)
+    {
+        return string_view();
     }
+    char text[AddressCache::MAX_TEXT_LENGTH];
+    size_t length = AddressCache::shared().lookup(address.family, address.bytes, text);
+    return arena.copyString(text, length);
+}
+
+const string &PacketParser::getProtocolName(uint8_t protocol_number)
+{
+    // Built once so rows can point at the names instead of copying them
+    static const vector<string> names = []()
+    {
+        vector<string> table(256);
+        for (int i = 0; i < 256; ++i)
+        {
+            table[i] = "PROTO_" + to_string(i);
+        }
+        table[1] = "ICMP";
+        table[2] = "IGMP";
+        table[6] = "TCP";
+        table[17] = "UDP";
+        table[41] = "IPv6";
+        table[47] = "GRE";
+        table[50] = "ESP";
+        table[51] = "AH";
+        table[58] = "ICMPv6";
+        table[89] = "OSPF";
+        table[132] = "SCTP";
+        return table;
+    }();
+    return names[protocol_number];
 }
@@ -0,0 +1,364 @@
+#include "PacketRing.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+namespace
+{
+    const size_t WRITE_BUFFER_BYTES = 1u << 20;
+    const uint32_t PCAPNG_SHB = 0x0A0D0D0A;
+    const uint32_t PCAPNG_IDB = 0x00000001;
+    const uint32_t PCAPNG_EPB = 0x00000006;
+    const uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+    const uint16_t OPT_ENDOFOPT = 0;
+    const uint16_t OPT_COMMENT = 1;
+    const uint16_t SHB_USERAPPL = 4;
+
+    inline size_t align8(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+
+    inline size_t pad4(size_t size)
+    {
+        return (size + 3) & ~static_cast<size_t>(3);
+    }
+
+    // pcapng blocks are written in host byte order; readers detect it from
+    // the section header's byte-order magic
+    template <typename T>
+    void put(std::string &out, T value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void putPadded(std::string &out, const void *data, size_t size)
+    {
+        out.append(static_cast<const char *>(data), size);
+        out.append(pad4(size) - size, '\0');
+    }
+
+    void putOption(std::string &out, uint16_t code, const std::string &value)
+    {
+        put<uint16_t>(out, code);
+        put<uint16_t>(out, static_cast<uint16_t>(value.size()));
+        putPadded(out, value.data(), value.size());
+    }
+
+    void appendSectionHeader(std::string &out, const std::string &comment)
+    {
+        std::string options;
+        putOption(options, OPT_COMMENT, comment.substr(0, 0xFFFF));
+        putOption(options, SHB_USERAPPL, "NetworkPacketAnalyzer");
+        put<uint16_t>(options, OPT_ENDOFOPT);
+        put<uint16_t>(options, 0);
+
+        uint32_t length = static_cast<uint32_t>(28 + options.size());
+        put<uint32_t>(out, PCAPNG_SHB);
+        put<uint32_t>(out, length);
+        put<uint32_t>(out, PCAPNG_BYTE_ORDER_MAGIC);
+        put<uint16_t>(out, 1); // version 1.0
+        put<uint16_t>(out, 0);
+        put<int64_t>(out, -1); // section length not given
+        out += options;
+        put<uint32_t>(out, length);
+    }
+
+    void appendInterface(std::string &out, int link_type, uint32_t snapshot_length)
+    {
+        // Timestamps are in microseconds, the pcapng default resolution
+        put<uint32_t>(out, PCAPNG_IDB);
+        put<uint32_t>(out, 20);
+        put<uint16_t>(out, static_cast<uint16_t>(link_type));
+        put<uint16_t>(out, 0);
+        put<uint32_t>(out, snapshot_length);
+        put<uint32_t>(out, 20);
+    }
+
+    std::string formatUtcStamp(std::chrono::system_clock::time_point now)
+    {
+        std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+        char text[32];
+        size_t length = std::strftime(text, sizeof(text), "%Y%m%d-%H%M%S", std::gmtime(&seconds));
+        return std::string(text, length);
+    }
+}
+
+PacketRing::PacketRing(const Config &config)
+    : config_(config), capacity_(align8(config.memory_bytes)), head_(0), tail_(0), newest_us_(INT64_MIN),
+      dump_active_(false), dump_read_(0), dump_end_(0), dump_sequence_(0), running_(false), dump_pending_(false),
+      packets_stored_(0), packets_skipped_(0), dumps_written_(0), dumps_refused_(0), packets_dumped_(0)
+{
+}
+
+PacketRing::~PacketRing()
+{
+    stop();
+}
+
+bool PacketRing::start()
+{
+    if (capacity_ < sizeof(RecordHeader) * 2)
+    {
+        last_error_ = "Packet ring memory too small";
+        return false;
+    }
+    buffer_.reset(new (std::nothrow) uint8_t[capacity_]);
+    if (!buffer_)
+    {
+        last_error_ = "Failed to allocate " + std::to_string(capacity_ >> 20) + " MiB for the packet ring";
+        return false;
+    }
+    // Fault the pages in now rather than on the capture thread
+    std::memset(buffer_.get(), 0, capacity_);
+
+    running_ = true;
+    writer_ = std::thread(&PacketRing::writerLoop, this);
+    std::cout << "Packet ring: last " << config_.retention_seconds << " s, up to " << (capacity_ >> 20)
+              << " MiB, dumps to " << config_.path_prefix << "-*.pcapng" << std::endl;
+    return true;
+}
+
+void PacketRing::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake_.notify_one();
+    if (writer_.joinable())
+    {
+        writer_.join();
+    }
+}
+
+const PacketRing::RecordHeader *PacketRing::recordAt(uint64_t &position) const
+{
+    size_t offset = static_cast<size_t>(position % capacity_);
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(buffer_.get() + offset);
+    if (capacity_ - offset < sizeof(RecordHeader) || record->caplen == WRAP_MARKER)
+    {
+        position += capacity_ - offset;
+        record = reinterpret_cast<const RecordHeader *>(buffer_.get());
+    }
+    return record;
+}
+
+bool PacketRing::evictOldest()
+{
+    if (tail_ == head_)
+    {
+        return false;
+    }
+    if (dump_active_.load(std::memory_order_acquire) && tail_ >= dump_read_.load(std::memory_order_acquire))
+    {
+        return false; // not yet written by the dump in progress
+    }
+    uint64_t position = tail_;
+    const RecordHeader *record = recordAt(position);
+    tail_ = position + align8(sizeof(RecordHeader) + record->caplen);
+    return true;
+}
+
+void PacketRing::evictExpired(int64_t newest_us)
+{
+    int64_t cutoff = newest_us - static_cast<int64_t>(config_.retention_seconds) * 1000000;
+    while (tail_ != head_)
+    {
+        uint64_t position = tail_;
+        if (recordAt(position)->timestamp_us >= cutoff || !evictOldest())
+        {
+            break;
+        }
+    }
+}
+
+void PacketRing::push(const struct pcap_pkthdr *header, const uint8_t *data)
+{
+    size_t size = align8(sizeof(RecordHeader) + header->caplen);
+    if (!buffer_ || size > capacity_ / 2)
+    {
+        packets_skipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int64_t timestamp_us = static_cast<int64_t>(header->ts.tv_sec) * 1000000 + header->ts.tv_usec;
+    if (timestamp_us > newest_us_)
+    {
+        newest_us_ = timestamp_us;
+        evictExpired(newest_us_);
+    }
+
+    // A record never straddles the end of the buffer; the rest of the lap
+    // is skipped instead
+    size_t offset = static_cast<size_t>(head_ % capacity_);
+    size_t to_end = capacity_ - offset;
+    size_t needed = size <= to_end ? size : to_end + size;
+    while (capacity_ - (head_ - tail_) < needed)
+    {
+        if (!evictOldest())
+        {
+            packets_skipped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    if (size > to_end)
+    {
+        if (to_end >= sizeof(RecordHeader))
+        {
+            reinterpret_cast<RecordHeader *>(buffer_.get() + offset)->caplen = WRAP_MARKER;
+        }
+        head_ += to_end;
+        offset = 0;
+    }
+
+    RecordHeader *record = reinterpret_cast<RecordHeader *>(buffer_.get() + offset);
+    record->timestamp_us = timestamp_us;
+    record->caplen = header->caplen;
+    record->wire_length = header->len;
+    std::memcpy(record + 1, data, header->caplen);
+    head_ += size;
+    packets_stored_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool PacketRing::triggerDump(const std::string &reason)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_ || dump_pending_ || dump_active_.load(std::memory_order_acquire))
+    {
+        dumps_refused_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (newest_us_ != INT64_MIN)
+    {
+        evictExpired(newest_us_);
+    }
+
+    dump_read_.store(tail_, std::memory_order_release);
+    dump_end_ = head_;
+    dump_active_.store(true, std::memory_order_release);
+    dump_path_ = config_.path_prefix + "-" + formatUtcStamp(std::chrono::system_clock::now()) + "-" +
+                 std::to_string(++dump_sequence_) + ".pcapng";
+    dump_reason_ = reason;
+    dump_pending_ = true;
+    wake_.notify_one();
+    return true;
+}
+
+void PacketRing::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        wake_.wait(lock, [this]()
+                   { return dump_pending_ || !running_; });
+        if (!dump_pending_)
+        {
+            break;
+        }
+
+        uint64_t start = dump_read_.load(std::memory_order_acquire);
+        uint64_t end = dump_end_;
+        std::string path = dump_path_;
+        std::string reason = dump_reason_;
+        lock.unlock();
+        bool ok = writeDump(start, end, path, reason);
+        lock.lock();
+
+        dump_pending_ = false;
+        dump_active_.store(false, std::memory_order_release);
+        if (ok)
+        {
+            last_dump_path_ = path;
+            dumps_written_.fetch_add(1, std::memory_order_relaxed);
+            std::cout << "Packet ring dumped to " << path << " (" << reason << ")" << std::endl;
+        }
+        else
+        {
+            std::cerr << "Error: " << last_error_ << std::endl;
+        }
+    }
+}
+
+bool PacketRing::writeDump(uint64_t start, uint64_t end, const std::string &path, const std::string &reason)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_error_ = "Failed to open packet ring dump " + path;
+        return false;
+    }
+
+    std::string block;
+    block.reserve(WRITE_BUFFER_BYTES + config_.snapshot_length + 64);
+    appendSectionHeader(block, "trigger: " + reason);
+    appendInterface(block, config_.link_type, config_.snapshot_length);
+
+    uint64_t position = start;
+    while (position < end)
+    {
+        const RecordHeader *record = recordAt(position);
+        if (position >= end)
+        {
+            break;
+        }
+        uint64_t timestamp = static_cast<uint64_t>(record->timestamp_us);
+        uint32_t length = static_cast<uint32_t>(32 + pad4(record->caplen));
+        put<uint32_t>(block, PCAPNG_EPB);
+        put<uint32_t>(block, length);
+        put<uint32_t>(block, 0); // interface
+        put<uint32_t>(block, static_cast<uint32_t>(timestamp >> 32));
+        put<uint32_t>(block, static_cast<uint32_t>(timestamp & 0xFFFFFFFF));
+        put<uint32_t>(block, record->caplen);
+        put<uint32_t>(block, record->wire_length);
+        putPadded(block, record + 1, record->caplen);
+        put<uint32_t>(block, length);
+
+        // Copied out: the capture thread may reuse the space
+        position += align8(sizeof(RecordHeader) + record->caplen);
+        dump_read_.store(position, std::memory_order_release);
+        packets_dumped_.fetch_add(1, std::memory_order_relaxed);
+
+        if (block.size() >= WRITE_BUFFER_BYTES)
+        {
+            file.write(block.data(), static_cast<std::streamsize>(block.size()));
+            block.clear();
+        }
+    }
+    file.write(block.data(), static_cast<std::streamsize>(block.size()));
+    file.close();
+    if (!file)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_error_ = "Error writing packet ring dump " + path;
+        return false;
+    }
+    return true;
+}
+
+PacketRing::Stats PacketRing::getStats() const
+{
+    Stats stats;
+    stats.packets_stored = packets_stored_.load();
+    stats.packets_skipped = packets_skipped_.load();
+    stats.dumps_written = dumps_written_.load();
+    stats.dumps_refused = dumps_refused_.load();
+    stats.packets_dumped = packets_dumped_.load();
+    return stats;
+}
+
+std::string PacketRing::getLastDumpPath() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_dump_path_;
+}
+
+std::string PacketRing::getLastError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_error_;
+}
@@ -0,0 +1,223 @@
+#include "PayloadKernels.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PAYLOAD_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Counts below this use the single-table loop in every kernel
+    const size_t SHORT_PAYLOAD = 64;
+    // c * log2(c) for the counts most payloads produce
+    const size_t ENTROPY_TABLE_SIZE = 2048;
+    const size_t CALIBRATION_BYTES = 1460;
+    const int CALIBRATION_ROUNDS = 64;
+
+    // ---------------------------------------------------------------- scalar
+
+    void countBytesScalar(const uint8_t *data, size_t length, uint32_t *counts)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            counts[data[i]]++;
+        }
+    }
+
+    // ---------------------------------------------------------------- split
+    // Four interleaved sub-tables, so runs of the same byte do not serialise
+    // on one counter's store-to-load forwarding. 16-bit counters are enough
+    // for a payload of at most 65535 bytes.
+
+    void countBytesSplit(const uint8_t *data, size_t length, uint32_t *counts)
+    {
+        if (length < SHORT_PAYLOAD)
+        {
+            countBytesScalar(data, length, counts);
+            return;
+        }
+        uint16_t tables[4][256];
+        std::memset(tables, 0, sizeof(tables));
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            tables[0][word & 0xFF]++;
+            tables[1][(word >> 8) & 0xFF]++;
+            tables[2][(word >> 16) & 0xFF]++;
+            tables[3][(word >> 24) & 0xFF]++;
+            tables[0][(word >> 32) & 0xFF]++;
+            tables[1][(word >> 40) & 0xFF]++;
+            tables[2][(word >> 48) & 0xFF]++;
+            tables[3][word >> 56]++;
+        }
+        for (; i < length; ++i)
+        {
+            tables[0][data[i]]++;
+        }
+        for (int value = 0; value < 256; ++value)
+        {
+            counts[value] += static_cast<uint32_t>(tables[0][value]) + tables[1][value] + tables[2][value] + tables[3][value];
+        }
+    }
+
+#ifdef PAYLOAD_KERNELS_X86
+    // ---------------------------------------------------------------- AVX-512
+    // Sixteen bytes per iteration: gather their counters, add one plus the
+    // number of earlier lanes holding the same byte (conflict detection),
+    // and scatter back. Among equal lanes the highest is stored last and
+    // carries the full increment.
+
+    // The unmasked broadcast, widen and gather intrinsics start from an
+    // undefined vector that GCC reports as maybe-uninitialized, so the
+    // masked forms with every lane enabled and a zero source are used.
+    __attribute__((target("avx512f,avx512cd,avx512bw"))) void countBytesAVX512(const uint8_t *data, size_t length, uint32_t *counts)
+    {
+        const __m512i zero = _mm512_setzero_si512();
+        const __m512i nibble_bits = _mm512_mask_broadcast_i32x4(
+            zero, 0xFFFF, _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+        const __m512i low_nibble = _mm512_set1_epi8(0x0F);
+        const __m512i ones8 = _mm512_set1_epi8(1);
+        const __m512i ones16 = _mm512_set1_epi16(1);
+        const __m512i ones32 = _mm512_set1_epi32(1);
+
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16)
+        {
+            __m512i index = _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+            __m512i conflicts = _mm512_conflict_epi32(index);
+            // Popcount of each 32-bit conflict mask: per-byte nibble lookup,
+            // then horizontal byte sums
+            __m512i bits = _mm512_add_epi8(_mm512_shuffle_epi8(nibble_bits, _mm512_and_si512(conflicts, low_nibble)),
+                                           _mm512_shuffle_epi8(nibble_bits, _mm512_and_si512(_mm512_srli_epi16(conflicts, 4), low_nibble)));
+            __m512i earlier = _mm512_madd_epi16(_mm512_maddubs_epi16(bits, ones8), ones16);
+            __m512i values = _mm512_mask_i32gather_epi32(zero, 0xFFFF, index, counts, 4);
+            values = _mm512_add_epi32(values, _mm512_add_epi32(earlier, ones32));
+            _mm512_i32scatter_epi32(counts, index, values, 4);
+        }
+        countBytesScalar(data + i, length - i, counts);
+    }
+#endif
+
+    const PayloadKernels SCALAR_KERNELS = {"scalar", countBytesScalar};
+    const PayloadKernels SPLIT_KERNELS = {"split", countBytesSplit};
+#ifdef PAYLOAD_KERNELS_X86
+    const PayloadKernels AVX512_KERNELS = {"avx512", countBytesAVX512};
+#endif
+
+    const PayloadKernels *calibrate()
+    {
+        std::vector<const PayloadKernels *> kernels = getAvailablePayloadKernels();
+        // A third each of zeros, text and random bytes: runs of one value
+        // are the worst case for a single counter table
+        uint8_t payload[CALIBRATION_BYTES];
+        uint32_t state = 0x2545F491;
+        for (size_t i = 0; i < CALIBRATION_BYTES; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            size_t third = i * 3 / CALIBRATION_BYTES;
+            payload[i] = third == 0 ? 0 : third == 1 ? static_cast<uint8_t>('a' + (state >> 24) % 26) : static_cast<uint8_t>(state >> 24);
+        }
+
+        const PayloadKernels *best = kernels.front();
+        double best_ns = 0;
+        for (const PayloadKernels *kernel : kernels)
+        {
+            uint32_t counts[256];
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < CALIBRATION_ROUNDS; ++round)
+            {
+                std::memset(counts, 0, sizeof(counts));
+                kernel->count_bytes(payload, CALIBRATION_BYTES, counts);
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (kernel == kernels.front() || ns < best_ns)
+            {
+                best = kernel;
+                best_ns = ns;
+            }
+        }
+        return best;
+    }
+
+    struct EntropyTable
+    {
+        float values[ENTROPY_TABLE_SIZE];
+
+        EntropyTable()
+        {
+            values[0] = 0;
+            for (size_t count = 1; count < ENTROPY_TABLE_SIZE; ++count)
+            {
+                values[count] = static_cast<float>(count * std::log2(static_cast<double>(count)));
+            }
+        }
+    };
+
+    inline double countLog2Count(uint32_t count)
+    {
+        static const EntropyTable table;
+        return count < ENTROPY_TABLE_SIZE ? table.values[count] : count * std::log2(static_cast<double>(count));
+    }
+}
+
+std::vector<const PayloadKernels *> getAvailablePayloadKernels()
+{
+    std::vector<const PayloadKernels *> kernels;
+    kernels.push_back(&SCALAR_KERNELS);
+    kernels.push_back(&SPLIT_KERNELS);
+#ifdef PAYLOAD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512bw"))
+        kernels.push_back(&AVX512_KERNELS);
+#endif
+    return kernels;
+}
+
+const PayloadKernels &getPayloadKernels()
+{
+    static const PayloadKernels *selected = calibrate();
+    return *selected;
+}
+
+void summarisePayload(const uint32_t *counts, size_t length, PayloadFeature &feature)
+{
+    feature.present = true;
+    feature.length = static_cast<uint16_t>(length);
+    for (int bucket = 0; bucket < PayloadFeature::BUCKETS; ++bucket)
+    {
+        uint32_t total = 0;
+        for (int value = bucket * 16; value < bucket * 16 + 16; ++value)
+        {
+            total += counts[value];
+        }
+        feature.buckets[bucket] = static_cast<uint16_t>(total);
+    }
+    if (length == 0)
+    {
+        feature.entropy = 0;
+        feature.printable_ratio = 0;
+        return;
+    }
+
+    uint32_t printable = counts['\t'] + counts['\n'] + counts['\r'];
+    for (int value = 0x20; value <= 0x7E; ++value)
+    {
+        printable += counts[value];
+    }
+
+    // H = log2(n) - sum(c * log2(c)) / n
+    double sum = 0;
+    for (int value = 0; value < 256; ++value)
+    {
+        sum += countLog2Count(counts[value]);
+    }
+    double n = static_cast<double>(length);
+    double entropy = std::log2(n) - sum / n;
+    feature.entropy = static_cast<float>(entropy > 0 ? entropy : 0);
+    feature.printable_ratio = static_cast<float>(printable / n);
+}
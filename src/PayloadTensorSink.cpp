@@ -0,0 +1,112 @@
+#include "PayloadTensorSink.h"
+#include "PacketParser.h"
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+    // Magic, version 1.0, u16 header length, then a padded dict sized for
+    // any row count, so the final shape fits in place
+    const char NPY_MAGIC[] = "\x93NUMPY\x01\x00";
+    const size_t NPY_PREAMBLE_BYTES = 10;
+    const size_t NPY_HEADER_BYTES = 128;
+}
+
+PayloadTensorSink::PayloadTensorSink(const std::string &filename, size_t head_bytes)
+    : filename_(filename),
+      head_bytes_(head_bytes == 0 ? DEFAULT_HEAD_BYTES
+                                  : (head_bytes > PacketParser::MAX_PAYLOAD_HEAD_BYTES ? PacketParser::MAX_PAYLOAD_HEAD_BYTES : head_bytes)),
+      rows_(0)
+{
+}
+
+PayloadTensorSink::~PayloadTensorSink()
+{
+    close();
+}
+
+std::string PayloadTensorSink::buildHeader() const
+{
+    std::string dict = "{'descr': '|u1', 'fortran_order': False, 'shape': (" + std::to_string(rows_) + ", " +
+                       std::to_string(head_bytes_) + "), }";
+    std::string header(NPY_MAGIC, NPY_PREAMBLE_BYTES - 2);
+    uint16_t length = static_cast<uint16_t>(NPY_HEADER_BYTES - NPY_PREAMBLE_BYTES);
+    header += static_cast<char>(length & 0xFF);
+    header += static_cast<char>(length >> 8);
+    header += dict;
+    header.append(NPY_HEADER_BYTES - 1 - header.size(), ' ');
+    header += '\n';
+    return header;
+}
+
+bool PayloadTensorSink::open()
+{
+    file_.open(filename_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!file_.is_open())
+    {
+        last_error_ = "Failed to open file: " + filename_;
+        return false;
+    }
+    std::string header = buildHeader();
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    std::cout << "Initialized new payload tensor file: " << filename_ << " (" << head_bytes_ << " bytes per row)" << std::endl;
+    return true;
+}
+
+bool PayloadTensorSink::consume(const PacketBatch &batch)
+{
+    if (!file_.is_open())
+    {
+        last_error_ = "Writer not initialized or file not open";
+        return false;
+    }
+
+    block_.assign(batch.packets.size() * head_bytes_, '\0');
+    char *row = &block_[0];
+    for (const auto &record : batch.packets)
+    {
+        const ByteView &head = record.feature.payload.head;
+        size_t length = head.size < head_bytes_ ? head.size : head_bytes_;
+        if (length > 0)
+        {
+            std::memcpy(row, head.data, length);
+        }
+        row += head_bytes_;
+    }
+    file_.write(block_.data(), static_cast<std::streamsize>(block_.size()));
+    rows_ += batch.packets.size();
+    if (!file_)
+    {
+        last_error_ = "Error writing payload rows to " + filename_;
+        return false;
+    }
+    return true;
+}
+
+void PayloadTensorSink::close()
+{
+    if (file_.is_open())
+    {
+        std::string header = buildHeader();
+        file_.seekp(0);
+        file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        file_.close();
+        std::cout << "Closed payload tensor file" << std::endl;
+    }
+}
+
+std::string PayloadTensorSink::getName() const
+{
+    return "npy:" + filename_;
+}
+
+std::string PayloadTensorSink::getLastError() const
+{
+    return last_error_;
+}
+
+std::string PayloadTensorSink::getSummary() const
+{
+    return getName() + ": " + std::to_string(rows_) + " rows of " + std::to_string(head_bytes_) + " payload bytes";
+}
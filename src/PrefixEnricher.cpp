@@ -0,0 +1,233 @@
+#include "PrefixEnricher.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+
+static_assert(PrefixTable::KINDS == EnrichmentFeature::KINDS, "one enrichment column pair per prefix list kind");
+
+const int PrefixEnricher::RELOAD_CHECK_SECONDS;
+
+bool PrefixEnricher::parseSpec(const std::string &spec, std::vector<PrefixSource> &sources, std::string &error)
+{
+    std::istringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        size_t equals = item.find('=');
+        if (equals == std::string::npos || equals + 1 == item.size())
+        {
+            error = "Expected <kind>=<file> in '" + item + "'";
+            return false;
+        }
+        std::string kind = item.substr(0, equals);
+        PrefixSource source;
+        source.kind = -1;
+        for (int i = 0; i < PrefixTable::KINDS; ++i)
+        {
+            if (kind == PrefixTable::KIND_NAMES[i])
+            {
+                source.kind = i;
+            }
+        }
+        if (source.kind < 0)
+        {
+            error = "Unknown prefix list kind '" + kind + "' (expected asn, subnet or geo)";
+            return false;
+        }
+        source.path = item.substr(equals + 1);
+        sources.push_back(source);
+    }
+    if (sources.empty())
+    {
+        error = "No prefix lists given";
+        return false;
+    }
+    return true;
+}
+
+PrefixEnricher::PrefixEnricher(const std::vector<PrefixSource> &sources)
+    : sources_(sources), table_generation_(0), rows_(0), addresses_matched_(0), stop_(false), generation_(0),
+      reloads_(0), reload_failures_(0)
+{
+}
+
+PrefixEnricher::~PrefixEnricher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (watcher_.joinable())
+    {
+        watcher_.join();
+    }
+}
+
+std::shared_ptr<const PrefixTable> PrefixEnricher::load(std::string &error) const
+{
+    auto table = std::make_shared<PrefixTable>();
+    for (const auto &source : sources_)
+    {
+        if (!table->loadFile(source.kind, source.path))
+        {
+            error = table->getLastError();
+            return nullptr;
+        }
+    }
+    if (!table->build())
+    {
+        error = table->getLastError();
+        return nullptr;
+    }
+    return table;
+}
+
+bool PrefixEnricher::checkModified()
+{
+    bool changed = false;
+    modified_.resize(sources_.size());
+    for (size_t i = 0; i < sources_.size(); ++i)
+    {
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(sources_[i].path, error);
+        // A file missing for a moment (being replaced) counts as unchanged
+        if (!error && modified != modified_[i])
+        {
+            modified_[i] = modified;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool PrefixEnricher::start()
+{
+    // Times taken before reading, so an edit during the load is seen later
+    checkModified();
+    table_ = load(last_error_);
+    if (!table_)
+    {
+        return false;
+    }
+    published_ = table_;
+    generation_.store(1, std::memory_order_release);
+    table_generation_ = 1;
+
+    std::cout << "Enrichment: " << table_->getPrefixCount(4) << " IPv4 and " << table_->getPrefixCount(6)
+              << " IPv6 prefixes from " << sources_.size() << " lists (" << (table_->getMemoryBytes() >> 20)
+              << " MiB), reloaded when changed" << std::endl;
+    watcher_ = std::thread(&PrefixEnricher::watchLoop, this);
+    return true;
+}
+
+void PrefixEnricher::watchLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_)
+    {
+        wake_.wait_for(lock, std::chrono::seconds(RELOAD_CHECK_SECONDS), [this]()
+                       { return stop_; });
+        if (stop_)
+        {
+            break;
+        }
+        std::shared_ptr<const PrefixTable> retired = std::move(retired_);
+        lock.unlock();
+
+        retired.reset();
+        std::string error;
+        bool changed = checkModified();
+        std::shared_ptr<const PrefixTable> table = changed ? load(error) : nullptr;
+
+        lock.lock();
+        if (!changed)
+        {
+            continue;
+        }
+        if (table)
+        {
+            published_ = table;
+            reloads_++;
+            generation_.fetch_add(1, std::memory_order_release);
+            std::cout << "Reloaded prefix lists: " << table->getPrefixCount(4) << " IPv4 and " << table->getPrefixCount(6)
+                      << " IPv6 prefixes" << std::endl;
+        }
+        else
+        {
+            reload_failures_++;
+            std::cerr << "Prefix list reload failed, keeping the previous tables: " << error << std::endl;
+        }
+    }
+}
+
+void PrefixEnricher::process(PacketRecord &record, Arena &arena)
+{
+    if (generation_.load(std::memory_order_acquire) != table_generation_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_ = std::move(table_);
+        table_ = published_;
+        table_generation_ = generation_.load(std::memory_order_relaxed);
+    }
+
+    const PrefixTable &table = *table_;
+    PacketFeature &feature = record.feature;
+    EnrichmentFeature &enrichment = feature.enrichment;
+    uint32_t src_leaf = table.lookup(feature.src_ip);
+    uint32_t dst_leaf = table.lookup(feature.dst_ip);
+    enrichment.present = true;
+    rows_++;
+    addresses_matched_ += (src_leaf != 0) + (dst_leaf != 0);
+    if ((src_leaf | dst_leaf) == 0)
+    {
+        return;
+    }
+    for (int kind = 0; kind < EnrichmentFeature::KINDS; ++kind)
+    {
+        std::string_view src = table.getLabel(src_leaf, kind);
+        std::string_view dst = table.getLabel(dst_leaf, kind);
+        if (!src.empty())
+            enrichment.src[kind] = arena.copyString(src.data(), src.size());
+        if (!dst.empty())
+            enrichment.dst[kind] = arena.copyString(dst.data(), dst.size());
+    }
+}
+
+PrefixEnricher::Stats PrefixEnricher::getStats() const
+{
+    Stats stats;
+    stats.rows = rows_;
+    stats.addresses_matched = addresses_matched_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.reloads = reloads_;
+    stats.reload_failures = reload_failures_;
+    return stats;
+}
+
+std::string PrefixEnricher::getSummary() const
+{
+    Stats stats = getStats();
+    std::ostringstream summary;
+    summary << "Enrichment:";
+    for (int kind = 0; kind < PrefixTable::KINDS; ++kind)
+    {
+        if (table_ && table_->hasKind(kind))
+        {
+            summary << " " << PrefixTable::KIND_NAMES[kind];
+        }
+    }
+    summary << "; " << stats.addresses_matched << " of " << stats.rows * 2 << " addresses labelled (" << std::fixed
+            << std::setprecision(1) << (stats.rows > 0 ? 50.0 * stats.addresses_matched / stats.rows : 0.0) << "%), "
+            << stats.reloads << " reloads";
+    if (stats.reload_failures > 0)
+    {
+        summary << ", " << stats.reload_failures << " failed";
+    }
+    return summary.str();
+}
@@ -0,0 +1,272 @@
+#include "PrefixTable.h"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+namespace
+{
+    const size_t TBL24_ENTRIES = 1u << 24;
+    const size_t ROOT6_ENTRIES = 1u << 16;
+
+    std::string trim(const std::string &text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    // "<address>[/<length>]" into a network address with the host bits cleared
+    bool parsePrefix(const std::string &text, IpAddress &network, int &length)
+    {
+        size_t slash = text.find('/');
+        std::string address = text.substr(0, slash);
+        if (inet_pton(AF_INET, address.c_str(), network.bytes) == 1)
+        {
+            network.family = 4;
+            length = 32;
+        }
+        else if (inet_pton(AF_INET6, address.c_str(), network.bytes) == 1)
+        {
+            network.family = 6;
+            length = 128;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (slash != std::string::npos)
+        {
+            std::string digits = text.substr(slash + 1);
+            char *end = nullptr;
+            long value = std::strtol(digits.c_str(), &end, 10);
+            if (digits.empty() || *end != '\0' || value < 0 || value > length)
+            {
+                return false;
+            }
+            length = static_cast<int>(value);
+        }
+        for (int bit = length; bit < (network.family == 4 ? 32 : 128); ++bit)
+        {
+            network.bytes[bit >> 3] &= static_cast<uint8_t>(~(0x80u >> (bit & 7)));
+        }
+        return true;
+    }
+}
+
+const char *const PrefixTable::KIND_NAMES[PrefixTable::KINDS] = {"asn", "subnet", "geo"};
+const uint32_t PrefixTable::POINTER;
+
+PrefixTable::PrefixTable()
+    : tbl24_(nullptr, std::free), prefixes4_(0), prefixes6_(0), kind_prefixes_()
+{
+    labels_.push_back("");
+    label_ids_[""] = 0;
+    leaves_.push_back({});
+    leaf_ids_[leaves_.front()] = 0;
+}
+
+bool PrefixTable::loadFile(int kind, const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        last_error_ = "Cannot open prefix list " + path;
+        return false;
+    }
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        size_t split = line.find_first_of(" \t,");
+        std::string label = split == std::string::npos ? "" : trim(line.substr(split + 1));
+        if (!addPrefix(kind, line.substr(0, split), label))
+        {
+            last_error_ = path + ":" + std::to_string(line_number) + ": " + last_error_;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PrefixTable::addPrefix(int kind, const std::string &prefix, const std::string &label)
+{
+    PendingPrefix pending;
+    int length = 0;
+    if (!parsePrefix(prefix, pending.network, length))
+    {
+        last_error_ = "Invalid prefix '" + prefix + "'";
+        return false;
+    }
+    if (label.empty())
+    {
+        last_error_ = "Missing label for " + prefix;
+        return false;
+    }
+
+    auto found = label_ids_.find(label);
+    if (found == label_ids_.end())
+    {
+        found = label_ids_.emplace(label, static_cast<uint32_t>(labels_.size())).first;
+        labels_.push_back(label);
+    }
+    pending.length = static_cast<uint8_t>(length);
+    pending.kind = static_cast<uint8_t>(kind);
+    pending.label = found->second;
+    pending_.push_back(pending);
+    kind_prefixes_[kind]++;
+    (pending.network.family == 4 ? prefixes4_ : prefixes6_)++;
+    return true;
+}
+
+uint32_t PrefixTable::withLabel(uint32_t leaf, int kind, uint32_t label)
+{
+    std::array<uint32_t, KINDS> labels = leaves_[leaf];
+    labels[kind] = label;
+    auto found = leaf_ids_.find(labels);
+    if (found != leaf_ids_.end())
+    {
+        return found->second;
+    }
+    uint32_t id = static_cast<uint32_t>(leaves_.size());
+    leaves_.push_back(labels);
+    leaf_ids_.emplace(labels, id);
+    return id;
+}
+
+void PrefixTable::paint(uint32_t *entries, size_t count, int kind, uint32_t label)
+{
+    // Ranges are mostly runs of one leaf, so remember the last replacement
+    uint32_t last_old = POINTER;
+    uint32_t last_new = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Shorter prefixes are painted first, so the range holds no pointers
+        if (entries[i] != last_old)
+        {
+            last_old = entries[i];
+            last_new = withLabel(last_old, kind, label);
+        }
+        entries[i] = last_new;
+    }
+}
+
+void PrefixTable::insert4(const PendingPrefix &prefix)
+{
+    const uint8_t *bytes = prefix.network.bytes;
+    uint32_t index = (static_cast<uint32_t>(bytes[0]) << 16) | (bytes[1] << 8) | bytes[2];
+    if (prefix.length <= 24)
+    {
+        paint(tbl24_.get() + index, size_t(1) << (24 - prefix.length), prefix.kind, prefix.label);
+        return;
+    }
+    uint32_t &entry = tbl24_.get()[index];
+    if (!(entry & POINTER))
+    {
+        uint32_t group = static_cast<uint32_t>(tbl8_.size() >> 8);
+        tbl8_.resize(tbl8_.size() + 256, entry);
+        entry = POINTER | group;
+    }
+    uint32_t base = (entry & ~POINTER) << 8;
+    paint(tbl8_.data() + base + bytes[3], size_t(1) << (32 - prefix.length), prefix.kind, prefix.label);
+}
+
+void PrefixTable::insert6(const PendingPrefix &prefix)
+{
+    const uint8_t *bytes = prefix.network.bytes;
+    uint32_t index = (static_cast<uint32_t>(bytes[0]) << 8) | bytes[1];
+    if (prefix.length <= 16)
+    {
+        paint(root6_.data() + index, size_t(1) << (16 - prefix.length), prefix.kind, prefix.label);
+        return;
+    }
+    // Walk down to the node holding the prefix's last bits, pushing the
+    // covering leaf into every node created on the way
+    std::vector<uint32_t> *entries = &root6_;
+    size_t position = index;
+    int bit = 16;
+    while (true)
+    {
+        uint32_t entry = (*entries)[position];
+        if (!(entry & POINTER))
+        {
+            uint32_t node = static_cast<uint32_t>(nodes6_.size() >> STRIDE);
+            nodes6_.resize(nodes6_.size() + (size_t(1) << STRIDE), entry);
+            entry = POINTER | node;
+            (*entries)[position] = entry;
+        }
+        entries = &nodes6_;
+        size_t base = static_cast<size_t>(entry & ~POINTER) << STRIDE;
+        if (prefix.length <= bit + STRIDE)
+        {
+            paint(nodes6_.data() + base + nibble(bytes, bit), size_t(1) << (bit + STRIDE - prefix.length), prefix.kind,
+                  prefix.label);
+            return;
+        }
+        position = base + nibble(bytes, bit);
+        bit += STRIDE;
+    }
+}
+
+bool PrefixTable::build()
+{
+    std::stable_sort(pending_.begin(), pending_.end(), [](const PendingPrefix &a, const PendingPrefix &b)
+                     { return a.length < b.length; });
+    if (prefixes4_ > 0)
+    {
+        tbl24_.reset(static_cast<uint32_t *>(std::calloc(TBL24_ENTRIES, sizeof(uint32_t))));
+        if (!tbl24_)
+        {
+            last_error_ = "Cannot allocate the IPv4 prefix table";
+            return false;
+        }
+    }
+    if (prefixes6_ > 0)
+    {
+        root6_.assign(ROOT6_ENTRIES, 0);
+    }
+    for (const auto &prefix : pending_)
+    {
+        if (prefix.network.family == 4)
+        {
+            insert4(prefix);
+        }
+        else
+        {
+            insert6(prefix);
+        }
+    }
+    pending_.clear();
+    pending_.shrink_to_fit();
+    leaf_ids_.clear();
+    label_ids_.clear();
+    return true;
+}
+
+size_t PrefixTable::getMemoryBytes() const
+{
+    size_t bytes = (tbl24_ ? TBL24_ENTRIES * sizeof(uint32_t) : 0) + (tbl8_.size() + root6_.size() + nodes6_.size()) * sizeof(uint32_t) +
+                   leaves_.size() * sizeof(leaves_[0]);
+    for (const auto &label : labels_)
+    {
+        bytes += label.size();
+    }
+    return bytes;
+}
@@ -0,0 +1,640 @@
+#include "RuleLabeler.h"
+#include "CivilTime.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+namespace
+{
+    using Address128 = RuleLabeler::Address128;
+    const uint64_t NO_PORT = 65536;
+
+    template <typename Key>
+    using Ranges = std::vector<std::pair<Key, Key>>;
+
+    // One compiled rule; host= and port= rules are expanded into one rule
+    // per side. An unset field accepts everything, a set field only its
+    // ranges (e.g. src with only IPv6 ranges never matches an IPv4 row).
+    struct Rule
+    {
+        uint32_t label;
+        bool src_set, dst_set, sport_set, dport_set, proto_set, time_set;
+        Ranges<uint64_t> src4, dst4, sport, dport, proto;
+        Ranges<Address128> src6, dst6;
+        Ranges<int64_t> time;
+
+        Rule() : label(0), src_set(false), dst_set(false), sport_set(false), dport_set(false), proto_set(false), time_set(false) {}
+    };
+
+    inline int lowestBit(uint64_t x)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int bit = 0;
+        while (!(x & 1))
+        {
+            x >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    inline bool successor(uint64_t value, uint64_t &next)
+    {
+        next = value + 1;
+        return value != std::numeric_limits<uint64_t>::max();
+    }
+
+    inline bool successor(int64_t value, int64_t &next)
+    {
+        next = value + (value != std::numeric_limits<int64_t>::max());
+        return value != std::numeric_limits<int64_t>::max();
+    }
+
+    inline bool successor(const Address128 &value, Address128 &next)
+    {
+        next.low = value.low + 1;
+        next.high = value.high + (next.low == 0);
+        return !(value.high == UINT64_MAX && value.low == UINT64_MAX);
+    }
+
+    inline uint64_t loadBE64(const uint8_t *bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    inline uint64_t key4(const uint8_t *bytes)
+    {
+        return (static_cast<uint64_t>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    }
+
+    inline Address128 key6(const uint8_t *bytes)
+    {
+        return Address128{loadBE64(bytes), loadBE64(bytes + 8)};
+    }
+
+    // Index of the interval holding key (starts[0] is the minimum key).
+    // Branch-free halving: the comparison becomes a conditional move, so
+    // unpredictable addresses cost no mispredictions.
+    template <typename Key>
+    inline size_t findSegment(const std::vector<Key> &starts, const Key &key)
+    {
+        const Key *base = starts.data();
+        size_t count = starts.size();
+        while (count > 1)
+        {
+            size_t half = count / 2;
+            base = key < base[half] ? base : base + half;
+            count -= half;
+        }
+        return static_cast<size_t>(base - starts.data());
+    }
+
+    template <typename Key>
+    inline uint32_t findSet(const RuleLabeler::Dimension<Key> &dimension, const Key &key)
+    {
+        return dimension.sets[findSegment(dimension.starts, key)];
+    }
+
+    inline uint32_t findSet4(const RuleLabeler::Dimension<uint64_t> &dimension, uint64_t key)
+    {
+        const uint32_t *block = &dimension.blocks[key >> 16];
+        const uint64_t *base = &dimension.starts[block[0]];
+        size_t count = block[1] - block[0] + 1;
+        while (count > 1)
+        {
+            size_t half = count / 2;
+            base = key < base[half] ? base : base + half;
+            count -= half;
+        }
+        return dimension.sets[base - dimension.starts.data()];
+    }
+
+    void buildBlocks(RuleLabeler::Dimension<uint64_t> &dimension)
+    {
+        dimension.blocks.resize(65537);
+        for (uint64_t block = 0; block <= 65536; ++block)
+        {
+            dimension.blocks[block] = static_cast<uint32_t>(findSegment(dimension.starts, block << 16));
+        }
+    }
+
+    // Stores each distinct rule bitset once
+    class SetInterner
+    {
+    public:
+        SetInterner(size_t words, std::vector<uint64_t> &store) : words_(words), store_(store) {}
+
+        uint32_t add(const uint64_t *set)
+        {
+            std::vector<uint64_t> key(set, set + words_);
+            auto found = ids_.find(key);
+            if (found != ids_.end())
+            {
+                return found->second;
+            }
+            uint32_t offset = static_cast<uint32_t>(store_.size());
+            store_.insert(store_.end(), key.begin(), key.end());
+            ids_.emplace(std::move(key), offset);
+            return offset;
+        }
+
+    private:
+        size_t words_;
+        std::vector<uint64_t> &store_;
+        std::map<std::vector<uint64_t>, uint32_t> ids_;
+    };
+
+    // ranges[r] is rule r's accepted ranges, nullptr when the rule does not
+    // constrain this field
+    template <typename Key>
+    void buildDimension(RuleLabeler::Dimension<Key> &dimension, const std::vector<const Ranges<Key> *> &ranges, const Key &min,
+                        size_t words, SetInterner &interner)
+    {
+        std::vector<uint64_t> any(words, 0);
+        dimension.starts.assign(1, min);
+        for (size_t rule = 0; rule < ranges.size(); ++rule)
+        {
+            if (!ranges[rule])
+            {
+                any[rule >> 6] |= uint64_t(1) << (rule & 63);
+                continue;
+            }
+            dimension.used = true;
+            for (const auto &range : *ranges[rule])
+            {
+                Key next;
+                dimension.starts.push_back(range.first);
+                if (successor(range.second, next))
+                    dimension.starts.push_back(next);
+            }
+        }
+        std::sort(dimension.starts.begin(), dimension.starts.end());
+        dimension.starts.erase(std::unique(dimension.starts.begin(), dimension.starts.end()), dimension.starts.end());
+
+        size_t segments = dimension.starts.size();
+        std::vector<uint64_t> sets(segments * words, 0);
+        for (size_t segment = 0; segment < segments; ++segment)
+        {
+            std::copy(any.begin(), any.end(), sets.begin() + segment * words);
+        }
+        for (size_t rule = 0; rule < ranges.size(); ++rule)
+        {
+            if (!ranges[rule])
+                continue;
+            for (const auto &range : *ranges[rule])
+            {
+                size_t first = std::lower_bound(dimension.starts.begin(), dimension.starts.end(), range.first) - dimension.starts.begin();
+                Key next;
+                size_t last = successor(range.second, next)
+                                  ? std::lower_bound(dimension.starts.begin(), dimension.starts.end(), next) - dimension.starts.begin()
+                                  : segments;
+                for (size_t segment = first; segment < last; ++segment)
+                {
+                    sets[segment * words + (rule >> 6)] |= uint64_t(1) << (rule & 63);
+                }
+            }
+        }
+
+        // Neighbouring intervals with the same rules become one
+        std::vector<Key> starts;
+        dimension.sets.clear();
+        for (size_t segment = 0; segment < segments; ++segment)
+        {
+            uint32_t set = interner.add(&sets[segment * words]);
+            if (dimension.sets.empty() || dimension.sets.back() != set)
+            {
+                starts.push_back(dimension.starts[segment]);
+                dimension.sets.push_back(set);
+            }
+        }
+        dimension.starts.swap(starts);
+    }
+
+    // Dimension over [0, size) flattened into a direct table
+    std::vector<uint32_t> buildDirect(const std::vector<const Ranges<uint64_t> *> &ranges, uint64_t size, size_t words,
+                                      SetInterner &interner, bool &used)
+    {
+        RuleLabeler::Dimension<uint64_t> dimension;
+        buildDimension<uint64_t>(dimension, ranges, 0, words, interner);
+        used = used || dimension.used;
+        std::vector<uint32_t> table(size);
+        for (uint64_t value = 0; value < size; ++value)
+        {
+            table[value] = findSet(dimension, value);
+        }
+        return table;
+    }
+
+    bool parseNumberRange(const std::string &text, uint64_t max, std::pair<uint64_t, uint64_t> &range)
+    {
+        size_t dash = text.find('-');
+        std::string first = text.substr(0, dash);
+        std::string second = dash == std::string::npos ? first : text.substr(dash + 1);
+        char *end = nullptr;
+        unsigned long long low = std::strtoull(first.c_str(), &end, 10);
+        if (first.empty() || *end != '\0')
+            return false;
+        unsigned long long high = std::strtoull(second.c_str(), &end, 10);
+        if (second.empty() || *end != '\0' || low > high || high > max)
+            return false;
+        range = std::make_pair(static_cast<uint64_t>(low), static_cast<uint64_t>(high));
+        return true;
+    }
+
+    bool parseProtocol(const std::string &text, std::pair<uint64_t, uint64_t> &range)
+    {
+        static const std::pair<const char *, uint64_t> names[] = {
+            {"icmp", 1}, {"tcp", 6}, {"udp", 17}, {"gre", 47}, {"esp", 50}, {"ah", 51}, {"icmpv6", 58}, {"sctp", 132}};
+        for (const auto &name : names)
+        {
+            if (text == name.first)
+            {
+                range = std::make_pair(name.second, name.second);
+                return true;
+            }
+        }
+        return parseNumberRange(text, 255, range);
+    }
+
+    // Address, prefix or a-b range into the family's key ranges
+    bool parseAddress(const std::string &text, Ranges<uint64_t> &ranges4, Ranges<Address128> &ranges6)
+    {
+        uint8_t low[16] = {};
+        uint8_t high[16] = {};
+        size_t slash = text.find('/');
+        size_t dash = text.find('-');
+        std::string first = text.substr(0, slash != std::string::npos ? slash : dash);
+        int family = inet_pton(AF_INET, first.c_str(), low) == 1 ? 4 : inet_pton(AF_INET6, first.c_str(), low) == 1 ? 6 : 0;
+        if (family == 0)
+            return false;
+        int bits = family == 4 ? 32 : 128;
+
+        if (slash != std::string::npos)
+        {
+            char *end = nullptr;
+            long length = std::strtol(text.c_str() + slash + 1, &end, 10);
+            if (end == text.c_str() + slash + 1 || *end != '\0' || length < 0 || length > bits)
+                return false;
+            std::memcpy(high, low, sizeof(low));
+            for (int bit = static_cast<int>(length); bit < bits; ++bit)
+            {
+                low[bit >> 3] &= static_cast<uint8_t>(~(0x80u >> (bit & 7)));
+                high[bit >> 3] |= static_cast<uint8_t>(0x80u >> (bit & 7));
+            }
+        }
+        else if (dash != std::string::npos)
+        {
+            std::string second = text.substr(dash + 1);
+            if (inet_pton(family == 4 ? AF_INET : AF_INET6, second.c_str(), high) != 1)
+                return false;
+        }
+        else
+        {
+            std::memcpy(high, low, sizeof(low));
+        }
+
+        if (family == 4)
+        {
+            if (key4(low) > key4(high))
+                return false;
+            ranges4.emplace_back(key4(low), key4(high));
+        }
+        else
+        {
+            if (key6(high) < key6(low))
+                return false;
+            ranges6.emplace_back(key6(low), key6(high));
+        }
+        return true;
+    }
+
+    // Epoch seconds (fraction allowed) or UTC "YYYY-MM-DDTHH:MM:SS[.f][Z]"
+    // into microseconds
+    bool parseTime(const std::string &text, int64_t &micros)
+    {
+        char *end = nullptr;
+        double seconds = std::strtod(text.c_str(), &end);
+        if (!text.empty() && *end == '\0')
+        {
+            micros = static_cast<int64_t>(seconds * 1e6);
+            return true;
+        }
+        int year, month, day, hour, minute, second, consumed = 0;
+        if (std::sscanf(text.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%n", &year, &month, &day, &hour, &minute, &second, &consumed) != 6)
+            return false;
+        std::string rest = text.substr(consumed);
+        double fraction = 0;
+        if (!rest.empty() && rest[0] == '.')
+        {
+            fraction = std::strtod(rest.c_str(), &end);
+            rest = end;
+        }
+        if (!(rest.empty() || rest == "Z") || month < 1 || month > 12 || day < 1 || day > 31)
+            return false;
+        int64_t epoch = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+        micros = epoch * 1000000 + static_cast<int64_t>(fraction * 1e6);
+        return true;
+    }
+
+    template <typename Parse>
+    bool parseList(const std::string &values, Parse parse)
+    {
+        std::istringstream stream(values);
+        std::string item;
+        bool any = false;
+        while (std::getline(stream, item, ','))
+        {
+            if (!parse(item))
+                return false;
+            any = true;
+        }
+        return any;
+    }
+}
+
+RuleLabeler::RuleLabeler(const std::string &path)
+    : path_(path), default_label_(0), words_per_set_(1), ports_used_(false), proto_used_(false), last_time_segment_(0)
+{
+}
+
+bool RuleLabeler::load()
+{
+    std::ifstream file(path_);
+    if (!file.is_open())
+    {
+        last_error_ = "Cannot open label rules " + path_;
+        return false;
+    }
+
+    auto labelIndex = [this](const std::string &label)
+    {
+        auto found = std::find(labels_.begin(), labels_.end(), label);
+        if (found != labels_.end())
+            return static_cast<uint32_t>(found - labels_.begin());
+        labels_.push_back(label);
+        return static_cast<uint32_t>(labels_.size() - 1);
+    };
+
+    std::vector<Rule> rules;
+    std::string default_label;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        std::istringstream tokens(line);
+        std::string label;
+        if (!(tokens >> label) || label[0] == '#')
+            continue;
+        auto fail = [&](const std::string &message)
+        {
+            last_error_ = path_ + ":" + std::to_string(line_number) + ": " + message;
+            return false;
+        };
+        if (label == "default")
+        {
+            if (!(tokens >> default_label))
+                return fail("default needs a label");
+            continue;
+        }
+
+        Rule rule;
+        rule.label = labelIndex(label);
+        Ranges<uint64_t> host4, port;
+        Ranges<Address128> host6;
+        bool host_set = false, port_set = false;
+        std::string field;
+        while (tokens >> field)
+        {
+            size_t equals = field.find('=');
+            std::string name = field.substr(0, equals);
+            std::string values = equals == std::string::npos ? "" : field.substr(equals + 1);
+            bool ok;
+            if (name == "src" || name == "dst" || name == "host")
+            {
+                Ranges<uint64_t> &ranges4 = name == "src" ? rule.src4 : name == "dst" ? rule.dst4 : host4;
+                Ranges<Address128> &ranges6 = name == "src" ? rule.src6 : name == "dst" ? rule.dst6 : host6;
+                (name == "src" ? rule.src_set : name == "dst" ? rule.dst_set : host_set) = true;
+                ok = parseList(values, [&](const std::string &item)
+                               { return parseAddress(item, ranges4, ranges6); });
+            }
+            else if (name == "sport" || name == "dport" || name == "port")
+            {
+                Ranges<uint64_t> &ranges = name == "sport" ? rule.sport : name == "dport" ? rule.dport : port;
+                (name == "sport" ? rule.sport_set : name == "dport" ? rule.dport_set : port_set) = true;
+                ok = parseList(values, [&](const std::string &item)
+                               {
+                                   std::pair<uint64_t, uint64_t> range;
+                                   bool parsed = parseNumberRange(item, 65535, range);
+                                   ranges.push_back(range);
+                                   return parsed; });
+            }
+            else if (name == "proto")
+            {
+                rule.proto_set = true;
+                ok = parseList(values, [&](const std::string &item)
+                               {
+                                   std::pair<uint64_t, uint64_t> range;
+                                   bool parsed = parseProtocol(item, range);
+                                   rule.proto.push_back(range);
+                                   return parsed; });
+            }
+            else if (name == "time")
+            {
+                rule.time_set = true;
+                ok = parseList(values, [&](const std::string &item)
+                               {
+                                   size_t dots = item.find("..");
+                                   if (dots == std::string::npos)
+                                       return false;
+                                   int64_t start = std::numeric_limits<int64_t>::min();
+                                   int64_t stop = std::numeric_limits<int64_t>::max();
+                                   std::string first = item.substr(0, dots), second = item.substr(dots + 2);
+                                   if ((!first.empty() && !parseTime(first, start)) || (!second.empty() && !parseTime(second, stop)) ||
+                                       stop <= start)
+                                       return false;
+                                   // The end of a window is exclusive
+                                   rule.time.emplace_back(start, second.empty() ? stop : stop - 1);
+                                   return true; });
+            }
+            else
+            {
+                return fail("unknown field '" + name + "'");
+            }
+            if (!ok)
+            {
+                return fail("invalid " + name + " '" + values + "'");
+            }
+        }
+        if ((host_set && (rule.src_set || rule.dst_set)) || (port_set && (rule.sport_set || rule.dport_set)))
+        {
+            return fail("host and port cannot be combined with src/dst or sport/dport");
+        }
+
+        // Either side: one rule per side (and per pair of sides with both)
+        for (int host_side = 0; host_side < (host_set ? 2 : 1); ++host_side)
+        {
+            for (int port_side = 0; port_side < (port_set ? 2 : 1); ++port_side)
+            {
+                Rule expanded = rule;
+                if (host_set)
+                {
+                    (host_side == 0 ? expanded.src_set : expanded.dst_set) = true;
+                    (host_side == 0 ? expanded.src4 : expanded.dst4) = host4;
+                    (host_side == 0 ? expanded.src6 : expanded.dst6) = host6;
+                }
+                if (port_set)
+                {
+                    (port_side == 0 ? expanded.sport_set : expanded.dport_set) = true;
+                    (port_side == 0 ? expanded.sport : expanded.dport) = port;
+                }
+                rules.push_back(std::move(expanded));
+            }
+        }
+    }
+
+    default_label_ = labelIndex(default_label);
+    words_per_set_ = rules.empty() ? 1 : (rules.size() + 63) / 64;
+    SetInterner interner(words_per_set_, words_);
+    auto collect = [&rules](auto member, bool Rule::*set)
+    {
+        std::vector<const typename std::remove_reference<decltype(rules[0].*member)>::type *> ranges;
+        for (const auto &rule : rules)
+            ranges.push_back(rule.*set ? &(rule.*member) : nullptr);
+        return ranges;
+    };
+    buildDimension<uint64_t>(src4_, collect(&Rule::src4, &Rule::src_set), 0, words_per_set_, interner);
+    buildDimension<uint64_t>(dst4_, collect(&Rule::dst4, &Rule::dst_set), 0, words_per_set_, interner);
+    buildBlocks(src4_);
+    buildBlocks(dst4_);
+    buildDimension<Address128>(src6_, collect(&Rule::src6, &Rule::src_set), Address128{0, 0}, words_per_set_, interner);
+    buildDimension<Address128>(dst6_, collect(&Rule::dst6, &Rule::dst_set), Address128{0, 0}, words_per_set_, interner);
+    buildDimension<int64_t>(time_, collect(&Rule::time, &Rule::time_set), std::numeric_limits<int64_t>::min(), words_per_set_,
+                            interner);
+    sport_ = buildDirect(collect(&Rule::sport, &Rule::sport_set), NO_PORT + 1, words_per_set_, interner, ports_used_);
+    dport_ = buildDirect(collect(&Rule::dport, &Rule::dport_set), NO_PORT + 1, words_per_set_, interner, ports_used_);
+    proto_ = buildDirect(collect(&Rule::proto, &Rule::proto_set), 256, words_per_set_, interner, proto_used_);
+
+    for (const auto &rule : rules)
+    {
+        rule_labels_.push_back(rule.label);
+    }
+    label_counts_.assign(labels_.size(), 0);
+    return true;
+}
+
+const std::string &RuleLabeler::classify(const PacketFeature &feature)
+{
+    return labels_[match(feature)];
+}
+
+uint32_t RuleLabeler::match(const PacketFeature &feature)
+{
+    if (rule_labels_.empty())
+    {
+        return default_label_; // empty or default-only rules file
+    }
+    const uint64_t *sets[7];
+    size_t count = 0;
+    if (feature.src_ip.family == 4)
+    {
+        if (src4_.used)
+            sets[count++] = &words_[findSet4(src4_, key4(feature.src_ip.bytes))];
+        if (dst4_.used)
+            sets[count++] = &words_[findSet4(dst4_, key4(feature.dst_ip.bytes))];
+    }
+    else
+    {
+        if (src6_.used)
+            sets[count++] = &words_[findSet(src6_, key6(feature.src_ip.bytes))];
+        if (dst6_.used)
+            sets[count++] = &words_[findSet(dst6_, key6(feature.dst_ip.bytes))];
+    }
+    if (ports_used_)
+    {
+        sets[count++] = &words_[sport_[feature.transport.present ? feature.transport.src_port : NO_PORT]];
+        sets[count++] = &words_[dport_[feature.transport.present ? feature.transport.dst_port : NO_PORT]];
+    }
+    if (proto_used_)
+    {
+        sets[count++] = &words_[proto_[feature.l4_protocol]];
+    }
+    if (time_.used)
+    {
+        auto timestamp = feature.type == PacketFeature::Type::IPv4 ? feature.ipv4.timestamp : feature.ipv6.timestamp;
+        int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count();
+        size_t segment = last_time_segment_;
+        if (micros < time_.starts[segment] || (segment + 1 < time_.starts.size() && micros >= time_.starts[segment + 1]))
+        {
+            segment = findSegment(time_.starts, micros);
+            last_time_segment_ = segment;
+        }
+        sets[count++] = &words_[time_.sets[segment]];
+    }
+
+    for (size_t word = 0; word < words_per_set_; ++word)
+    {
+        uint64_t matches = word + 1 < words_per_set_ || rule_labels_.size() % 64 == 0
+                               ? ~uint64_t(0)
+                               : (uint64_t(1) << (rule_labels_.size() % 64)) - 1;
+        for (size_t i = 0; i < count && matches; ++i)
+        {
+            matches &= sets[i][word];
+        }
+        if (matches)
+        {
+            return rule_labels_[word * 64 + lowestBit(matches)];
+        }
+    }
+    return default_label_;
+}
+
+void RuleLabeler::process(PacketRecord &record, Arena &arena)
+{
+    uint32_t label = match(record.feature);
+    const std::string &text = labels_[label];
+    record.feature.label = text.empty() ? std::string_view() : arena.copyString(text.data(), text.size());
+    label_counts_[label]++;
+}
+
+std::string RuleLabeler::getSummary() const
+{
+    uint64_t total = 0;
+    for (uint64_t count : label_counts_)
+    {
+        total += count;
+    }
+    std::ostringstream summary;
+    summary << "Labels (" << rule_labels_.size() << " rules):";
+    const char *separator = " ";
+    for (size_t i = 0; i < labels_.size(); ++i)
+    {
+        if (labels_[i].empty() && label_counts_[i] == 0)
+            continue;
+        summary << separator << (labels_[i].empty() ? "(unlabelled)" : labels_[i]) << " " << label_counts_[i] << " ("
+                << std::fixed << std::setprecision(1) << (total > 0 ? 100.0 * label_counts_[i] / total : 0.0) << "%)";
+        separator = ", ";
+    }
+    return summary.str();
+}
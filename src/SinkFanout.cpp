@@ -0,0 +1,531 @@
+#include "SinkFanout.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<PacketRecord>::value, "spilled rows are written as raw bytes");
+
+namespace
+{
+    const uint32_t SPILL_MAGIC = 0x4C4C5053; // "SPLL"
+    // Roughly what one row takes across the fixed-width columns
+    const size_t FIXED_COLUMN_BYTES = 96;
+
+    // One spilled batch: header, rows, then the rows' variable-length fields.
+    // blob_base is the address the fields were copied to before writing, so
+    // the views in the rows can be rebased after reading.
+    struct SpillHeader
+    {
+        uint32_t magic;
+        uint32_t has_columns;
+        uint64_t rows;
+        uint64_t blob_bytes;
+        uint64_t blob_base;
+    };
+
+    size_t estimateBatchBytes(const PacketBatch &batch)
+    {
+        return batch.packets.size() * sizeof(PacketRecord) + batch.arena.bytesUsed() +
+               batch.columns.size() * FIXED_COLUMN_BYTES + batch.columns.options_data.size() +
+               batch.columns.extension_data.size();
+    }
+
+    std::string makeSpillPath(const std::string &directory, size_t index, const std::string &sink_name)
+    {
+        std::string name;
+        for (char c : sink_name)
+        {
+            bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+            name += plain ? c : '_';
+        }
+        std::string base = directory.empty() ? "." : directory;
+        if (base.back() != '/')
+        {
+            base += '/';
+        }
+        return base + ".spill-" + std::to_string(index) + "-" + name + ".seg";
+    }
+}
+
+bool BackpressurePolicy::parse(const std::string &spec, BackpressurePolicy &policy, std::string &error)
+{
+    size_t colon = spec.find(':');
+    std::string mode = spec.substr(0, colon);
+    std::string argument = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    bool has_argument = colon != std::string::npos;
+
+    if (spec.empty())
+    {
+        policy.mode = Mode::BLOCK;
+        return true;
+    }
+    if (mode == "block" || mode == "drop-newest" || mode == "drop-oldest")
+    {
+        if (has_argument)
+        {
+            error = "Backpressure policy " + mode + " takes no argument";
+            return false;
+        }
+        policy.mode = mode == "block" ? Mode::BLOCK : mode == "drop-newest" ? Mode::DROP_NEWEST : Mode::DROP_OLDEST;
+        return true;
+    }
+    if (mode == "sample")
+    {
+        int every = 10;
+        if (has_argument)
+        {
+            char *end = nullptr;
+            long value = std::strtol(argument.c_str(), &end, 10);
+            if (argument.empty() || *end != '\0' || value < 2 || value > 1000000)
+            {
+                error = "Sample rate must be an integer from 2 to 1000000: " + argument;
+                return false;
+            }
+            every = static_cast<int>(value);
+        }
+        policy.mode = Mode::SAMPLE;
+        policy.sample_every = every;
+        return true;
+    }
+    if (mode == "spill")
+    {
+        if (has_argument && argument.empty())
+        {
+            error = "Spill directory is empty";
+            return false;
+        }
+        policy.mode = Mode::SPILL;
+        policy.spill_directory = argument;
+        return true;
+    }
+    error = "Unknown backpressure policy '" + spec + "' (expected block, drop-newest, drop-oldest, sample[:<n>] or spill[:<dir>])";
+    return false;
+}
+
+const char *BackpressurePolicy::getModeName(Mode mode)
+{
+    switch (mode)
+    {
+    case Mode::BLOCK:
+        return "block";
+    case Mode::DROP_NEWEST:
+        return "drop-newest";
+    case Mode::DROP_OLDEST:
+        return "drop-oldest";
+    case Mode::SAMPLE:
+        return "sample";
+    case Mode::SPILL:
+        return "spill";
+    }
+    return "unknown";
+}
+
+const size_t SinkFanout::DEFAULT_QUEUE_DEPTH;
+
+SinkFanout::SinkFanout(size_t queue_depth, const BackpressurePolicy &policy)
+    : queue_depth_(queue_depth > 0 ? queue_depth : 1), policy_(policy), started_(false)
+{
+}
+
+SinkFanout::~SinkFanout()
+{
+    stop();
+}
+
+void SinkFanout::addSink(std::unique_ptr<OutputSink> sink)
+{
+    auto lane = std::make_unique<Lane>();
+    lane->sink = std::move(sink);
+    lanes_.push_back(std::move(lane));
+}
+
+bool SinkFanout::start()
+{
+    for (size_t i = 0; i < lanes_.size(); ++i)
+    {
+        if (!lanes_[i]->sink->open())
+        {
+            last_error_ = "Failed to open output " + lanes_[i]->sink->getName() + ": " + lanes_[i]->sink->getLastError();
+            for (size_t j = 0; j < i; ++j)
+            {
+                lanes_[j]->sink->close();
+            }
+            return false;
+        }
+    }
+
+    for (auto &lane : lanes_)
+    {
+        Lane *raw = lane.get();
+        lane->worker = std::thread([this, raw]()
+                                   { runLane(*raw); });
+    }
+    started_ = true;
+    return true;
+}
+
+void SinkFanout::submit(SharedPacketBatch batch)
+{
+    if (!started_ || !batch || batch->packets.empty())
+    {
+        return;
+    }
+
+    size_t rows = batch->packets.size();
+    size_t bytes = estimateBatchBytes(*batch);
+    for (auto &entry : lanes_)
+    {
+        Lane &lane = *entry;
+        lane.rows_submitted.fetch_add(rows, std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(lane.mutex);
+        // An empty queue always takes the batch, however large
+        auto fits = [&lane, bytes, this]()
+        {
+            return lane.queue.empty() ||
+                   (lane.queue.size() < queue_depth_ && lane.queued_bytes + bytes <= policy_.queue_bytes);
+        };
+
+        bool queue_batch = true;
+        switch (policy_.mode)
+        {
+        case BackpressurePolicy::Mode::BLOCK:
+            if (!fits())
+            {
+                lane.producer_stalls.fetch_add(1, std::memory_order_relaxed);
+                lane.not_full.wait(lock, fits);
+            }
+            break;
+        case BackpressurePolicy::Mode::DROP_NEWEST:
+            queue_batch = fits();
+            break;
+        case BackpressurePolicy::Mode::DROP_OLDEST:
+            while (!fits())
+            {
+                const PacketBatch &oldest = *lane.queue.front();
+                lane.rows_dropped.fetch_add(oldest.packets.size(), std::memory_order_relaxed);
+                lane.queued_bytes -= estimateBatchBytes(oldest);
+                lane.queue.pop_front();
+            }
+            break;
+        case BackpressurePolicy::Mode::SAMPLE:
+            if (lane.queue.size() * 2 >= queue_depth_ || lane.queued_bytes * 2 >= policy_.queue_bytes)
+            {
+                if (++lane.sample_counter % static_cast<uint64_t>(policy_.sample_every) != 0)
+                {
+                    lane.rows_sampled_out.fetch_add(rows, std::memory_order_relaxed);
+                    continue;
+                }
+                queue_batch = fits();
+            }
+            break;
+        case BackpressurePolicy::Mode::SPILL:
+            // Once spilling, everything goes through the segment until the
+            // sink has caught up, so rows stay in order
+            if (lane.spill_pending > 0 || !fits())
+            {
+                lock.unlock();
+                if (!spillBatch(lane, *batch))
+                {
+                    lane.rows_dropped.fetch_add(rows, std::memory_order_relaxed);
+                }
+                continue;
+            }
+            break;
+        }
+
+        if (!queue_batch)
+        {
+            lane.rows_dropped.fetch_add(rows, std::memory_order_relaxed);
+            continue;
+        }
+        lane.queue.push_back(batch);
+        lane.queued_bytes += bytes;
+        lock.unlock();
+        lane.not_empty.notify_one();
+    }
+}
+
+void SinkFanout::stop()
+{
+    if (!started_)
+    {
+        return;
+    }
+    started_ = false;
+
+    // Workers drain what is queued before they exit
+    for (auto &lane : lanes_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            lane->closing = true;
+        }
+        lane->not_empty.notify_one();
+    }
+    for (auto &lane : lanes_)
+    {
+        if (lane->worker.joinable())
+        {
+            lane->worker.join();
+        }
+        lane->sink->close();
+        if (lane->spill_out.is_open())
+        {
+            lane->spill_out.close();
+            lane->spill_in.close();
+            std::remove(lane->spill_path.c_str());
+        }
+    }
+}
+
+size_t SinkFanout::getSinkCount() const
+{
+    return lanes_.size();
+}
+
+bool SinkFanout::wantsColumns() const
+{
+    for (const auto &lane : lanes_)
+    {
+        if (lane->sink->wantsColumns())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t SinkFanout::getPayloadHeadBytes() const
+{
+    size_t bytes = 0;
+    for (const auto &lane : lanes_)
+    {
+        size_t wanted = lane->sink->getPayloadHeadBytes();
+        bytes = wanted > bytes ? wanted : bytes;
+    }
+    return bytes;
+}
+
+std::vector<SinkStats> SinkFanout::getStats() const
+{
+    std::vector<SinkStats> stats;
+    for (const auto &lane : lanes_)
+    {
+        SinkStats entry;
+        entry.name = lane->sink->getName();
+        entry.batches_written = lane->batches_written.load(std::memory_order_relaxed);
+        entry.rows_written = lane->rows_written.load(std::memory_order_relaxed);
+        entry.write_errors = lane->write_errors.load(std::memory_order_relaxed);
+        entry.producer_stalls = lane->producer_stalls.load(std::memory_order_relaxed);
+        entry.rows_submitted = lane->rows_submitted.load(std::memory_order_relaxed);
+        entry.rows_dropped = lane->rows_dropped.load(std::memory_order_relaxed);
+        entry.rows_sampled_out = lane->rows_sampled_out.load(std::memory_order_relaxed);
+        entry.rows_spilled = lane->rows_spilled.load(std::memory_order_relaxed);
+        entry.spill_peak_bytes = lane->spill_peak_bytes.load(std::memory_order_relaxed);
+        entry.summary = lane->sink->getSummary();
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+std::string SinkFanout::getLastError() const
+{
+    return last_error_;
+}
+
+void SinkFanout::runLane(Lane &lane)
+{
+    while (true)
+    {
+        SharedPacketBatch batch;
+        {
+            std::unique_lock<std::mutex> lock(lane.mutex);
+            lane.not_empty.wait(lock, [&lane]()
+                                { return lane.closing || !lane.queue.empty() || lane.spill_pending > 0; });
+            if (!lane.queue.empty())
+            {
+                batch = std::move(lane.queue.front());
+                lane.queue.pop_front();
+                lane.queued_bytes -= estimateBatchBytes(*batch);
+            }
+            else if (lane.spill_pending == 0)
+            {
+                return;
+            }
+        }
+
+        // The memory queue is always older than the segment
+        if (batch)
+        {
+            lane.not_full.notify_one();
+            deliver(lane, *batch);
+        }
+        else if (readSpilledBatch(lane))
+        {
+            deliver(lane, lane.spill_batch);
+        }
+    }
+}
+
+void SinkFanout::deliver(Lane &lane, const PacketBatch &batch)
+{
+    if (lane.sink->consume(batch))
+    {
+        lane.batches_written.fetch_add(1, std::memory_order_relaxed);
+        lane.rows_written.fetch_add(batch.packets.size(), std::memory_order_relaxed);
+    }
+    else
+    {
+        lane.write_errors.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Failed to write packet batch to " << lane.sink->getName() << ": "
+                  << lane.sink->getLastError() << std::endl;
+    }
+}
+
+bool SinkFanout::spillBatch(Lane &lane, const PacketBatch &batch)
+{
+    // Serialized outside the file lock, into the producer's scratch buffer
+    size_t rows = batch.packets.size();
+    size_t blob_bytes = 0;
+    for (const PacketRecord &record : batch.packets)
+    {
+        blob_bytes += variableFieldBytes(record.feature);
+    }
+    size_t record_bytes = rows * sizeof(PacketRecord);
+    std::string &buffer = lane.spill_buffer;
+    buffer.resize(sizeof(SpillHeader) + record_bytes + blob_bytes);
+    char *records = &buffer[sizeof(SpillHeader)];
+    char *blob = records + record_bytes;
+
+    SpillHeader header;
+    header.magic = SPILL_MAGIC;
+    header.has_columns = batch.columns.empty() ? 0 : 1;
+    header.rows = rows;
+    header.blob_bytes = blob_bytes;
+    header.blob_base = reinterpret_cast<uintptr_t>(blob);
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    char *storage = blob;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        PacketRecord record = batch.packets[i];
+        relocateVariableFields(record.feature, storage);
+        storage += variableFieldBytes(record.feature);
+        std::memcpy(records + i * sizeof(PacketRecord), &record, sizeof(PacketRecord));
+    }
+
+    {
+        std::lock_guard<std::mutex> file_lock(lane.spill_mutex);
+        if (!lane.spill_out.is_open())
+        {
+            size_t index = 0;
+            while (lanes_[index].get() != &lane)
+            {
+                ++index;
+            }
+            lane.spill_path = makeSpillPath(policy_.spill_directory, index, lane.sink->getName());
+            lane.spill_out.open(lane.spill_path, std::ios::binary | std::ios::out | std::ios::trunc);
+            lane.spill_in.open(lane.spill_path, std::ios::binary | std::ios::in);
+            if (!lane.spill_out.is_open() || !lane.spill_in.is_open())
+            {
+                std::cerr << "Failed to open spill segment " << lane.spill_path << ", dropping rows instead" << std::endl;
+                lane.spill_out.close();
+                lane.spill_in.close();
+                return false;
+            }
+        }
+
+        lane.spill_out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        lane.spill_out.flush();
+        if (!lane.spill_out)
+        {
+            // Later batches overwrite the partial one; the reader never
+            // gets past what was counted as pending
+            lane.spill_out.clear();
+            lane.spill_out.seekp(static_cast<std::streamoff>(lane.spill_bytes));
+            return false;
+        }
+        lane.spill_bytes += buffer.size();
+        if (lane.spill_bytes > lane.spill_peak_bytes.load(std::memory_order_relaxed))
+        {
+            lane.spill_peak_bytes.store(lane.spill_bytes, std::memory_order_relaxed);
+        }
+        lane.rows_spilled.fetch_add(rows, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.spill_pending++;
+    }
+    lane.not_empty.notify_one();
+    return true;
+}
+
+bool SinkFanout::readSpilledBatch(Lane &lane)
+{
+    std::lock_guard<std::mutex> file_lock(lane.spill_mutex);
+    PacketBatch &batch = lane.spill_batch;
+
+    // Seeking also drops anything the stream buffered past the last
+    // complete batch
+    SpillHeader header;
+    lane.spill_in.clear();
+    lane.spill_in.seekg(static_cast<std::streamoff>(lane.spill_read_offset));
+    lane.spill_in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    bool ok = static_cast<bool>(lane.spill_in) && header.magic == SPILL_MAGIC;
+    char *blob = nullptr;
+    if (ok)
+    {
+        batch.packets.assign(header.rows, PacketRecord{PacketFeature(PacketFeature::Type::IPv4), 0});
+        lane.spill_in.read(reinterpret_cast<char *>(batch.packets.data()),
+                           static_cast<std::streamsize>(header.rows * sizeof(PacketRecord)));
+        batch.arena.reset();
+        blob = header.blob_bytes > 0 ? static_cast<char *>(batch.arena.allocate(header.blob_bytes, 1)) : nullptr;
+        if (blob)
+        {
+            lane.spill_in.read(blob, static_cast<std::streamsize>(header.blob_bytes));
+        }
+        ok = static_cast<bool>(lane.spill_in);
+        lane.spill_read_offset += sizeof(header) + header.rows * sizeof(PacketRecord) + header.blob_bytes;
+    }
+    if (ok)
+    {
+        batch.columns.clear();
+        if (header.has_columns)
+        {
+            batch.columns.reserve(batch.packets.size());
+        }
+        for (PacketRecord &record : batch.packets)
+        {
+            rebaseVariableFields(record.feature, static_cast<uintptr_t>(header.blob_base), blob);
+            if (header.has_columns)
+            {
+                batch.columns.appendRow(record);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(lane.mutex);
+    if (ok)
+    {
+        lane.spill_pending--;
+    }
+    else
+    {
+        // Nothing after a bad batch can be trusted
+        std::cerr << "Failed to read spill segment " << lane.spill_path << ", " << lane.spill_pending
+                  << " batches lost" << std::endl;
+        lane.write_errors.fetch_add(lane.spill_pending, std::memory_order_relaxed);
+        lane.spill_pending = 0;
+    }
+    if (lane.spill_pending == 0)
+    {
+        // Caught up: start the segment over
+        lane.spill_out.close();
+        lane.spill_out.open(lane.spill_path, std::ios::binary | std::ios::out | std::ios::trunc);
+        lane.spill_bytes = 0;
+        lane.spill_read_offset = 0;
+    }
+    return ok;
+}
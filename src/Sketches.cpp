@@ -0,0 +1,459 @@
+#include "Sketches.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // splitmix64 finaliser
+    inline uint64_t mix64(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline int leadingZeros64(uint64_t x)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(x);
+#else
+        int count = 0;
+        for (uint64_t bit = uint64_t(1) << 63; bit != 0 && (x & bit) == 0; bit >>= 1)
+        {
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    size_t slotCountFor(size_t capacity)
+    {
+        size_t slots = 16;
+        while (slots < capacity * 2)
+        {
+            slots <<= 1;
+        }
+        return slots;
+    }
+}
+
+uint64_t hashAddress(const IpAddress &address)
+{
+    uint64_t high;
+    uint64_t low;
+    std::memcpy(&high, address.bytes, 8);
+    std::memcpy(&low, address.bytes + 8, 8);
+    return mix64(high ^ mix64(low ^ (static_cast<uint64_t>(address.family) << 56)));
+}
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : width_(width > 0 ? width : 1), depth_(depth > 0 ? depth : 1), counters_(width_ * depth_, 0)
+{
+}
+
+size_t CountMinSketch::cell(size_t row, uint64_t hash) const
+{
+    // Kirsch-Mitzenmacher: row hashes derived from the two halves
+    uint64_t h1 = hash & 0xFFFFFFFFULL;
+    uint64_t h2 = (hash >> 32) | 1;
+    return row * width_ + static_cast<size_t>((h1 + row * h2) % width_);
+}
+
+void CountMinSketch::add(uint64_t hash, uint32_t count)
+{
+    uint32_t target = estimate(hash) + count;
+    if (target < count)
+    {
+        target = UINT32_MAX; // saturate
+    }
+    for (size_t row = 0; row < depth_; ++row)
+    {
+        uint32_t &counter = counters_[cell(row, hash)];
+        if (counter < target)
+        {
+            counter = target;
+        }
+    }
+}
+
+uint32_t CountMinSketch::estimate(uint64_t hash) const
+{
+    uint32_t minimum = UINT32_MAX;
+    for (size_t row = 0; row < depth_; ++row)
+    {
+        minimum = std::min(minimum, counters_[cell(row, hash)]);
+    }
+    return minimum;
+}
+
+bool CountMinSketch::merge(const CountMinSketch &other)
+{
+    if (other.width_ != width_ || other.depth_ != depth_)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < counters_.size(); ++i)
+    {
+        uint32_t sum = counters_[i] + other.counters_[i];
+        counters_[i] = sum < counters_[i] ? UINT32_MAX : sum;
+    }
+    return true;
+}
+
+void CountMinSketch::clear()
+{
+    std::fill(counters_.begin(), counters_.end(), 0);
+}
+
+HyperLogLog::HyperLogLog(uint8_t precision)
+    : precision_(std::min<uint8_t>(16, std::max<uint8_t>(4, precision))), registers_(size_t(1) << precision_, 0)
+{
+}
+
+void HyperLogLog::add(uint64_t hash)
+{
+    size_t index = static_cast<size_t>(hash >> (64 - precision_));
+    uint64_t rest = (hash << precision_) | (uint64_t(1) << (precision_ - 1)); // guard bit bounds the rank
+    uint8_t rank = static_cast<uint8_t>(leadingZeros64(rest) + 1);
+    if (rank > registers_[index])
+    {
+        registers_[index] = rank;
+    }
+}
+
+double HyperLogLog::estimate() const
+{
+    double m = static_cast<double>(registers_.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t value : registers_)
+    {
+        sum += std::ldexp(1.0, -value);
+        zeros += value == 0;
+    }
+    double alpha = registers_.size() == 16 ? 0.673 : registers_.size() == 32 ? 0.697
+                                                   : registers_.size() == 64   ? 0.709
+                                                                               : 0.7213 / (1.0 + 1.079 / m);
+    double raw = alpha * m * m / sum;
+    if (raw <= 2.5 * m && zeros > 0)
+    {
+        // Small range: linear counting is more accurate
+        return m * std::log(m / static_cast<double>(zeros));
+    }
+    return raw;
+}
+
+bool HyperLogLog::merge(const HyperLogLog &other)
+{
+    if (other.precision_ != precision_)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < registers_.size(); ++i)
+    {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+    return true;
+}
+
+void HyperLogLog::clear()
+{
+    std::fill(registers_.begin(), registers_.end(), 0);
+}
+
+SpaceSaving::SpaceSaving(size_t capacity, uint8_t destination_precision)
+    : precision_(destination_precision), used_(0)
+{
+    capacity = capacity > 0 ? capacity : 1;
+    entries_.reserve(capacity);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        entries_.emplace_back(destination_precision);
+    }
+    heap_.reserve(capacity);
+    heap_pos_.assign(capacity, 0);
+    slots_.assign(slotCountFor(capacity), -1);
+}
+
+int32_t SpaceSaving::find(const IpAddress &key, uint64_t hash) const
+{
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        int32_t index = slots_[slot];
+        if (index < 0)
+        {
+            return -1;
+        }
+        const Entry &entry = entries_[static_cast<size_t>(index)];
+        if (entry.hash == hash && entry.key == key)
+        {
+            return index;
+        }
+    }
+}
+
+void SpaceSaving::insertSlot(uint32_t index)
+{
+    size_t mask = slots_.size() - 1;
+    size_t slot = entries_[index].hash & mask;
+    while (slots_[slot] >= 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    slots_[slot] = static_cast<int32_t>(index);
+}
+
+void SpaceSaving::eraseSlot(uint32_t index)
+{
+    size_t mask = slots_.size() - 1;
+    size_t slot = entries_[index].hash & mask;
+    while (slots_[slot] != static_cast<int32_t>(index))
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; slots_[next] >= 0; next = (next + 1) & mask)
+    {
+        size_t home = entries_[static_cast<size_t>(slots_[next])].hash & mask;
+        bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable)
+        {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    slots_[hole] = -1;
+}
+
+void SpaceSaving::swapHeap(size_t a, size_t b)
+{
+    std::swap(heap_[a], heap_[b]);
+    heap_pos_[heap_[a]] = static_cast<uint32_t>(a);
+    heap_pos_[heap_[b]] = static_cast<uint32_t>(b);
+}
+
+void SpaceSaving::siftUp(size_t position)
+{
+    while (position > 0)
+    {
+        size_t parent = (position - 1) / 2;
+        if (entries_[heap_[parent]].count <= entries_[heap_[position]].count)
+        {
+            break;
+        }
+        swapHeap(parent, position);
+        position = parent;
+    }
+}
+
+void SpaceSaving::siftDown(size_t position)
+{
+    size_t count = heap_.size();
+    for (;;)
+    {
+        size_t smallest = position;
+        size_t left = position * 2 + 1;
+        size_t right = left + 1;
+        if (left < count && entries_[heap_[left]].count < entries_[heap_[smallest]].count)
+            smallest = left;
+        if (right < count && entries_[heap_[right]].count < entries_[heap_[smallest]].count)
+            smallest = right;
+        if (smallest == position)
+        {
+            return;
+        }
+        swapHeap(position, smallest);
+        position = smallest;
+    }
+}
+
+uint64_t SpaceSaving::minimumCount() const
+{
+    return used_ < entries_.size() || heap_.empty() ? 0 : entries_[heap_[0]].count;
+}
+
+void SpaceSaving::offer(const IpAddress &key, uint64_t hash, uint64_t weight, uint64_t destination_hash)
+{
+    int32_t found = find(key, hash);
+    if (found >= 0)
+    {
+        Entry &entry = entries_[static_cast<size_t>(found)];
+        entry.count += weight;
+        entry.destinations.add(destination_hash);
+        siftDown(heap_pos_[static_cast<size_t>(found)]);
+        return;
+    }
+
+    uint32_t index;
+    if (used_ < entries_.size())
+    {
+        index = static_cast<uint32_t>(used_++);
+        Entry &entry = entries_[index];
+        entry.count = weight;
+        entry.error = 0;
+        heap_pos_[index] = static_cast<uint32_t>(heap_.size());
+        heap_.push_back(index);
+        entry.key = key;
+        entry.hash = hash;
+        entry.destinations.clear();
+        entry.destinations.add(destination_hash);
+        insertSlot(index);
+        siftUp(heap_pos_[index]);
+        return;
+    }
+
+    // Replace the minimum: the newcomer inherits its count as error
+    index = heap_[0];
+    Entry &entry = entries_[index];
+    eraseSlot(index);
+    entry.error = entry.count;
+    entry.count += weight;
+    entry.key = key;
+    entry.hash = hash;
+    entry.destinations.clear();
+    entry.destinations.add(destination_hash);
+    insertSlot(index);
+    siftDown(0);
+}
+
+bool SpaceSaving::merge(const SpaceSaving &other)
+{
+    if (other.entries_.size() != entries_.size() || other.precision_ != precision_)
+    {
+        return false;
+    }
+
+    uint64_t own_minimum = minimumCount();
+    uint64_t other_minimum = other.minimumCount();
+
+    std::vector<Entry> combined;
+    combined.reserve(used_ + other.used_);
+    for (size_t i = 0; i < used_; ++i)
+    {
+        Entry entry = entries_[i];
+        int32_t match = other.find(entry.key, entry.hash);
+        if (match >= 0)
+        {
+            const Entry &theirs = other.entries_[static_cast<size_t>(match)];
+            entry.count += theirs.count;
+            entry.error += theirs.error;
+            entry.destinations.merge(theirs.destinations);
+        }
+        else
+        {
+            entry.count += other_minimum;
+            entry.error += other_minimum;
+        }
+        combined.push_back(entry);
+    }
+    for (size_t i = 0; i < other.used_; ++i)
+    {
+        const Entry &theirs = other.entries_[i];
+        if (find(theirs.key, theirs.hash) < 0)
+        {
+            Entry entry = theirs;
+            entry.count += own_minimum;
+            entry.error += own_minimum;
+            combined.push_back(entry);
+        }
+    }
+
+    size_t keep = std::min(combined.size(), entries_.size());
+    std::partial_sort(combined.begin(), combined.begin() + static_cast<std::ptrdiff_t>(keep), combined.end(),
+                      [](const Entry &a, const Entry &b)
+                      { return a.count > b.count; });
+
+    clear();
+    for (size_t i = 0; i < keep; ++i)
+    {
+        entries_[i] = combined[i];
+        heap_pos_[i] = static_cast<uint32_t>(i);
+        heap_.push_back(static_cast<uint32_t>(i));
+        insertSlot(static_cast<uint32_t>(i));
+    }
+    used_ = keep;
+    for (size_t i = heap_.size() / 2; i-- > 0;)
+    {
+        siftDown(i);
+    }
+    return true;
+}
+
+void SpaceSaving::clear()
+{
+    used_ = 0;
+    heap_.clear();
+    std::fill(slots_.begin(), slots_.end(), -1);
+}
+
+std::vector<const SpaceSaving::Entry *> SpaceSaving::top(size_t limit) const
+{
+    std::vector<const Entry *> result;
+    result.reserve(used_);
+    for (size_t i = 0; i < used_; ++i)
+    {
+        result.push_back(&entries_[i]);
+    }
+    std::sort(result.begin(), result.end(), [](const Entry *a, const Entry *b)
+              { return a->count != b->count ? a->count > b->count : a->error < b->error; });
+    if (result.size() > limit)
+    {
+        result.resize(limit);
+    }
+    return result;
+}
+
+TrafficSketch::TrafficSketch(const Config &config)
+    : config_(config), top_sources_(config.top_sources, config.source_precision),
+      source_packets_(config.count_min_width, config.count_min_depth),
+      sources_(config.window_precision), destinations_(config.window_precision), packets_(0), bytes_(0)
+{
+}
+
+void TrafficSketch::add(const PacketFeature &packet, uint32_t wire_length)
+{
+    uint64_t source = hashAddress(packet.src_ip);
+    uint64_t destination = hashAddress(packet.dst_ip);
+    top_sources_.offer(packet.src_ip, source, wire_length, destination);
+    source_packets_.add(source);
+    sources_.add(source);
+    destinations_.add(destination);
+    packets_++;
+    bytes_ += wire_length;
+}
+
+bool TrafficSketch::merge(const TrafficSketch &other)
+{
+    const Config &theirs = other.config_;
+    if (theirs.top_sources != config_.top_sources || theirs.count_min_width != config_.count_min_width ||
+        theirs.count_min_depth != config_.count_min_depth || theirs.source_precision != config_.source_precision ||
+        theirs.window_precision != config_.window_precision)
+    {
+        return false;
+    }
+    if (!top_sources_.merge(other.top_sources_) || !source_packets_.merge(other.source_packets_) ||
+        !sources_.merge(other.sources_) || !destinations_.merge(other.destinations_))
+    {
+        return false;
+    }
+    packets_ += other.packets_;
+    bytes_ += other.bytes_;
+    return true;
+}
+
+void TrafficSketch::clear()
+{
+    top_sources_.clear();
+    source_packets_.clear();
+    sources_.clear();
+    destinations_.clear();
+    packets_ = 0;
+    bytes_ = 0;
+}
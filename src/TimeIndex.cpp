@@ -0,0 +1,298 @@
+#include "TimeIndex.h"
+#include "CivilTime.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+const char TimeIndex::MAGIC[8] = {'N', 'P', 'A', 'T', 'I', 'D', 'X', '1'};
+
+namespace
+{
+    const size_t REBUILD_CHUNK_BYTES = 1u << 20;
+
+    // Fixed-width decimal field; false on a non-digit
+    bool readDigits(const char *text, int count, int &value)
+    {
+        value = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+            if (digit > 9)
+                return false;
+            value = value * 10 + static_cast<int>(digit);
+        }
+        return true;
+    }
+}
+
+TimeIndex::TimeIndex(uint32_t block_rows, int block_ms)
+    : block_rows_(block_rows), block_us_(static_cast<int64_t>(block_ms) * 1000), file_(nullptr),
+      block_open_(false), block_(), block_row_count_(0), entry_count_(0)
+{
+}
+
+TimeIndex::~TimeIndex()
+{
+    close();
+}
+
+bool TimeIndex::open(const std::string &data_path, uint64_t data_size)
+{
+    path_ = getPath(data_path);
+    block_open_ = false;
+    entry_count_ = 0;
+
+    // Keep the entries that still describe the file; anything else is
+    // rewritten, which is cheap next to the rows it stands for
+    std::vector<Entry> entries;
+    std::string error;
+    if (data_size > 0 && !load(path_, data_size, entries, error))
+    {
+        entries.clear();
+    }
+    file_ = std::fopen(path_.c_str(), "wb");
+    if (file_ == nullptr)
+    {
+        last_error_ = "Failed to open index " + path_;
+        return false;
+    }
+    if (std::fwrite(MAGIC, sizeof(MAGIC), 1, file_) != 1)
+    {
+        last_error_ = "Error writing index " + path_;
+        return false;
+    }
+    for (const auto &entry : entries)
+    {
+        if (!writeEntry(entry))
+        {
+            return false;
+        }
+    }
+    if (data_size == 0)
+    {
+        return true;
+    }
+
+    // Rows appended after the last indexed block (a crash before the block
+    // closed, or a file written without an index)
+    uint64_t indexed_end = entries.empty() ? 0 : entries.back().offset + entries.back().bytes;
+    if (indexed_end < data_size)
+    {
+        if (!indexExistingRows(data_path, indexed_end, data_size))
+        {
+            return false;
+        }
+        std::cout << "Indexed " << (data_size - indexed_end) << " bytes of " << data_path
+                  << " missing from its time index" << std::endl;
+    }
+    return flush();
+}
+
+bool TimeIndex::indexExistingRows(const std::string &data_path, uint64_t from, uint64_t to)
+{
+    std::ifstream data(data_path, std::ios::binary);
+    if (!data.is_open())
+    {
+        last_error_ = "Failed to read " + data_path + " for indexing";
+        return false;
+    }
+    data.seekg(static_cast<std::streamoff>(from));
+
+    // From the start, the header is skipped; rows are whole lines
+    bool skip_line = from == 0;
+    uint64_t line_start = from;
+    int64_t last_us = 0;
+    std::string carry;
+    std::vector<char> chunk(REBUILD_CHUNK_BYTES);
+    uint64_t position = from;
+    while (position < to)
+    {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(chunk.size(), to - position));
+        data.read(chunk.data(), static_cast<std::streamsize>(want));
+        if (static_cast<size_t>(data.gcount()) != want)
+        {
+            last_error_ = "Failed to read " + data_path + " for indexing";
+            return false;
+        }
+        size_t begin = 0;
+        for (size_t i = 0; i < want; ++i)
+        {
+            if (chunk[i] != '\n')
+                continue;
+            uint64_t line_end = position + i + 1;
+            if (skip_line)
+            {
+                skip_line = false;
+            }
+            else
+            {
+                // The timestamp is in the first few bytes, possibly split
+                // across chunks
+                carry.append(chunk.data() + begin, std::min<size_t>(i - begin, 32));
+                int64_t micros = 0;
+                if (parseTimestamp(carry.data(), carry.size(), micros))
+                    last_us = micros;
+                addRow(line_start, line_end - line_start, last_us);
+            }
+            carry.clear();
+            line_start = line_end;
+            begin = i + 1;
+        }
+        if (carry.size() < 32)
+        {
+            carry.append(chunk.data() + begin, std::min<size_t>(want - begin, 32 - carry.size()));
+        }
+        position += want;
+    }
+    return true;
+}
+
+void TimeIndex::addRow(uint64_t offset, uint64_t length, int64_t timestamp_us)
+{
+    if (block_open_ && ((block_rows_ > 0 && block_row_count_ >= block_rows_) ||
+                        (block_us_ > 0 && timestamp_us - block_.min_us >= block_us_)))
+    {
+        writeEntry(block_);
+        block_open_ = false;
+    }
+    if (!block_open_)
+    {
+        block_.offset = offset;
+        block_.bytes = 0;
+        block_.min_us = block_.max_us = timestamp_us;
+        block_row_count_ = 0;
+        block_open_ = true;
+    }
+    block_.bytes += length;
+    block_.min_us = std::min(block_.min_us, timestamp_us);
+    block_.max_us = std::max(block_.max_us, timestamp_us);
+    block_row_count_++;
+}
+
+bool TimeIndex::writeEntry(const Entry &entry)
+{
+    if (file_ == nullptr)
+    {
+        return false;
+    }
+    uint64_t words[4] = {entry.offset, entry.bytes, static_cast<uint64_t>(entry.min_us), static_cast<uint64_t>(entry.max_us)};
+    if (std::fwrite(words, sizeof(words), 1, file_) != 1)
+    {
+        last_error_ = "Error writing index " + path_;
+        return false;
+    }
+    entry_count_++;
+    return true;
+}
+
+bool TimeIndex::flush()
+{
+    if (file_ != nullptr && (std::fflush(file_) != 0 || std::ferror(file_)))
+    {
+        last_error_ = "Error writing index " + path_;
+        return false;
+    }
+    return last_error_.empty();
+}
+
+bool TimeIndex::close()
+{
+    if (file_ == nullptr)
+    {
+        return true;
+    }
+    if (block_open_)
+    {
+        writeEntry(block_);
+        block_open_ = false;
+    }
+    bool ok = flush();
+    if (std::fclose(file_) != 0)
+    {
+        last_error_ = "Error closing index " + path_;
+        ok = false;
+    }
+    file_ = nullptr;
+    return ok;
+}
+
+bool TimeIndex::load(const std::string &index_path, uint64_t data_size, std::vector<Entry> &entries, std::string &error)
+{
+    entries.clear();
+    std::ifstream file(index_path, std::ios::binary);
+    if (!file.is_open())
+    {
+        error = "No index " + index_path;
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error = index_path + " is not a time index";
+        return false;
+    }
+
+    // Entries are contiguous; the first one not fitting the file (or not
+    // following its predecessor) ends the usable part
+    uint64_t words[4];
+    uint64_t expected = 0;
+    while (file.read(reinterpret_cast<char *>(words), sizeof(words)))
+    {
+        Entry entry{words[0], words[1], static_cast<int64_t>(words[2]), static_cast<int64_t>(words[3])};
+        if ((!entries.empty() && entry.offset != expected) || entry.bytes == 0 || entry.offset > data_size ||
+            entry.bytes > data_size - entry.offset)
+        {
+            break;
+        }
+        entries.push_back(entry);
+        expected = entry.offset + entry.bytes;
+    }
+    return true;
+}
+
+void TimeIndex::findBlocks(const std::vector<Entry> &entries, int64_t from_us, int64_t to_us, size_t &first, size_t &last)
+{
+    // Running maximum from the front and minimum from the back: every block
+    // before first has only rows earlier than from_us, every block from last
+    // on only rows at or after to_us
+    std::vector<int64_t> running_max(entries.size());
+    std::vector<int64_t> running_min(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        running_max[i] = i == 0 ? entries[i].max_us : std::max(running_max[i - 1], entries[i].max_us);
+    }
+    for (size_t i = entries.size(); i-- > 0;)
+    {
+        running_min[i] = i + 1 == entries.size() ? entries[i].min_us : std::min(running_min[i + 1], entries[i].min_us);
+    }
+    first = static_cast<size_t>(std::partition_point(running_max.begin(), running_max.end(),
+                                                     [from_us](int64_t value) { return value < from_us; }) -
+                                running_max.begin());
+    last = static_cast<size_t>(std::partition_point(running_min.begin(), running_min.end(),
+                                                    [to_us](int64_t value) { return value < to_us; }) -
+                               running_min.begin());
+    if (last < first)
+    {
+        last = first;
+    }
+}
+
+bool TimeIndex::parseTimestamp(const char *text, size_t length, int64_t &micros)
+{
+    // 0123456789012345678901234
+    // YYYY-MM-DD HH:MM:SS.ffffff
+    int year, month, day, hour, minute, second, fraction;
+    if (length < 26 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' || text[16] != ':' ||
+        text[19] != '.' || !readDigits(text, 4, year) || !readDigits(text + 5, 2, month) ||
+        !readDigits(text + 8, 2, day) || !readDigits(text + 11, 2, hour) || !readDigits(text + 14, 2, minute) ||
+        !readDigits(text + 17, 2, second) || !readDigits(text + 20, 6, fraction) || month < 1 || month > 12 ||
+        day < 1 || day > 31)
+    {
+        return false;
+    }
+    int64_t epoch = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400 +
+                    hour * 3600 + minute * 60 + second;
+    micros = epoch * 1000000 + fraction;
+    return true;
+}
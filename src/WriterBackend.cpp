@@ -0,0 +1,777 @@
+#include "WriterBackend.h"
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(IORING_FEAT_SINGLE_MMAP) && defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define WRITER_BACKEND_URING 1
+#endif
+#endif
+#endif
+
+namespace
+{
+    inline size_t alignUp(size_t size, size_t alignment)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    void freeAligned(void *memory)
+    {
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+
+    void *allocateAligned(size_t size)
+    {
+#ifdef _WIN32
+        return _aligned_malloc(size, WriterBackend::DIRECT_ALIGNMENT);
+#else
+        void *memory = nullptr;
+        return posix_memalign(&memory, WriterBackend::DIRECT_ALIGNMENT, size) == 0 ? memory : nullptr;
+#endif
+    }
+
+    std::string describeErrno(const std::string &what)
+    {
+        return what + ": " + std::strerror(errno);
+    }
+
+    // ---------------------------------------------------------------- posix
+
+    class PosixWriterBackend : public WriterBackend
+    {
+    public:
+        explicit PosixWriterBackend(const Options &options) : WriterBackend(options) {}
+
+        ~PosixWriterBackend() override
+        {
+            close();
+        }
+
+        std::string getName() const override { return direct_active_ ? "posix-direct" : "posix"; }
+
+    protected:
+        bool submitBuffer(size_t index) override
+        {
+            Buffer &buffer = buffers_[index];
+            size_t done = 0;
+            while (done < buffer.used)
+            {
+#ifdef _WIN32
+                if (_lseeki64(fd_, static_cast<__int64>(buffer.offset + done), SEEK_SET) < 0)
+                {
+                    last_error_ = describeErrno("Seek failed");
+                    return false;
+                }
+                int written = _write(fd_, buffer.data + done, static_cast<unsigned int>(buffer.used - done));
+#else
+                ssize_t written = ::pwrite(fd_, buffer.data + done, buffer.used - done,
+                                           static_cast<off_t>(buffer.offset + done));
+#endif
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    last_error_ = describeErrno("Write failed");
+                    return false;
+                }
+                done += static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        bool waitBuffer(size_t) override
+        {
+            return true;
+        }
+    };
+
+#ifdef WRITER_BACKEND_URING
+    // ---------------------------------------------------------------- io_uring
+    // Raw system calls, so no liburing is needed. One write per buffer is in
+    // flight at most; the buffers and the file are registered with the ring
+    // when the kernel and RLIMIT_MEMLOCK allow it.
+
+    int uringSetup(unsigned entries, struct io_uring_params *params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int uringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int uringRegister(int ring_fd, unsigned opcode, const void *arg, unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, count));
+    }
+
+    class UringWriterBackend : public WriterBackend
+    {
+    public:
+        explicit UringWriterBackend(const Options &options)
+            : WriterBackend(options), ring_fd_(-1), ring_memory_(MAP_FAILED), ring_bytes_(0),
+              sqes_(static_cast<struct io_uring_sqe *>(MAP_FAILED)), sqes_bytes_(0),
+              fixed_buffers_(false), fixed_file_(false), failed_(false)
+        {
+        }
+
+        ~UringWriterBackend() override
+        {
+            close();
+            releaseRing();
+        }
+
+        std::string getName() const override { return direct_active_ ? "uring-direct" : "uring"; }
+
+    protected:
+        bool onOpen() override
+        {
+            failed_ = false;
+            progress_.assign(buffers_.size(), 0);
+            if (ring_fd_ >= 0)
+            {
+                return registerFile();
+            }
+
+            struct io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            unsigned entries = 4;
+            while (entries < buffers_.size())
+                entries <<= 1;
+            ring_fd_ = uringSetup(entries, &params);
+            if (ring_fd_ < 0)
+            {
+                last_error_ = describeErrno("io_uring_setup failed");
+                return false;
+            }
+
+            // One mapping holds both rings (IORING_FEAT_SINGLE_MMAP)
+            size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            size_t cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            ring_bytes_ = sq_bytes > cq_bytes ? sq_bytes : cq_bytes;
+            ring_memory_ = mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ring_fd_, IORING_OFF_SQ_RING);
+            sqes_bytes_ = params.sq_entries * sizeof(struct io_uring_sqe);
+            sqes_ = static_cast<struct io_uring_sqe *>(mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE,
+                                                            MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+            if (ring_memory_ == MAP_FAILED || sqes_ == MAP_FAILED)
+            {
+                last_error_ = describeErrno("io_uring mmap failed");
+                releaseRing();
+                return false;
+            }
+            char *ring = static_cast<char *>(ring_memory_);
+            sq_tail_ = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+            cq_head_ = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<struct io_uring_cqe *>(ring + params.cq_off.cqes);
+
+            std::vector<struct iovec> vectors(buffers_.size());
+            for (size_t i = 0; i < buffers_.size(); ++i)
+            {
+                vectors[i].iov_base = buffers_[i].data;
+                vectors[i].iov_len = options_.buffer_bytes;
+            }
+            fixed_buffers_ = uringRegister(ring_fd_, IORING_REGISTER_BUFFERS, vectors.data(),
+                                           static_cast<unsigned>(vectors.size())) == 0;
+            return registerFile();
+        }
+
+        void onClose() override
+        {
+            if (fixed_file_)
+            {
+                uringRegister(ring_fd_, IORING_UNREGISTER_FILES, nullptr, 0);
+                fixed_file_ = false;
+            }
+        }
+
+        bool submitBuffer(size_t index) override
+        {
+            progress_[index] = 0;
+            buffers_[index].in_flight = true;
+            return queueWrite(index);
+        }
+
+        bool waitBuffer(size_t index) override
+        {
+            while (buffers_[index].in_flight && !failed_)
+            {
+                reap();
+                if (!buffers_[index].in_flight || failed_)
+                    break;
+                if (uringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                {
+                    last_error_ = describeErrno("io_uring_enter failed");
+                    failed_ = true;
+                }
+            }
+            if (failed_)
+            {
+                // The ring is abandoned; nothing more is waited for
+                for (Buffer &buffer : buffers_)
+                    buffer.in_flight = false;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        int ring_fd_;
+        void *ring_memory_;
+        size_t ring_bytes_;
+        struct io_uring_sqe *sqes_;
+        size_t sqes_bytes_;
+        unsigned *sq_tail_;
+        unsigned sq_mask_;
+        unsigned *sq_array_;
+        unsigned *cq_head_;
+        unsigned *cq_tail_;
+        unsigned cq_mask_;
+        struct io_uring_cqe *cqes_;
+        bool fixed_buffers_;
+        bool fixed_file_;
+        bool failed_;
+        std::vector<size_t> progress_; // bytes of each in-flight buffer already written
+
+        bool registerFile()
+        {
+            fixed_file_ = uringRegister(ring_fd_, IORING_REGISTER_FILES, &fd_, 1) == 0;
+            return true;
+        }
+
+        void releaseRing()
+        {
+            if (sqes_ != MAP_FAILED)
+                munmap(sqes_, sqes_bytes_);
+            if (ring_memory_ != MAP_FAILED)
+                munmap(ring_memory_, ring_bytes_);
+            if (ring_fd_ >= 0)
+                ::close(ring_fd_);
+            sqes_ = static_cast<struct io_uring_sqe *>(MAP_FAILED);
+            ring_memory_ = MAP_FAILED;
+            ring_fd_ = -1;
+        }
+
+        // Queues the unwritten rest of buffer index
+        bool queueWrite(size_t index)
+        {
+            const Buffer &buffer = buffers_[index];
+            size_t done = progress_[index];
+            unsigned tail = *sq_tail_;
+            unsigned slot = tail & sq_mask_;
+            struct io_uring_sqe *sqe = &sqes_[slot];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = fixed_buffers_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->fd = fixed_file_ ? 0 : fd_;
+            sqe->flags = fixed_file_ ? IOSQE_FIXED_FILE : 0;
+            sqe->addr = reinterpret_cast<uint64_t>(buffer.data + done);
+            sqe->len = static_cast<uint32_t>(buffer.used - done);
+            sqe->off = buffer.offset + done;
+            sqe->buf_index = static_cast<uint16_t>(index);
+            sqe->user_data = index;
+            sq_array_[slot] = slot;
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+            while (uringEnter(ring_fd_, 1, 0, 0) < 0)
+            {
+                if (errno != EINTR)
+                {
+                    last_error_ = describeErrno("io_uring_enter failed");
+                    failed_ = true;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void reap()
+        {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head)
+            {
+                const struct io_uring_cqe &cqe = cqes_[head & cq_mask_];
+                size_t index = static_cast<size_t>(cqe.user_data);
+                if (index >= buffers_.size())
+                    continue;
+                if (cqe.res < 0)
+                {
+                    errno = -cqe.res;
+                    last_error_ = describeErrno("Write failed");
+                    failed_ = true;
+                    continue;
+                }
+                progress_[index] += static_cast<size_t>(cqe.res);
+                if (progress_[index] >= buffers_[index].used)
+                {
+                    buffers_[index].in_flight = false;
+                }
+                else if (cqe.res == 0)
+                {
+                    last_error_ = "Write made no progress";
+                    failed_ = true;
+                }
+                else
+                {
+                    queueWrite(index); // short write: the rest goes in again
+                }
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        }
+    };
+#endif
+}
+
+WriterBackend::WriterBackend(const Options &options)
+    : options_(options), fd_(-1), direct_active_(false), memory_(nullptr, freeAligned), current_(0),
+      logical_size_(0), base_size_(0), completed_size_(0), durable_size_(0), sync_count_(0), sync_stop_(false),
+      sync_requested_at_(0)
+{
+    options_.buffer_bytes = alignUp(options_.buffer_bytes > 0 ? options_.buffer_bytes : 1, DIRECT_ALIGNMENT);
+    if (options_.buffer_count < 2)
+        options_.buffer_count = 2;
+}
+
+WriterBackend::~WriterBackend()
+{
+    // Subclasses close in their own destructor, while their overrides exist
+}
+
+bool WriterBackend::open(const std::string &path, bool append)
+{
+    close();
+    last_error_.clear();
+    if (!memory_)
+    {
+        memory_.reset(static_cast<char *>(allocateAligned(options_.buffer_bytes * options_.buffer_count)));
+        if (!memory_)
+        {
+            last_error_ = "Failed to allocate write buffers";
+            return false;
+        }
+        buffers_.resize(static_cast<size_t>(options_.buffer_count));
+        for (size_t i = 0; i < buffers_.size(); ++i)
+        {
+            buffers_[i].data = memory_.get() + i * options_.buffer_bytes;
+        }
+    }
+
+#ifdef _WIN32
+    int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (append ? 0 : _O_TRUNC);
+    fd_ = _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+    direct_active_ = false;
+#else
+    // Positioned writes, so no O_APPEND: completions may arrive out of order
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC);
+    direct_active_ = false;
+#ifdef O_DIRECT
+    if (options_.direct)
+    {
+        // Read access for carrying the tail block of an existing file
+        fd_ = ::open(path.c_str(), (flags & ~O_WRONLY) | O_RDWR | O_DIRECT, 0644);
+        direct_active_ = fd_ >= 0;
+    }
+#endif
+    if (fd_ < 0)
+    {
+        // Also covers file systems without O_DIRECT support (EINVAL)
+        fd_ = ::open(path.c_str(), flags, 0644);
+    }
+#endif
+    if (fd_ < 0)
+    {
+        last_error_ = describeErrno("Failed to open " + path);
+        return false;
+    }
+
+#ifdef _WIN32
+    __int64 size = append ? _lseeki64(fd_, 0, SEEK_END) : 0;
+#else
+    off_t size = append ? ::lseek(fd_, 0, SEEK_END) : 0;
+#endif
+    if (size < 0)
+    {
+        last_error_ = describeErrno("Failed to size " + path);
+        close();
+        return false;
+    }
+    base_size_ = logical_size_ = static_cast<uint64_t>(size);
+    completed_size_ = durable_size_ = sync_requested_at_ = logical_size_;
+    sync_count_ = 0;
+    sync_error_.clear();
+
+    for (Buffer &buffer : buffers_)
+    {
+        buffer.used = 0;
+        buffer.in_flight = false;
+    }
+    current_ = 0;
+    Buffer &first = buffers_[0];
+    first.offset = logical_size_;
+#ifndef _WIN32
+    size_t partial = static_cast<size_t>(logical_size_ % DIRECT_ALIGNMENT);
+    if (direct_active_ && partial > 0)
+    {
+        // Direct writes start on a block boundary: carry the existing tail
+        first.offset = logical_size_ - partial;
+        if (::pread(fd_, first.data, DIRECT_ALIGNMENT, static_cast<off_t>(first.offset)) != static_cast<ssize_t>(partial))
+        {
+            last_error_ = describeErrno("Failed to read the tail of " + path);
+            close();
+            return false;
+        }
+        first.used = partial;
+    }
+#endif
+
+    if (!onOpen())
+    {
+        close();
+        return false;
+    }
+    if (options_.durability == Durability::PERIODIC)
+    {
+        sync_stop_ = false;
+        syncer_ = std::thread(&WriterBackend::syncLoop, this);
+    }
+    return true;
+}
+
+bool WriterBackend::write(const char *data, size_t size)
+{
+    if (fd_ < 0)
+    {
+        last_error_ = "Write to a closed file";
+        return false;
+    }
+    logical_size_ += size;
+    while (size > 0)
+    {
+        Buffer &buffer = buffers_[current_];
+        size_t chunk = options_.buffer_bytes - buffer.used;
+        if (chunk > size)
+            chunk = size;
+        std::memcpy(buffer.data + buffer.used, data, chunk);
+        buffer.used += chunk;
+        data += chunk;
+        size -= chunk;
+        if (buffer.used == options_.buffer_bytes && !submitCurrent(false))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WriterBackend::submitCurrent(bool pad)
+{
+    Buffer &buffer = buffers_[current_];
+    if (buffer.used == 0)
+    {
+        return true;
+    }
+
+    size_t submit_size = buffer.used;
+    size_t keep = 0;
+    if (direct_active_)
+    {
+        // Whole blocks only; the partial block moves on to the next buffer,
+        // written padded now as well when pad is set
+        size_t whole = buffer.used & ~(DIRECT_ALIGNMENT - 1);
+        keep = buffer.used - whole;
+        submit_size = whole;
+        if (pad && keep > 0)
+        {
+            std::memset(buffer.data + buffer.used, 0, DIRECT_ALIGNMENT - keep);
+            submit_size = whole + DIRECT_ALIGNMENT;
+        }
+        if (submit_size == 0)
+        {
+            return true;
+        }
+    }
+
+    size_t next_index = (current_ + 1) % buffers_.size();
+    if (!waitBuffer(next_index))
+    {
+        return false;
+    }
+    Buffer &next = buffers_[next_index];
+    next.offset = buffer.offset + (buffer.used - keep);
+    std::memcpy(next.data, buffer.data + buffer.used - keep, keep);
+    next.used = keep;
+
+    buffer.used = submit_size;
+    if (!submitBuffer(current_))
+    {
+        return false;
+    }
+    current_ = next_index;
+    updateCompleted();
+    return true;
+}
+
+void WriterBackend::updateCompleted()
+{
+    // Everything below the oldest write still in flight, or below the
+    // buffer being filled, has reached the file
+    uint64_t completed = buffers_[current_].offset;
+    for (const Buffer &buffer : buffers_)
+    {
+        if (buffer.in_flight && buffer.offset < completed)
+            completed = buffer.offset;
+    }
+    completed_size_.store(completed, std::memory_order_release);
+
+    if (options_.durability == Durability::PERIODIC && completed - sync_requested_at_ >= options_.sync_bytes)
+    {
+        sync_requested_at_ = completed;
+        {
+            std::lock_guard<std::mutex> lock(sync_mutex_);
+        }
+        sync_wake_.notify_one();
+    }
+}
+
+bool WriterBackend::syncFile()
+{
+#if defined(_WIN32)
+    int result = _commit(fd_);
+#elif defined(__linux__)
+    int result = ::fdatasync(fd_);
+#else
+    int result = ::fsync(fd_);
+#endif
+    if (result != 0)
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex_);
+        sync_error_ = describeErrno("fdatasync failed");
+        return false;
+    }
+    return true;
+}
+
+void WriterBackend::syncLoop()
+{
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    while (!sync_stop_)
+    {
+        sync_wake_.wait_for(lock, std::chrono::milliseconds(options_.sync_interval_ms), [this]()
+                            { return sync_stop_ || completed_size_.load() - durable_size_.load() >= options_.sync_bytes; });
+        uint64_t target = completed_size_.load(std::memory_order_acquire);
+        if (sync_stop_ || target == durable_size_.load())
+        {
+            continue;
+        }
+        // One call covers every write completed so far
+        lock.unlock();
+        bool ok = syncFile();
+        lock.lock();
+        if (ok)
+        {
+            durable_size_ = target;
+            sync_count_++;
+        }
+    }
+}
+
+bool WriterBackend::checkSyncError()
+{
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    if (sync_error_.empty())
+    {
+        return true;
+    }
+    last_error_ = sync_error_;
+    return false;
+}
+
+bool WriterBackend::submit()
+{
+    return fd_ < 0 || (submitCurrent(false) && checkSyncError());
+}
+
+bool WriterBackend::flush()
+{
+    if (fd_ < 0)
+    {
+        return true;
+    }
+    bool ok = submitCurrent(true);
+    for (size_t i = 0; i < buffers_.size(); ++i)
+    {
+        ok = waitBuffer(i) && ok;
+    }
+    updateCompleted();
+#ifndef _WIN32
+    if (ok && direct_active_ && logical_size_ % DIRECT_ALIGNMENT != 0 &&
+        ::ftruncate(fd_, static_cast<off_t>(logical_size_)) != 0)
+    {
+        last_error_ = describeErrno("Failed to trim the padded block");
+        ok = false;
+    }
+#endif
+    return ok;
+}
+
+bool WriterBackend::close()
+{
+    if (fd_ < 0)
+    {
+        return true;
+    }
+    bool ok = flush();
+    if (syncer_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(sync_mutex_);
+            sync_stop_ = true;
+        }
+        sync_wake_.notify_one();
+        syncer_.join();
+    }
+    ok = ok && checkSyncError();
+    if (ok && options_.durability != Durability::NONE)
+    {
+        ok = syncFile() && checkSyncError();
+        if (ok)
+        {
+            durable_size_ = logical_size_;
+            sync_count_++;
+        }
+    }
+    onClose();
+#ifdef _WIN32
+    ok = _close(fd_) == 0 && ok;
+#else
+    ok = ::close(fd_) == 0 && ok;
+#endif
+    fd_ = -1;
+    return ok;
+}
+
+bool WriterBackend::isUringAvailable()
+{
+#ifdef WRITER_BACKEND_URING
+    static const bool available = []()
+    {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = uringSetup(2, &params);
+        if (fd < 0)
+            return false; // old kernel, or io_uring disabled (e.g. by seccomp)
+        ::close(fd);
+        return (params.features & IORING_FEAT_SINGLE_MMAP) != 0 && (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<WriterBackend> WriterBackend::create(const Options &options)
+{
+#ifdef WRITER_BACKEND_URING
+    if (options.type != WriterBackendType::POSIX && isUringAvailable())
+    {
+        return std::unique_ptr<WriterBackend>(new UringWriterBackend(options));
+    }
+#endif
+    return std::unique_ptr<WriterBackend>(new PosixWriterBackend(options));
+}
+
+bool WriterBackend::parseDurability(const std::string &spec, Options &options, std::string &error)
+{
+    if (spec == "none" || spec.empty())
+    {
+        options.durability = Durability::NONE;
+        return true;
+    }
+    if (spec == "close")
+    {
+        options.durability = Durability::CLOSE;
+        return true;
+    }
+    if (spec.compare(0, 8, "periodic") != 0 || (spec.size() > 8 && spec[8] != ':'))
+    {
+        error = "Unknown durability '" + spec + "' (expected none, close or periodic[:<ms>[:<mb>]])";
+        return false;
+    }
+
+    // periodic[:<ms>[:<mb>]]
+    long long values[2] = {options.sync_interval_ms, static_cast<long long>(options.sync_bytes >> 20)};
+    size_t position = 8;
+    for (int i = 0; i < 2 && position < spec.size(); ++i)
+    {
+        size_t next = spec.find(':', position + 1);
+        std::string text = spec.substr(position + 1, next == std::string::npos ? std::string::npos : next - position - 1);
+        char *end = nullptr;
+        values[i] = std::strtoll(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || values[i] < 1 || values[i] > 86400000)
+        {
+            error = "Invalid durability value '" + text + "' in '" + spec + "'";
+            return false;
+        }
+        position = next == std::string::npos ? spec.size() : next;
+    }
+    if (position < spec.size())
+    {
+        error = "Too many values in durability '" + spec + "'";
+        return false;
+    }
+    options.durability = Durability::PERIODIC;
+    options.sync_interval_ms = static_cast<int>(values[0]);
+    options.sync_bytes = static_cast<uint64_t>(values[1]) << 20;
+    return true;
+}
+
+bool WriterBackend::parseSpec(const std::string &spec, Options &options, std::string &error)
+{
+    size_t colon = spec.find(':');
+    std::string name = spec.substr(0, colon);
+    std::string flag = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if (name == "auto" || name.empty())
+        options.type = WriterBackendType::AUTO;
+    else if (name == "posix")
+        options.type = WriterBackendType::POSIX;
+    else if (name == "uring" || name == "io_uring")
+        options.type = WriterBackendType::URING;
+    else
+    {
+        error = "Unknown writer backend '" + name + "' (expected auto, posix or uring)";
+        return false;
+    }
+    if (!flag.empty() && flag != "direct")
+    {
+        error = "Unknown writer option '" + flag + "' (expected direct)";
+        return false;
+    }
+    options.direct = flag == "direct";
+    return true;
+}
@@ -1,50 +1,101 @@
-#include "PacketCapturer.h"
-#include "PacketParser.h"
-#include "DatasetWriter.h"
+#include "CaptureSession.h"
+#include "CaptureDaemon.h"
+#include "Benchmarks.h"
 #include <iostream>
 #include <signal.h>
-#include <memory>
-#include <atomic>
-#include <chrono>
-#include <iomanip>
-#include <thread>
 #include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <map>
 #include <filesystem>
 #include <system_error>
 
-std::atomic<bool> keep_running(true);
-
-void signalHandler(int signal)
+void signalHandler(int)
 {
-    std::cout << "\nReceived signal " << signal << ". Stopping capture..." << std::endl;
-    keep_running = false;
+    // Only reached on platforms without signalfd; the capture loop reports the stop
+    CaptureLoop::notifySignal();
 }
 
-enum class IPVersionFilter
+void triggerSignalHandler(int)
 {
-    IPv4_ONLY,
-    IPv6_ONLY,
-    ALL,
-    ICMP_ONLY,
-    BGP_ONLY
+    // Only reached on platforms without signalfd; the capture loop runs the dump
+    CaptureLoop::notifyTriggerSignal();
+}
+
+// Options recognised after the positional arguments (--name value)
+const char *const KNOWN_OPTIONS[] = {
+    "--stream",
+    "--sink",
+    "--columns",
+    "--tunnel-depth",
+    "--ring",
+    "--ring-mb",
+    "--ring-trigger-pps",
+    "--writer",
+    "--durability",
+    "--backpressure",
+    "--queue-mb",
+    "--reorder-ms",
+    "--reorder-mb",
+    "--dedup",
+    "--enrich",
+    "--labels",
+    "--anonymize",
+    "--anonymize-key",
+    "--split",
+    "--split-seed",
+    "--index-rows",
+    "--index-ms",
 };
 
-std::string getIPVersionFilterString(IPVersionFilter filter)
+bool extractOptions(int &argc, char **argv, std::map<std::string, std::string> &options)
 {
-    switch (filter)
-    {
-    case IPVersionFilter::IPv4_ONLY:
-        return "ip";
-    case IPVersionFilter::IPv6_ONLY:
-        return "ip6";
-    case IPVersionFilter::ALL:
-        return "";
-    case IPVersionFilter::ICMP_ONLY:
-        return "icmp or icmp6";
-    case IPVersionFilter::BGP_ONLY:
-        return "tcp port 179";
-    }
-    return "";
+    int kept = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--", 2) != 0)
+        {
+            argv[kept++] = argv[i];
+            continue;
+        }
+
+        bool known = false;
+        for (const char *name : KNOWN_OPTIONS)
+        {
+            known = known || strcmp(argv[i], name) == 0;
+        }
+        if (!known || i + 1 >= argc)
+        {
+            std::cerr << "Error: " << (known ? "Missing value for option " : "Unknown option ") << argv[i] << std::endl;
+            return false;
+        }
+        // Repeated options accumulate as a comma-separated list
+        std::string &value = options[argv[i]];
+        value += (value.empty() ? "" : ",") + std::string(argv[i + 1]);
+        ++i;
+    }
+    argc = kept;
+    return true;
+}
+
+// Integer option in [min, max]; an absent option leaves value unchanged
+bool parseIntegerOption(std::map<std::string, std::string> &options, const char *name, long long min, long long max,
+                        long long &value)
+{
+    const std::string &text = options[name];
+    if (text.empty())
+    {
+        return true;
+    }
+    char *end = nullptr;
+    long long parsed = std::strtoll(text.c_str(), &end, 10);
+    if (*end != '\0' || parsed < min || parsed > max)
+    {
+        std::cerr << "Error: Invalid value '" << text << "' for " << name << std::endl;
+        return false;
+    }
+    value = parsed;
+    return true;
 }
 
 void printUsage(const char *program_name)
@@ -52,15 +103,58 @@ void printUsage(const char *program_name)
     std::cout << "Usage: " << program_name << " [options]" << std::endl;
     std::cout << "\nModes:" << std::endl;
     std::cout << "  --list-interfaces    List all network interfaces in JSON format" << std::endl;
+    std::cout << "  --daemon [socket] [outputDir]" << std::endl;
+    std::cout << "                       Run as a capture service controlled over a Unix socket" << std::endl;
+    std::cout << "  --bench-kernels [n]  Check and time the payload byte-counting kernels on n synthetic payloads" << std::endl;
+    std::cout << "  --bench-writer [mb] [dir] Compare the CSV writer backends on mb MiB of output (default 1024)" << std::endl;
     std::cout << "  (no args)            Interactive mode with prompts" << std::endl;
     std::cout << "\nAPI Format (for web backend):" << std::endl;
     std::cout << "  " << program_name << " <output> <interface> <filter> <duration> [promiscuous] [stopFile]" << std::endl;
     std::cout << "    output      - CSV filename" << std::endl;
-    std::cout << "    interface   - 'auto' or device path" << std::endl;
+    std::cout << "    interface   - 'auto', a device path, or devices separated by commas (merged by timestamp)" << std::endl;
     std::cout << "    filter      - ipv4|ipv6|both|all|icmp|bgp" << std::endl;
     std::cout << "    duration    - seconds (0 = unlimited)" << std::endl;
     std::cout << "    promiscuous - on|off (default: on)" << std::endl;
     std::cout << "    stopFile   - optional path to a stop-signal file" << std::endl;
+    std::cout << "\nOptions (API and legacy formats):" << std::endl;
+    std::cout << "  --stream <socket>    Publish live rows and per-second stats on a Unix socket" << std::endl;
+    std::cout << "  --sink <type:target> Additional output, repeatable; written alongside the main CSV" << std::endl;
+    std::cout << "                       csv:<file>[:ipv4|ipv6|both]  binary:<file>  live:<socket>[:stats]" << std::endl;
+    std::cout << "                       sketch:<file>[:seconds] (per-window top sources, default 10 s)" << std::endl;
+    std::cout << "                       npy:<file>[:bytes] (leading payload bytes per row, default 64)" << std::endl;
+    std::cout << "  --columns <groups>   Extra CSV column groups, comma-separated:" << std::endl;
+    std::cout << "                       fragment - ports, TCP flags, fragment reassembly tracking" << std::endl;
+    std::cout << "                       tunnel   - GRE/IP-in-IP/6in4/VXLAN/GENEVE layers and inner packet" << std::endl;
+    std::cout << "                       host     - per-host activity over the last 2 s and last 100 packets" << std::endl;
+    std::cout << "                       payload  - payload bytes, entropy, printable ratio, 16-bucket histogram" << std::endl;
+    std::cout << "                       interface - capture interface (always on with several interfaces)" << std::endl;
+    std::cout << "  --tunnel-depth <n>   Encapsulation layers to remove (0-4, default 2 with tunnel columns)" << std::endl;
+    std::cout << "  --ring <seconds>     Keep the last seconds of raw packets in memory; SIGUSR1 dumps them" << std::endl;
+    std::cout << "                       to <output>-ring-<time>-<n>.pcapng" << std::endl;
+    std::cout << "  --ring-mb <n>        Memory cap of the packet ring (default 64)" << std::endl;
+    std::cout << "  --ring-trigger-pps <n> Also dump when a second of capture reaches n packets" << std::endl;
+    std::cout << "  --writer <backend>   CSV file writing: auto, posix or uring, optionally :direct for O_DIRECT" << std::endl;
+    std::cout << "  --durability <mode>  none, close (fdatasync at close) or periodic[:<ms>[:<mb>]]" << std::endl;
+    std::cout << "                       (group-commit fdatasync, default every 1000 ms or 64 MiB)" << std::endl;
+    std::cout << "  --backpressure <p>   When an output falls behind: block (default), drop-newest, drop-oldest," << std::endl;
+    std::cout << "                       sample[:<n>] (keep 1 in n batches) or spill[:<dir>] (overflow to disk)" << std::endl;
+    std::cout << "  --queue-mb <n>       Memory cap of each output's queue (default 256)" << std::endl;
+    std::cout << "  --reorder-ms <n>     With several interfaces: how long a frame waits for the others (default 100)" << std::endl;
+    std::cout << "  --reorder-mb <n>     Memory cap of the interface merge buffers (default 64)" << std::endl;
+    std::cout << "  --dedup <ms>         Drop repeated frames seen within ms (SPAN/mirror ports), before parsing" << std::endl;
+    std::cout << "  --enrich <lists>     Label addresses from prefix lists, kind=file comma-separated with kind" << std::endl;
+    std::cout << "                       asn, subnet or geo; lists are reloaded when their files change" << std::endl;
+    std::cout << "  --labels <file>      Ground-truth Label column from a rules file (first matching rule wins)" << std::endl;
+    std::cout << "  --anonymize <ids>    Rewrite identifiers in all outputs: ip (prefix-preserving), ports, ipid," << std::endl;
+    std::cout << "                       flowlabel, tunnelid (keyed permutations) or all, comma-separated" << std::endl;
+    std::cout << "  --anonymize-key <file> 64 hex digits; the same key maps hosts alike across captures" << std::endl;
+    std::cout << "                       (default: a random key per run; implies --anonymize ip)" << std::endl;
+    std::cout << "  --split <splits>     Split the CSV output by flow into one file per split, name=weight" << std::endl;
+    std::cout << "                       comma-separated (e.g. train=0.8,validation=0.1,test=0.1)" << std::endl;
+    std::cout << "  --split-seed <n>     Key of the flow hash choosing the split (default 0)" << std::endl;
+    std::cout << "  --index-rows <n>     Time index next to the CSV (<file>.idx, for DatasetSlice), one entry" << std::endl;
+    std::cout << "                       per n rows" << std::endl;
+    std::cout << "  --index-ms <ms>      ... or per ms of capture time; with both, whichever comes first" << std::endl;
     std::cout << "\nLegacy Format:" << std::endl;
     std::cout << "  " << program_name << " <output> <type> <promiscuous> [interface]" << std::endl;
     std::cout << "    output      - CSV filename" << std::endl;
@@ -76,9 +170,6 @@ void printUsage(const char *program_name)
 
 int main(int argc, char *argv[])
 {
-    // Reset global flag in case of reuse
-    keep_running = true;
-
     // Handle special mode: --list-interfaces (output JSON for API)
     if (argc >= 2 && strcmp(argv[1], "--list-interfaces") == 0)
     {
@@ -87,9 +178,147 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    // Handle special mode: --daemon [socketPath] [outputDir] (long-running capture service)
+    if (argc >= 2 && strcmp(argv[1], "--daemon") == 0)
+    {
+        std::string socket_path = argc >= 3 ? argv[2] : CaptureDaemon::DEFAULT_SOCKET_PATH;
+        std::string output_dir = argc >= 4 ? argv[3] : "";
+        signal(SIGINT, signalHandler);
+        signal(SIGTERM, signalHandler);
+        CaptureDaemon daemon(socket_path, output_dir);
+        return daemon.run();
+    }
+
+    // Handle special mode: --bench-kernels [count] (offline kernel check and timing)
+    if (argc >= 2 && strcmp(argv[1], "--bench-kernels") == 0)
+    {
+        size_t count = argc >= 3 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+        return runKernelBenchmark(count > 0 ? count : 100000);
+    }
+
+    // Handle special mode: --bench-writer [megabytes] [directory] (writer backend comparison)
+    if (argc >= 2 && strcmp(argv[1], "--bench-writer") == 0)
+    {
+        size_t megabytes = argc >= 3 ? std::strtoul(argv[2], nullptr, 10) : 1024;
+        return runWriterBenchmark(megabytes > 0 ? megabytes : 1024, argc >= 4 ? argv[3] : ".");
+    }
+
     std::cout << "=== Network Packet Analyzer ===" << std::endl;
 
+    std::map<std::string, std::string> options;
+    uint32_t column_groups = 0;
+    std::string option_error;
+    if (!extractOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (!DatasetWriter::parseColumnGroups(options["--columns"], column_groups, option_error))
+    {
+        std::cerr << "Error: " << option_error << std::endl;
+        return 1;
+    }
+    std::vector<PrefixSource> enrich_sources;
+    if (!options["--enrich"].empty() && !PrefixEnricher::parseSpec(options["--enrich"], enrich_sources, option_error))
+    {
+        std::cerr << "Error: " << option_error << std::endl;
+        return 1;
+    }
+    uint32_t anonymize_fields = 0;
+    if (!options["--anonymize"].empty() && !Anonymizer::parseFields(options["--anonymize"], anonymize_fields, option_error))
+    {
+        std::cerr << "Error: " << option_error << std::endl;
+        return 1;
+    }
+    if (anonymize_fields == 0 && !options["--anonymize-key"].empty())
+    {
+        anonymize_fields = ANONYMIZE_ADDRESSES;
+    }
+    std::vector<DatasetSplit> splits;
+    if (!options["--split"].empty() && !DatasetWriter::parseSplits(options["--split"], splits, option_error))
+    {
+        std::cerr << "Error: " << option_error << std::endl;
+        return 1;
+    }
+    int tunnel_depth = -1;
+    if (!options["--tunnel-depth"].empty())
+    {
+        char *end = nullptr;
+        long depth = std::strtol(options["--tunnel-depth"].c_str(), &end, 10);
+        if (*end != '\0' || depth < 0 || depth > TunnelFeature::MAX_DEPTH)
+        {
+            std::cerr << "Error: Invalid tunnel depth '" << options["--tunnel-depth"] << "'" << std::endl;
+            return 1;
+        }
+        tunnel_depth = static_cast<int>(depth);
+    }
+
+    WriterBackend::Options writer;
+    if ((!options["--writer"].empty() && !WriterBackend::parseSpec(options["--writer"], writer, option_error)) ||
+        !WriterBackend::parseDurability(options["--durability"], writer, option_error))
+    {
+        std::cerr << "Error: " << option_error << std::endl;
+        return 1;
+    }
+
+    BackpressurePolicy backpressure;
+    long long queue_megabytes = 256;
+    if (!BackpressurePolicy::parse(options["--backpressure"], backpressure, option_error))
+    {
+        std::cerr << "Error: " << option_error << std::endl;
+        return 1;
+    }
+    if (!parseIntegerOption(options, "--queue-mb", 1, 65536, queue_megabytes))
+    {
+        return 1;
+    }
+    backpressure.queue_bytes = static_cast<size_t>(queue_megabytes) << 20;
+
+    long long reorder_ms = 100;
+    long long reorder_megabytes = 64;
+    if (!parseIntegerOption(options, "--reorder-ms", 1, 60000, reorder_ms) ||
+        !parseIntegerOption(options, "--reorder-mb", 1, 65536, reorder_megabytes))
+    {
+        return 1;
+    }
+
+    long long dedup_ms = 0;
+    if (!parseIntegerOption(options, "--dedup", 1, 60000, dedup_ms))
+    {
+        return 1;
+    }
+
+    long long split_seed = 0;
+    if (!parseIntegerOption(options, "--split-seed", 0, LLONG_MAX, split_seed))
+    {
+        return 1;
+    }
+
+    long long index_rows = 0;
+    long long index_ms = 0;
+    if (!parseIntegerOption(options, "--index-rows", 1, 100000000, index_rows) ||
+        !parseIntegerOption(options, "--index-ms", 1, 3600000, index_ms))
+    {
+        return 1;
+    }
+
+    long long ring_seconds = 0;
+    long long ring_megabytes = 64;
+    long long ring_trigger_pps = 0;
+    if (!parseIntegerOption(options, "--ring", 1, 3600, ring_seconds) ||
+        !parseIntegerOption(options, "--ring-mb", 1, 65536, ring_megabytes) ||
+        !parseIntegerOption(options, "--ring-trigger-pps", 1, 100000000, ring_trigger_pps))
+    {
+        return 1;
+    }
+
     signal(SIGINT, signalHandler);
+#ifdef SIGUSR1
+    if (ring_seconds > 0)
+    {
+        signal(SIGUSR1, triggerSignalHandler);
+    }
+#endif
 #ifdef _WIN32
     signal(SIGBREAK, signalHandler);
 #endif
@@ -170,17 +399,7 @@ int main(int argc, char *argv[])
         interface_name = argv[2];
 
         std::string filter_arg = argv[3];
-        if (filter_arg == "ipv4")
-            ip_filter = IPVersionFilter::IPv4_ONLY;
-        else if (filter_arg == "ipv6")
-            ip_filter = IPVersionFilter::IPv6_ONLY;
-        else if (filter_arg == "both" || filter_arg == "all")
-            ip_filter = IPVersionFilter::ALL;
-        else if (filter_arg == "icmp")
-            ip_filter = IPVersionFilter::ICMP_ONLY;
-        else if (filter_arg == "bgp")
-            ip_filter = IPVersionFilter::BGP_ONLY;
-        else
+        if (!parseIPVersionFilter(filter_arg, ip_filter))
         {
             std::cerr << "Error: Invalid filter '" << filter_arg << "'" << std::endl;
             return 1;
@@ -259,40 +478,10 @@ int main(int argc, char *argv[])
         promiscuous_mode = (choice == 1);
     }
 
-    CSVMode csv_mode;
-    switch (ip_filter)
+    if (use_interactive || interface_name.empty())
     {
-    case IPVersionFilter::IPv4_ONLY:
-        csv_mode = CSVMode::IPv4_ONLY;
-        break;
-    case IPVersionFilter::IPv6_ONLY:
-        csv_mode = CSVMode::IPv6_ONLY;
-        break;
-    case IPVersionFilter::ALL:
-    case IPVersionFilter::ICMP_ONLY:
-    case IPVersionFilter::BGP_ONLY:
-        csv_mode = CSVMode::BOTH;
-        break;
-    }
-
-    auto capturer = std::make_unique<PacketCapturer>();
-    auto handler = std::make_unique<PacketParser>();
-    auto writer = std::make_unique<DatasetWriter>(output_filename, csv_mode);
-
-    if (interface_name == "auto")
-    {
-        // Auto-select: pick first active interface with addresses
-        interface_name = capturer->selectFirstActiveInterface();
-        if (interface_name.empty())
-        {
-            std::cerr << "No active network interface found" << std::endl;
-            return 1;
-        }
-        std::cout << "Auto-selected interface: " << interface_name << std::endl;
-    }
-    else if (use_interactive || interface_name.empty())
-    {
-        interface_name = capturer->selectInterfaceInteractively();
+        PacketCapturer selector;
+        interface_name = selector.selectInterfaceInteractively();
         if (interface_name.empty())
         {
             std::cerr << "No interface selected or available" << std::endl;
@@ -300,214 +489,71 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (!capturer->initialize(interface_name, promiscuous_mode))
+    CaptureConfig config;
+    config.output_filename = output_filename;
+    config.interface_name = interface_name;
+    config.ip_filter = ip_filter;
+    config.promiscuous = promiscuous_mode;
+    config.duration_seconds = duration_seconds;
+    config.stop_file = stop_signal_file;
+    config.stream_socket = options["--stream"];
+    config.sinks = splitSinkList(options["--sink"]);
+    config.column_groups = column_groups;
+    config.tunnel_depth = tunnel_depth;
+    config.ring_seconds = static_cast<int>(ring_seconds);
+    config.ring_megabytes = static_cast<size_t>(ring_megabytes);
+    config.ring_trigger_pps = static_cast<uint64_t>(ring_trigger_pps);
+    config.writer = writer;
+    config.backpressure = backpressure;
+    config.reorder_ms = static_cast<int>(reorder_ms);
+    config.reorder_megabytes = static_cast<size_t>(reorder_megabytes);
+    config.dedup_ms = static_cast<int>(dedup_ms);
+    config.enrich_sources = enrich_sources;
+    config.label_rules = options["--labels"];
+    config.anonymize_fields = anonymize_fields;
+    config.anonymize_key_file = options["--anonymize-key"];
+    config.splits = splits;
+    config.split_seed = static_cast<uint64_t>(split_seed);
+    config.index_rows = static_cast<uint32_t>(index_rows);
+    config.index_ms = static_cast<int>(index_ms);
+
+    // From here on termination signals are consumed by the capture loop.
+    // Blocked before initialize() starts the sink, ring and reload threads,
+    // which inherit the mask, so no signal is delivered to one of them.
+    CaptureLoop::blockTerminationSignals();
+    if (config.ring_seconds > 0)
     {
-        std::cerr << "Failed to initialize packet capturer: " << capturer->getLastError() << std::endl;
-        return 1;
+        CaptureLoop::blockTriggerSignal();
     }
 
-    if (!writer->initialize())
+    CaptureSession session(config);
+    if (!session.initialize())
     {
-        std::cerr << "Failed to initialize dataset writer: " << writer->getLastError() << std::endl;
+        std::cerr << session.getLastError() << std::endl;
         return 1;
     }
 
-    std::string filter_string = getIPVersionFilterString(ip_filter);
-    if (!filter_string.empty())
-    {
-        if (!capturer->setFilter(filter_string))
-        {
-            std::cerr << "Failed to set packet filter: " << capturer->getLastError() << std::endl;
-            return 1;
-        }
-    }
-    else
-    {
-        std::cout << "No packet filter applied - capturing all packets" << std::endl;
-    }
-
-    uint64_t packet_count = 0;
-    uint64_t processed_count = 0;
-    uint64_t dropped_count = 0;
-    auto start_time = std::chrono::steady_clock::now();
-
-    // If a finite duration is requested, also start a timer thread that will
-    // break the pcap loop even if no packets arrive (important on idle links).
-    std::thread timer_thread;
-    if (duration_seconds > 0)
-    {
-        auto capturer_ptr = capturer.get();
-        timer_thread = std::thread([capturer_ptr, &start_time, duration_seconds]()
-                                   {
-            using namespace std::chrono;
-            // Sleep until duration elapses; use steady_clock for monotonic timing
-            auto target = steady_clock::now() + seconds(duration_seconds);
-            std::this_thread::sleep_until(target);
-            // Signal stop and break the loop from another thread
-            keep_running = false;
-            if (capturer_ptr)
-            {
-                std::cout << "\n[Timer] Duration reached. Stopping capture..." << std::endl;
-                capturer_ptr->stopCapture();
-            } });
-    }
-
-    std::thread stop_file_thread;
-    if (!stop_signal_file.empty())
-    {
-        auto capturer_ptr = capturer.get();
-        stop_file_thread = std::thread([capturer_ptr, stop_signal_file]()
-                                       {
-            std::filesystem::path signal_path(stop_signal_file);
-            while (keep_running)
-            {
-                if (std::filesystem::exists(signal_path))
-                {
-                    std::cout << "\n[Stop] External stop signal detected. Stopping capture..." << std::endl;
-                    keep_running = false;
-                    if (capturer_ptr)
-                    {
-                        capturer_ptr->stopCapture();
-                    }
-                    break;
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
-            } });
-    }
-
-    capturer->setCallback([&](const uint8_t *packet, int size, const struct pcap_pkthdr *header)
-                          {
-        // Check duration timeout
-        if (duration_seconds > 0) {
-            auto elapsed = std::chrono::steady_clock::now() - start_time;
-            auto elapsed_sec = std::chrono::duration_cast<std::chrono::seconds>(elapsed).count();
-            if (elapsed_sec >= duration_seconds) {
-                keep_running = false;
-                // Also explicitly break the pcap loop to stop immediately
-                // even under continuous traffic.
-                if (capturer)
-                {
-                    capturer->stopCapture();
-                }
-                return;
-            }
-        }
-
-        if (!keep_running) {
-            // Ensure loop is broken if we were signaled to stop
-            if (capturer)
-            {
-                capturer->stopCapture();
-            }
-            return;
-        }
-        
-        packet_count++;
-        
-        auto feature = handler->processPacket(packet, size, header);
-        if (feature) {
-            if (writer->writePacket(*feature)) {
-                processed_count++;
-                
-                if (processed_count % 5 == 0) {
-                    auto elapsed = std::chrono::steady_clock::now() - start_time;
-                    auto elapsed_sec = std::chrono::duration_cast<std::chrono::seconds>(elapsed).count();
-                    double pps = elapsed_sec > 0 ? static_cast<double>(processed_count) / elapsed_sec : 0;
-                    
-                    std::string ip_type, protocol_name, src_ip, dst_ip;
-                    
-                    if (feature->type == PacketFeature::Type::IPv4) {
-                        ip_type = "IPv4";
-                        protocol_name = feature->ipv4.protocol_name;
-                        src_ip = feature->ipv4.src_address;
-                        dst_ip = feature->ipv4.dst_address;
-                    } else {
-                        ip_type = "IPv6";
-                        protocol_name = feature->ipv6.protocol_name;
-                        src_ip = feature->ipv6.src_address;
-                        dst_ip = feature->ipv6.dst_address;
-                    }
-                    
-                    std::cout << "[" << processed_count << "] " << ip_type << "/" << protocol_name
-                              << " | " << src_ip << " -> " << dst_ip 
-                              << " | Size: " << header->len << " bytes"
-                              << " | Rate: " << std::fixed << std::setprecision(1) << pps << " pps"
-                              << " | Total captured: " << packet_count << std::endl;
-                }
-                
-                if (processed_count % 100 == 0) {
-                    std::cout << "=== Milestone: " << processed_count << " packets processed ===" << std::endl;
-                }
-            } else {
-                std::cerr << "Failed to write packet: " << writer->getLastError() << std::endl;
-            }
-        } else {
-            dropped_count++;
-            if (dropped_count % 50 == 0) {
-                std::cout << "Warning: " << dropped_count << " packets dropped (parsing failed or non-IP)" << std::endl;
-            }
-        } });
-
     std::cout << "Starting packet capture. Press Ctrl+C to stop." << std::endl;
     std::cout << "Output file: " << output_filename << std::endl;
 
-    if (!capturer->startCapture())
+    if (!session.run())
     {
-        std::cerr << "Failed to start capture: " << capturer->getLastError() << std::endl;
-        // Join timer thread if it was started
-        if (timer_thread.joinable())
-        {
-            timer_thread.join();
-        }
-        if (stop_file_thread.joinable())
-        {
-            stop_file_thread.join();
-        }
+        std::cerr << session.getLastError() << std::endl;
         return 1;
     }
 
-    bool interrupted = !keep_running.load();
-    keep_running = false;
-
-    // Wait a moment for cleanup after Ctrl+C
-    if (interrupted)
+    if (session.getStopReason() == CaptureLoop::StopReason::SIGNAL)
     {
         std::cout << "Exiting..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 
-    // Join the timer thread if it was started
-    if (timer_thread.joinable())
-    {
-        timer_thread.join();
-    }
-
-    if (stop_file_thread.joinable())
-    {
-        stop_file_thread.join();
-    }
-
-    writer->close();
-
     if (!stop_signal_file.empty())
     {
         std::error_code ec;
         std::filesystem::remove(stop_signal_file, ec);
     }
 
-    auto total_elapsed = std::chrono::steady_clock::now() - start_time;
-    auto total_elapsed_sec = std::chrono::duration_cast<std::chrono::seconds>(total_elapsed).count();
-    double avg_pps = total_elapsed_sec > 0 ? static_cast<double>(processed_count) / total_elapsed_sec : 0;
-
-    std::cout << "\n=== CAPTURE SUMMARY ===" << std::endl;
-    std::cout << "Total packets captured: " << packet_count << std::endl;
-    std::cout << "Packets processed: " << processed_count << std::endl;
-    std::cout << "Packets dropped: " << dropped_count << std::endl;
-    std::cout << "Success rate: " << std::fixed << std::setprecision(1)
-              << (packet_count > 0 ? (100.0 * processed_count / packet_count) : 0) << "%" << std::endl;
-    std::cout << "Capture duration: " << total_elapsed_sec << " seconds" << std::endl;
-    std::cout << "Average rate: " << std::fixed << std::setprecision(1) << avg_pps << " packets/sec" << std::endl;
-    std::cout << "Output saved to: " << output_filename << std::endl;
+    session.printSummary();
 
     return 0;
-}
\ No newline at end of file
+}
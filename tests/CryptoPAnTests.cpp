@@ -0,0 +1,56 @@
+// CryptoPAn: the reference implementation's sample key and trace, and
+// prefix preservation for IPv6.
+
+#include "TestSupport.h"
+#include "CryptoPAn.h"
+#include <cstring>
+
+namespace
+{
+    void testCryptoPAn()
+    {
+        // Key and address pairs of the reference implementation's sample trace
+        const uint8_t key[CryptoPAn::KEY_BYTES] = {21,  34,  23,  141, 51,  164, 207, 128, 19,  10, 91,
+                                                   22,  73,  144, 125, 16,  216, 152, 143, 131, 121, 121,
+                                                   101, 39,  98,  87,  76,  45,  42,  132, 34,  2};
+        const struct
+        {
+            const char *raw;
+            const char *anonymized;
+        } pairs[] = {
+            {"128.11.68.132", "135.242.180.132"},  {"129.118.74.4", "134.136.186.123"},
+            {"130.132.252.244", "133.68.164.234"}, {"141.223.7.43", "141.167.8.160"},
+            {"141.233.145.108", "141.129.237.235"}, {"152.163.225.39", "151.140.114.167"},
+            {"156.29.3.236", "147.225.12.42"},     {"165.247.96.84", "162.9.99.234"},
+            {"166.107.77.190", "160.132.178.185"}, {"192.102.249.13", "252.138.62.131"},
+            {"192.215.32.125", "252.43.47.189"},   {"192.233.80.103", "252.25.108.8"},
+            {"192.41.57.43", "252.222.221.184"},   {"193.150.244.223", "253.169.52.216"},
+            {"195.205.63.100", "255.186.223.5"},
+        };
+        // Twice, so the second round is served by the prefix memo
+        CryptoPAn cryptopan(key);
+        for (int round = 0; round < 2; ++round)
+        {
+            for (const auto &pair : pairs)
+            {
+                IpAddress address = parseAddress(pair.raw);
+                cryptopan.anonymize(address);
+                check(formatAddress(address) == pair.anonymized, std::string("CryptoPAn ") + pair.raw);
+            }
+        }
+
+        // Prefix preservation for IPv6: a shared /48 stays a shared /48
+        IpAddress a = parseAddress("2001:db8:1:2::1");
+        IpAddress b = parseAddress("2001:db8:1:ff00::1");
+        cryptopan.anonymize(a);
+        cryptopan.anonymize(b);
+        check(std::memcmp(a.bytes, b.bytes, 6) == 0 && ((a.bytes[6] ^ b.bytes[6]) & 0x80) != 0,
+              "CryptoPAn IPv6 prefix preservation");
+    }
+}
+
+int main()
+{
+    testCryptoPAn();
+    return finishChecks();
+}
@@ -0,0 +1,63 @@
+// Deduplicator: copies of a frame as mirror ports deliver them (same
+// frame, after a router, VLAN-tagged) within and after the window.
+
+#include "TestSupport.h"
+#include "Deduplicator.h"
+#include <vector>
+
+namespace
+{
+    std::vector<uint8_t> makeFrame(uint8_t ttl, uint8_t payload, bool vlan)
+    {
+        std::vector<uint8_t> frame(14, 0);
+        frame[12] = 0x08;
+        frame[13] = 0x00;
+        if (vlan)
+        {
+            frame[12] = 0x81;
+            frame[13] = 0x00;
+            const uint8_t tag[] = {0x00, 0x64, 0x08, 0x00};
+            frame.insert(frame.end(), tag, tag + sizeof(tag));
+        }
+        const uint8_t ip[] = {0x45, 0, 0, 32, 0x12, 0x34, 0, 0, ttl, 17, static_cast<uint8_t>(ttl * 7), 0,
+                              192, 0, 2, 1, 192, 0, 2, 2, 0x30, 0x39, 0, 53, 0, 12, 0, 0, payload, 1, 2, 3};
+        frame.insert(frame.end(), ip, ip + sizeof(ip));
+        return frame;
+    }
+
+    void testDeduplicator()
+    {
+        Deduplicator dedup(50);
+        const struct
+        {
+            const char *what;
+            uint8_t ttl;
+            uint8_t payload;
+            bool vlan;
+            int64_t time_us;
+            bool duplicate;
+        } frames[] = {
+            {"first copy", 64, 1, false, 0, false},
+            {"same frame", 64, 1, false, 1000, true},
+            {"copy after a router", 63, 1, false, 2000, true},
+            {"VLAN-tagged copy", 64, 1, true, 3000, true},
+            {"other payload", 64, 2, false, 4000, false},
+            {"copy after the window", 64, 1, false, 200000, false},
+            {"copy of the re-seen frame", 64, 1, false, 210000, true},
+        };
+        for (const auto &test : frames)
+        {
+            std::vector<uint8_t> frame = makeFrame(test.ttl, test.payload, test.vlan);
+            bool duplicate = dedup.isDuplicate(frame.data(), frame.size(), static_cast<uint32_t>(frame.size()), test.time_us);
+            check(duplicate == test.duplicate, std::string("Deduplicator: ") + test.what);
+        }
+        Deduplicator::Stats stats = dedup.getStats();
+        check(stats.frames == 7 && stats.duplicates == 4, "Deduplicator statistics");
+    }
+}
+
+int main()
+{
+    testDeduplicator();
+    return finishChecks();
+}
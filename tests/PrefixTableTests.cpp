@@ -0,0 +1,70 @@
+// PrefixTable: longest-prefix match over overlapping IPv4 and IPv6 prefixes
+// of two kinds, added out of length order.
+
+#include "TestSupport.h"
+#include "PrefixTable.h"
+
+namespace
+{
+    void testPrefixTable()
+    {
+        // Added out of length order on purpose; build() must still leave the
+        // longest match in every entry
+        PrefixTable table;
+        const struct
+        {
+            int kind;
+            const char *prefix;
+            const char *label;
+        } prefixes[] = {
+            {1, "10.1.2.200/32", "host"},
+            {1, "10.1.2.128/25", "upper"},
+            {1, "10.0.0.0/8", "ten"},
+            {1, "10.1.2.0/24", "lan"},
+            {1, "10.1.0.0/16", "site"},
+            {0, "10.0.0.0/9", "AS64496"},
+            {1, "2001:db8:1:2::1/128", "host6"},
+            {1, "2001:db8::/32", "doc"},
+            {1, "2001:db8:1::/48", "site6"},
+            {1, "2001:db8:1:2::/64", "lan6"},
+        };
+        for (const auto &entry : prefixes)
+        {
+            check(table.addPrefix(entry.kind, entry.prefix, entry.label), std::string("addPrefix ") + entry.prefix);
+        }
+        check(table.build(), "PrefixTable::build");
+
+        const struct
+        {
+            const char *address;
+            const char *subnet;
+            const char *asn;
+        } cases[] = {
+            {"10.1.2.200", "host", "AS64496"},
+            {"10.1.2.201", "upper", "AS64496"},
+            {"10.1.2.127", "lan", "AS64496"},
+            {"10.1.3.1", "site", "AS64496"},
+            {"10.2.0.1", "ten", "AS64496"},
+            {"10.200.0.1", "ten", ""},
+            {"11.0.0.1", "", ""},
+            {"2001:db8:1:2::1", "host6", ""},
+            {"2001:db8:1:2::2", "lan6", ""},
+            {"2001:db8:1:3::1", "site6", ""},
+            {"2001:db8:ffff::1", "doc", ""},
+            {"2001:db9::1", "", ""},
+        };
+        for (const auto &test : cases)
+        {
+            uint32_t leaf = table.lookup(parseAddress(test.address));
+            check(table.getLabel(leaf, 1) == test.subnet, std::string("subnet label of ") + test.address);
+            check(table.getLabel(leaf, 0) == test.asn, std::string("asn label of ") + test.address);
+        }
+        check(table.lookup(parseAddress("11.0.0.1")) == 0, "unmatched address has leaf 0");
+    }
+}
+
+int main()
+{
+    testPrefixTable();
+    return finishChecks();
+}
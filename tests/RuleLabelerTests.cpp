@@ -0,0 +1,245 @@
+// RuleLabeler: rule files from empty and default-only to first-match order
+// over addresses, ports, protocol and time, and rejected rules; labels that
+// outlive their batch in a held fragment or a spilled batch.
+
+#include "TestSupport.h"
+#include "RuleLabeler.h"
+#include "FragmentTracker.h"
+#include "SinkFanout.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <set>
+
+namespace
+{
+    PacketFeature makeFeature(const char *src, const char *dst, uint8_t protocol, int src_port, int dst_port,
+                              int64_t epoch_seconds)
+    {
+        PacketFeature feature(PacketFeature::Type::IPv4);
+        feature.src_ip = parseAddress(src);
+        feature.dst_ip = parseAddress(dst);
+        if (feature.src_ip.family == 6)
+        {
+            feature.type = PacketFeature::Type::IPv6;
+            feature.ipv6.timestamp = std::chrono::system_clock::time_point(std::chrono::seconds(epoch_seconds));
+        }
+        else
+        {
+            feature.ipv4.timestamp = std::chrono::system_clock::time_point(std::chrono::seconds(epoch_seconds));
+        }
+        feature.l4_protocol = protocol;
+        feature.transport.present = src_port >= 0;
+        feature.transport.src_port = static_cast<uint16_t>(src_port >= 0 ? src_port : 0);
+        feature.transport.dst_port = static_cast<uint16_t>(dst_port >= 0 ? dst_port : 0);
+        return feature;
+    }
+
+    void testRuleLabeler()
+    {
+        const int64_t T0 = 1790848800; // 2026-10-01T10:00:00Z
+        const struct
+        {
+            const char *name;
+            const char *rules;
+            size_t rule_count;
+            const char *src;
+            const char *dst;
+            uint8_t protocol;
+            int src_port;
+            int dst_port;
+            int64_t time;
+            const char *label;
+        } cases[] = {
+            {"empty", "", 0, "192.0.2.1", "192.0.2.2", 6, 1000, 80, T0, ""},
+            {"comments", "# nothing yet\n\n", 0, "192.0.2.1", "192.0.2.2", 6, 1000, 80, T0, ""},
+            {"default-only", "default benign\n", 0, "192.0.2.1", "192.0.2.2", 17, 53, 53, T0, "benign"},
+            {"default-only-v6", "default benign\n", 0, "2001:db8::1", "2001:db8::2", 58, -1, -1, T0, "benign"},
+            {"first-wins", "scan src=198.51.100.0/24\nhost src=198.51.100.7\n", 2, "198.51.100.7", "192.0.2.2", 6,
+             1000, 22, T0, "scan"},
+            {"overlap-miss", "scan src=198.51.100.0/25\nhost src=198.51.100.200\ndefault benign\n", 2,
+             "198.51.100.200", "192.0.2.2", 6, 1000, 22, T0, "host"},
+            {"fields", "ddos dst=192.0.2.10 dport=80 proto=tcp\ndefault benign\n", 1, "203.0.113.1", "192.0.2.10",
+             6, 40000, 80, T0, "ddos"},
+            {"fields-proto-miss", "ddos dst=192.0.2.10 dport=80 proto=tcp\ndefault benign\n", 1, "203.0.113.1",
+             "192.0.2.10", 17, 40000, 80, T0, "benign"},
+            // host= and port= expand into one compiled rule per side
+            {"either-port", "c2 host=203.0.113.5 port=443,8443\n", 4, "10.0.0.1", "203.0.113.5", 6, 8443, 50000, T0,
+             "c2"},
+            {"range", "scan src=198.51.100.7-198.51.100.9\n", 1, "198.51.100.10", "192.0.2.2", 6, 1, 2, T0, ""},
+            {"time-in", "ddos time=2026-10-01T10:00:00Z..2026-10-01T10:30:00Z\ndefault benign\n", 1, "192.0.2.1",
+             "192.0.2.2", 6, 1, 2, T0 + 600, "ddos"},
+            {"time-end-exclusive", "ddos time=2026-10-01T10:00:00Z..2026-10-01T10:30:00Z\ndefault benign\n", 1,
+             "192.0.2.1", "192.0.2.2", 6, 1, 2, T0 + 1800, "benign"},
+            {"catch-all", "all\n", 1, "2001:db8::1", "2001:db8::2", 6, 1, 2, T0, "all"},
+            {"v6-prefix", "lab src=2001:db8:1::/48\ndefault benign\n", 1, "2001:db8:1::5", "2001:db8::2", 6, 1, 2, T0,
+             "lab"},
+        };
+        for (const auto &test : cases)
+        {
+            RuleLabeler labeler(writeTempFile(std::string("rules-") + test.name, test.rules));
+            if (!labeler.load())
+            {
+                check(false, std::string("RuleLabeler load ") + test.name + ": " + labeler.getLastError());
+                continue;
+            }
+            check(labeler.getRuleCount() == test.rule_count, std::string("rule count of ") + test.name);
+            PacketFeature feature = makeFeature(test.src, test.dst, test.protocol, test.src_port, test.dst_port, test.time);
+            check(labeler.classify(feature) == test.label, std::string("label of ") + test.name);
+        }
+
+        const char *invalid[] = {"default\n", "x foo=bar\n", "x src=300.1.1.1\n", "x port=70000\n", "x time=yesterday\n"};
+        for (const char *rules : invalid)
+        {
+            RuleLabeler labeler(writeTempFile("rules-invalid", rules));
+            check(!labeler.load(), std::string("RuleLabeler rejects ") + rules);
+        }
+    }
+
+    // Overwrites everything the arena handed out since its last reset
+    void scribbleArena(Arena &arena)
+    {
+        size_t used = arena.bytesUsed();
+        arena.reset();
+        std::memset(arena.allocate(used, 1), '#', used);
+    }
+
+    void testHeldFragmentLabel()
+    {
+        RuleLabeler labeler(writeTempFile("rules-fragment", "frag src=198.51.100.0/24\n"));
+        check(labeler.load(), "RuleLabeler load fragment rules");
+        FragmentTracker tracker;
+
+        PacketBatch first;
+        PacketRecord head{makeFeature("198.51.100.7", "192.0.2.2", 17, 1000, 53, 1790848800), 1514};
+        head.feature.fragment.is_fragment = true;
+        head.feature.fragment.more_fragments = true;
+        head.feature.fragment.identification = 7;
+        head.feature.fragment.payload_bytes = 1480;
+        labeler.process(head, first.arena);
+        tracker.add(std::move(head), first);
+        check(first.packets.empty(), "first fragment is held");
+        scribbleArena(first.arena);
+
+        PacketBatch second;
+        PacketRecord tail{makeFeature("198.51.100.7", "192.0.2.2", 17, -1, -1, 1790848800), 534};
+        tail.feature.fragment.is_fragment = true;
+        tail.feature.fragment.identification = 7;
+        tail.feature.fragment.offset_bytes = 1480;
+        tail.feature.fragment.payload_bytes = 500;
+        labeler.process(tail, second.arena);
+        tracker.add(std::move(tail), second);
+        check(second.packets.size() == 2, "datagram released when complete");
+        for (const PacketRecord &record : second.packets)
+        {
+            check(record.feature.label == "frag", "label of a fragment held across batches");
+        }
+    }
+
+    // Records the label of every row it is given; the first consume() waits
+    // until the test opens the gate so that later batches spill
+    class LabelSink : public OutputSink
+    {
+    public:
+        struct Row
+        {
+            const PacketBatch *batch;
+            std::string label;
+            const char *data;
+        };
+
+        bool open() override { return true; }
+        bool consume(const PacketBatch &batch) override
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            gate_changed_.wait(lock, [this] { return open_; });
+            for (const PacketRecord &record : batch.packets)
+            {
+                rows_.push_back(Row{&batch, std::string(record.feature.label), record.feature.label.data()});
+            }
+            return true;
+        }
+        void close() override {}
+        std::string getName() const override { return "labels"; }
+        std::string getLastError() const override { return ""; }
+
+        void openGate()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+            gate_changed_.notify_all();
+        }
+        std::vector<Row> getRows()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return rows_;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable gate_changed_;
+        bool open_ = false;
+        std::vector<Row> rows_;
+    };
+
+    void testSpilledBatchLabel()
+    {
+        const char *labels[] = {"scan", "ddos", "host", "c2"};
+        BackpressurePolicy policy;
+        policy.mode = BackpressurePolicy::Mode::SPILL;
+        policy.spill_directory = std::filesystem::temp_directory_path().string();
+        SinkFanout fanout(1, policy);
+        LabelSink *sink = new LabelSink();
+        fanout.addSink(std::unique_ptr<OutputSink>(sink));
+        check(fanout.start(), "SinkFanout start");
+
+        std::vector<std::shared_ptr<PacketBatch>> batches;
+        std::set<const void *> originals;
+        for (const char *label : labels)
+        {
+            auto batch = std::make_shared<PacketBatch>();
+            for (int row = 0; row < 3; ++row)
+            {
+                PacketRecord record{makeFeature("192.0.2.1", "192.0.2.2", 6, 1000 + row, 80, 1790848800), 60};
+                record.feature.label = batch->arena.copyString(label, std::strlen(label));
+                batch->packets.push_back(record);
+            }
+            originals.insert(batch.get());
+            batches.push_back(batch);
+            fanout.submit(batch);
+        }
+        sink->openGate();
+        fanout.stop();
+
+        std::vector<SinkStats> stats = fanout.getStats();
+        check(!stats.empty() && stats[0].rows_spilled > 0, "rows went through the spill segment");
+        std::vector<LabelSink::Row> rows = sink->getRows();
+        check(rows.size() == 12, "every row delivered");
+        for (size_t index = 0; index < rows.size(); ++index)
+        {
+            const LabelSink::Row &row = rows[index];
+            check(row.label == labels[index / 3], "label of row " + std::to_string(index) + " in order");
+            if (originals.count(row.batch) == 0)
+            {
+                // Read back from the segment: the view must be into the
+                // spilled copy, not into the submitted batch's arena
+                for (const auto &batch : batches)
+                {
+                    for (const PacketRecord &record : batch->packets)
+                    {
+                        check(row.data != record.feature.label.data(), "spilled label rebased");
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    testRuleLabeler();
+    testHeldFragmentLabel();
+    testSpilledBatchLabel();
+    return finishChecks();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// Helpers shared by the table-driven test programs under tests/. Each
+// program is one ctest test: it runs its checks, reports every failure and
+// returns finishChecks() from main.
+
+#include "PacketFeature.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+inline int &checkFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline void check(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << what << std::endl;
+        checkFailures()++;
+    }
+}
+
+// Exit status for main: 0 when every check passed
+inline int finishChecks()
+{
+    if (checkFailures() > 0)
+    {
+        std::cerr << checkFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
+
+inline IpAddress parseAddress(const std::string &text)
+{
+    IpAddress address;
+    if (inet_pton(AF_INET, text.c_str(), address.bytes) == 1)
+    {
+        address.family = 4;
+    }
+    else if (inet_pton(AF_INET6, text.c_str(), address.bytes) == 1)
+    {
+        address.family = 6;
+    }
+    return address;
+}
+
+inline std::string formatAddress(const IpAddress &address)
+{
+    char text[INET6_ADDRSTRLEN];
+    inet_ntop(address.family == 4 ? AF_INET : AF_INET6, address.bytes, text, sizeof(text));
+    return text;
+}
+
+// Writes content to a file in the temporary directory and returns its path
+inline std::string writeTempFile(const std::string &name, const std::string &content)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("npa-test-" + name);
+    std::ofstream file(path, std::ios::trunc);
+    file << content;
+    return path.string();
+}
@@ -0,0 +1,149 @@
+// TimeIndex: block lookup over out-of-order blocks, the row timestamp parser
+// DatasetSlice relies on, and index files written with the rows or rebuilt
+// from an existing CSV.
+
+#include "TestSupport.h"
+#include "TimeIndex.h"
+#include <vector>
+#include <cstring>
+
+namespace
+{
+    void testTimeIndex()
+    {
+        // Blocks overlap in time: 2 ends before 1, 3 starts before 2
+        const std::vector<TimeIndex::Entry> entries = {
+            {0, 100, 0, 10}, {100, 100, 5, 20}, {200, 100, 15, 18}, {300, 100, 12, 30}, {400, 100, 31, 40},
+        };
+        const struct
+        {
+            int64_t from;
+            int64_t to;
+            size_t first;
+            size_t last;
+        } ranges[] = {
+            {0, 100, 0, 5},
+            {11, 13, 1, 4},
+            {19, 21, 1, 4},
+            {21, 31, 3, 4},
+            {31, 32, 4, 5},
+            {41, 50, 5, 5},
+            {-10, 0, 0, 0},
+        };
+        for (const auto &range : ranges)
+        {
+            size_t first = 0, last = 0;
+            TimeIndex::findBlocks(entries, range.from, range.to, first, last);
+            std::string what = "findBlocks [" + std::to_string(range.from) + ", " + std::to_string(range.to) + ")";
+            check(first == range.first && last == range.last, what);
+
+            // Every block that can hold a row of the range is inside [first, last)
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                bool overlaps = entries[i].max_us >= range.from && entries[i].min_us < range.to;
+                check(!overlaps || (i >= first && i < last), what + " covers block " + std::to_string(i));
+            }
+        }
+        size_t first = 1, last = 1;
+        TimeIndex::findBlocks({}, 0, 10, first, last);
+        check(first == 0 && last == 0, "findBlocks on an empty index");
+
+        const struct
+        {
+            const char *text;
+            bool ok;
+            int64_t micros;
+        } timestamps[] = {
+            {"1970-01-01 00:00:00.000001", true, 1},
+            {"2026-10-01 10:00:00.000000,192.0.2.1", true, 1790848800LL * 1000000},
+            {"2000-02-29 12:34:56.789012", true, 951827696LL * 1000000 + 789012},
+            {"1969-12-31 23:59:59.500000", true, -500000},
+            {"2026-10-01 10:00:00.00000", false, 0},
+            {"2026-13-01 10:00:00.000000", false, 0},
+            {"2026-10-00 10:00:00.000000", false, 0},
+            {"2026-10-01T10:00:00.000000", false, 0},
+            {"2026-1x-01 10:00:00.000000", false, 0},
+            {"Timestamp,Source", false, 0},
+        };
+        for (const auto &test : timestamps)
+        {
+            int64_t micros = 0;
+            bool ok = TimeIndex::parseTimestamp(test.text, std::strlen(test.text), micros);
+            check(ok == test.ok && (!ok || micros == test.micros), std::string("parseTimestamp ") + test.text);
+        }
+    }
+
+    void testIndexFile()
+    {
+        // Rows slightly out of time order, in blocks of two
+        const char *rows[] = {
+            "2026-10-01 10:00:00.000000,a\n", "2026-10-01 10:00:02.000000,b\n", "2026-10-01 10:00:01.000000,c\n",
+            "2026-10-01 10:00:03.000000,d\n", "2026-10-01 10:00:04.000000,e\n",
+        };
+        std::string csv = "Timestamp,Value\n";
+        for (const char *row : rows)
+        {
+            csv += row;
+        }
+        std::string data_path = writeTempFile("index.csv", csv);
+        std::filesystem::remove(TimeIndex::getPath(data_path));
+        const int64_t T0 = 1790848800LL * 1000000;
+        const std::vector<TimeIndex::Entry> expected = {
+            {16, 58, T0, T0 + 2000000}, {74, 58, T0 + 1000000, T0 + 3000000}, {132, 29, T0 + 4000000, T0 + 4000000},
+        };
+        auto same = [&expected](const std::vector<TimeIndex::Entry> &entries)
+        {
+            if (entries.size() != expected.size())
+                return false;
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                if (entries[i].offset != expected[i].offset || entries[i].bytes != expected[i].bytes ||
+                    entries[i].min_us != expected[i].min_us || entries[i].max_us != expected[i].max_us)
+                    return false;
+            }
+            return true;
+        };
+
+        // Written alongside the rows
+        {
+            TimeIndex index(2, 0);
+            check(index.open(data_path, 0), "TimeIndex open for a new file");
+            uint64_t offset = 16;
+            for (const char *row : rows)
+            {
+                int64_t micros = 0;
+                TimeIndex::parseTimestamp(row, std::strlen(row), micros);
+                index.addRow(offset, std::strlen(row), micros);
+                offset += std::strlen(row);
+            }
+            check(index.close(), "TimeIndex close");
+        }
+        std::vector<TimeIndex::Entry> entries;
+        std::string error;
+        check(TimeIndex::load(TimeIndex::getPath(data_path), csv.size(), entries, error) && same(entries),
+              "TimeIndex entries written with the rows");
+
+        // Entries past the end of a shortened file are ignored
+        check(TimeIndex::load(TimeIndex::getPath(data_path), 100, entries, error) && entries.size() == 1,
+              "TimeIndex load ignores entries past the data");
+
+        // Rebuilt from the CSV when the index is missing
+        std::filesystem::remove(TimeIndex::getPath(data_path));
+        {
+            TimeIndex index(2, 0);
+            check(index.open(data_path, csv.size()), "TimeIndex open rebuilding a missing index");
+            check(index.close(), "TimeIndex close after rebuilding");
+        }
+        check(TimeIndex::load(TimeIndex::getPath(data_path), csv.size(), entries, error) && same(entries),
+              "TimeIndex entries rebuilt from the file");
+        std::filesystem::remove(TimeIndex::getPath(data_path));
+        std::filesystem::remove(data_path);
+    }
+}
+
+int main()
+{
+    testTimeIndex();
+    testIndexFile();
+    return finishChecks();
+}
@@ -1,4 +1,4 @@
-import { render, screen, fireEvent, waitFor } from '@testing-library/react'
+import { render, screen, fireEvent, waitFor, act } from '@testing-library/react'
 import userEvent from '@testing-library/user-event'
 import Home from '../pages/index'
 import { describe, it, expect, beforeEach, vi } from 'vitest'
@@ -297,4 +297,56 @@ describe('Home Component', () => {
       expect(capturingButton).toBeDisabled()
     })
   })
-})
+
+  it('shows live stats streamed during capture', async () => {
+    class MockEventSource {
+      static instances: MockEventSource[] = []
+      onmessage: ((event: { data: string }) => void) | null = null
+      onerror: (() => void) | null = null
+      close = vi.fn()
+      constructor(public url: string) {
+        MockEventSource.instances.push(this)
+      }
+    }
+    vi.stubGlobal('EventSource', MockEventSource)
+
+    let resolveCapture: any
+    ;(global.fetch as any)
+      .mockResolvedValueOnce({
+        ok: true,
+        json: async () => ({ success: true, interfaces: [] }),
+      })
+      .mockImplementationOnce(() => new Promise(resolve => { resolveCapture = resolve }))
+
+    render(<Home />)
+
+    await userEvent.click(screen.getByRole('button', { name: /start capture/i }))
+
+    const source = MockEventSource.instances[0]
+    expect(source.url).toBe('/api/live?output=packet_capture.csv')
+
+    act(() => {
+      source.onmessage?.({ data: JSON.stringify({
+        type: 'stats', packets: 42, bytes: 4096, totalPackets: 100, droppedRows: 0,
+        protocols: { TCP: 40, UDP: 2 },
+      }) })
+      source.onmessage?.({ data: JSON.stringify({
+        type: 'rows',
+        rows: [{ ts: 1.5, version: 4, src: '10.0.0.1', dst: '10.0.0.2', protocol: 'TCP', length: 60 }],
+      }) })
+    })
+
+    expect(screen.getByText(/42 packets\/s/i)).toBeInTheDocument()
+    expect(screen.getByText(/TCP: 40/)).toBeInTheDocument()
+    expect(screen.getByText('10.0.0.1')).toBeInTheDocument()
+
+    resolveCapture({
+      ok: true,
+      json: async () => ({ success: true, message: '/packet_capture.csv' }),
+    })
+    await waitFor(() => {
+      expect(source.close).toHaveBeenCalled()
+    })
+    vi.unstubAllGlobals()
+  })
+})
\ No newline at end of file
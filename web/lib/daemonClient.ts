@@ -0,0 +1,89 @@
+import net from "net";
+import fs from "fs";
+
+// Thin client for the sniffer's daemon mode (`NetworkPacketAnalyzer --daemon`).
+// Each request is one JSON line over the Unix-domain control socket and gets
+// exactly one JSON line back. When no daemon socket exists the API routes fall
+// back to spawning one sniffer process per capture.
+
+export type DaemonCapture = {
+  id: string;
+  state: "running" | "finished" | "failed";
+  output: string;
+  interface: string;
+  stopReason?: string;
+  error?: string;
+  packetsCaptured?: number;
+  packetsProcessed?: number;
+  packetsDropped?: number;
+  elapsedSeconds?: number;
+};
+
+export type DaemonResponse = {
+  ok: boolean;
+  error?: string;
+  capture?: DaemonCapture;
+  captures?: DaemonCapture[];
+  stopped?: number;
+};
+
+export const defaultSocketPath = "/tmp/network-packet-analyzer.sock";
+
+export function getDaemonSocketPath(): string {
+  return process.env.SNIFFER_SOCKET || defaultSocketPath;
+}
+
+export function isDaemonAvailable(): boolean {
+  if (process.platform === "win32") return false;
+  try {
+    return fs.statSync(getDaemonSocketPath()).isSocket();
+  } catch {
+    return false;
+  }
+}
+
+export function sendDaemonCommand(
+  command: Record<string, string | number | boolean>,
+  timeoutMs = 5000
+): Promise<DaemonResponse> {
+  return new Promise((resolve, reject) => {
+    const socket = net.createConnection(getDaemonSocketPath());
+    let buffer = "";
+    let settled = false;
+
+    const finish = (err: Error | null, value?: DaemonResponse) => {
+      if (settled) return;
+      settled = true;
+      socket.destroy();
+      if (err) reject(err);
+      else resolve(value as DaemonResponse);
+    };
+
+    // timeoutMs <= 0 waits indefinitely (used by the "wait" command)
+    if (timeoutMs > 0) {
+      socket.setTimeout(timeoutMs, () =>
+        finish(new Error(`Daemon did not answer '${command.cmd}' in time`))
+      );
+    }
+
+    socket.on("connect", () => {
+      socket.write(JSON.stringify(command) + "\n");
+    });
+
+    socket.on("data", (chunk) => {
+      buffer += chunk.toString();
+      const newline = buffer.indexOf("\n");
+      if (newline < 0) return;
+      try {
+        finish(null, JSON.parse(buffer.slice(0, newline)));
+      } catch (err) {
+        finish(new Error("Invalid daemon response: " + String(err)));
+      }
+    });
+
+    socket.on("error", (err) => finish(err));
+    socket.on("close", () =>
+      finish(new Error("Daemon closed the connection without a response"))
+    );
+  });
+}
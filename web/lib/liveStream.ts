@@ -0,0 +1,30 @@
+import crypto from "crypto";
+import path from "path";
+import { getDaemonSocketPath } from "./daemonClient";
+
+// Each capture publishes live rows/stats on its own Unix socket (see the
+// sniffer's --stream option). The path is derived from the capture id (the
+// output name, which may include subdirectories) so /api/capture and
+// /api/live agree on it without shared state. It sits beside the daemon's
+// control socket, the only directory the daemon binds stream sockets in.
+export function getLiveSocketPath(captureId: string): string {
+  const safeBase = path
+    .basename(captureId)
+    .replace(/[^A-Za-z0-9_.-]/g, "_")
+    .replace(/\.{2,}/g, ".")
+    .slice(0, 32);
+  // a/x.csv and b/x.csv share a base name: the hash keeps them apart
+  const digest = crypto
+    .createHash("sha256")
+    .update(captureId)
+    .digest("hex")
+    .slice(0, 12);
+  return path.join(
+    path.dirname(getDaemonSocketPath()),
+    `nda-live-${safeBase}-${digest}.sock`
+  );
+}
+
+export function isLiveStreamSupported(): boolean {
+  return process.platform !== "win32";
+}
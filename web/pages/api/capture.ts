@@ -3,6 +3,11 @@ import { spawn, ChildProcess } from "child_process";
 import path from "path";
 import fs from "fs";
 import { registerCapture, removeCapture } from "../../lib/captureStore";
+import { isDaemonAvailable, sendDaemonCommand } from "../../lib/daemonClient";
+import {
+  getLiveSocketPath,
+  isLiveStreamSupported,
+} from "../../lib/liveStream";
 
 type Data = {
   success: boolean;
@@ -49,6 +54,12 @@ export default async function handler(
     promiscuous,
   });
 
+  // Prefer a running capture daemon: no process spawn, warm pcap handles
+  if (isDaemonAvailable()) {
+    await captureViaDaemon(res, { output, iface, filter, duration, promiscuous });
+    return;
+  }
+
   // Determine repository root and executable candidates
   const repoRoot = path.resolve(process.cwd(), "..");
   console.log("[API] Repo root:", repoRoot);
@@ -120,6 +131,9 @@ export default async function handler(
       promiscuousMode,
       stopFilePath,
     ];
+    if (isLiveStreamSupported()) {
+      args.push("--stream", getLiveSocketPath(output));
+    }
     console.log("[API] Spawning sniffer with args:", args);
 
     // Wrap spawn in a Promise to properly await completion
@@ -234,3 +248,61 @@ export default async function handler(
       .json({ success: false, message: err.message || String(err) });
   }
 }
+
+type CaptureParams = {
+  output: string;
+  iface: string;
+  filter: string;
+  duration: number;
+  promiscuous: string;
+};
+
+async function captureViaDaemon(
+  res: NextApiResponse<Data>,
+  params: CaptureParams
+) {
+  const publicDir = path.join(process.cwd(), "public");
+  if (!fs.existsSync(publicDir)) {
+    fs.mkdirSync(publicDir, { recursive: true });
+  }
+  const outPath = path.join(publicDir, params.output);
+
+  try {
+    const started = await sendDaemonCommand({
+      cmd: "start",
+      id: params.output,
+      output: outPath,
+      interface: params.iface || "auto",
+      filter: params.filter || "both",
+      duration: Number(params.duration) || 0,
+      promiscuous: params.promiscuous === "off" ? "off" : "on",
+      stream: getLiveSocketPath(params.output),
+    });
+    console.log("[API] Daemon start response:", started);
+    if (!started.ok) {
+      res.status(500).json({ success: false, message: started.error });
+      return;
+    }
+
+    // Resolves when the capture ends (duration elapsed or /api/stop-capture)
+    const finished = await sendDaemonCommand(
+      { cmd: "wait", id: params.output },
+      0
+    );
+    console.log("[API] Daemon wait response:", finished);
+    if (!finished.ok) {
+      res.status(500).json({
+        success: false,
+        message: finished.error || "Capture failed",
+      });
+      return;
+    }
+
+    res.status(200).json({ success: true, message: `/${params.output}` });
+  } catch (err: any) {
+    console.error("[API] Daemon error:", err);
+    res
+      .status(500)
+      .json({ success: false, message: err.message || String(err) });
+  }
+}
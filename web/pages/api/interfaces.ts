@@ -2,6 +2,7 @@ import type { NextApiRequest, NextApiResponse } from "next";
 import { spawn } from "child_process";
 import path from "path";
 import fs from "fs";
+import { isDaemonAvailable, sendDaemonCommand } from "../../lib/daemonClient";
 
 type Interface = {
   id: string;
@@ -29,6 +30,18 @@ export default async function handler(
     return;
   }
 
+  if (isDaemonAvailable()) {
+    try {
+      const result = (await sendDaemonCommand({
+        cmd: "interfaces",
+      })) as unknown as Data;
+      res.status(result.success ? 200 : 500).json(result);
+      return;
+    } catch (err) {
+      console.error("[API /interfaces] Daemon error, falling back:", err);
+    }
+  }
+
   // Find the executable
   const repoRoot = path.resolve(process.cwd(), "..");
   const exeBase = "NetworkPacketAnalyzer";
@@ -0,0 +1,84 @@
+import type { NextApiRequest, NextApiResponse } from "next";
+import net from "net";
+import { getLiveSocketPath, isLiveStreamSupported } from "../../lib/liveStream";
+
+// Relays the sniffer's live stream socket to the browser as Server-Sent
+// Events. Each newline-delimited JSON message becomes one SSE "data:" frame.
+
+export const config = {
+  api: {
+    responseLimit: false,
+  },
+};
+
+const CONNECT_RETRY_MS = 250;
+const CONNECT_ATTEMPTS = 40; // the capture may still be starting
+
+export default function handler(req: NextApiRequest, res: NextApiResponse) {
+  if (req.method !== "GET") {
+    res.status(405).json({ success: false, message: "Method not allowed" });
+    return;
+  }
+
+  const output = String(req.query.output || "packet_capture.csv");
+  if (!isLiveStreamSupported()) {
+    res
+      .status(501)
+      .json({ success: false, message: "Live stream not supported here" });
+    return;
+  }
+
+  res.writeHead(200, {
+    "Content-Type": "text/event-stream",
+    "Cache-Control": "no-cache, no-transform",
+    Connection: "keep-alive",
+  });
+
+  const socketPath = getLiveSocketPath(output);
+  let socket: net.Socket | null = null;
+  let closed = false;
+  let attempts = 0;
+  let buffer = "";
+
+  const finish = () => {
+    if (closed) return;
+    closed = true;
+    socket?.destroy();
+    res.end();
+  };
+
+  const connect = () => {
+    if (closed) return;
+    attempts++;
+    socket = net.createConnection(socketPath);
+
+    socket.on("data", (chunk) => {
+      buffer += chunk.toString();
+      let newline;
+      while ((newline = buffer.indexOf("\n")) >= 0) {
+        const line = buffer.slice(0, newline);
+        buffer = buffer.slice(newline + 1);
+        if (!line) continue;
+        res.write(`data: ${line}\n\n`);
+        if (line.includes('"type":"end"')) {
+          finish();
+          return;
+        }
+      }
+    });
+
+    socket.on("error", () => {
+      socket?.destroy();
+      if (attempts < CONNECT_ATTEMPTS && !closed) {
+        setTimeout(connect, CONNECT_RETRY_MS);
+      } else {
+        finish();
+      }
+    });
+
+    socket.on("end", finish);
+  };
+
+  req.on("close", finish);
+  connect();
+}
@@ -5,6 +5,7 @@ import {
   stopByKeyWithFallback,
   forceKillCapture,
 } from "../../lib/captureStore";
+import { isDaemonAvailable, sendDaemonCommand } from "../../lib/daemonClient";
 
 type Data = {
   success: boolean;
@@ -24,6 +25,20 @@ export default async function handler(
 
   try {
     const { output } = req.body || ({} as { output?: string });
+
+    if (isDaemonAvailable()) {
+      const response = await sendDaemonCommand(
+        output ? { cmd: "stop", id: output } : { cmd: "stop" }
+      );
+      res.status(200).json({
+        success: response.ok,
+        message: response.ok
+          ? `Stopped ${response.stopped ?? 0} capture(s)`
+          : response.error,
+      });
+      return;
+    }
+
     if (output) {
       const signaled = signalStop(output);
       if (signaled) {
@@ -10,6 +10,25 @@ type Interface = {
   isLoopback: boolean;
 };
 
+type LiveRow = {
+  ts: number;
+  version: number;
+  src: string;
+  dst: string;
+  protocol: string;
+  length: number;
+};
+
+type LiveStats = {
+  packets: number;
+  bytes: number;
+  totalPackets: number;
+  droppedRows: number;
+  protocols: Record<string, number>;
+};
+
+const MAX_LIVE_ROWS = 20;
+
 export default function Home() {
   const [iface, setIface] = useState("");
   const [output, setOutput] = useState("packet_capture.csv");
@@ -24,6 +43,9 @@ export default function Home() {
   const [loadingInterfaces, setLoadingInterfaces] = useState(false);
   const [captureStartTime, setCaptureStartTime] = useState<number | null>(null);
   const [elapsedTime, setElapsedTime] = useState(0);
+  const [liveStats, setLiveStats] = useState<LiveStats | null>(null);
+  const [liveRows, setLiveRows] = useState<LiveRow[]>([]);
+  const liveSourceRef = useRef<EventSource | null>(null);
 
   // Fetch available interfaces on component mount
   useEffect(() => {
@@ -66,6 +88,44 @@ export default function Home() {
     };
   }, [isLoading, captureStartTime]);
 
+  // Live rows and per-second stats relayed from the sniffer by /api/live
+  function openLiveStream(outputName: string) {
+    closeLiveStream();
+    setLiveStats(null);
+    setLiveRows([]);
+    if (typeof EventSource === "undefined") return;
+
+    const source = new EventSource(
+      "/api/live?output=" + encodeURIComponent(outputName)
+    );
+    source.onmessage = (event) => {
+      let message: any;
+      try {
+        message = JSON.parse(event.data);
+      } catch {
+        return;
+      }
+      if (message.type === "stats") {
+        setLiveStats(message);
+      } else if (message.type === "rows") {
+        setLiveRows((rows) =>
+          [...message.rows.slice().reverse(), ...rows].slice(0, MAX_LIVE_ROWS)
+        );
+      } else if (message.type === "end") {
+        closeLiveStream();
+      }
+    };
+    source.onerror = () => closeLiveStream();
+    liveSourceRef.current = source;
+  }
+
+  function closeLiveStream() {
+    liveSourceRef.current?.close();
+    liveSourceRef.current = null;
+  }
+
+  useEffect(() => closeLiveStream, []);
+
   async function startCapture(e: any) {
     e.preventDefault();
     setIsLoading(true);
@@ -73,6 +133,7 @@ export default function Home() {
     setDownloadUrl(null);
     setCaptureStartTime(Date.now());
     setElapsedTime(0);
+    openLiveStream(output);
 
     try {
       const res = await fetch("/api/capture", {
@@ -98,6 +159,7 @@ export default function Home() {
     } finally {
       setIsLoading(false);
       setCaptureStartTime(null);
+      closeLiveStream();
     }
   }
 
@@ -265,6 +327,48 @@ export default function Home() {
                   🛑 Stop Capture
                 </button>
               )}
+              {liveStats && (
+                <div style={{ marginTop: "10px", fontSize: "13px" }}>
+                  <p style={{ margin: "5px 0" }}>
+                    📈 {liveStats.packets} packets/s ·{" "}
+                    {(liveStats.bytes / 1024).toFixed(1)} KiB/s ·{" "}
+                    {liveStats.totalPackets} total
+                    {liveStats.droppedRows > 0 &&
+                      ` · ${liveStats.droppedRows} live rows skipped`}
+                  </p>
+                  <p style={{ margin: "5px 0", color: "#666" }}>
+                    {Object.entries(liveStats.protocols)
+                      .map(([name, count]) => `${name}: ${count}`)
+                      .join(" · ")}
+                  </p>
+                </div>
+              )}
+              {liveRows.length > 0 && (
+                <table style={{ fontSize: "12px", marginTop: "5px" }}>
+                  <thead>
+                    <tr>
+                      <th>Time</th>
+                      <th>IP</th>
+                      <th>Source</th>
+                      <th>Destination</th>
+                      <th>Protocol</th>
+                      <th>Length</th>
+                    </tr>
+                  </thead>
+                  <tbody>
+                    {liveRows.map((row, i) => (
+                      <tr key={`${row.ts}-${i}`}>
+                        <td>{row.ts.toFixed(3)}</td>
+                        <td>v{row.version}</td>
+                        <td>{row.src}</td>
+                        <td>{row.dst}</td>
+                        <td>{row.protocol}</td>
+                        <td>{row.length}</td>
+                      </tr>
+                    ))}
+                  </tbody>
+                </table>
+              )}
             </div>
           )}
         </div>